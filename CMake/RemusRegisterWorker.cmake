@@ -19,10 +19,14 @@
 #   [ INSTALL_PATH <path to install to> ]
 #   [ WORKER_FILE_EXT <> ]
 #   [ NO_INSTALL ]
+#   [ ZYGOTE ]
 #   [ FILE_TYPE  <type of requirements file> FILE_PATH  <path to requirements file> ]
 #   [ TAG <JSON data> ]
 #   [ ARGUMENTS <arg1> ... ]
 #   [ ENVIRONMENT <varName1> <varValue1> ... ]
+#   [ MAX_WORKERS <count> ]
+#   [ CPU_COST <cores> ]
+#   [ MEMORY_COST <megabytes> ]
 #   )
 #
 #
@@ -67,7 +71,7 @@
 # environment variables before executing the worker; and specifies that the
 # worker should be started with additional command line arguments. Note that
 # the first occurrence of "@SELF@" in any argument is converted into the
-# full path to the remus worker file (as identified by the WorkerFinder
+# full path to the remus worker file (as identified by the WorkerCatalog
 # class at run time, not at configure- or build-time).
 #
 # Finally, the TAG string should evaluate to valid JSON or be doubly-escaped
@@ -95,6 +99,15 @@
 #
 #NO_INSTALL allows you to generate build directory remus rw files
 #
+#MAX_WORKERS limits how many instances of the worker the WorkerFactory will
+#run at once. CPU_COST and MEMORY_COST declare the cores and megabytes of
+#memory a running worker uses, the WorkerFactory only launches a worker when
+#those costs fit in what is left of the capacity of the host.
+#
+#ZYGOTE marks the worker as being started once by the WorkerFactory, with
+#workers forked from that pre-initialized process on demand. The executable
+#has to call remus::worker::runZygote once it has initialized.
+#
 function(remus_register_mesh_worker workerTarget )
   #enable only the new parser for this function. Policies are scoped to the
   #function so we don't have to worry about this affecting the calling project
@@ -102,8 +115,8 @@ function(remus_register_mesh_worker workerTarget )
     cmake_policy(SET CMP0053 NEW)
   endif()
 
-  set(options NO_INSTALL)
-  set(oneValueArgs INPUT_TYPE OUTPUT_TYPE EXECUTABLE_NAME WORKER_NAME INSTALL_PATH WORKER_FILE_EXT FILE_TYPE FILE_PATH TAG)
+  set(options NO_INSTALL ZYGOTE)
+  set(oneValueArgs INPUT_TYPE OUTPUT_TYPE EXECUTABLE_NAME WORKER_NAME INSTALL_PATH WORKER_FILE_EXT FILE_TYPE FILE_PATH TAG MAX_WORKERS CPU_COST MEMORY_COST)
   set(multiValueArgs ARGUMENTS ENVIRONMENT)
   cmake_parse_arguments(R "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN} )
 
@@ -160,6 +173,26 @@ function(remus_register_mesh_worker workerTarget )
     \"Tag\":  ${R_TAG},")
   endif()
 
+  if(R_MAX_WORKERS)
+    set(extra_json "${extra_json}
+    \"MaxWorkerCount\":  ${R_MAX_WORKERS},")
+  endif()
+
+  if(R_CPU_COST)
+    set(extra_json "${extra_json}
+    \"CpuCost\":  ${R_CPU_COST},")
+  endif()
+
+  if(R_MEMORY_COST)
+    set(extra_json "${extra_json}
+    \"MemoryCost\":  ${R_MEMORY_COST},")
+  endif()
+
+  if(R_ZYGOTE)
+    set(extra_json "${extra_json}
+    \"Zygote\":  true,")
+  endif()
+
   if(R_ARGUMENTS)
     # Since "@SELF@" should be replaced at run-time, not
     # configure-time, we set SELF here so that @SELF@ -> @SELF@:
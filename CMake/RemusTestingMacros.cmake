@@ -84,10 +84,14 @@ endfunction()
 #   CONFIG_DIR <LocationToConfigureAt>
 #   FILE_EXT  <FileExtOfWorker>
 #   IS_FILE_BASED
+#   ZYGOTE
 #   [ WORKER_NAME <name> ]
 #   [ TAG <JSON data> ]
 #   [ ARGUMENTS <arg1> ... ]
 #   [ ENVIRONMENT <varName1> <varValue1> ... ]
+#   [ MAX_WORKERS <count> ]
+#   [ CPU_COST <cores> ]
+#   [ MEMORY_COST <megabytes> ]
 #   )
 #
 # IS_FILE_BASED will set the requirements to be file based, and specify
@@ -105,8 +109,8 @@ function(remus_register_unit_test_worker)
     cmake_policy(SET CMP0053 NEW)
   endif()
 
-  set(options IS_FILE_BASED)
-  set(oneValueArgs EXEC_NAME INPUT_TYPE OUTPUT_TYPE CONFIG_DIR FILE_EXT TAG WORKER_NAME)
+  set(options IS_FILE_BASED ZYGOTE)
+  set(oneValueArgs EXEC_NAME INPUT_TYPE OUTPUT_TYPE CONFIG_DIR FILE_EXT TAG WORKER_NAME MAX_WORKERS CPU_COST MEMORY_COST)
   set(multiValueArgs ARGUMENTS ENVIRONMENT)
   cmake_parse_arguments(R
     "${options}" "${oneValueArgs}" "${multiValueArgs}"
@@ -125,6 +129,26 @@ function(remus_register_unit_test_worker)
     \"Tag\":  ${R_TAG},")
   endif()
 
+  if(R_MAX_WORKERS)
+    set(extra_json "${extra_json}
+    \"MaxWorkerCount\":  ${R_MAX_WORKERS},")
+  endif()
+
+  if(R_CPU_COST)
+    set(extra_json "${extra_json}
+    \"CpuCost\":  ${R_CPU_COST},")
+  endif()
+
+  if(R_MEMORY_COST)
+    set(extra_json "${extra_json}
+    \"MemoryCost\":  ${R_MEMORY_COST},")
+  endif()
+
+  if(R_ZYGOTE)
+    set(extra_json "${extra_json}
+    \"Zygote\":  true,")
+  endif()
+
   if(R_ARGUMENTS)
     # Since "@SELF@" should be replaced at run-time, not
     # configure-time, we set SELF here so that @SELF@ -> @SELF@:
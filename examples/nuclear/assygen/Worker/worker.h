@@ -34,8 +34,10 @@ public:
 protected:
   void launchProcess(const AssygenInput& job);
   void cleanlyExit();
-  void jobFailed(const remus::worker::Job& job);
-  bool pollStatus(const remus::worker::Job& job);
+  void jobFailed(const remus::worker::Job& job, const std::string& reason);
+  bool pollStatus(const remus::worker::Job& job,
+                  const std::string& logFile,
+                  std::string& failure);
   remus::common::ExecuteProcess* Process;
 };
 
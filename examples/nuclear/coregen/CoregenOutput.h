@@ -24,9 +24,18 @@ public:
     :Valid(valid)
   {}
 
+  //the result holds the prefix, and the log of the process on a
+  //second line
   CoregenOutput(const remus::proto::JobResult& job, bool valid=true)
-    : Prefix(job.data()), Valid(valid)
-  {}
+    : Prefix(job.data()), LogFile(), Valid(valid)
+  {
+    const std::string::size_type split = this->Prefix.find('\n');
+    if(split != std::string::npos)
+    {
+      this->LogFile = this->Prefix.substr(split + 1);
+      this->Prefix.erase(split);
+    }
+  }
 
   CoregenOutput(std::string& prefix, bool valid=true)
     : Prefix(prefix), Valid(valid)
@@ -37,6 +46,11 @@ public:
     return Prefix;
   }
 
+  std::string const& getLogFile() const
+  {
+    return LogFile;
+  }
+
   bool isValid() const
   { return Valid; }
 
@@ -47,6 +61,7 @@ public:
   { return Prefix; }
 private:
   std::string Prefix;
+  std::string LogFile;
   bool Valid;
 };
 
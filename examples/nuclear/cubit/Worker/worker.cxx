@@ -20,6 +20,7 @@
 
 #include <remus/common/CompilerInformation.h>
 #include <remus/proto/JobStatus.h>
+#include <remus/worker/ProcessMonitor.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
 #define BOOST_FILESYSTEM_VERSION 3
@@ -55,25 +56,30 @@ void worker::meshJob()
 
   launchProcess(in);
 
-  if (!pollStatus(j))
+  //keep all the output of the process next to the input
+  const std::string logFile =
+    boost::filesystem::absolute(in.getInputFile() + ".log").string();
+
+  std::string failure;
+  if (!pollStatus(j, logFile, failure))
   {
-    this->jobFailed(j);
+    this->jobFailed(j, failure);
     return;
   }
 
   //Do it
   remus::proto::JobResult results = remus::proto::make_JobResult(j.id(),
-                                                           in.getInputFile());
+                                   in.getInputFile() + "\n" + logFile);
   this->returnResult(results);
 
   return;
 }
 
 //----------------------------------------------------------------------------
-void worker::jobFailed(const remus::worker::Job& job)
+void worker::jobFailed(const remus::worker::Job& job,
+                       const std::string& reason)
 {
-  remus::proto::JobStatus status(job.id(),remus::FAILED);
-  this->updateStatus(status);
+  this->sendJobFailure(job, reason);
 
   return;
 }
@@ -116,36 +122,22 @@ void worker::cleanlyExit()
 }
 
 //-----------------------------------------------------------------------------
-bool worker::pollStatus(const remus::worker::Job& job)
+bool worker::pollStatus(const remus::worker::Job& job,
+                        const std::string& logFile,
+                        std::string& failure)
 {
-  //loop on polling of the omicron process
-  typedef remus::common::ProcessPipe ProcessPipe;
-
-  //poll on STDOUT and STDERRR only
-  bool validExection=true;
-  remus::proto::JobStatus status(job.id(),remus::IN_PROGRESS);
-  while(this->Process->isAlive()&& validExection )
-  {
-    //poll till we have a data, waiting for-ever!
-    ProcessPipe data = this->Process->poll(-1);
-    if(data.type == ProcessPipe::STDOUT)
-    {
-      //we have something on the output pipe
-      remus::proto::JobProgress progress(data.text);
-      status.updateProgress(progress);
-      this->updateStatus(status);
-    }
-  }
+  //stream the output of the process into the progress of the job, with
+  //the full output spooled to the log file
+  remus::worker::ProcessMonitor monitor(*this, job);
+  monitor.logFile(logFile);
 
   //verify we exited normally, not segfault or numeric exception
-  validExection &= this->Process->exitedNormally();
-
-  if(!validExection)
+  if(!monitor.monitor(*this->Process))
   {//we call terminate to make sure we send the message to the server
     //that we have failed to mesh the input correctly
+    failure = monitor.tail() + "\nsee " + logFile;
     this->cleanlyExit();
     return false;
   }
   return true;
 }
-
@@ -12,6 +12,7 @@
 
 #include <remus/client/Client.h>
 
+#include <remus/proto/DirectTransport.h>
 #include <remus/proto/Message.h>
 #include <remus/proto/Response.h>
 
@@ -125,13 +126,22 @@ Client::retrieveRequirements( const remus::common::MeshIOType& meshtypes)
 remus::proto::Job
 Client::submitJob(const remus::proto::JobSubmission& submission)
 {
-  std::ostringstream buffer;
-  buffer << submission;
-
-  remus::proto::send_Message(submission.type(),
-                             remus::MAKE_MESH,
-                            buffer.str(),
-                            &this->Zmq->Server);
+  //when the server is in our process we hand it the submission itself,
+  //instead of serializing it
+  const bool direct =
+    remus::proto::is_DirectEndpoint(this->ConnectionInfo.endpoint());
+  const std::string data = direct ? remus::proto::to_DirectHandle(submission)
+                                  : remus::proto::to_string(submission);
+
+  const remus::proto::Message sent =
+      remus::proto::send_Message(submission.type(),
+                                 remus::MAKE_MESH,
+                                 data,
+                                 &this->Zmq->Server);
+  if(direct && !sent.isValid())
+    { //the submission never left, so take it back from the direct transport
+    remus::proto::release_DirectHandle(data);
+    }
 
   remus::proto::Response response =
       remus::proto::receive_Response(&this->Zmq->Server);
@@ -162,8 +172,9 @@ remus::proto::JobResult Client::retrieveResults(const remus::proto::Job& job)
 
   remus::proto::Response response =
       remus::proto::receive_Response(&this->Zmq->Server);
-  const std::string result(response.data(), response.dataSize());
-  return remus::proto::to_JobResult(result);
+  //a server in our process hands us the result itself
+  return remus::proto::to_JobResult(response.data(), response.dataSize(),
+         remus::proto::is_DirectEndpoint(this->ConnectionInfo.endpoint()));
 }
 
 //------------------------------------------------------------------------------
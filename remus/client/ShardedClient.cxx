@@ -0,0 +1,425 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/client/ShardedClient.h>
+
+#include <remus/common/Timer.h>
+#include <remus/proto/QueueSummary.h>
+#include <remus/proto/Message.h>
+#include <remus/proto/Response.h>
+#include <remus/proto/zmqHelper.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace
+{
+//the number of points each server has on the hash ring, so that the
+//submissions are spread evenly over the servers
+const std::size_t virtualNodesPerServer = 64;
+
+//------------------------------------------------------------------------------
+//64 bit FNV-1a, which is stable across platforms and runs so that the same
+//content always maps to the same server
+boost::uint64_t fingerprint(const std::string& data)
+{
+  boost::uint64_t hash = 14695981039346656037ULL;
+  for(std::string::size_type i=0; i < data.size(); ++i)
+    {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+}
+
+namespace remus{
+namespace client{
+
+namespace detail{
+struct ShardManagement
+{
+  typedef std::pair<boost::uint64_t, std::size_t> RingPoint;
+
+  ShardManagement(const remus::client::ShardedServerConnection& conn);
+
+  //the server on the hash ring that owns the content of the submission
+  std::size_t byContent(const remus::proto::JobSubmission& submission) const;
+
+  //the server that can start a job with the requirements soonest, using
+  //the last probes of the servers. Returns the number of servers if none
+  //of them answered the probes
+  std::size_t leastLoaded(const remus::proto::JobRequirements& reqs) const;
+
+  //ask every server for its queue summary, measuring how long it takes
+  //them to answer
+  void probe(boost::int64_t timeout);
+
+  std::vector< boost::shared_ptr<remus::client::Client> > Clients;
+  std::vector< boost::shared_ptr<zmq::socket_t> > Probes;
+
+  //the last probe of each server, where servers that didn't answer have
+  //a negative latency
+  std::vector< remus::proto::QueueSummary > Summaries;
+  std::vector< boost::int64_t > Latencies;
+  bool HaveProbed;
+  remus::common::Timer SinceProbe;
+
+  std::vector< RingPoint > Ring;
+  std::map< boost::uuids::uuid, std::size_t > Owners;
+};
+
+//------------------------------------------------------------------------------
+ShardManagement::ShardManagement(
+                        const remus::client::ShardedServerConnection& conn):
+  Clients(),
+  Probes(),
+  Summaries(conn.size()),
+  Latencies(conn.size(), -1),
+  HaveProbed(false),
+  SinceProbe(),
+  Ring(),
+  Owners()
+{
+  const std::vector<remus::client::ServerConnection>& servers = conn.servers();
+  for(std::size_t i=0; i < servers.size(); ++i)
+    {
+    this->Clients.push_back(
+                      boost::make_shared<remus::client::Client>(servers[i]));
+
+    //probes don't wait on each other, so they get a socket of their own
+    boost::shared_ptr<zmq::socket_t> probe(
+                      new zmq::socket_t(*(servers[i].context()), ZMQ_DEALER));
+    zmq::set_socket_linger(*probe);
+    zmq::connectToAddress(*probe, servers[i].endpoint());
+    this->Probes.push_back(probe);
+
+    for(std::size_t v=0; v < virtualNodesPerServer; ++v)
+      {
+      const std::string point = servers[i].endpoint() + "#" +
+                                boost::lexical_cast<std::string>(v);
+      this->Ring.push_back(RingPoint(fingerprint(point), i));
+      }
+    }
+  std::sort(this->Ring.begin(), this->Ring.end());
+}
+
+//------------------------------------------------------------------------------
+std::size_t ShardManagement::byContent(
+                        const remus::proto::JobSubmission& submission) const
+{
+  if(this->Ring.empty())
+    {
+    return 0;
+    }
+
+  //the first point on the ring at or after the fingerprint owns it
+  const RingPoint key(fingerprint(remus::proto::to_string(submission)), 0);
+  std::vector< RingPoint >::const_iterator point =
+                std::lower_bound(this->Ring.begin(), this->Ring.end(), key);
+  if(point == this->Ring.end())
+    {
+    point = this->Ring.begin();
+    }
+  return point->second;
+}
+
+//------------------------------------------------------------------------------
+std::size_t ShardManagement::leastLoaded(
+                          const remus::proto::JobRequirements& reqs) const
+{
+  std::size_t best = this->Clients.size();
+  std::size_t bestWaiting = 0;
+  boost::int64_t bestLatency = 0;
+  for(std::size_t i=0; i < this->Clients.size(); ++i)
+    {
+    if(this->Latencies[i] < 0)
+      {
+      continue;
+      }
+
+    //the number of jobs, ours included, the server can't start right away
+    remus::proto::QueueSummary::const_iterator depth =
+                                                this->Summaries[i].find(reqs);
+    const remus::proto::QueueDepth ours = (depth != this->Summaries[i].end()) ?
+      remus::proto::QueueDepth(depth->second.Queued + 1, depth->second.Capacity) :
+      remus::proto::QueueDepth(1, 0);
+    const std::size_t waiting = ours.excess();
+
+    if(best == this->Clients.size() || waiting < bestWaiting ||
+       (waiting == bestWaiting && this->Latencies[i] < bestLatency))
+      {
+      best = i;
+      bestWaiting = waiting;
+      bestLatency = this->Latencies[i];
+      }
+    }
+  return best;
+}
+
+//------------------------------------------------------------------------------
+void ShardManagement::probe(boost::int64_t timeout)
+{
+  //an empty endpoint tells the server we are probing it, instead of being
+  //a peer server that wants to exchange jobs
+  const std::string request("\n");
+
+  std::vector<zmq::pollitem_t> items;
+  for(std::size_t i=0; i < this->Probes.size(); ++i)
+    {
+    zmq::socket_t& socket = *this->Probes[i];
+
+    //throw away the answers to probes that timed out
+    zmq::pollitem_t item = { socket, 0, ZMQ_POLLIN, 0 };
+    while(zmq::poll(&item, 1, 0) > 0 && (item.revents & ZMQ_POLLIN))
+      {
+      remus::proto::receive_Response(&socket);
+      }
+
+    remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                                          remus::QUEUE_SUMMARY,
+                                          request,
+                                          &socket);
+    this->Latencies[i] = -1;
+    items.push_back(item);
+    }
+
+  //gather the answers while they arrive, so that every server is only
+  //waited on until the timeout
+  std::size_t answered = 0;
+  remus::common::Timer timer;
+  while(answered < items.size() && timer.elapsed() < timeout)
+    {
+    const long remaining = static_cast<long>(timeout - timer.elapsed());
+    zmq::poll(&items[0], static_cast<int>(items.size()),
+              std::max(remaining, 0L));
+    for(std::size_t i=0; i < items.size(); ++i)
+      {
+      if(this->Latencies[i] < 0 && (items[i].revents & ZMQ_POLLIN))
+        {
+        const remus::proto::Response response =
+                        remus::proto::receive_Response(this->Probes[i].get());
+        this->Latencies[i] = timer.elapsed();
+        this->Summaries[i] = remus::proto::to_QueueSummary(
+                        std::string(response.data(), response.dataSize()));
+        ++answered;
+        }
+      }
+    }
+
+  this->HaveProbed = true;
+  this->SinceProbe.reset();
+}
+
+}
+
+//------------------------------------------------------------------------------
+ShardedClient::ShardedClient(const remus::client::ShardedServerConnection& conn):
+  ConnectionInfo(conn),
+  Shards( new detail::ShardManagement(conn) )
+{
+}
+
+//------------------------------------------------------------------------------
+ShardedClient::~ShardedClient()
+{
+}
+
+//------------------------------------------------------------------------------
+const remus::client::ShardedServerConnection& ShardedClient::connection() const
+{
+  return this->ConnectionInfo;
+}
+
+//------------------------------------------------------------------------------
+remus::common::MeshIOTypeSet ShardedClient::supportedIOTypes()
+{
+  remus::common::MeshIOTypeSet supportedTypes;
+  for(std::size_t i=0; i < this->Shards->Clients.size(); ++i)
+    {
+    const remus::common::MeshIOTypeSet types =
+                                  this->Shards->Clients[i]->supportedIOTypes();
+    supportedTypes.insert(types.begin(), types.end());
+    }
+  return supportedTypes;
+}
+
+//------------------------------------------------------------------------------
+bool ShardedClient::canMesh(const remus::common::MeshIOType& meshtypes)
+{
+  for(std::size_t i=0; i < this->Shards->Clients.size(); ++i)
+    {
+    if(this->Shards->Clients[i]->canMesh(meshtypes))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+bool ShardedClient::canMesh(const remus::proto::JobRequirements& reqs)
+{
+  for(std::size_t i=0; i < this->Shards->Clients.size(); ++i)
+    {
+    if(this->Shards->Clients[i]->canMesh(reqs))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobRequirementsSet
+ShardedClient::retrieveRequirements( const remus::common::MeshIOType& meshtypes)
+{
+  remus::proto::JobRequirementsSet set;
+  for(std::size_t i=0; i < this->Shards->Clients.size(); ++i)
+    {
+    const remus::proto::JobRequirementsSet reqs =
+                      this->Shards->Clients[i]->retrieveRequirements(meshtypes);
+    set.insert(reqs.begin(), reqs.end());
+    }
+  return set;
+}
+
+//------------------------------------------------------------------------------
+std::size_t ShardedClient::serverFor(
+                              const remus::proto::JobSubmission& submission)
+{
+  if(this->ConnectionInfo.policy() == ShardedServerConnection::LeastLoaded)
+    {
+    if(!this->Shards->HaveProbed ||
+       this->Shards->SinceProbe.elapsed() >= this->ConnectionInfo.probeInterval())
+      {
+      this->Shards->probe(this->ConnectionInfo.probeTimeout());
+      }
+    const std::size_t server =
+                      this->Shards->leastLoaded(submission.requirements());
+    if(server < this->Shards->Clients.size())
+      {
+      return server;
+      }
+    //no server answered, so fall back to placing the job by content
+    }
+  return this->Shards->byContent(submission);
+}
+
+//------------------------------------------------------------------------------
+remus::proto::Job
+ShardedClient::submitJob(const remus::proto::JobSubmission& submission)
+{
+  const std::size_t server = this->serverFor(submission);
+  if(server >= this->Shards->Clients.size())
+    {
+    return remus::proto::Job(boost::uuids::uuid(), submission.type());
+    }
+
+  const remus::proto::Job job =
+                      this->Shards->Clients[server]->submitJob(submission);
+  if(job.valid())
+    {
+    this->Shards->Owners[job.id()] = server;
+
+    //until the next probe count the job as queued on the server, so that
+    //submissions in between probes are spread as well
+    if(this->Shards->HaveProbed)
+      {
+      ++this->Shards->Summaries[server][submission.requirements()].Queued;
+      }
+    }
+  return job;
+}
+
+//------------------------------------------------------------------------------
+std::size_t ShardedClient::ownerOf(const remus::proto::Job& job) const
+{
+  std::map< boost::uuids::uuid, std::size_t >::const_iterator owner =
+                                          this->Shards->Owners.find(job.id());
+  return (owner != this->Shards->Owners.end()) ? owner->second :
+                                                 this->Shards->Clients.size();
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobStatus ShardedClient::jobStatus(const remus::proto::Job& job)
+{
+  const std::size_t owner = this->ownerOf(job);
+  if(owner < this->Shards->Clients.size())
+    {
+    return this->Shards->Clients[owner]->jobStatus(job);
+    }
+
+  //we don't know who owns the job, so look for a server that knows it
+  for(std::size_t i=0; i < this->Shards->Clients.size(); ++i)
+    {
+    const remus::proto::JobStatus status =
+                                    this->Shards->Clients[i]->jobStatus(job);
+    if(!status.invalid())
+      {
+      this->Shards->Owners[job.id()] = i;
+      return status;
+      }
+    }
+  return remus::proto::JobStatus(job.id(), remus::INVALID_STATUS);
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobResult ShardedClient::retrieveResults(const remus::proto::Job& job)
+{
+  std::size_t owner = this->ownerOf(job);
+  if(owner >= this->Shards->Clients.size())
+    {
+    this->jobStatus(job);
+    owner = this->ownerOf(job);
+    }
+  if(owner >= this->Shards->Clients.size())
+    {
+    return remus::proto::JobResult(job.id());
+    }
+
+  const remus::proto::JobResult result =
+                              this->Shards->Clients[owner]->retrieveResults(job);
+  if(result.valid())
+    { //the server forgets the job once the result is retrieved
+    this->Shards->Owners.erase(job.id());
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobStatus ShardedClient::terminate(const remus::proto::Job& job)
+{
+  std::size_t owner = this->ownerOf(job);
+  if(owner >= this->Shards->Clients.size())
+    {
+    this->jobStatus(job);
+    owner = this->ownerOf(job);
+    }
+  if(owner >= this->Shards->Clients.size())
+    {
+    return remus::proto::JobStatus(job.id(), remus::INVALID_STATUS);
+    }
+
+  this->Shards->Owners.erase(job.id());
+  return this->Shards->Clients[owner]->terminate(job);
+}
+
+}
+}
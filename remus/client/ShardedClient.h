@@ -0,0 +1,110 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_client_ShardedClient_h
+#define remus_client_ShardedClient_h
+
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/scoped_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <remus/client/Client.h>
+#include <remus/client/ShardedServerConnection.h>
+
+//included for export symbols
+#include <remus/client/ClientExports.h>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+//The sharded client submits meshing jobs to a collection of remus servers,
+//so that jobs can be spread over multiple servers without a separate load
+//balancer. Which server a job is submitted to is decided by the policy of
+//the ShardedServerConnection. The client remembers the server that owns
+//each job it submitted, so that querying the status, retrieving the
+//results and terminating a job talk to the right server.
+namespace remus{
+namespace client{
+
+namespace detail { struct ShardManagement; }
+
+class REMUSCLIENT_EXPORT ShardedClient
+{
+public:
+  //connect to all servers of the sharded connection
+  explicit ShardedClient(const remus::client::ShardedServerConnection& conn);
+
+  //explicit destructor since we use the pimpl idiom
+  ~ShardedClient();
+
+  //return the connection info that was used to connect to the
+  //remus servers
+  const remus::client::ShardedServerConnection& connection() const;
+
+  //the MeshIOTypes supported by any of the servers
+  remus::common::MeshIOTypeSet supportedIOTypes();
+
+  //returns true if any of the servers supports the mesh types
+  bool canMesh(const remus::common::MeshIOType& meshtypes);
+
+  //returns true if any of the servers supports the exact requirements
+  bool canMesh(const remus::proto::JobRequirements& requirements);
+
+  //the JobRequirements of all servers that support the mesh types
+  remus::proto::JobRequirementsSet
+  retrieveRequirements( const remus::common::MeshIOType& meshtypes );
+
+  //Submit a job to the server chosen by the policy of the connection
+  remus::proto::Job submitJob(const remus::proto::JobSubmission& submission);
+
+  //the index of the server the policy of the connection chooses for the
+  //submission, without submitting it
+  std::size_t serverFor(const remus::proto::JobSubmission& submission);
+
+  //the index of the server that owns the job. Returns the number of
+  //servers for jobs we didn't submit, or whose results we retrieved
+  std::size_t ownerOf(const remus::proto::Job& job) const;
+
+  //Given a remus Job object returns the status of the job, asking every
+  //server for jobs we don't know the owner of
+  remus::proto::JobStatus jobStatus(const remus::proto::Job& job);
+
+  //Return job result of of a give job, after which we forget the owner
+  //of the job
+  remus::proto::JobResult retrieveResults(const remus::proto::Job& job);
+
+  //attempts to terminate a given job on the server that owns it, after
+  //which we forget the owner of the job
+  remus::proto::JobStatus terminate(const remus::proto::Job& job);
+
+protected:
+  remus::client::ShardedServerConnection ConnectionInfo;
+private:
+  //explicitly state the client doesn't support copy or move semantics
+  ShardedClient(const ShardedClient&);
+  void operator=(const ShardedClient&);
+
+  boost::scoped_ptr<detail::ShardManagement> Shards;
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/client/ShardedServerConnection.h>
+
+namespace remus{
+namespace client{
+
+//------------------------------------------------------------------------------
+ShardedServerConnection::ShardedServerConnection():
+  Servers(),
+  SelectionPolicy(ContentHash),
+  ProbeInterval(250),
+  ProbeTimeout(1000)
+{
+}
+
+//------------------------------------------------------------------------------
+ShardedServerConnection::ShardedServerConnection(
+                    const std::vector<remus::client::ServerConnection>& servers,
+                    Policy policy):
+  Servers(servers),
+  SelectionPolicy(policy),
+  ProbeInterval(250),
+  ProbeTimeout(1000)
+{
+}
+
+//------------------------------------------------------------------------------
+void ShardedServerConnection::add(const remus::client::ServerConnection& server)
+{
+  this->Servers.push_back(server);
+}
+
+//------------------------------------------------------------------------------
+void ShardedServerConnection::context(boost::shared_ptr<zmq::context_t> c)
+{
+  typedef std::vector<remus::client::ServerConnection>::iterator it;
+  for(it i = this->Servers.begin(); i != this->Servers.end(); ++i)
+    {
+    i->context(c);
+    }
+}
+
+//------------------------------------------------------------------------------
+remus::client::ShardedServerConnection make_ShardedServerConnection(
+                                    const std::string& dests,
+                                    ShardedServerConnection::Policy policy)
+{
+  ShardedServerConnection connection;
+  connection.policy(policy);
+
+  std::string::size_type start = 0;
+  while(start < dests.size())
+    {
+    std::string::size_type end = dests.find(',', start);
+    if(end == std::string::npos)
+      {
+      end = dests.size();
+      }
+
+    //ignore the white space around each endpoint
+    const std::string::size_type first =
+                              dests.find_first_not_of(" \t", start);
+    if(first != std::string::npos && first < end)
+      {
+      const std::string::size_type last =
+                              dests.find_last_not_of(" \t", end - 1);
+      connection.add(remus::client::make_ServerConnection(
+                              dests.substr(first, last - first + 1)));
+      }
+    start = end + 1;
+    }
+  return connection;
+}
+
+}
+}
@@ -0,0 +1,105 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_client_ShardedServerConnection_h
+#define remus_client_ShardedServerConnection_h
+
+#include <remus/client/ServerConnection.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <string>
+#include <vector>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace client{
+
+//A connection to a collection of remus servers, used by the ShardedClient
+//to spread job submissions over those servers. The policy decides which
+//server a submission goes to:
+//
+// ContentHash places submissions on a consistent hash ring by a fingerprint
+// of their content, so that duplicate submissions land on the same server,
+// and adding a server only moves a fraction of the submissions.
+//
+// LeastLoaded probes the queue depth and latency of every server, and
+// sends the submission to the server that can start it soonest.
+class REMUSCLIENT_EXPORT ShardedServerConnection
+{
+public:
+  enum Policy {ContentHash, LeastLoaded};
+
+  //create a connection without any servers
+  ShardedServerConnection();
+
+  //create a connection to the given servers
+  explicit ShardedServerConnection(
+                        const std::vector<remus::client::ServerConnection>& servers,
+                        Policy policy = ContentHash);
+
+  //add a server to the collection
+  void add(const remus::client::ServerConnection& server);
+
+  const std::vector<remus::client::ServerConnection>& servers() const
+    { return this->Servers; }
+  std::size_t size() const { return this->Servers.size(); }
+
+  Policy policy() const { return this->SelectionPolicy; }
+  void policy(Policy p) { this->SelectionPolicy = p; }
+
+  //the time in milliseconds the probes of the LeastLoaded policy are
+  //reused for, instead of probing the servers on every submission.
+  //Defaults to 250.
+  boost::int64_t probeInterval() const { return this->ProbeInterval; }
+  void probeInterval(boost::int64_t millisec) { this->ProbeInterval = millisec; }
+
+  //the time in milliseconds we wait for servers to answer a probe. Servers
+  //that don't answer in time aren't sent submissions until they answer a
+  //later probe. Defaults to 1000.
+  boost::int64_t probeTimeout() const { return this->ProbeTimeout; }
+  void probeTimeout(boost::int64_t millisec) { this->ProbeTimeout = millisec; }
+
+  //have all servers use the same context, which is required to connect
+  //to servers through inproc endpoints
+  void context(boost::shared_ptr<zmq::context_t> c);
+
+private:
+  std::vector<remus::client::ServerConnection> Servers;
+  Policy SelectionPolicy;
+  boost::int64_t ProbeInterval;
+  boost::int64_t ProbeTimeout;
+};
+
+//convert a comma separated list of endpoints in the form of
+//proto://hostname:port into a sharded server connection. Endpoints we fail
+//to parse connect to the default server, like make_ServerConnection
+REMUSCLIENT_EXPORT
+remus::client::ShardedServerConnection make_ShardedServerConnection(
+                          const std::string& dests,
+                          ShardedServerConnection::Policy policy =
+                                        ShardedServerConnection::ContentHash);
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
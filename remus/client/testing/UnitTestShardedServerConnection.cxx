@@ -0,0 +1,67 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/client/ShardedServerConnection.h>
+#include <remus/testing/Testing.h>
+
+#include <string>
+
+int UnitTestShardedServerConnection(int, char *[])
+{
+  using remus::client::ShardedServerConnection;
+
+  ShardedServerConnection empty;
+  REMUS_ASSERT( (empty.size() == 0) );
+  REMUS_ASSERT( (empty.policy() == ShardedServerConnection::ContentHash) );
+
+  //the endpoints are separated by commas, and whitespace is ignored
+  ShardedServerConnection shards = remus::client::make_ShardedServerConnection(
+            "tcp://74.125.30.106:82, tcp://74.125.30.107:83,inproc://client",
+            ShardedServerConnection::LeastLoaded);
+  REMUS_ASSERT( (shards.size() == 3) );
+  REMUS_ASSERT( (shards.policy() == ShardedServerConnection::LeastLoaded) );
+  REMUS_ASSERT( (shards.servers()[0].endpoint() ==
+                 remus::client::make_ServerConnection(
+                                "tcp://74.125.30.106:82").endpoint()) );
+  REMUS_ASSERT( (shards.servers()[1].endpoint() ==
+                 remus::client::make_ServerConnection(
+                                "tcp://74.125.30.107:83").endpoint()) );
+  REMUS_ASSERT( (shards.servers()[2].endpoint() ==
+                 std::string("inproc://client")) );
+
+  //every server shares the context once it is set, which inproc requires
+  boost::shared_ptr<zmq::context_t> context =
+                                        remus::client::make_ServerContext();
+  shards.context(context);
+  for(std::size_t i=0; i < shards.size(); ++i)
+    {
+    REMUS_ASSERT( (shards.servers()[i].context() == context) );
+    }
+
+  shards.add(remus::client::ServerConnection());
+  REMUS_ASSERT( (shards.size() == 4) );
+
+  shards.policy(ShardedServerConnection::ContentHash);
+  REMUS_ASSERT( (shards.policy() == ShardedServerConnection::ContentHash) );
+
+  REMUS_ASSERT( (shards.probeInterval() == 250) );
+  REMUS_ASSERT( (shards.probeTimeout() == 1000) );
+  shards.probeInterval(10);
+  shards.probeTimeout(20);
+  REMUS_ASSERT( (shards.probeInterval() == 10) );
+  REMUS_ASSERT( (shards.probeTimeout() == 20) );
+
+  //empty entries are skipped
+  REMUS_ASSERT( (remus::client::make_ShardedServerConnection(
+                  "inproc://a,,inproc://b,").size() == 2) );
+  return 0;
+}
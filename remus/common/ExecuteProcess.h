@@ -106,6 +106,12 @@ public:
   void errPipeToFile(const std::string& filename)
   { return this->pipeToFile(ProcessPipe::STDERR, filename); }
 
+  //returns the process id of the launched process, or -1 if it hasn't
+  //been executed or the id isn't known on this platform. When multiple
+  //processes have been appended the id is only known on Linux when the
+  //launch created exactly one process.
+  int processId() const;
+
   //returns if the process is still alive
   bool isAlive();
 
@@ -31,7 +31,15 @@ namespace remus {
      ServiceTypeMacro(RETRIEVE_RESULT, 7, "RETRIEVE RESULT"), \
      ServiceTypeMacro(HEARTBEAT, 8, "HEARTBEAT"), \
      ServiceTypeMacro(TERMINATE_JOB, 9, "TERMINATE JOB"), \
-     ServiceTypeMacro(TERMINATE_WORKER, 10, "TERMINATE WORKER")
+     ServiceTypeMacro(TERMINATE_WORKER, 10, "TERMINATE WORKER"), \
+     ServiceTypeMacro(JOB_CREDITS, 11, "JOB CREDITS"), \
+     ServiceTypeMacro(JOB_BATCH, 12, "JOB BATCH"), \
+     ServiceTypeMacro(RETRIEVE_RESULT_BATCH, 13, "RETRIEVE RESULT BATCH"), \
+     ServiceTypeMacro(QUEUE_SUMMARY, 14, "QUEUE SUMMARY"), \
+     ServiceTypeMacro(FORWARD_JOBS, 15, "FORWARD JOBS"), \
+     ServiceTypeMacro(STEAL_JOBS, 16, "STEAL JOBS"), \
+     ServiceTypeMacro(FORWARDED_STATUS, 17, "FORWARDED STATUS"), \
+     ServiceTypeMacro(FORWARDED_RESULT, 18, "FORWARDED RESULT")
 
 
 //------------------------------------------------------------------------------
@@ -62,7 +70,7 @@ inline std::string to_string(remus::SERVICE_TYPE t)
 //------------------------------------------------------------------------------
 inline remus::SERVICE_TYPE to_serviceType(const std::string& t)
 {
-  for(int i=1; i<=10; i++)
+  for(int i=1; i<=18; i++)
     {
     remus::SERVICE_TYPE mt=static_cast<remus::SERVICE_TYPE>(i);
     if (remus::to_string(mt) == t)
@@ -0,0 +1,596 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace{
+
+//----------------------------------------------------------------------------
+double now()
+  {
+  struct timeval tv;
+  ::gettimeofday(&tv, NULL);
+  return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec)*1e-6;
+  }
+
+//----------------------------------------------------------------------------
+void closeDescriptor(int& fd)
+  {
+  if(fd >= 0)
+    {
+    ::close(fd);
+    fd = -1;
+    }
+  }
+
+//----------------------------------------------------------------------------
+//create a pipe whose descriptors aren't inherited by any process we spawn,
+//apart from the ones they are explicitly duplicated into
+bool makePipe(int fds[2])
+  {
+  if(::pipe2(fds, O_CLOEXEC) != 0)
+    {
+    fds[0] = fds[1] = -1;
+    return false;
+    }
+  return true;
+  }
+
+//----------------------------------------------------------------------------
+//the environment of the parent, with the given variables replaced or added
+std::vector<std::string> makeEnvironment(
+                      const std::map<std::string,std::string>& environment)
+  {
+  std::vector<std::string> result;
+  for(char** e = environ; e && *e; ++e)
+    {
+    const std::string entry(*e);
+    const std::string name = entry.substr(0, entry.find('='));
+    if(environment.count(name) == 0)
+      {
+      result.push_back(entry);
+      }
+    }
+  typedef std::map<std::string,std::string>::const_iterator EnvIt;
+  for(EnvIt i = environment.begin(); i != environment.end(); ++i)
+    {
+    result.push_back(i->first + "=" + i->second);
+    }
+  return result;
+  }
+
+//----------------------------------------------------------------------------
+//the null terminated array of pointers that the exec family expects
+std::vector<char*> makeArgv(std::vector<std::string>& strings)
+  {
+  std::vector<char*> result;
+  for(std::size_t i=0; i < strings.size(); ++i)
+    {
+    result.push_back(&strings[i][0]);
+    }
+  result.push_back(NULL);
+  return result;
+  }
+}
+
+namespace remus{
+namespace common{
+
+//----------------------------------------------------------------------------
+//Launches processes with posix_spawn. Unlike fork, posix_spawn doesn't copy
+//the page tables of the calling process (glibc uses clone with CLONE_VM and
+//CLONE_VFORK), so the time to launch a process doesn't grow with the memory
+//used by the caller. The pipes, environment and pipelines behave the same
+//as the RemusSysTools process layer.
+struct ExecuteProcess::Process
+{
+public:
+  enum State
+    {
+    Starting,
+    Error,
+    Exception,
+    Executing,
+    Exited,
+    Killed
+    };
+
+  bool Created;
+  State CurrentState;
+  bool WasKilled;
+
+  //indexed by ProcessPipe::PipeType
+  bool Shared[4];
+  std::string Files[4];
+  //the read end of the STDOUT and STDERR pipes
+  int Pipes[4];
+
+  std::vector<pid_t> Pids;
+  std::vector<int> Status;
+  std::vector<bool> Reaped;
+  char Buffer[1024];
+
+  Process():
+    Created(false),
+    CurrentState(Starting),
+    WasKilled(false),
+    Pids(),
+    Status(),
+    Reaped()
+    {
+    for(int i=0; i < 4; ++i)
+      {
+      this->Shared[i] = false;
+      this->Pipes[i] = -1;
+      }
+    this->Shared[ProcessPipe::STDIN] = true;
+    }
+
+  ~Process()
+    {
+    //same as RemusSysTools we wait for a running process to finish
+    if(this->CurrentState == Executing)
+      {
+      this->waitForExit(true);
+      }
+    for(int i=0; i < 4; ++i)
+      {
+      closeDescriptor(this->Pipes[i]);
+      }
+    }
+
+  void execute(const std::vector<ExecuteProcess::Command>& commands,
+               const std::map<std::string,std::string>& environment);
+  bool kill();
+  void sharePipeWithParent(ProcessPipe::PipeType pipe, bool choice);
+  void pipeToFile(ProcessPipe::PipeType pipe, const std::string& filename);
+  bool isAlive();
+  bool exitedNormally();
+  remus::common::ProcessPipe poll(double timeout);
+
+  int processId() const
+    { return this->Pids.empty() ? -1 : static_cast<int>(this->Pids.back()); }
+
+private:
+  int openFor(ProcessPipe::PipeType pipe, int pipeFds[2]);
+  void drainPipes();
+  bool reap(bool block);
+  bool waitForExit(bool block);
+};
+
+//-----------------------------------------------------------------------------
+//the descriptor the child should use for the given pipe, or -1 when the
+//child shares it with us
+int ExecuteProcess::Process::openFor(ProcessPipe::PipeType pipe, int pipeFds[2])
+{
+  pipeFds[0] = pipeFds[1] = -1;
+  const bool input = (pipe == ProcessPipe::STDIN);
+  if(!this->Files[pipe].empty())
+    {
+    const int flags = input ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+    return ::open(this->Files[pipe].c_str(), flags | O_CLOEXEC, 0644);
+    }
+  if(this->Shared[pipe])
+    {
+    return -1;
+    }
+  if(input)
+    {
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+
+  //output we read ourselves, the read end is non blocking so that we can
+  //drain it without waiting for the child
+  if(!makePipe(pipeFds))
+    {
+    return -1;
+    }
+  ::fcntl(pipeFds[0], F_SETFL, ::fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+  return pipeFds[1];
+}
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::execute(
+                  const std::vector<ExecuteProcess::Command>& commands,
+                  const std::map<std::string,std::string>& environment)
+{
+  if(this->CurrentState == Executing || commands.empty())
+    {
+    return;
+    }
+  this->Created = true;
+  this->WasKilled = false;
+  this->Pids.clear();
+  this->Status.clear();
+  this->Reaped.clear();
+  for(int i=0; i < 4; ++i)
+    {
+    closeDescriptor(this->Pipes[i]);
+    }
+
+  //build the environment in the child, instead of changing ours
+  std::vector<std::string> envStrings = makeEnvironment(environment);
+  std::vector<char*> envp = makeArgv(envStrings);
+
+  int outPipe[2], errPipe[2], unused[2];
+  int inFd = this->openFor(ProcessPipe::STDIN, unused);
+  int outFd = this->openFor(ProcessPipe::STDOUT, outPipe);
+  int errFd = this->openFor(ProcessPipe::STDERR, errPipe);
+
+  //children get the default SIGPIPE behavior and no blocked signals, no
+  //matter what the thread launching them has setup
+  posix_spawnattr_t attr;
+  ::posix_spawnattr_init(&attr);
+  sigset_t signals;
+  sigemptyset(&signals);
+  ::posix_spawnattr_setsigmask(&attr, &signals);
+  sigaddset(&signals, SIGPIPE);
+  ::posix_spawnattr_setsigdefault(&attr, &signals);
+  short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_USEVFORK
+  flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  ::posix_spawnattr_setflags(&attr, flags);
+
+  bool failed = false;
+  int prevRead = -1;
+  for(std::size_t i=0; i < commands.size() && !failed; ++i)
+    {
+    const bool last = (i == commands.size() - 1);
+
+    //each process in the pipeline reads the output of the one before it
+    int link[2] = {-1, -1};
+    if(!last && !makePipe(link))
+      {
+      failed = true;
+      break;
+      }
+
+    posix_spawn_file_actions_t actions;
+    ::posix_spawn_file_actions_init(&actions);
+    const int stdinFd = (i == 0) ? inFd : prevRead;
+    const int stdoutFd = last ? outFd : link[1];
+    if(stdinFd >= 0)
+      {
+      ::posix_spawn_file_actions_adddup2(&actions, stdinFd, STDIN_FILENO);
+      }
+    if(stdoutFd >= 0)
+      {
+      ::posix_spawn_file_actions_adddup2(&actions, stdoutFd, STDOUT_FILENO);
+      }
+    if(errFd >= 0)
+      {
+      ::posix_spawn_file_actions_adddup2(&actions, errFd, STDERR_FILENO);
+      }
+
+    std::vector<std::string> argStrings(1, commands[i].Cmd);
+    argStrings.insert(argStrings.end(), commands[i].Args.begin(),
+                      commands[i].Args.end());
+    std::vector<char*> argv = makeArgv(argStrings);
+
+    pid_t pid = -1;
+    const int result = ::posix_spawnp(&pid, argv[0], &actions, &attr,
+                                      &argv[0], &envp[0]);
+    ::posix_spawn_file_actions_destroy(&actions);
+
+    closeDescriptor(prevRead);
+    closeDescriptor(link[1]);
+    prevRead = link[0];
+    if(result != 0)
+      {
+      failed = true;
+      break;
+      }
+    this->Pids.push_back(pid);
+    this->Status.push_back(0);
+    this->Reaped.push_back(false);
+    }
+  ::posix_spawnattr_destroy(&attr);
+
+  //the children have their own copies of the descriptors now
+  closeDescriptor(prevRead);
+  closeDescriptor(inFd);
+  closeDescriptor(outFd);
+  closeDescriptor(errFd);
+  this->Pipes[ProcessPipe::STDOUT] = outPipe[0];
+  this->Pipes[ProcessPipe::STDERR] = errPipe[0];
+
+  if(failed)
+    { //don't leave part of a pipeline running
+    for(std::size_t i=0; i < this->Pids.size(); ++i)
+      {
+      ::kill(this->Pids[i], SIGKILL);
+      ::waitpid(this->Pids[i], NULL, 0);
+      }
+    this->Pids.clear();
+    this->Status.clear();
+    this->Reaped.clear();
+    closeDescriptor(this->Pipes[ProcessPipe::STDOUT]);
+    closeDescriptor(this->Pipes[ProcessPipe::STDERR]);
+    this->CurrentState = Error;
+    return;
+    }
+  this->CurrentState = Executing;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::kill()
+{
+  if(this->Created && this->CurrentState == Executing)
+    {
+    for(std::size_t i=0; i < this->Pids.size(); ++i)
+      {
+      if(!this->Reaped[i])
+        {
+        ::kill(this->Pids[i], SIGKILL);
+        }
+      }
+    this->WasKilled = true;
+    this->waitForExit(true);
+    return true;
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::sharePipeWithParent(ProcessPipe::PipeType pipe,
+                                                  bool choice)
+{
+  if(pipe < ProcessPipe::STDIN || pipe > ProcessPipe::STDERR)
+    {
+    return;
+    }
+  this->Shared[pipe] = choice;
+  if(choice)
+    {
+    this->Files[pipe].clear();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::pipeToFile(ProcessPipe::PipeType pipe,
+                                         const std::string& filename)
+{
+  if(pipe < ProcessPipe::STDIN || pipe > ProcessPipe::STDERR)
+    {
+    return;
+    }
+  this->Files[pipe] = filename;
+  if(!filename.empty())
+    {
+    this->Shared[pipe] = false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//read and discard any output nobody polled for, so that a child is never
+//stuck writing to a full pipe
+void ExecuteProcess::Process::drainPipes()
+{
+  for(int i=ProcessPipe::STDOUT; i <= ProcessPipe::STDERR; ++i)
+    {
+    while(this->Pipes[i] >= 0)
+      {
+      const ssize_t got = ::read(this->Pipes[i], this->Buffer,
+                                 sizeof(this->Buffer));
+      if(got > 0)
+        {
+        continue;
+        }
+      if(got < 0 && errno == EINTR)
+        {
+        continue;
+        }
+      if(got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+        closeDescriptor(this->Pipes[i]);
+        }
+      break;
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//returns true once every process of the pipeline has been reaped
+bool ExecuteProcess::Process::reap(bool block)
+{
+  bool all = true;
+  for(std::size_t i=0; i < this->Pids.size(); ++i)
+    {
+    if(this->Reaped[i])
+      {
+      continue;
+      }
+    int status = 0;
+    pid_t r = -1;
+    do
+      {
+      r = ::waitpid(this->Pids[i], &status, block ? 0 : WNOHANG);
+      } while(r < 0 && errno == EINTR);
+
+    if(r == this->Pids[i])
+      {
+      this->Status[i] = status;
+      this->Reaped[i] = true;
+      }
+    else if(r < 0 && errno == ECHILD)
+      {
+      this->Reaped[i] = true;
+      }
+    else
+      {
+      all = false;
+      }
+    }
+  return all;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::waitForExit(bool block)
+{
+  if(this->CurrentState != Executing)
+    {
+    return true;
+    }
+
+  while(true)
+    {
+    this->drainPipes();
+    if(this->reap(false))
+      {
+      break;
+      }
+    if(!block)
+      {
+      return false;
+      }
+
+    //wait for output to drain or a short while before checking again
+    struct pollfd items[2];
+    int count = 0;
+    for(int i=ProcessPipe::STDOUT; i <= ProcessPipe::STDERR; ++i)
+      {
+      if(this->Pipes[i] >= 0)
+        {
+        items[count].fd = this->Pipes[i];
+        items[count].events = POLLIN;
+        items[count].revents = 0;
+        ++count;
+        }
+      }
+    ::poll(items, static_cast<nfds_t>(count), 1);
+    }
+
+  const int status = this->Status.back();
+  if(this->WasKilled)
+    {
+    this->CurrentState = Killed;
+    }
+  else if(WIFSIGNALED(status))
+    {
+    this->CurrentState = Exception;
+    }
+  else
+    {
+    this->CurrentState = Exited;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::isAlive()
+{
+  if(!this->Created)
+    {
+    //never was created can't be  alive
+    return false;
+    }
+  this->waitForExit(false);
+  return this->CurrentState == Executing;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::exitedNormally()
+{
+  if(!this->Created)
+    {
+    //never was created can't be  alive
+    return false;
+    }
+  this->waitForExit(false);
+  return this->CurrentState == Exited;
+}
+
+//-----------------------------------------------------------------------------
+remus::common::ProcessPipe ExecuteProcess::Process::poll(double timeout)
+{
+  //The timeout's unit of time is SECONDS. Zero means don't wait, and a
+  //negative value means wait until there is output
+  typedef remus::common::ProcessPipe PPipe;
+
+  if(!this->Created)
+    {
+    return PPipe(PPipe::None);
+    }
+
+  const double start = now();
+  while(true)
+    {
+    struct pollfd items[2];
+    PPipe::PipeType types[2];
+    int count = 0;
+    for(int i=PPipe::STDOUT; i <= PPipe::STDERR; ++i)
+      {
+      if(this->Pipes[i] >= 0)
+        {
+        items[count].fd = this->Pipes[i];
+        items[count].events = POLLIN;
+        items[count].revents = 0;
+        types[count] = static_cast<PPipe::PipeType>(i);
+        ++count;
+        }
+      }
+    if(count == 0)
+      {
+      return PPipe(PPipe::None);
+      }
+
+    int waitFor = -1;
+    if(timeout >= 0)
+      {
+      const double left = timeout - (now() - start);
+      waitFor = (left <= 0) ? 0 : static_cast<int>(left * 1000);
+      }
+
+    const int ready = ::poll(items, static_cast<nfds_t>(count), waitFor);
+    if(ready < 0 && errno == EINTR)
+      {
+      continue;
+      }
+    if(ready <= 0)
+      {
+      return PPipe(PPipe::Timeout);
+      }
+
+    for(int i=0; i < count; ++i)
+      {
+      if(items[i].revents == 0)
+        {
+        continue;
+        }
+      const ssize_t got = ::read(items[i].fd, this->Buffer,
+                                 sizeof(this->Buffer));
+      if(got > 0)
+        {
+        PPipe result(types[i]);
+        result.text = std::string(this->Buffer, static_cast<std::size_t>(got));
+        return result;
+        }
+      if(got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        { //the child closed its end
+        closeDescriptor(this->Pipes[types[i]]);
+        }
+      }
+    }
+}
+
+}
+}
@@ -0,0 +1,333 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <RemusSysTools/Process.h>
+
+#include <stdlib.h>
+
+#ifdef __linux__
+# include <fstream>
+# include <set>
+# include <sstream>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace{
+
+remus::common::ProcessPipe::PipeType toProcessPipeType(int type)
+  {
+  typedef remus::common::ProcessPipe PPipe;
+  typedef remus::common::ProcessPipe::PipeType PipeType;
+
+  RemusSysToolsProcess_Pipes_e processType =
+      static_cast<RemusSysToolsProcess_Pipes_e>(type);
+  PipeType pipeType;
+  switch(processType)
+    {
+    case RemusSysToolsProcess_Pipe_STDIN:
+      pipeType = PPipe::STDIN;
+      break;
+    case RemusSysToolsProcess_Pipe_STDOUT:
+      pipeType = PPipe::STDOUT;
+      break;
+    case RemusSysToolsProcess_Pipe_STDERR:
+      pipeType = PPipe::STDERR;
+      break;
+    case RemusSysToolsProcess_Pipe_Timeout:
+      pipeType = PPipe::Timeout;
+      break;
+    case RemusSysToolsProcess_Pipe_None:
+    default:
+      pipeType = PPipe::None;
+      break;
+    }
+  return pipeType;
+  }
+
+int fromProcessPipeType(remus::common::ProcessPipe::PipeType type)
+  {
+  typedef remus::common::ProcessPipe PPipe;
+
+  RemusSysToolsProcess_Pipes_e pipeType;
+  switch(type)
+    {
+    case PPipe::STDIN:
+      pipeType = RemusSysToolsProcess_Pipe_STDIN;
+      break;
+    case PPipe::STDOUT:
+      pipeType = RemusSysToolsProcess_Pipe_STDOUT;
+      break;
+    case PPipe::STDERR:
+      pipeType = RemusSysToolsProcess_Pipe_STDERR;
+      break;
+    case PPipe::Timeout:
+      pipeType = RemusSysToolsProcess_Pipe_Timeout;
+      break;
+    case PPipe::None:
+    default:
+      pipeType = RemusSysToolsProcess_Pipe_None;
+      break;
+    }
+  return pipeType;
+  }
+
+#ifdef __linux__
+//the processes that have been started by the calling thread. RemusSysTools
+//doesn't tell us the id of the processes it launches, but they are children
+//of the thread that executed them. If the kernel doesn't provide the list
+//of children we return an empty set.
+std::set<int> threadChildren()
+  {
+  std::ostringstream path;
+  path << "/proc/self/task/" << ::syscall(SYS_gettid) << "/children";
+  std::ifstream f(path.str().c_str());
+
+  std::set<int> children;
+  int pid = 0;
+  while(f >> pid)
+    {
+    children.insert(pid);
+    }
+  return children;
+  }
+#endif
+}
+
+namespace remus{
+namespace common{
+
+//----------------------------------------------------------------------------
+//Launches processes with the RemusSysTools process layer, which forks the
+//calling process
+struct ExecuteProcess::Process
+{
+public:
+  RemusSysToolsProcess *Proc;
+  bool Created;
+  int Pid;
+  Process():Created(false),Pid(-1)
+    {
+    this->Proc = RemusSysToolsProcess_New();
+    }
+  ~Process()
+    {
+    if(this->Created)
+      {
+      RemusSysToolsProcess_Delete(this->Proc);
+      }
+
+    }
+
+  void execute(const std::vector<ExecuteProcess::Command>& commands,
+               const std::map<std::string,std::string>& environment);
+  bool kill();
+  void sharePipeWithParent(ProcessPipe::PipeType pipe, bool choice);
+  void pipeToFile(ProcessPipe::PipeType pipe, const std::string& filename);
+  bool isAlive();
+  bool exitedNormally();
+  remus::common::ProcessPipe poll(double timeout);
+
+  int processId() const { return this->Pid; }
+};
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::execute(
+                  const std::vector<ExecuteProcess::Command>& commands,
+                  const std::map<std::string,std::string>& environment)
+{
+  for (std::size_t cmdId=0;cmdId<commands.size();cmdId++)
+  {
+    //allocate array large enough for command str, args, and null entry
+    const std::size_t size(commands[cmdId].Args.size() + 2);
+    const char **cmds = new const char * [size];
+    cmds[0] = commands[cmdId].Cmd.c_str();
+    for(std::size_t i=0; i < commands[cmdId].Args.size();++i)
+    {
+      cmds[1 + i] = commands[cmdId].Args[i].c_str();
+    }
+    cmds[size-1]=NULL;
+
+    if (cmdId == 0)
+    {
+      RemusSysToolsProcess_SetCommand(this->Proc,cmds);
+    }
+    else
+    {
+      RemusSysToolsProcess_AddCommand(this->Proc,cmds);
+    }
+    delete[] cmds;
+  }
+
+  // For each requested environment variable, save
+  // the old value before setting the new one.
+  typedef std::map<std::string,std::string> envmap_t;
+  envmap_t TmpEnv;
+  for (envmap_t::const_iterator it = environment.begin(); it != environment.end(); ++it)
+    {
+    char* buf;
+#if !defined(_WIN32) || defined(__CYGWIN__)
+    buf = getenv(it->first.c_str());
+    if (buf && buf[0])
+      TmpEnv[it->first] = buf;
+    setenv(it->first.c_str(), it->second.c_str(), 1);
+#else
+    const bool valid = (_dupenv_s(&buf, NULL, it->first.c_str()) == 0) &&
+                       (buf != NULL);
+    if (valid)
+      TmpEnv[it->first] = buf;
+    _putenv_s(it->first.c_str(), it->second.c_str());
+#endif
+    }
+
+  RemusSysToolsProcess_SetOption(this->Proc,
+                            RemusSysToolsProcess_Option_HideWindow, true);
+
+#ifdef __linux__
+  const std::set<int> existingChildren = threadChildren();
+#endif
+
+  RemusSysToolsProcess_Execute(this->Proc);
+
+#ifdef __linux__
+  //the new child of this thread is the process we just launched
+  if(RemusSysToolsProcess_GetState(this->Proc) ==
+     RemusSysToolsProcess_State_Executing)
+    {
+    const std::set<int> children = threadChildren();
+    std::vector<int> launched;
+    for(std::set<int>::const_iterator i=children.begin(); i!=children.end(); ++i)
+      {
+      if(existingChildren.count(*i) == 0)
+        {
+        launched.push_back(*i);
+        }
+      }
+    this->Pid = (launched.size() == 1) ? launched[0] : -1;
+    }
+#endif
+
+  // Now that the process has been created, reset the environment.
+  for (envmap_t::const_iterator it = TmpEnv.begin(); it != TmpEnv.end(); ++it)
+    {
+#if !defined(_WIN32) || defined(__CYGWIN__)
+    setenv(it->first.c_str(), it->second.c_str(), 1);
+#else
+    _putenv_s(it->first.c_str(), it->second.c_str());
+#endif
+    }
+
+  this->Created = true;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::kill()
+{
+  if(this->Created &&
+     RemusSysToolsProcess_GetState(this->Proc) ==
+     RemusSysToolsProcess_State_Executing)
+    {
+    RemusSysToolsProcess_Kill( this->Proc );
+    RemusSysToolsProcess_WaitForExit(this->Proc, 0);
+    return true;
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::sharePipeWithParent(ProcessPipe::PipeType pipe,
+                                                  bool choice)
+{
+  RemusSysToolsProcess_SetPipeShared(this->Proc,
+                                     fromProcessPipeType(pipe),
+                                     choice);
+}
+
+//-----------------------------------------------------------------------------
+void ExecuteProcess::Process::pipeToFile(ProcessPipe::PipeType pipe,
+                                         const std::string& filename)
+{
+  RemusSysToolsProcess_SetPipeFile(this->Proc,
+                                   fromProcessPipeType(pipe),
+                                   filename.c_str());
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::isAlive()
+{
+  if(!this->Created)
+    {
+    //never was created can't be  alive
+    return false;
+    }
+  //poll just to see if the state has changed
+  double timeout = -1; //set to a negative number to poll
+  RemusSysToolsProcess_WaitForExit(this->Proc, &timeout);
+
+  int state = RemusSysToolsProcess_GetState(this->Proc);
+  return state == RemusSysToolsProcess_State_Executing;
+}
+
+//-----------------------------------------------------------------------------
+bool ExecuteProcess::Process::exitedNormally()
+{
+  if(!this->Created)
+    {
+    //never was created can't be  alive
+    return false;
+    }
+  //poll just to see if the state has changed
+  double timeout = -1; //set to a negative number to poll
+  RemusSysToolsProcess_WaitForExit(this->Proc, &timeout);
+
+  int state = RemusSysToolsProcess_GetState(this->Proc);
+  return (state == RemusSysToolsProcess_State_Exited);
+}
+
+//-----------------------------------------------------------------------------
+remus::common::ProcessPipe ExecuteProcess::Process::poll(double timeout)
+{
+  //The timeout's unit of time is SECONDS.
+
+  typedef remus::common::ProcessPipe PPipe;
+
+  if(!this->Created)
+    {
+    return PPipe(PPipe::None);
+    }
+
+  //convert our syntax for timout to the RemusSysTools version
+  //our negative values mean zero for sysToolProcess
+  //our zero value means a negative value
+  //other wise we are the same
+
+  //RemusSysTools currently doesn't have a block for inifinte time that acutally works
+  const double fakeInfiniteWait = 100000000;
+  double realTimeOut = (timeout == 0 ) ? -1 : ( timeout < 0) ? fakeInfiniteWait : timeout;
+
+  //poll sys tool for data
+  int length;
+  char* data;
+  int pipe = RemusSysToolsProcess_WaitForData(this->Proc,
+                                          &data,&length,&realTimeOut);
+  PPipe::PipeType type = toProcessPipeType(pipe);
+
+  PPipe result(type);
+  if(result.valid())
+    {
+    result.text = std::string(data,length);
+    }
+  return result;
+}
+
+}
+}
@@ -56,10 +56,20 @@ int main(int argc, char** argv)
       }
     else if( prog_type.find("CERR_OUTPUT") == 0)
       mode = 3;
+    else if( prog_type.find("ECHO_INPUT") == 0)
+      mode = 4;
     }
 
   //determine our behavior
-  if(mode == 0)
+  if(mode == 4)
+    { //copy standard in to standard out, used to test pipelines
+    std::string line;
+    while(std::getline(std::cin, line))
+      {
+      std::cout << line << std::endl;
+      }
+    }
+  else if(mode == 0)
     {
     remus::common::SleepForMillisec(500);
     }
@@ -30,18 +30,25 @@ int UnitTestExecuteProcess(int, char *[])
   //for now that will be a terminal / shell
   {
   std::cout << eapp.name << std::endl;
-  remus::common::ExecuteProcess example(eapp.name);
+  //without arguments the example exits right away, which a fast launch
+  //can observe before we check isAlive, so ask it to run until killed
+  std::vector< std::string > args;
+  args.push_back("NO_OUTPUT");
+  remus::common::ExecuteProcess example(eapp.name, args);
 
   //validate that isAlive and kill return the proper results before
   //we call execute
   REMUS_ASSERT(!example.isAlive());
   REMUS_ASSERT(!example.kill());
+  REMUS_ASSERT( (example.processId() == -1) );
 
   //start the process
   example.execute();
 
   //validate the program is running, and than terminate it
   REMUS_ASSERT(example.isAlive());
+  //the process id is -1 when it can't be determined, but never zero
+  REMUS_ASSERT( (example.processId() != 0) );
   REMUS_ASSERT(example.kill()); //kill
 
   //make sure the program terminated
@@ -168,5 +175,43 @@ int UnitTestExecuteProcess(int, char *[])
   REMUS_ASSERT(example.kill());
   }
 
+//==============================================================================
+//  Test a pipeline, where the output of each process is the input of the next
+//==============================================================================
+  {
+  //the first process only writes while it has REMUS_TEST in its environment
+  std::vector< std::string > args;
+  args.push_back("COUT_OUTPUT");
+  std::map< std::string, std::string > env;
+  env["REMUS_TEST"] = "TRUE";
+  remus::common::ExecuteProcess example(eapp.name, args, env);
+
+  std::vector< std::string > echoArgs;
+  echoArgs.push_back("ECHO_INPUT");
+  example.appendProcess(eapp.name, echoArgs);
+
+  example.execute();
+  REMUS_ASSERT(example.isAlive());
+
+  remus::common::ProcessPipe pollResult = example.poll(10);
+  REMUS_ASSERT(pollResult.valid());
+  REMUS_ASSERT( (pollResult.type == remus::common::ProcessPipe::STDOUT) );
+  REMUS_ASSERT( (pollResult.text.find("standard channel output") == 0) );
+
+  REMUS_ASSERT(example.kill());
+  REMUS_ASSERT(!example.isAlive());
+  }
+
+//==============================================================================
+//  Test launching a program that doesn't exist
+//==============================================================================
+  {
+  remus::common::ExecuteProcess example("/remus/no/such/executable");
+  example.execute();
+  REMUS_ASSERT(!example.isAlive());
+  REMUS_ASSERT(!example.exitedNormally());
+  REMUS_ASSERT(!example.kill());
+  }
+
   return 0;
 }
@@ -21,7 +21,7 @@
 int UnitTestServiceStatusTypes(int, char *[])
 {
   //verify all service types
- for(int i=1; i <=9; i++)
+ for(int i=1; i <=18; i++)
     {
     remus::SERVICE_TYPE mt=static_cast<remus::SERVICE_TYPE>(i);
     std::string service_str = remus::to_string(mt);
@@ -0,0 +1,407 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/proto/DirectTransport.h>
+
+#include <remus/proto/zmqTraits.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+
+namespace
+{
+//every handle starts with this prefix, followed by the object type and
+//the random token of the parked object
+const char handlePrefix[] = "remus-direct:";
+const std::size_t handlePrefixSize = sizeof(handlePrefix) - 1;
+const std::size_t handleSize = handlePrefixSize + 1 + 16;
+
+//the type of object a handle refers to, so that a handle can't be claimed
+//as the wrong type
+enum ObjectType
+{
+  SubmissionObject = 'S',
+  WorkerJobObject = 'W',
+  WorkerJobBatchObject = 'w',
+  ResultObject = 'R',
+  ResultBatchObject = 'r'
+};
+
+//------------------------------------------------------------------------------
+boost::int64_t now()
+{
+  using namespace std::chrono;
+  return static_cast<boost::int64_t>(
+    duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+class ParkedObjects
+{
+public:
+  ParkedObjects():
+    Mutex(),
+    Generator(),
+    Lifetime(60000),
+    Objects(),
+    ParkOrder()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  std::string park(ObjectType type, const boost::shared_ptr<void>& object)
+  {
+    const boost::int64_t parkedAt = now();
+    boost::uuids::uuid token;
+    {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    this->expire(parkedAt);
+
+    //the random generator draws from the operating system, so tokens
+    //can't be guessed from the tokens that came before them
+    token = this->Generator();
+    this->Objects[token] = Entry(type,object);
+    this->ParkOrder.push_back( std::make_pair(parkedAt, token) );
+    }
+
+    std::string handle(handlePrefix, handlePrefixSize);
+    handle += static_cast<char>(type);
+    handle.append(reinterpret_cast<const char*>(token.data), token.size());
+    return handle;
+  }
+
+  //----------------------------------------------------------------------------
+  boost::shared_ptr<void> claim(ObjectType type, const char* data,
+                                std::size_t size)
+  {
+    boost::shared_ptr<void> object;
+    boost::uuids::uuid token;
+    if(!this->parse(data, size, token) ||
+       data[handlePrefixSize] != static_cast<char>(type))
+      {
+      return object;
+      }
+
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    ObjectMap::iterator item = this->Objects.find(token);
+    if(item != this->Objects.end() && item->second.first == type)
+      {
+      object = item->second.second;
+      this->Objects.erase(item);
+      }
+    return object;
+  }
+
+  //----------------------------------------------------------------------------
+  bool release(const char* data, std::size_t size)
+  {
+    boost::uuids::uuid token;
+    if(!this->parse(data, size, token))
+      {
+      return false;
+      }
+
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    return this->Objects.erase(token) > 0;
+  }
+
+  //----------------------------------------------------------------------------
+  std::size_t size()
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    return this->Objects.size();
+  }
+
+  //----------------------------------------------------------------------------
+  void lifetime(boost::int64_t millisec)
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    this->Lifetime = millisec;
+  }
+
+  //----------------------------------------------------------------------------
+  boost::int64_t lifetime()
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    return this->Lifetime;
+  }
+
+private:
+  //----------------------------------------------------------------------------
+  bool parse(const char* data, std::size_t size, boost::uuids::uuid& token) const
+  {
+    if(size != handleSize ||
+       std::memcmp(data, handlePrefix, handlePrefixSize) != 0)
+      {
+      return false;
+      }
+    std::memcpy(token.data, data + handlePrefixSize + 1, token.size());
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  //drop the objects parked longer than the lifetime, requires the lock.
+  //Objects are parked in order, so only the expired ones are visited
+  void expire(boost::int64_t currentTime)
+  {
+    while(!this->ParkOrder.empty() &&
+          currentTime - this->ParkOrder.front().first > this->Lifetime)
+      {
+      //claimed objects are already gone, which erase ignores
+      this->Objects.erase(this->ParkOrder.front().second);
+      this->ParkOrder.pop_front();
+      }
+  }
+
+  typedef std::pair<ObjectType, boost::shared_ptr<void> > Entry;
+  typedef std::map<boost::uuids::uuid, Entry> ObjectMap;
+
+  boost::mutex Mutex;
+  boost::uuids::random_generator Generator;
+  boost::int64_t Lifetime;
+  ObjectMap Objects;
+  std::deque< std::pair<boost::int64_t, boost::uuids::uuid> > ParkOrder;
+};
+
+//------------------------------------------------------------------------------
+ParkedObjects& parked()
+{
+  static ParkedObjects objects;
+  return objects;
+}
+
+//------------------------------------------------------------------------------
+template<typename T>
+bool claim(ObjectType type, const char* data, std::size_t size, T& result)
+{
+  boost::shared_ptr<void> object = parked().claim(type, data, size);
+  if(!object)
+    {
+    return false;
+    }
+  result = *(boost::static_pointer_cast<T>(object));
+  return true;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobSubmission owningCopy(const remus::proto::JobSubmission& sub)
+{
+  remus::proto::JobSubmission copy(sub);
+  typedef remus::proto::JobSubmission::iterator it;
+  for(it i = copy.begin(); i != copy.end(); ++i)
+    {
+    i->second = i->second.owningCopy();
+    }
+  return copy;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::WorkerJob owningCopy(const remus::proto::WorkerJob& job)
+{
+  remus::proto::WorkerJob copy(job.id(), owningCopy(job.submission()));
+  copy.updateValidityReason(job.validityReason());
+  return copy;
+}
+
+}
+
+namespace remus{
+namespace proto{
+
+//------------------------------------------------------------------------------
+bool is_DirectEndpoint(const std::string& endpoint)
+{
+  const std::string scheme =
+      zmq::proto::scheme_and_separator(zmq::proto::inproc());
+  return endpoint.compare(0, scheme.size(), scheme) == 0;
+}
+
+//------------------------------------------------------------------------------
+std::string to_DirectHandle(const remus::proto::JobSubmission& sub)
+{
+  return parked().park(SubmissionObject,
+                       boost::make_shared<JobSubmission>(owningCopy(sub)));
+}
+
+//------------------------------------------------------------------------------
+std::string to_DirectHandle(const remus::proto::WorkerJob& job)
+{
+  return parked().park(WorkerJobObject,
+                       boost::make_shared<WorkerJob>(owningCopy(job)));
+}
+
+//------------------------------------------------------------------------------
+std::string to_DirectHandle(const std::vector< remus::proto::WorkerJob >& jobs)
+{
+  boost::shared_ptr< std::vector<WorkerJob> > copy =
+      boost::make_shared< std::vector<WorkerJob> >();
+  copy->reserve(jobs.size());
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    copy->push_back( owningCopy(jobs[i]) );
+    }
+  return parked().park(WorkerJobBatchObject, copy);
+}
+
+//------------------------------------------------------------------------------
+std::string to_DirectHandle(const remus::proto::JobResult& result)
+{
+  return parked().park(ResultObject,
+                       boost::make_shared<JobResult>(result.owningCopy()));
+}
+
+//------------------------------------------------------------------------------
+std::string to_DirectHandle(const std::vector< remus::proto::JobResult >& results)
+{
+  boost::shared_ptr< std::vector<JobResult> > copy =
+      boost::make_shared< std::vector<JobResult> >();
+  copy->reserve(results.size());
+  for(std::size_t i=0; i < results.size(); ++i)
+    {
+    copy->push_back( results[i].owningCopy() );
+    }
+  return parked().park(ResultBatchObject, copy);
+}
+
+//------------------------------------------------------------------------------
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::JobSubmission& sub)
+{
+  return claim(SubmissionObject, data, size, sub);
+}
+
+//------------------------------------------------------------------------------
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::WorkerJob& job)
+{
+  return claim(WorkerJobObject, data, size, job);
+}
+
+//------------------------------------------------------------------------------
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        std::vector< remus::proto::WorkerJob >& jobs)
+{
+  return claim(WorkerJobBatchObject, data, size, jobs);
+}
+
+//------------------------------------------------------------------------------
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::JobResult& result)
+{
+  return claim(ResultObject, data, size, result);
+}
+
+//------------------------------------------------------------------------------
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        std::vector< remus::proto::JobResult >& results)
+{
+  return claim(ResultBatchObject, data, size, results);
+}
+
+//------------------------------------------------------------------------------
+bool release_DirectHandle(const std::string& handle)
+{
+  return parked().release(handle.data(), handle.size());
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobSubmission to_JobSubmission(const char* data,
+                                             std::size_t size, bool direct)
+{
+  remus::proto::JobSubmission sub;
+  if(direct && claim_DirectHandle(data, size, sub))
+    {
+    return sub;
+    }
+  return to_JobSubmission(data, size);
+}
+
+//------------------------------------------------------------------------------
+remus::proto::WorkerJob to_WorkerJob(const std::string& msg, bool direct)
+{
+  remus::proto::WorkerJob job;
+  if(direct && claim_DirectHandle(msg.data(), msg.size(), job))
+    {
+    return job;
+    }
+  return to_WorkerJob(msg);
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::WorkerJob > to_WorkerJobBatch(const std::string& msg,
+                                                         bool direct)
+{
+  std::vector< remus::proto::WorkerJob > jobs;
+  if(direct && claim_DirectHandle(msg.data(), msg.size(), jobs))
+    {
+    return jobs;
+    }
+  return to_WorkerJobBatch(msg);
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobResult to_JobResult(const char* data, std::size_t size,
+                                     bool direct)
+{
+  remus::proto::JobResult result( (boost::uuids::nil_uuid()) );
+  if(direct && claim_DirectHandle(data, size, result))
+    {
+    return result;
+    }
+  return to_JobResult(data, size);
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::JobResult > to_JobResultBatch(const char* data,
+                                                         std::size_t size,
+                                                         bool direct)
+{
+  std::vector< remus::proto::JobResult > results;
+  if(direct && claim_DirectHandle(data, size, results))
+    {
+    return results;
+    }
+  return to_JobResultBatch(data, size);
+}
+
+//------------------------------------------------------------------------------
+std::size_t parked_DirectObjectCount()
+{
+  return parked().size();
+}
+
+//------------------------------------------------------------------------------
+void parked_DirectObjectLifetime(boost::int64_t millisec)
+{
+  parked().lifetime(millisec);
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t parked_DirectObjectLifetime()
+{
+  return parked().lifetime();
+}
+
+}
+}
@@ -0,0 +1,144 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_proto_DirectTransport_h
+#define remus_proto_DirectTransport_h
+
+#include <string>
+#include <vector>
+
+#include <remus/proto/JobResult.h>
+#include <remus/proto/JobSubmission.h>
+#include <remus/proto/WorkerJob.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+//included for export symbols
+#include <remus/proto/ProtoExports.h>
+
+//The direct transport hands jobs and results between a client, server and
+//worker that live in the same process without serializing them. Instead of
+//the serialized object the sender puts a small handle in the message, and
+//the receiver trades that handle for the object itself. Handles only refer
+//to objects parked in this process, so they are only sent over inproc
+//connections, which zmq restricts to a single process.
+//
+//Handles are random 128 bit tokens, and are only claimed by receivers that
+//know the message arrived on an inproc socket, so a message from another
+//process can't claim an object parked in this one. Each handle can be
+//claimed once, and objects that aren't claimed within the parked object
+//lifetime are dropped, as their message was most likely dropped too.
+
+namespace remus{
+namespace proto{
+
+//------------------------------------------------------------------------------
+//returns true when messages sent to the endpoint never leave this process
+REMUSPROTO_EXPORT
+bool is_DirectEndpoint(const std::string& endpoint);
+
+//------------------------------------------------------------------------------
+//park an object and return the handle to send in its place. Content that
+//points at memory owned by the caller is copied, as the caller is free to
+//release that memory once the message has been sent.
+REMUSPROTO_EXPORT
+std::string to_DirectHandle(const remus::proto::JobSubmission& sub);
+
+REMUSPROTO_EXPORT
+std::string to_DirectHandle(const remus::proto::WorkerJob& job);
+
+REMUSPROTO_EXPORT
+std::string to_DirectHandle(const std::vector< remus::proto::WorkerJob >& jobs);
+
+REMUSPROTO_EXPORT
+std::string to_DirectHandle(const remus::proto::JobResult& result);
+
+REMUSPROTO_EXPORT
+std::string to_DirectHandle(const std::vector< remus::proto::JobResult >& results);
+
+//------------------------------------------------------------------------------
+//trade a handle for the object it refers to. Returns false and leaves the
+//object untouched if the data isn't a handle to an object of that type that
+//is parked in this process.
+REMUSPROTO_EXPORT
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::JobSubmission& sub);
+
+REMUSPROTO_EXPORT
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::WorkerJob& job);
+
+REMUSPROTO_EXPORT
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        std::vector< remus::proto::WorkerJob >& jobs);
+
+REMUSPROTO_EXPORT
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        remus::proto::JobResult& result);
+
+REMUSPROTO_EXPORT
+bool claim_DirectHandle(const char* data, std::size_t size,
+                        std::vector< remus::proto::JobResult >& results);
+
+//------------------------------------------------------------------------------
+//drop the object a handle refers to, used by a sender whose message
+//couldn't be sent. Returns false if the handle doesn't refer to a parked
+//object.
+REMUSPROTO_EXPORT
+bool release_DirectHandle(const std::string& handle);
+
+//------------------------------------------------------------------------------
+//decode a message that was received on an inproc socket when direct is
+//true, in which case the message can be a handle. Otherwise the message
+//is always parsed as a serialized object.
+REMUSPROTO_EXPORT
+remus::proto::JobSubmission to_JobSubmission(const char* data,
+                                             std::size_t size, bool direct);
+
+REMUSPROTO_EXPORT
+remus::proto::WorkerJob to_WorkerJob(const std::string& msg, bool direct);
+
+REMUSPROTO_EXPORT
+std::vector< remus::proto::WorkerJob > to_WorkerJobBatch(const std::string& msg,
+                                                         bool direct);
+
+REMUSPROTO_EXPORT
+remus::proto::JobResult to_JobResult(const char* data, std::size_t size,
+                                     bool direct);
+
+REMUSPROTO_EXPORT
+std::vector< remus::proto::JobResult > to_JobResultBatch(const char* data,
+                                                         std::size_t size,
+                                                         bool direct);
+
+//------------------------------------------------------------------------------
+//the number of objects that are parked waiting for their handle to be
+//claimed.
+REMUSPROTO_EXPORT
+std::size_t parked_DirectObjectCount();
+
+//------------------------------------------------------------------------------
+//the time in milliseconds an object stays parked waiting for its handle to
+//be claimed. Objects older than this are dropped whenever another object
+//is parked. The default lifetime is one minute.
+REMUSPROTO_EXPORT
+void parked_DirectObjectLifetime(boost::int64_t millisec);
+
+REMUSPROTO_EXPORT
+boost::int64_t parked_DirectObjectLifetime();
+
+}
+}
+
+#endif
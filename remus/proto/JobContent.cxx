@@ -22,6 +22,7 @@ REMUS_THIRDPARTY_POST_INCLUDE
 
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 #include <utility>
 
 namespace remus{
@@ -69,6 +70,10 @@ struct JobContent::InternalImpl
   std::size_t size() const { return Size; }
   const char* data() const { return Data; }
 
+  //false when Data points to memory that was handed to us without a copy
+  bool ownsData() const
+    { return this->Size == 0 || this->Data == this->Storage.data(); }
+
   bool equal(const boost::shared_ptr<InternalImpl> other)
     {
     return (this->shortHash() == other->shortHash()) &&
@@ -202,6 +207,20 @@ std::size_t JobContent::dataSize() const
   return this->Implementation->size();
 }
 
+//------------------------------------------------------------------------------
+JobContent JobContent::owningCopy() const
+{
+  JobContent copy(*this);
+  if(!this->Implementation->ownsData())
+    {
+    boost::shared_array<char> contents( new char[this->dataSize()] );
+    std::memcpy(contents.get(), this->data(), this->dataSize());
+    copy.Implementation = boost::make_shared<InternalImpl>(contents,
+                                                           this->dataSize());
+    }
+  return copy;
+}
+
 //------------------------------------------------------------------------------
 bool JobContent::operator<(const JobContent& other) const
 {
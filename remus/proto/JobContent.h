@@ -85,6 +85,11 @@ public:
   const char* data() const;
   std::size_t dataSize() const;
 
+  //returns a copy that owns its data. When we were constructed from a
+  //pointer to memory we don't own that memory is copied, otherwise the
+  //data is shared with the copy.
+  JobContent owningCopy() const;
+
   ///implement a less than operator and equal operator so you
   //can use the class in containers and algorithms
   bool operator<(const JobContent& other) const;
@@ -20,10 +20,12 @@
 //suppress warnings inside boost headers for gcc, clang and MSVC
 REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/make_shared.hpp>
+#include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 
 namespace remus {
@@ -65,6 +67,10 @@ struct JobResult::InternalImpl
   std::size_t size() const { return Size; }
   const char* data() const { return Data; }
 
+  //false when Data points to memory that was handed to us without a copy
+  bool ownsData() const
+    { return this->Size == 0 || this->Data == this->Storage.data(); }
+
 private:
 
   //store the size of the data being held
@@ -155,6 +161,20 @@ std::size_t JobResult::dataSize() const
   return this->Implementation->size();
 }
 
+//------------------------------------------------------------------------------
+JobResult JobResult::owningCopy() const
+{
+  JobResult copy(*this);
+  if(!this->Implementation->ownsData())
+    {
+    boost::shared_array<char> contents( new char[this->dataSize()] );
+    std::memcpy(contents.get(), this->data(), this->dataSize());
+    copy.Implementation = boost::make_shared<InternalImpl>(contents,
+                                                           this->dataSize());
+    }
+  return copy;
+}
+
 
 //------------------------------------------------------------------------------
 bool JobResult::operator<(const JobResult& other) const
@@ -230,6 +250,39 @@ remus::proto::JobResult to_JobResult(const char* data, std::size_t size)
   return res;
 }
 
+//------------------------------------------------------------------------------
+std::string to_string(const std::vector< remus::proto::JobResult >& results)
+{
+  std::ostringstream buffer;
+  buffer << results.size() << '\n';
+  typedef std::vector< remus::proto::JobResult >::const_iterator it;
+  for(it i = results.begin(); i != results.end(); ++i)
+    {
+    buffer << *i << '\n';
+    }
+  return buffer.str();
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::JobResult > to_JobResultBatch(const char* data,
+                                                         std::size_t size)
+{
+  std::stringstream buffer;
+  remus::internal::writeString(buffer, data, size);
+
+  std::size_t numberOfResults = 0;
+  buffer >> numberOfResults;
+
+  std::vector< remus::proto::JobResult > results;
+  for(std::size_t i=0; i < numberOfResults && buffer.good(); ++i)
+    {
+    remus::proto::JobResult result( (boost::uuids::nil_uuid()) );
+    buffer >> result;
+    results.push_back(result);
+    }
+  return results;
+}
+
 
 }
 }
@@ -14,6 +14,7 @@
 #define remus_proto_JobResult_h
 
 #include <string>
+#include <vector>
 
 #include <remus/common/CompilerInformation.h>
 
@@ -86,6 +87,11 @@ public:
   const char* data() const;
   std::size_t dataSize() const;
 
+  //returns a copy that owns its data. When we were constructed from a
+  //pointer to memory we don't own that memory is copied, otherwise the
+  //data is shared with the copy.
+  JobResult owningCopy() const;
+
 
   //implement a less than operator and equal operator so you
   //can use the class in containers and algorithms
@@ -146,6 +152,16 @@ inline remus::proto::JobResult to_JobResult(const std::string& msg)
   return to_JobResult(msg.c_str(), msg.size());
 }
 
+//------------------------------------------------------------------------------
+//serialize a batch of results so they can be sent in a single message
+REMUSPROTO_EXPORT
+std::string to_string(const std::vector< remus::proto::JobResult >& results);
+
+//------------------------------------------------------------------------------
+REMUSPROTO_EXPORT
+std::vector< remus::proto::JobResult > to_JobResultBatch(const char* data,
+                                                         std::size_t size);
+
 }
 }
 
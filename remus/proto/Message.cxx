@@ -273,5 +273,34 @@ bool Message::send_impl(zmq::socket_t *socket, SendMode mode) const
   return valid;
 }
 
+//------------------------------------------------------------------------------
+std::string to_HeartbeatPayload(boost::int64_t dur_in_milli)
+{
+  const boost::uint64_t value = static_cast<boost::uint64_t>(dur_in_milli);
+  std::string payload(sizeof(value), '\0');
+  for(std::size_t i=0; i < sizeof(value); ++i)
+    {
+    payload[i] = static_cast<char>( (value >> (8*i)) & 0xFF );
+    }
+  return payload;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t to_HeartbeatInterval(const char* data, std::size_t size)
+{
+  boost::uint64_t value = 0;
+  if(data == NULL || size != sizeof(value))
+    {
+    return 0;
+    }
+
+  for(std::size_t i=0; i < sizeof(value); ++i)
+    {
+    const boost::uint64_t byte = static_cast<unsigned char>(data[i]);
+    value |= byte << (8*i);
+    }
+  return static_cast<boost::int64_t>(value);
+}
+
 }
 }
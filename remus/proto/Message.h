@@ -16,9 +16,12 @@
 #include <remus/common/CompilerInformation.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <string>
+
 #include <remus/common/MeshIOType.h>
 #include <remus/common/ServiceTypes.h>
 #include <remus/common/StatusTypes.h>
@@ -91,6 +94,19 @@ REMUSPROTO_EXPORT
 bool forward_Message(const remus::proto::Message& message,
                      zmq::socket_t* socket);
 
+//----------------------------------------------------------------------------
+//encode the number of milliseconds until a worker's next heartbeat as the
+//payload of a HEARTBEAT message. The payload is a fixed size little endian
+//integer, so it is cheap to build and parse.
+REMUSPROTO_EXPORT
+std::string to_HeartbeatPayload(boost::int64_t dur_in_milli);
+
+//----------------------------------------------------------------------------
+//decode the payload of a HEARTBEAT message. Returns zero when the payload
+//isn't a heartbeat interval.
+REMUSPROTO_EXPORT
+boost::int64_t to_HeartbeatInterval(const char* data, std::size_t size);
+
 
 //All creation of this class needs to happen through the make_Message
 //set of functions
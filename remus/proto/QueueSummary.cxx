@@ -0,0 +1,55 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/proto/QueueSummary.h>
+
+#include <sstream>
+
+namespace remus {
+namespace proto {
+
+//------------------------------------------------------------------------------
+std::string to_string(const remus::proto::QueueSummary& summary)
+{
+  std::ostringstream buffer;
+  buffer << summary.size() << std::endl;
+  for(QueueSummary::const_iterator i = summary.begin(); i != summary.end(); ++i)
+    {
+    buffer << i->second.Queued << " " << i->second.Capacity << std::endl;
+    buffer << i->first << std::endl;
+    }
+  return buffer.str();
+}
+
+//------------------------------------------------------------------------------
+remus::proto::QueueSummary to_QueueSummary(const std::string& msg)
+{
+  QueueSummary summary;
+  std::istringstream buffer(msg);
+  std::size_t size = 0;
+  buffer >> size;
+  for(std::size_t i=0; i < size && buffer.good(); ++i)
+    {
+    QueueDepth depth;
+    remus::proto::JobRequirements reqs;
+    buffer >> depth.Queued >> depth.Capacity;
+    buffer >> reqs;
+    if(!buffer.fail())
+      {
+      summary[reqs] = depth;
+      }
+    }
+  return summary;
+}
+
+}
+}
@@ -0,0 +1,70 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_proto_QueueSummary_h
+#define remus_proto_QueueSummary_h
+
+#include <map>
+#include <string>
+
+#include <remus/proto/JobRequirements.h>
+
+//included for export symbols
+#include <remus/proto/ProtoExports.h>
+
+#include <remus/common/CompilerInformation.h>
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus {
+namespace proto {
+
+//The queue depth of a server for a single set of requirements: the jobs
+//it has queued that no worker has been launched for, and the number of
+//jobs it could start right away. Servers send these to their peers, and
+//to clients that probe how loaded they are.
+struct QueueDepth
+{
+  QueueDepth(): Queued(0), Capacity(0) {}
+  QueueDepth(std::size_t queued, std::size_t capacity):
+    Queued(queued), Capacity(capacity) {}
+
+  //the queued jobs the server can't start right away
+  std::size_t excess() const
+    { return (this->Queued > this->Capacity) ? this->Queued - this->Capacity : 0; }
+
+  //the jobs the server could start right away on top of its queued jobs
+  std::size_t spare() const
+    { return (this->Capacity > this->Queued) ? this->Capacity - this->Queued : 0; }
+
+  std::size_t Queued;
+  std::size_t Capacity;
+};
+
+typedef std::map< remus::proto::JobRequirements, QueueDepth > QueueSummary;
+
+REMUSPROTO_EXPORT
+std::string to_string(const remus::proto::QueueSummary& summary);
+
+REMUSPROTO_EXPORT
+remus::proto::QueueSummary to_QueueSummary(const std::string& msg);
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
@@ -98,6 +98,41 @@ remus::proto::WorkerJob to_WorkerJob(const std::string& msg)
   return remus::proto::WorkerJob(id,submission);
 }
 
+//------------------------------------------------------------------------------
+std::string to_string(const std::vector< remus::proto::WorkerJob >& jobs)
+{
+  std::ostringstream buffer;
+  buffer << jobs.size() << std::endl;
+  typedef std::vector< remus::proto::WorkerJob >::const_iterator it;
+  for(it i = jobs.begin(); i != jobs.end(); ++i)
+    {
+    buffer << i->id() << std::endl;
+    buffer << i->submission() << std::endl;
+    }
+  return buffer.str();
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::WorkerJob > to_WorkerJobBatch(const std::string& msg)
+{
+  std::istringstream buffer(msg);
+
+  std::size_t numberOfJobs = 0;
+  buffer >> numberOfJobs;
+
+  std::vector< remus::proto::WorkerJob > jobs;
+  for(std::size_t i=0; i < numberOfJobs && buffer.good(); ++i)
+    {
+    boost::uuids::uuid id;
+    remus::proto::JobSubmission submission;
+
+    buffer >> id;
+    buffer >> submission;
+    jobs.push_back( remus::proto::WorkerJob(id,submission) );
+    }
+  return jobs;
+}
+
 }
 }
 
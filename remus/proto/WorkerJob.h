@@ -14,6 +14,7 @@
 #define remus_proto_WorkerJob_h
 
 #include <string>
+#include <vector>
 
 #include <remus/common/MeshIOType.h>
 #include <remus/proto/JobSubmission.h>
@@ -87,6 +88,15 @@ REMUSPROTO_EXPORT std::string to_string(const remus::proto::WorkerJob& job);
 //------------------------------------------------------------------------------
 REMUSPROTO_EXPORT remus::proto::WorkerJob to_WorkerJob(const std::string& msg);
 
+//------------------------------------------------------------------------------
+//serialize a batch of jobs so they can be sent to a worker in a single message
+REMUSPROTO_EXPORT std::string to_string(
+                        const std::vector< remus::proto::WorkerJob >& jobs);
+
+//------------------------------------------------------------------------------
+REMUSPROTO_EXPORT std::vector< remus::proto::WorkerJob > to_WorkerJobBatch(
+                        const std::string& msg);
+
 }
 }
 
@@ -0,0 +1,190 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <remus/common/SleepFor.h>
+#include <remus/proto/DirectTransport.h>
+#include <remus/testing/Testing.h>
+
+#include <cstring>
+
+namespace {
+
+using namespace remus::proto;
+using namespace remus::meshtypes;
+
+JobSubmission make_Submission(const char* data, std::size_t size)
+{
+  remus::common::MeshIOType io_type =
+      remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  JobSubmission sub( make_JobRequirements(io_type, "DirectWorker", "") );
+  sub["data"] = JobContent(remus::common::ContentFormat::User, data, size);
+  return sub;
+}
+
+void verify_endpoints()
+{
+  REMUS_ASSERT( (is_DirectEndpoint("inproc://server")) );
+  REMUS_ASSERT( (!is_DirectEndpoint("tcp://127.0.0.1:50505")) );
+  REMUS_ASSERT( (!is_DirectEndpoint("ipc://server")) );
+  REMUS_ASSERT( (!is_DirectEndpoint("inproc")) );
+}
+
+void verify_submission_handoff()
+{
+  //content made from memory we own must be copied when parked, so we can
+  //release the memory once the handle has been made
+  char* data = new char[6];
+  std::memcpy(data, "direct", 6);
+  JobSubmission sub = make_Submission(data, 6);
+
+  const std::size_t parked = parked_DirectObjectCount();
+  const std::string handle = to_DirectHandle(sub);
+  REMUS_ASSERT( (parked_DirectObjectCount() == parked + 1) );
+  std::memset(data, 0, 6);
+  delete[] data;
+
+  //the decoder only recognizes the handle when told the message arrived
+  //on an inproc socket
+  JobSubmission notClaimed = to_JobSubmission(handle.data(), handle.size());
+  REMUS_ASSERT( (notClaimed.size() == 0) );
+  REMUS_ASSERT( (parked_DirectObjectCount() == parked + 1) );
+
+  JobSubmission claimed = to_JobSubmission(handle.data(), handle.size(), true);
+  REMUS_ASSERT( (claimed.requirements() == sub.requirements()) );
+  REMUS_ASSERT( (claimed.size() == 1) );
+  const JobContent& content = claimed.find("data")->second;
+  REMUS_ASSERT( (std::string(content.data(),content.dataSize()) == "direct") );
+  REMUS_ASSERT( (parked_DirectObjectCount() == parked) );
+
+  //a handle can only be claimed once
+  JobSubmission again;
+  REMUS_ASSERT( (!claim_DirectHandle(handle.data(), handle.size(), again)) );
+}
+
+void verify_types_must_match()
+{
+  const boost::uuids::uuid id = remus::testing::UUIDGenerator();
+  JobResult result = make_JobResult(id, std::string("result"));
+  const std::string handle = to_DirectHandle(result);
+
+  //a result handle can't be claimed as a job
+  WorkerJob job;
+  REMUS_ASSERT( (!claim_DirectHandle(handle.data(), handle.size(), job)) );
+
+  std::vector<JobResult> results;
+  REMUS_ASSERT( (!claim_DirectHandle(handle.data(), handle.size(), results)) );
+
+  JobResult claimed = to_JobResult(handle.data(), handle.size(), true);
+  REMUS_ASSERT( (claimed.id() == id) );
+  REMUS_ASSERT( (std::string(claimed.data(),claimed.dataSize()) == "result") );
+
+  //serialized objects and garbage are not handles
+  const std::string serialized = to_string(result);
+  REMUS_ASSERT( (!claim_DirectHandle(serialized.data(), serialized.size(), claimed)) );
+  const std::string garbage = "remus-direct:Rnot-a-number";
+  REMUS_ASSERT( (!claim_DirectHandle(garbage.data(), garbage.size(), claimed)) );
+}
+
+void verify_tokens()
+{
+  //handles are random, so knowing one handle doesn't reveal the next
+  const boost::uuids::uuid id = remus::testing::UUIDGenerator();
+  const std::string first = to_DirectHandle(make_JobResult(id, std::string("a")));
+  const std::string second = to_DirectHandle(make_JobResult(id, std::string("b")));
+  REMUS_ASSERT( (first.size() == second.size()) );
+  REMUS_ASSERT( (first.compare(0, first.size() - 16, second, 0,
+                               second.size() - 16) == 0) );
+  REMUS_ASSERT( (first != second) );
+
+  //a handle whose message was never sent can be released
+  const std::size_t parked = parked_DirectObjectCount();
+  REMUS_ASSERT( (release_DirectHandle(first)) );
+  REMUS_ASSERT( (!release_DirectHandle(first)) );
+  REMUS_ASSERT( (!release_DirectHandle(to_string(make_JobResult(id, std::string("c"))))) );
+  REMUS_ASSERT( (parked_DirectObjectCount() == parked - 1) );
+
+  JobResult claimed = to_JobResult(second.data(), second.size(), true);
+  REMUS_ASSERT( (std::string(claimed.data(),claimed.dataSize()) == "b") );
+}
+
+void verify_expiry()
+{
+  //objects that aren't claimed within their lifetime are dropped once
+  //another object is parked
+  const boost::int64_t lifetime = parked_DirectObjectLifetime();
+  parked_DirectObjectLifetime(50);
+  REMUS_ASSERT( (parked_DirectObjectLifetime() == 50) );
+
+  const boost::uuids::uuid id = remus::testing::UUIDGenerator();
+  const std::size_t parked = parked_DirectObjectCount();
+  const std::string dropped = to_DirectHandle(make_JobResult(id, std::string("a")));
+  remus::common::SleepForMillisec(100);
+  const std::string kept = to_DirectHandle(make_JobResult(id, std::string("b")));
+  REMUS_ASSERT( (parked_DirectObjectCount() == parked + 1) );
+
+  JobResult claimed( (boost::uuids::nil_uuid()) );
+  REMUS_ASSERT( (!claim_DirectHandle(dropped.data(), dropped.size(), claimed)) );
+  REMUS_ASSERT( (claim_DirectHandle(kept.data(), kept.size(), claimed)) );
+
+  parked_DirectObjectLifetime(lifetime);
+}
+
+void verify_batches()
+{
+  const char data[] = "batch";
+  std::vector<WorkerJob> jobs;
+  for(int i=0; i < 3; ++i)
+    {
+    jobs.push_back( WorkerJob(remus::testing::UUIDGenerator(),
+                              make_Submission(data, 5)) );
+    }
+
+  std::vector<WorkerJob> claimed = to_WorkerJobBatch( to_DirectHandle(jobs), true );
+  REMUS_ASSERT( (claimed.size() == 3) );
+  for(std::size_t i=0; i < claimed.size(); ++i)
+    {
+    REMUS_ASSERT( (claimed[i].valid()) );
+    REMUS_ASSERT( (claimed[i].id() == jobs[i].id()) );
+    REMUS_ASSERT( (claimed[i].details("data") == "batch") );
+    }
+
+  WorkerJob single = to_WorkerJob( to_DirectHandle(jobs[0]), true );
+  REMUS_ASSERT( (single.id() == jobs[0].id()) );
+
+  std::vector<JobResult> results;
+  results.push_back( make_JobResult(jobs[0].id(), std::string("a")) );
+  results.push_back( make_JobResult(jobs[1].id(), std::string("b")) );
+  const std::string handle = to_DirectHandle(results);
+  std::vector<JobResult> claimedResults =
+      to_JobResultBatch(handle.data(), handle.size(), true);
+  REMUS_ASSERT( (claimedResults.size() == 2) );
+  REMUS_ASSERT( (claimedResults[1].id() == jobs[1].id()) );
+}
+
+}
+
+int UnitTestDirectTransport(int, char *[])
+{
+  verify_endpoints();
+  verify_submission_handoff();
+  verify_types_must_match();
+  verify_tokens();
+  verify_expiry();
+  verify_batches();
+  return 0;
+}
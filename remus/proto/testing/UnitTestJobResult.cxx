@@ -104,10 +104,39 @@ void serialize_test()
   validate_serialization(c);
 }
 
+void serialize_batch_test()
+{
+  std::vector<JobResult> results;
+  results.push_back( make_JobResult( make_id(), std::string() ) );
+  results.push_back( make_JobResult( make_id(),
+                                     remus::testing::BinaryDataGenerator(1024),
+                                     remus::common::ContentFormat::BSON ) );
+  results.push_back( make_JobResult( make_id(),
+                                     remus::testing::AsciiStringGenerator(512),
+                                     remus::common::ContentFormat::XML ) );
+
+  const std::string temp = to_string(results);
+  std::vector<JobResult> from_string = to_JobResultBatch(temp.c_str(),
+                                                         temp.size());
+  REMUS_ASSERT( (from_string.size() == results.size()) );
+  for(std::size_t i=0; i < results.size(); ++i)
+    {
+    REMUS_ASSERT( (from_string[i].id() == results[i].id()) );
+    REMUS_ASSERT( (from_string[i].formatType() == results[i].formatType()) );
+    REMUS_ASSERT( (std::string(from_string[i].data(),from_string[i].dataSize()) ==
+                   std::string(results[i].data(),results[i].dataSize())) );
+    }
+
+  //verify an empty batch
+  const std::string empty = to_string( std::vector<JobResult>() );
+  REMUS_ASSERT( (to_JobResultBatch(empty.c_str(),empty.size()).size() == 0) );
+}
+
 }
 
 int UnitTestJobResult(int, char *[])
 {
   serialize_test();
+  serialize_batch_test();
   return 0;
 }
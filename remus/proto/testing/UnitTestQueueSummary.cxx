@@ -0,0 +1,72 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/proto/QueueSummary.h>
+
+#include <remus/testing/Testing.h>
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+using remus::proto::QueueDepth;
+using remus::proto::QueueSummary;
+
+const remus::proto::JobRequirements worker_type2D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh2D()),
+                                                  "", "" );
+const remus::proto::JobRequirements worker_type3D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh3D()),
+                                                  "a", "b" );
+
+void verify_depth()
+{
+  QueueDepth busy(5, 2);
+  REMUS_ASSERT( (busy.excess() == 3) );
+  REMUS_ASSERT( (busy.spare() == 0) );
+
+  QueueDepth idle(0, 4);
+  REMUS_ASSERT( (idle.excess() == 0) );
+  REMUS_ASSERT( (idle.spare() == 4) );
+
+  QueueDepth empty;
+  REMUS_ASSERT( (empty.excess() == 0) );
+  REMUS_ASSERT( (empty.spare() == 0) );
+}
+
+void verify_serialization()
+{
+  QueueSummary summary;
+  summary[worker_type2D] = QueueDepth(5, 2);
+  summary[worker_type3D] = QueueDepth(0, 4);
+
+  const QueueSummary parsed =
+                remus::proto::to_QueueSummary(remus::proto::to_string(summary));
+  REMUS_ASSERT( (parsed.size() == 2) );
+  REMUS_ASSERT( (parsed.find(worker_type2D)->second.Queued == 5) );
+  REMUS_ASSERT( (parsed.find(worker_type2D)->second.Capacity == 2) );
+  REMUS_ASSERT( (parsed.find(worker_type3D)->second.Queued == 0) );
+  REMUS_ASSERT( (parsed.find(worker_type3D)->second.Capacity == 4) );
+
+  REMUS_ASSERT( (remus::proto::to_QueueSummary(
+                 remus::proto::to_string(QueueSummary())).empty()) );
+  REMUS_ASSERT( (remus::proto::to_QueueSummary(std::string()).empty()) );
+}
+
+}
+
+int UnitTestQueueSummary(int, char *[])
+{
+  verify_depth();
+  verify_serialization();
+  return 0;
+}
@@ -23,6 +23,7 @@
 #include <remus/proto/zmqHelper.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
 #include <boost/lexical_cast.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
@@ -55,6 +56,32 @@ zmq::SocketIdentity address_recv(zmq::socket_t& socket)
   return zmq::SocketIdentity((char*)message.data(),message.size());
 }
 
+//------------------------------------------------------------------------------
+zmq::SocketIdentity address_recv(zmq::socket_t& socket, int& sourceFd)
+{
+  zmq_msg_t message;
+  zmq_msg_init(&message);
+  if(zmq_msg_recv(&message, socket.operator void*(), 0) < 0)
+    {
+    zmq_msg_close(&message);
+    throw zmq::error_t();
+    }
+
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4,1,0)
+  #ifndef ZMQ_SRCFD
+    #define ZMQ_SRCFD 2
+  #endif
+  sourceFd = zmq_msg_get(&message, ZMQ_SRCFD);
+#else
+  sourceFd = -1;
+#endif
+
+  zmq::SocketIdentity address(static_cast<char*>(zmq_msg_data(&message)),
+                              zmq_msg_size(&message));
+  zmq_msg_close(&message);
+  return address;
+}
+
 //------------------------------------------------------------------------------
 void connectToAddress(zmq::socket_t &socket,const std::string &endpoint)
 {
@@ -111,6 +138,112 @@ void poll_safely(zmq_pollitem_t *items, int nitems, boost::int64_t timeout)
     }
 }
 
+//------------------------------------------------------------------------------
+int poll_for_events(zmq_pollitem_t *items, int nitems, boost::int64_t timeout)
+{
+  const long zmq_timeout = (timeout < 0) ? -1 :
+                           static_cast<long>(ZMQ_POLL_MSEC*timeout);
+  const int rc = zmq_poll(items, nitems, zmq_timeout);
+  if(rc < 0)
+    {
+    if(zmq_errno() == EINTR)
+      {
+      //we were interrupted, so report no events and let the caller
+      //decide if it should poll again
+      for(int i=0; i < nitems; ++i)
+        { items[i].revents = 0; }
+      return 0;
+      }
+    throw zmq::error_t();
+    }
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+void send_wakeup(zmq::context_t& context, const std::string& endpoint)
+{
+  zmq::socket_t wakeup(context, ZMQ_PUSH);
+  const int linger_duration = 0;
+  wakeup.setsockopt(ZMQ_LINGER, &linger_duration, sizeof(int) );
+  wakeup.connect(endpoint.c_str());
+
+  zmq::message_t message(0);
+  wakeup.send(message, ZMQ_DONTWAIT);
+}
+
+//------------------------------------------------------------------------------
+bool monitor_socket(zmq::socket_t& socket, const std::string& endpoint,
+                    int events)
+{
+#if ZMQ_VERSION_MAJOR >= 4
+  return zmq_socket_monitor(socket.operator void*(), endpoint.c_str(),
+                            events) == 0;
+#else
+  //the event format of zmq 3 monitors differs, so we don't support it
+  (void) socket;
+  (void) endpoint;
+  (void) events;
+  return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+void stop_monitoring_socket(zmq::socket_t& socket)
+{
+#if ZMQ_VERSION_MAJOR >= 4
+  zmq_socket_monitor(socket.operator void*(), NULL, 0);
+#else
+  (void) socket;
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool recv_socket_event(zmq::socket_t& monitor, int& event, int& value)
+{
+  //every event is two frames, the first holds a 16 bit event id and
+  //32 bit value, the second is the endpoint the event occurred on
+  zmq::message_t eventFrame;
+  if(!monitor.recv(&eventFrame, ZMQ_DONTWAIT))
+    {
+    return false;
+    }
+
+  zmq::more_t more;
+  size_t more_size = sizeof(more);
+  monitor.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+  if(more)
+    { //the endpoint frame is sent atomically with the event frame
+    zmq::message_t endpointFrame;
+    monitor.recv(&endpointFrame);
+    }
+
+  if(eventFrame.size() < 6)
+    {
+    event = 0;
+    value = -1;
+    return true;
+    }
+
+  const char* data = static_cast<const char*>(eventFrame.data());
+  boost::uint16_t eventId;
+  boost::uint32_t eventValue;
+  std::copy(data, data + sizeof(eventId), reinterpret_cast<char*>(&eventId));
+  std::copy(data + sizeof(eventId), data + sizeof(eventId) + sizeof(eventValue),
+            reinterpret_cast<char*>(&eventValue));
+  event = static_cast<int>(eventId);
+  value = static_cast<int>(eventValue);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void drain_wakeups(zmq::socket_t& socket)
+{
+  zmq::message_t message;
+  while(socket.recv(&message, ZMQ_DONTWAIT))
+    {
+    }
+}
+
 } //namespace zmq
 
 //collection of methods that are private and can only be used by classes
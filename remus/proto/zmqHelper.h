@@ -32,6 +32,13 @@ bool address_send(zmq::socket_t & socket, const zmq::SocketIdentity& address);
 REMUSPROTO_EXPORT
 zmq::SocketIdentity address_recv(zmq::socket_t& socket);
 
+//receive the address of a message from a ROUTER socket, and the file
+//descriptor of the connection the message arrived on. sourceFd is set to
+//-1 when the transport has no file descriptor (inproc) or zmq is too old
+//to report it.
+REMUSPROTO_EXPORT
+zmq::SocketIdentity address_recv(zmq::socket_t& socket, int& sourceFd);
+
 //------------------------------------------------------------------------------
 REMUSPROTO_EXPORT
 void connectToAddress(zmq::socket_t &socket,const std::string &endpoint);
@@ -54,6 +61,46 @@ void connectToAddress(zmq::socket_t &socket,const zmq::socketInfo<T> &sInfo)
 REMUSPROTO_EXPORT
 void poll_safely(zmq_pollitem_t *items, int nitems, boost::int64_t timeout);
 
+//------------------------------------------------------------------------------
+//A wrapper around zeroMQ poll for event driven loops. Unlike poll_safely a
+//negative timeout blocks until an event occurs, and an interrupt returns
+//early so that the caller can check if it should stop. Returns the number
+//of items with events, which is zero on a timeout or interrupt.
+REMUSPROTO_EXPORT
+int poll_for_events(zmq_pollitem_t *items, int nitems, boost::int64_t timeout);
+
+//------------------------------------------------------------------------------
+//Wake up a thread that is polling a ZMQ_PULL socket bound to the given inproc
+//endpoint. This allows event driven loops to block without a timeout, and
+//still be told to stop instantly. Never blocks, even if nothing is bound.
+REMUSPROTO_EXPORT
+void send_wakeup(zmq::context_t& context, const std::string& endpoint);
+
+//------------------------------------------------------------------------------
+//discard every pending wakeup on a socket bound for send_wakeup
+REMUSPROTO_EXPORT
+void drain_wakeups(zmq::socket_t& socket);
+
+//------------------------------------------------------------------------------
+//Start reporting the given events of socket to a ZMQ_PAIR socket connected
+//to the inproc endpoint, see zmq_socket_monitor. Returns false when the
+//installed zmq doesn't support socket monitoring.
+REMUSPROTO_EXPORT
+bool monitor_socket(zmq::socket_t& socket, const std::string& endpoint,
+                    int events);
+
+//------------------------------------------------------------------------------
+//Stop reporting events of a socket that was passed to monitor_socket
+REMUSPROTO_EXPORT
+void stop_monitoring_socket(zmq::socket_t& socket);
+
+//------------------------------------------------------------------------------
+//Receive the next event from the PAIR socket connected to a socket monitor
+//without blocking. Returns false when no event is waiting. The value of
+//a connection event is the file descriptor of the connection.
+REMUSPROTO_EXPORT
+bool recv_socket_event(zmq::socket_t& monitor, int& event, int& value);
+
 //------------------------------------------------------------------------------
 //specify a default linger so that if what we are connecting to
 //doesn't exist and we are told to shutdown we don't hang for ever
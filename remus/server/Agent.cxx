@@ -0,0 +1,291 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/Agent.h>
+
+#include <remus/common/Timer.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/server/ServerPorts.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/server/detail/AgentMessages.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool starts_with(const std::string& s, const std::string& prefix)
+  {
+    return s.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  //convert the worker endpoint sent by the remote factory back into the
+  //PortConnection the WorkerFactory expects
+  remus::server::PortConnection to_PortConnection(const std::string& endpoint)
+  {
+    const std::string tcp = zmq::proto::scheme_and_separator(zmq::proto::tcp());
+    const std::string ipc = zmq::proto::scheme_and_separator(zmq::proto::ipc());
+    if(starts_with(endpoint, tcp))
+      {
+      const std::string::size_type colon = endpoint.rfind(':');
+      int port = -1;
+      try
+        {
+        port = boost::lexical_cast<int>(endpoint.substr(colon+1));
+        }
+      catch(boost::bad_lexical_cast&)
+        {
+        }
+      return remus::server::PortConnection(zmq::socketInfo<zmq::proto::tcp>(
+                  endpoint.substr(tcp.size(), colon - tcp.size()), port));
+      }
+    else if(starts_with(endpoint, ipc))
+      {
+      return remus::server::PortConnection(zmq::socketInfo<zmq::proto::ipc>(
+                  endpoint.substr(ipc.size())));
+      }
+    //inproc endpoints can't be reached from another process, but keep it
+    //so that the worker reports the failure
+    const std::string inproc =
+                  zmq::proto::scheme_and_separator(zmq::proto::inproc());
+    return remus::server::PortConnection(zmq::socketInfo<zmq::proto::inproc>(
+                starts_with(endpoint, inproc) ? endpoint.substr(inproc.size()) :
+                                                endpoint));
+  }
+}
+
+namespace remus{
+namespace server{
+
+//----------------------------------------------------------------------------
+struct Agent::AgentState
+{
+  AgentState(const std::string& name,
+             const std::string& endpoint,
+             const boost::shared_ptr<WorkerFactory>& factory):
+    Name(name),
+    FactoryEndpoint(endpoint),
+    Factory(factory),
+    WorkerEndpoint(),
+    HeartbeatInterval(1000),
+    Launched(),
+    Running(false),
+    StopRequested(false)
+    {
+    }
+
+  //the state message of the agent
+  std::vector<std::string> state() const;
+
+  void handle(const std::vector<std::string>& frames);
+
+  std::string Name;
+  std::string FactoryEndpoint;
+  boost::shared_ptr<WorkerFactory> Factory;
+  std::string WorkerEndpoint;
+  boost::int64_t HeartbeatInterval;
+  //the launch messages handled for each requirements
+  std::map< remus::proto::JobRequirements, unsigned long > Launched;
+  std::atomic<bool> Running;
+  std::atomic<bool> StopRequested;
+};
+
+//----------------------------------------------------------------------------
+std::vector<std::string> Agent::AgentState::state() const
+{
+  std::vector<std::string> frames;
+  frames.push_back(remus::server::detail::agent_message::State);
+  frames.push_back(this->Name);
+
+  const remus::common::MeshIOTypeSet types = this->Factory->supportedIOTypes();
+  for(remus::common::MeshIOTypeSet::const_iterator t = types.begin();
+      t != types.end(); ++t)
+    {
+    const remus::proto::JobRequirementsSet reqs =
+                                      this->Factory->workerRequirements(*t);
+    for(remus::proto::JobRequirementsSet::const_iterator r = reqs.begin();
+        r != reqs.end(); ++r)
+      {
+      std::map< remus::proto::JobRequirements, unsigned long >::const_iterator
+        launched = this->Launched.find(*r);
+      std::ostringstream counts;
+      counts << this->Factory->spaceFor(*r) << " "
+             << this->Factory->workerCount(*r) << " "
+             << ((launched != this->Launched.end()) ? launched->second : 0);
+      frames.push_back(counts.str());
+      frames.push_back(remus::proto::to_string(*r));
+      }
+    }
+  return frames;
+}
+
+//----------------------------------------------------------------------------
+void Agent::AgentState::handle(const std::vector<std::string>& frames)
+{
+  if(frames.empty())
+    {
+    return;
+    }
+
+  if(frames[0] == remus::server::detail::agent_message::Launch &&
+     frames.size() >= 3)
+    {
+    const remus::proto::JobRequirements reqs =
+                                  remus::proto::to_JobRequirements(frames[1]);
+    const std::string& endpoint = this->WorkerEndpoint.empty() ? frames[2] :
+                                                        this->WorkerEndpoint;
+    this->Factory->portForWorkersToUse(to_PortConnection(endpoint));
+    if(this->Factory->haveSpaceFor(reqs))
+      {
+      this->Factory->createWorker(reqs,
+                            WorkerFactoryBase::KillOnFactoryDeletion);
+      }
+    //launches we had no space for count as handled as well, as the remote
+    //factory learns about the missing worker from the running count
+    ++this->Launched[reqs];
+    }
+  else if(frames[0] == remus::server::detail::agent_message::Kill)
+    {
+    this->Factory->killWorkers();
+    }
+}
+
+//----------------------------------------------------------------------------
+Agent::Agent(const std::string& name,
+             const std::string& factoryEndpoint,
+             const boost::shared_ptr<WorkerFactory>& factory):
+  State(boost::make_shared<AgentState>(name, factoryEndpoint, factory))
+{
+}
+
+//----------------------------------------------------------------------------
+Agent::~Agent()
+{
+}
+
+//----------------------------------------------------------------------------
+const std::string& Agent::name() const
+{
+  return this->State->Name;
+}
+
+//----------------------------------------------------------------------------
+const std::string& Agent::factoryEndpoint() const
+{
+  return this->State->FactoryEndpoint;
+}
+
+//----------------------------------------------------------------------------
+const boost::shared_ptr<WorkerFactory>& Agent::factory() const
+{
+  return this->State->Factory;
+}
+
+//----------------------------------------------------------------------------
+void Agent::workerEndpoint(const std::string& endpoint)
+{
+  this->State->WorkerEndpoint = endpoint;
+}
+
+//----------------------------------------------------------------------------
+const std::string& Agent::workerEndpoint() const
+{
+  return this->State->WorkerEndpoint;
+}
+
+//----------------------------------------------------------------------------
+void Agent::heartbeatInterval(boost::int64_t millisec)
+{
+  this->State->HeartbeatInterval = millisec;
+}
+
+//----------------------------------------------------------------------------
+boost::int64_t Agent::heartbeatInterval() const
+{
+  return this->State->HeartbeatInterval;
+}
+
+//----------------------------------------------------------------------------
+void Agent::run()
+{
+  //the time we wait for messages before checking if we should stop
+  const long pollTimeout = 100;
+
+  AgentState& state = *this->State;
+  state.Running = true;
+
+  {
+  zmq::context_t context(1);
+  zmq::socket_t socket(context, ZMQ_DEALER);
+  zmq::set_socket_linger(socket);
+  socket.connect(state.FactoryEndpoint.c_str());
+
+  remus::common::Timer heartbeat;
+  std::vector<std::string> lastState;
+  while(!state.StopRequested)
+    {
+    state.Factory->updateWorkerCount();
+
+    //send the state on every heartbeat, and as soon as it changes so that
+    //the remote factory doesn't wait on workers that already exited
+    std::vector<std::string> current = state.state();
+    if(current != lastState || heartbeat.elapsed() >= state.HeartbeatInterval)
+      {
+      remus::server::detail::send_frames(socket, current);
+      lastState.swap(current);
+      heartbeat.reset();
+      }
+
+    const int exitDescriptor = state.Factory->workerExitDescriptor();
+    zmq::pollitem_t items[2] = {
+      { socket, 0, ZMQ_POLLIN, 0 },
+      { NULL, exitDescriptor, ZMQ_POLLIN, 0 } };
+    zmq::poll(&items[0], (exitDescriptor >= 0) ? 2 : 1, pollTimeout);
+
+    std::vector<std::string> frames;
+    while(remus::server::detail::recv_frames(socket, frames))
+      {
+      state.handle(frames);
+      }
+    }
+
+  //don't leave workers behind that nobody is counting
+  state.Factory->killWorkers();
+  }
+
+  state.StopRequested = false;
+  state.Running = false;
+}
+
+//----------------------------------------------------------------------------
+void Agent::stop()
+{
+  this->State->StopRequested = true;
+}
+
+//----------------------------------------------------------------------------
+bool Agent::isRunning() const
+{
+  return this->State->Running;
+}
+
+}
+}
@@ -0,0 +1,101 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_Agent_h
+#define remus_server_Agent_h
+
+#include <string>
+
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+//included for export symbols
+#include <remus/server/ServerExports.h>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace server{
+
+class WorkerFactory;
+
+//The node local half of the RemoteWorkerFactory, run by the remus-agent
+//executable on every host that workers should be launched on.
+//The agent connects to the agent endpoint of a RemoteWorkerFactory, and
+//reports the workers its WorkerFactory can launch and the space it has left
+//for them on every heartbeat, and whenever that changes. When the remote
+//factory asks for a worker the agent launches it with its WorkerFactory,
+//pointed at the worker endpoint of the server.
+//
+//Workers are killed when the remote factory is deleted, and when the agent
+//stops running.
+class REMUSSERVER_EXPORT Agent
+{
+public:
+  //create an agent that reports as name to the RemoteWorkerFactory bound
+  //to the given endpoint, and launches workers with the factory
+  Agent(const std::string& name,
+        const std::string& factoryEndpoint,
+        const boost::shared_ptr<WorkerFactory>& factory);
+
+  ~Agent();
+
+  const std::string& name() const;
+  const std::string& factoryEndpoint() const;
+
+  //the factory that launches the workers. Only configure it while the agent
+  //isn't running
+  const boost::shared_ptr<WorkerFactory>& factory() const;
+
+  //the endpoint workers connect to, instead of the one the remote factory
+  //asks for. Used when the server is reached through a different address
+  //from this host. Defaults to empty, which uses the one of the factory
+  void workerEndpoint(const std::string& endpoint);
+  const std::string& workerEndpoint() const;
+
+  //the time in milliseconds between the states sent to the remote factory,
+  //which needs to be well below its agent timeout. Defaults to 1000.
+  void heartbeatInterval(boost::int64_t millisec);
+  boost::int64_t heartbeatInterval() const;
+
+  //connect to the remote factory and handle its requests until stop is
+  //called
+  void run();
+
+  //stop a running agent, can be called from any thread
+  void stop();
+
+  bool isRunning() const;
+
+private:
+  Agent(const Agent&);
+  void operator=(const Agent&);
+
+  struct AgentState;
+  boost::shared_ptr<AgentState> State;
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
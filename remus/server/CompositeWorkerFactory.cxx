@@ -0,0 +1,365 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/CompositeWorkerFactory.h>
+
+#include <remus/server/ServerPorts.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+# include <unistd.h>
+#endif
+
+namespace remus{
+namespace server{
+
+//----------------------------------------------------------------------------
+RoutingPolicy::RoutingPolicy():
+  CheapJobCost(100),
+  CheapPayloadSize(1024 * 1024),
+  Costs(),
+  PayloadSizes(),
+  Isolation()
+{
+}
+
+//----------------------------------------------------------------------------
+void RoutingPolicy::estimatedCost(const remus::proto::JobRequirements& reqs,
+                                  boost::int64_t millisec)
+{
+  this->Costs[reqs] = millisec;
+}
+
+//----------------------------------------------------------------------------
+boost::int64_t RoutingPolicy::estimatedCost(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  std::map<remus::proto::JobRequirements, boost::int64_t>::const_iterator i =
+                                                        this->Costs.find(reqs);
+  return (i != this->Costs.end()) ? i->second : -1;
+}
+
+//----------------------------------------------------------------------------
+void RoutingPolicy::estimatedPayloadSize(
+                                    const remus::proto::JobRequirements& reqs,
+                                    boost::uint64_t bytes)
+{
+  this->PayloadSizes[reqs] = bytes;
+}
+
+//----------------------------------------------------------------------------
+boost::uint64_t RoutingPolicy::estimatedPayloadSize(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  std::map<remus::proto::JobRequirements, boost::uint64_t>::const_iterator i =
+                                                  this->PayloadSizes.find(reqs);
+  return (i != this->PayloadSizes.end()) ? i->second :
+                                  static_cast<boost::uint64_t>(reqs.requirementsSize());
+}
+
+//----------------------------------------------------------------------------
+void RoutingPolicy::crashIsolation(const remus::proto::JobRequirements& reqs,
+                                   CrashIsolation isolation)
+{
+  this->Isolation[reqs] = isolation;
+}
+
+//----------------------------------------------------------------------------
+RoutingPolicy::CrashIsolation RoutingPolicy::crashIsolation(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  std::map<remus::proto::JobRequirements, CrashIsolation>::const_iterator i =
+                                                    this->Isolation.find(reqs);
+  return (i != this->Isolation.end()) ? i->second : DecideByCost;
+}
+
+//----------------------------------------------------------------------------
+bool RoutingPolicy::preferIsolation(const remus::proto::JobRequirements& reqs,
+                                    boost::int64_t averageJobDuration) const
+{
+  if(this->crashIsolation(reqs) != DecideByCost)
+    {
+    return true;
+    }
+
+  //a worker sharing our process keeps a large payload in the memory of the
+  //server for as long as the job runs
+  if(this->estimatedPayloadSize(reqs) > this->CheapPayloadSize)
+    {
+    return true;
+    }
+
+  boost::int64_t cost = this->estimatedCost(reqs);
+  if(cost < 0)
+    {
+    cost = averageJobDuration;
+    }
+  //with no history assume the job is expensive, as starting a process for
+  //a cheap job costs far less than blocking a thread on an expensive one
+  return cost < 0 || cost > this->CheapJobCost;
+}
+
+//----------------------------------------------------------------------------
+CompositeWorkerFactory::CompositeWorkerFactory():
+  WorkerFactoryBase(),
+  Children(),
+  Routing(),
+  LastUsed(NULL),
+  Port(),
+  ExitDescriptor(-1)
+{
+}
+
+//----------------------------------------------------------------------------
+CompositeWorkerFactory::~CompositeWorkerFactory()
+{
+#ifdef __linux__
+  if(this->ExitDescriptor >= 0)
+    {
+    ::close(this->ExitDescriptor);
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void CompositeWorkerFactory::addFactory(const FactoryPtr& factory,
+                                        bool isolatesCrashes)
+{
+  if(!factory)
+    {
+    return;
+    }
+
+  Child child;
+  child.Factory = factory;
+  child.IsolatesCrashes = isolatesCrashes;
+  this->Children.push_back(child);
+
+  if(this->Port)
+    {
+    factory->portForWorkersToUse(*this->Port);
+    }
+
+#ifdef __linux__
+  //epoll descriptors can watch other epoll descriptors, so a single
+  //descriptor is readable when any child has a worker that exited
+  const int fd = factory->workerExitDescriptor();
+  if(fd >= 0)
+    {
+    if(this->ExitDescriptor < 0)
+      {
+      this->ExitDescriptor = ::epoll_create1(EPOLL_CLOEXEC);
+      }
+    if(this->ExitDescriptor >= 0)
+      {
+      struct epoll_event event;
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      ::epoll_ctl(this->ExitDescriptor, EPOLL_CTL_ADD, fd, &event);
+      }
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void CompositeWorkerFactory::portForWorkersToUse(
+                                    const remus::server::PortConnection& port)
+{
+  this->WorkerFactoryBase::portForWorkersToUse(port);
+  this->Port = boost::make_shared<remus::server::PortConnection>(port);
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    i->Factory->portForWorkersToUse(port);
+    }
+}
+
+//----------------------------------------------------------------------------
+remus::common::MeshIOTypeSet CompositeWorkerFactory::supportedIOTypes() const
+{
+  remus::common::MeshIOTypeSet types;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    const remus::common::MeshIOTypeSet childTypes =
+                                          i->Factory->supportedIOTypes();
+    types.insert(childTypes.begin(), childTypes.end());
+    }
+  return types;
+}
+
+//----------------------------------------------------------------------------
+remus::proto::JobRequirementsSet CompositeWorkerFactory::workerRequirements(
+                                        remus::common::MeshIOType type) const
+{
+  remus::proto::JobRequirementsSet reqs;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    const remus::proto::JobRequirementsSet childReqs =
+                                          i->Factory->workerRequirements(type);
+    reqs.insert(childReqs.begin(), childReqs.end());
+    }
+  return reqs;
+}
+
+//----------------------------------------------------------------------------
+bool CompositeWorkerFactory::haveSupport(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  return !this->route(reqs).empty();
+}
+
+//----------------------------------------------------------------------------
+bool CompositeWorkerFactory::createWorker(
+                        const remus::proto::JobRequirements& reqs,
+                        WorkerFactoryBase::FactoryDeletionBehavior lifespan)
+{
+  if(this->WorkerFactoryBase::spaceFor(reqs) == 0)
+    {
+    return false;
+    }
+
+  const std::vector<const Child*> children = this->route(reqs);
+  for(std::vector<const Child*>::const_iterator i = children.begin();
+      i != children.end(); ++i)
+    {
+    if((*i)->Factory->haveSpaceFor(reqs) &&
+       (*i)->Factory->createWorker(reqs, lifespan))
+      {
+      this->LastUsed = (*i)->Factory.get();
+      return true;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void CompositeWorkerFactory::updateWorkerCount()
+{
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    i->Factory->updateWorkerCount();
+    }
+}
+
+//----------------------------------------------------------------------------
+int CompositeWorkerFactory::workerExitDescriptor() const
+{
+#ifdef __linux__
+  return this->ExitDescriptor;
+#else
+  int descriptor = -1;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    const int fd = i->Factory->workerExitDescriptor();
+    if(fd >= 0 && descriptor >= 0)
+      { //we can't wait on more than one
+      return -1;
+      }
+    descriptor = std::max(descriptor, fd);
+    }
+  return descriptor;
+#endif
+}
+
+//----------------------------------------------------------------------------
+unsigned int CompositeWorkerFactory::currentWorkerCount() const
+{
+  unsigned int count = 0;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    count += i->Factory->currentWorkerCount();
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+unsigned int CompositeWorkerFactory::workerCount(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  unsigned int count = 0;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    if(i->Factory->haveSupport(reqs))
+      {
+      count += i->Factory->workerCount(reqs);
+      }
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+unsigned int CompositeWorkerFactory::spaceFor(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  const unsigned int space = this->WorkerFactoryBase::spaceFor(reqs);
+  if(space == 0)
+    {
+    return 0;
+    }
+
+  unsigned int childSpace = 0;
+  const std::vector<const Child*> children = this->route(reqs);
+  for(std::vector<const Child*>::const_iterator i = children.begin();
+      i != children.end() && childSpace < space; ++i)
+    {
+    const unsigned int s = (*i)->Factory->spaceFor(reqs);
+    childSpace = (s > space - childSpace) ? space : childSpace + s;
+    }
+  return std::min(space, childSpace);
+}
+
+//----------------------------------------------------------------------------
+std::vector<const CompositeWorkerFactory::Child*>
+CompositeWorkerFactory::route(const remus::proto::JobRequirements& reqs) const
+{
+  const bool isolate =
+    this->Routing.preferIsolation(reqs, this->averageJobDuration(reqs));
+  const bool required =
+    this->Routing.crashIsolation(reqs) == RoutingPolicy::RequireIsolation;
+
+  //the children of the preferred kind come first, in the order they were
+  //added, followed by the others when isolation isn't required
+  std::vector<const Child*> preferred, others;
+  for(std::vector<Child>::const_iterator i = this->Children.begin();
+      i != this->Children.end(); ++i)
+    {
+    if(!i->Factory->haveSupport(reqs))
+      {
+      continue;
+      }
+    if(i->IsolatesCrashes == isolate)
+      {
+      preferred.push_back(&(*i));
+      }
+    else if(!required)
+      {
+      others.push_back(&(*i));
+      }
+    }
+  preferred.insert(preferred.end(), others.begin(), others.end());
+  return preferred;
+}
+
+}
+}
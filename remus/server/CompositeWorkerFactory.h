@@ -0,0 +1,200 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_CompositeWorkerFactory_h
+#define remus_server_CompositeWorkerFactory_h
+
+#include <map>
+#include <vector>
+
+//included for export symbols
+#include <remus/server/ServerExports.h>
+#include <remus/server/WorkerFactoryBase.h>
+
+#include <remus/common/CompilerInformation.h>
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace server{
+
+//helper class that describes which kind of factory the
+//CompositeWorkerFactory should launch workers of a given requirements with.
+//Cheap jobs with small payloads are best run by factories that share the
+//process of the server, such as the ThreadWorkerFactory, which start workers
+//quickly. Expensive jobs, jobs with large payloads, and jobs whose workers
+//might crash are best run by factories that isolate their workers in their
+//own process, such as the WorkerFactory.
+//
+//The cost of a job is the estimated cost given for its requirements, or
+//else the average duration of the jobs with the requirements that have
+//finished. Until a job with the requirements has finished we assume jobs
+//are expensive.
+class REMUSSERVER_EXPORT RoutingPolicy
+{
+public:
+  enum CrashIsolation
+  {
+    //decide by the cost and payload size of the job
+    DecideByCost,
+    //prefer factories that isolate crashes, but fall back to the others
+    //when they have no space
+    PreferIsolation,
+    //only launch with factories that isolate crashes
+    RequireIsolation
+  };
+
+  //by default jobs that take up to 100 milliseconds with payloads of up to
+  //a megabyte are cheap
+  RoutingPolicy();
+
+  //the cost in milliseconds up to which a job is cheap
+  void cheapJobCost(boost::int64_t millisec) { this->CheapJobCost = millisec; }
+  boost::int64_t cheapJobCost() const { return this->CheapJobCost; }
+
+  //the payload size in bytes up to which a job is cheap
+  void cheapPayloadSize(boost::uint64_t bytes) { this->CheapPayloadSize = bytes; }
+  boost::uint64_t cheapPayloadSize() const { return this->CheapPayloadSize; }
+
+  //estimate how long in milliseconds jobs with the given requirements
+  //take, instead of relying on the durations of finished jobs. Returns -1
+  //for requirements without an estimate.
+  void estimatedCost(const remus::proto::JobRequirements& reqs,
+                     boost::int64_t millisec);
+  boost::int64_t estimatedCost(const remus::proto::JobRequirements& reqs) const;
+
+  //estimate the size in bytes of the payload of jobs with the given
+  //requirements. Requirements without an estimate use the size of the
+  //requirements themselves.
+  void estimatedPayloadSize(const remus::proto::JobRequirements& reqs,
+                            boost::uint64_t bytes);
+  boost::uint64_t estimatedPayloadSize(
+                            const remus::proto::JobRequirements& reqs) const;
+
+  //set if workers with the given requirements should be isolated from
+  //crashes. Defaults to DecideByCost.
+  void crashIsolation(const remus::proto::JobRequirements& reqs,
+                      CrashIsolation isolation);
+  CrashIsolation crashIsolation(const remus::proto::JobRequirements& reqs) const;
+
+  //returns true if workers with the given requirements should be launched
+  //by a factory that isolates crashes, given the average duration of the
+  //finished jobs with the requirements, which is negative when none have
+  //finished
+  bool preferIsolation(const remus::proto::JobRequirements& reqs,
+                       boost::int64_t averageJobDuration) const;
+
+private:
+  boost::int64_t CheapJobCost;
+  boost::uint64_t CheapPayloadSize;
+  std::map<remus::proto::JobRequirements, boost::int64_t> Costs;
+  std::map<remus::proto::JobRequirements, boost::uint64_t> PayloadSizes;
+  std::map<remus::proto::JobRequirements, CrashIsolation> Isolation;
+};
+
+//The Composite Worker Factory.
+//Owns several worker factories and acts as a single factory for the server,
+//so that one server can launch workers as threads and as processes.
+//Each child is added stating whether it isolates crashes of its workers.
+//createWorker asks the RoutingPolicy which kind of child suits the
+//requirements, and launches the worker with the first child of that kind
+//that supports the requirements and has space for them, falling back to
+//the children of the other kind unless isolation is required.
+//
+//The supported types, requirements and worker counts are those of all the
+//children together. The max worker count of the composite limits the total
+//number of workers, while each child keeps its own max worker count.
+class REMUSSERVER_EXPORT CompositeWorkerFactory : public WorkerFactoryBase
+{
+public:
+  typedef boost::shared_ptr<WorkerFactoryBase> FactoryPtr;
+
+  //defaults to a maximum of 1 worker at once, like all factories
+  CompositeWorkerFactory();
+
+  virtual ~CompositeWorkerFactory();
+
+  //add a child factory, which can't be removed. isolatesCrashes states
+  //if the workers of the factory run in their own process, so that their
+  //crashes don't take down the server
+  void addFactory(const FactoryPtr& factory, bool isolatesCrashes);
+
+  std::size_t numberOfFactories() const { return this->Children.size(); }
+
+  //the child factory that launched the last worker that was created,
+  //or NULL when no worker has been created
+  const WorkerFactoryBase* lastFactoryUsed() const { return this->LastUsed; }
+
+  //Set the policy that routes requirements to the child factories
+  void routingPolicy(const RoutingPolicy& policy) { this->Routing = policy; }
+  const RoutingPolicy& routingPolicy() const { return this->Routing; }
+
+  //passes the port on to all the child factories, including the ones
+  //added afterwards
+  virtual void portForWorkersToUse(const remus::server::PortConnection& port);
+
+  virtual remus::common::MeshIOTypeSet supportedIOTypes() const;
+
+  virtual remus::proto::JobRequirementsSet workerRequirements(
+                                       remus::common::MeshIOType type) const;
+
+  virtual bool haveSupport(const remus::proto::JobRequirements& reqs) const;
+
+  virtual bool createWorker(const remus::proto::JobRequirements& type,
+                            WorkerFactoryBase::FactoryDeletionBehavior lifespan);
+
+  virtual void updateWorkerCount();
+
+  //readable when a worker of any child has exited. On Linux the
+  //descriptors of the children are gathered with epoll, elsewhere this is
+  //the descriptor of the only child that has one, or -1
+  virtual int workerExitDescriptor() const;
+
+  virtual unsigned int currentWorkerCount() const;
+
+  virtual unsigned int workerCount(const remus::proto::JobRequirements& reqs) const;
+
+  //limited by the max worker count of the composite, and by the space
+  //the children have for the requirements
+  virtual unsigned int spaceFor(const remus::proto::JobRequirements& reqs) const;
+
+private:
+  CompositeWorkerFactory(const CompositeWorkerFactory&);
+  void operator=(const CompositeWorkerFactory&);
+
+  struct Child
+  {
+    FactoryPtr Factory;
+    bool IsolatesCrashes;
+  };
+
+  //the children that can launch workers with the requirements, in the
+  //order they should be tried
+  std::vector<const Child*> route(const remus::proto::JobRequirements& reqs) const;
+
+  std::vector<Child> Children;
+  RoutingPolicy Routing;
+  const WorkerFactoryBase* LastUsed;
+  boost::shared_ptr<remus::server::PortConnection> Port;
+  int ExitDescriptor;
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
@@ -24,8 +24,10 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/filesystem.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
 
 namespace {
   using namespace remus;
@@ -188,6 +190,24 @@ namespace {
           env[oneenv->string] = oneenv->valuestring;
       }
 
+    // Add the limits and resource costs of the worker, negative values are
+    // treated the same as not providing them
+    double maxWorkers = 0;
+    double cpuCost = 0;
+    double memoryCost = 0;
+    cJSON* maxobj = cJSON_GetObjectItem(root, "MaxWorkerCount");
+    if (maxobj && maxobj->type == cJSON_Number && maxobj->valuedouble > 0)
+      maxWorkers = std::min(maxobj->valuedouble,
+                   static_cast<double>(std::numeric_limits<unsigned int>::max()));
+    cJSON* cpuobj = cJSON_GetObjectItem(root, "CpuCost");
+    if (cpuobj && cpuobj->type == cJSON_Number && cpuobj->valuedouble > 0)
+      cpuCost = cpuobj->valuedouble;
+    cJSON* memobj = cJSON_GetObjectItem(root, "MemoryCost");
+    if (memobj && memobj->type == cJSON_Number && memobj->valuedouble > 0)
+      memoryCost = memobj->valuedouble;
+    cJSON* zygoteobj = cJSON_GetObjectItem(root, "Zygote");
+    const bool zygote = zygoteobj && zygoteobj->type == cJSON_True;
+
     cJSON_Delete(root);
 
     //try the executableName as an absolute path, also try
@@ -235,7 +255,12 @@ namespace {
       mesher_path = new_path;
       }
 
-    return remus::server::FactoryWorkerSpecification(mesher_path, cmdline, env, reqs);
+    remus::server::FactoryWorkerSpecification spec(mesher_path, cmdline, env, reqs);
+    spec.MaxWorkerCount = static_cast<unsigned int>(maxWorkers);
+    spec.CpuCost = cpuCost;
+    spec.MemoryCost = static_cast<boost::uint64_t>(memoryCost);
+    spec.Zygote = zygote;
+    return spec;
   }
 }
 
@@ -27,6 +27,10 @@ namespace server{
     ExecutionPath(),
     ExtraCommandLineArguments(),
     EnvironmentVariables(),
+    MaxWorkerCount(0),
+    CpuCost(0),
+    MemoryCost(0),
+    Zygote(false),
     isValid(false)
     {
     }
@@ -39,6 +43,10 @@ namespace server{
     ExecutionPath(),
     ExtraCommandLineArguments(),
     EnvironmentVariables(),
+    MaxWorkerCount(0),
+    CpuCost(0),
+    MemoryCost(0),
+    Zygote(false),
     isValid(false)
     {
     if(boost::filesystem::is_regular_file(exec_path))
@@ -58,6 +66,10 @@ namespace server{
     ExecutionPath(),
     ExtraCommandLineArguments(extra_args),
     EnvironmentVariables(),
+    MaxWorkerCount(0),
+    CpuCost(0),
+    MemoryCost(0),
+    Zygote(false),
     isValid(false)
     {
     if(boost::filesystem::is_regular_file(exec_path))
@@ -78,6 +90,10 @@ namespace server{
     ExecutionPath(),
     ExtraCommandLineArguments(extra_args),
     EnvironmentVariables(environment),
+    MaxWorkerCount(0),
+    CpuCost(0),
+    MemoryCost(0),
+    Zygote(false),
     isValid(false)
     {
     if(boost::filesystem::is_regular_file(exec_path))
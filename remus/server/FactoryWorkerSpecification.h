@@ -23,6 +23,7 @@
 //force to use filesystem version 3
 REMUS_THIRDPARTY_PRE_INCLUDE
 #define BOOST_FILESYSTEM_VERSION 3
+#include <boost/cstdint.hpp>
 #include <boost/filesystem.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
@@ -41,6 +42,15 @@ namespace server{
 //factory can launch. Currently the ExtraCommandLineArguments and
 //EnvironmentVariables are ignored by the default WorkerFactory, but
 //exist to allow for better worker factories designed by users of remus
+//
+//MaxWorkerCount limits how many of these workers can be running at once,
+//with zero meaning no limit beyond the factory's. CpuCost is the number of
+//cores a running worker uses, and MemoryCost the megabytes of memory, both
+//default to zero which means the worker isn't counted against the capacity
+//of the host.
+//
+//When Zygote is true the factory starts the executable once as a zygote,
+//and forks workers from it on demand. See remus/worker/Zygote.h
 struct REMUSSERVER_EXPORT FactoryWorkerSpecification
 {
   FactoryWorkerSpecification();
@@ -61,6 +71,10 @@ struct REMUSSERVER_EXPORT FactoryWorkerSpecification
   boost::filesystem::path ExecutionPath;
   std::vector< std::string > ExtraCommandLineArguments;
   std::map< std::string, std::string > EnvironmentVariables;
+  unsigned int MaxWorkerCount;
+  double CpuCost;
+  boost::uint64_t MemoryCost;
+  bool Zygote;
   bool isValid;
 };
 
@@ -0,0 +1,141 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/HostCapacity.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+//costs are summed as doubles, so allow for a little rounding error when
+//checking if another worker fits
+const double costTolerance = 1e-9;
+
+//----------------------------------------------------------------------------
+//count the processor entries of a cpuinfo file
+double read_cpuinfo(const std::string& path)
+{
+  std::ifstream f(path.c_str());
+  std::string line;
+  double cores = 0;
+  while(std::getline(f,line))
+    {
+    if(line.compare(0, 9, "processor") == 0)
+      {
+      ++cores;
+      }
+    }
+  return cores;
+}
+
+//----------------------------------------------------------------------------
+//find the MemTotal of a meminfo file and convert it from kB to megabytes
+boost::uint64_t read_meminfo(const std::string& path)
+{
+  std::ifstream f(path.c_str());
+  std::string line;
+  while(std::getline(f,line))
+    {
+    if(line.compare(0, 9, "MemTotal:") == 0)
+      {
+      std::istringstream buffer(line.substr(9));
+      boost::uint64_t kilobytes = 0;
+      buffer >> kilobytes;
+      return kilobytes / 1024;
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned int fit(double capacity, double used, double cost)
+{
+  if(cost <= 0 || capacity <= 0)
+    {
+    return std::numeric_limits<unsigned int>::max();
+    }
+  if(used <= 0 && cost > capacity)
+    { //nothing is running, so let a worker bigger than the host run alone
+    return 1;
+    }
+
+  const double left = capacity - used + costTolerance;
+  if(left < cost)
+    {
+    return 0;
+    }
+  const double count = std::floor(left / cost);
+  return static_cast<unsigned int>(std::min(count,
+          static_cast<double>(std::numeric_limits<unsigned int>::max())));
+}
+}
+
+namespace remus{
+namespace server{
+
+//----------------------------------------------------------------------------
+HostCapacity::HostCapacity():
+  Cores(0),
+  Memory(0)
+{
+}
+
+//----------------------------------------------------------------------------
+HostCapacity::HostCapacity(double cores, boost::uint64_t memoryInMegabytes):
+  Cores(std::max(0.0, cores)),
+  Memory(memoryInMegabytes)
+{
+}
+
+//----------------------------------------------------------------------------
+HostCapacity HostCapacity::discover()
+{
+#ifdef __linux__
+  HostCapacity capacity = HostCapacity::fromProc("/proc");
+  if(capacity.Cores > 0)
+    {
+    return capacity;
+    }
+  //fall back to the hardware concurrency when cpuinfo can't be read
+  capacity.Cores = static_cast<double>(std::thread::hardware_concurrency());
+  return capacity;
+#else
+  return HostCapacity(static_cast<double>(std::thread::hardware_concurrency()), 0);
+#endif
+}
+
+//----------------------------------------------------------------------------
+HostCapacity HostCapacity::fromProc(const std::string& procDirectory)
+{
+  return HostCapacity( read_cpuinfo(procDirectory + "/cpuinfo"),
+                       read_meminfo(procDirectory + "/meminfo") );
+}
+
+//----------------------------------------------------------------------------
+unsigned int HostCapacity::workersThatFit(double usedCores,
+                                          boost::uint64_t usedMemory,
+                                          double cpuCost,
+                                          boost::uint64_t memoryCost) const
+{
+  return std::min( fit(this->Cores, usedCores, cpuCost),
+                   fit(static_cast<double>(this->Memory),
+                       static_cast<double>(usedMemory),
+                       static_cast<double>(memoryCost)) );
+}
+
+}
+}
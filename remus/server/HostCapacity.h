@@ -0,0 +1,69 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_HostCapacity_h
+#define remus_server_HostCapacity_h
+
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <string>
+
+//included for export symbols
+#include <remus/server/ServerExports.h>
+
+namespace remus{
+namespace server{
+
+//Describes the cores and memory of the machine that a worker factory
+//launches workers on. The factory admits a worker only when the CpuCost
+//and MemoryCost of its specification fit in what is left of the capacity
+//after the workers that are already running.
+//A capacity of zero cores or zero megabytes means that resource is
+//unlimited, which is also what the default constructor gives.
+class REMUSSERVER_EXPORT HostCapacity
+{
+public:
+  HostCapacity();
+  HostCapacity(double cores, boost::uint64_t memoryInMegabytes);
+
+  //the capacity of the machine we are running on. On Linux this is read
+  //from /proc, on other platforms the cores are the hardware concurrency
+  //and the memory is unlimited.
+  static HostCapacity discover();
+
+  //read the capacity from the cpuinfo and meminfo files of the given proc
+  //directory. Files that can't be read leave that resource unlimited.
+  static HostCapacity fromProc(const std::string& procDirectory);
+
+  double cores() const { return this->Cores; }
+  boost::uint64_t memory() const { return this->Memory; }
+
+  //the number of workers with the given costs that fit in the capacity
+  //left over after the given usage. Workers that cost more than the whole
+  //host are allowed when nothing else is using it, otherwise they could
+  //never be launched.
+  unsigned int workersThatFit(double usedCores, boost::uint64_t usedMemory,
+                              double cpuCost, boost::uint64_t memoryCost) const;
+
+private:
+  double Cores;
+  boost::uint64_t Memory;
+};
+
+}
+}
+
+#endif
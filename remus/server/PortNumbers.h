@@ -29,6 +29,11 @@ static const int WORKER_PORT = 50510;
 //port to watch the status of jobs, see the health of the server, etc.
 static const int STATUS_PORT = 50550;
 
+//remus::server::AGENT_PORT is the port that remus-agents connect on, to
+//tell a RemoteWorkerFactory what workers they can launch, and to be asked
+//to launch them
+static const int AGENT_PORT = 50560;
+
 }
 }
 
@@ -0,0 +1,443 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/RemoteWorkerFactory.h>
+
+#include <remus/common/Timer.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/server/detail/AgentMessages.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace
+{
+  //the workers of one type that an agent can launch, as last reported by
+  //the agent, corrected for the launches it hasn't handled yet
+  struct WorkerSlots
+  {
+    WorkerSlots(): ReportedSpace(0), ReportedRunning(0), Launched(0), Sent(0) {}
+
+    unsigned long pending() const
+      { return (this->Sent > this->Launched) ? this->Sent - this->Launched : 0; }
+
+    unsigned int space() const
+      {
+      const unsigned long p = this->pending();
+      return (this->ReportedSpace > p) ?
+                  static_cast<unsigned int>(this->ReportedSpace - p) : 0;
+      }
+
+    unsigned int running() const
+      { return this->ReportedRunning + static_cast<unsigned int>(this->pending()); }
+
+    unsigned int ReportedSpace;
+    unsigned int ReportedRunning;
+    //the launches the agent has handled, and the ones we sent it
+    unsigned long Launched;
+    unsigned long Sent;
+  };
+
+  typedef std::map< remus::proto::JobRequirements, WorkerSlots > SlotMap;
+
+  struct AgentInfo
+  {
+    AgentInfo(): Name(), LastHeard(0), Workers() {}
+    std::string Name;
+    boost::int64_t LastHeard;
+    SlotMap Workers;
+  };
+
+  //agents are keyed by the identity the ROUTER socket gave them
+  typedef std::map< std::string, AgentInfo > AgentMap;
+}
+
+namespace remus{
+namespace server{
+
+//----------------------------------------------------------------------------
+struct RemoteWorkerFactory::AgentTracker
+{
+  AgentTracker(const std::string& host, int port):
+    Context(1),
+    Socket(Context, ZMQ_ROUTER),
+    Endpoint(),
+    Timeout(5000),
+    Clock(),
+    Agents()
+    {
+    //report agents that went away when we send to them, instead of
+    //dropping the message
+    const int mandatory = 1;
+    this->Socket.setsockopt(ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(int));
+
+    zmq::socketInfo<zmq::proto::tcp> info(host, port);
+    this->Endpoint = zmq::bindToAddress(this->Socket, info).endpoint();
+    }
+
+  //read all waiting messages, and forget the agents that timed out
+  void refresh();
+
+  //send a message to the agent, returns false if the agent is gone
+  bool send(const std::string& identity,
+            const std::vector<std::string>& frames);
+
+  void handleState(const std::vector<std::string>& frames);
+
+  zmq::context_t Context;
+  zmq::socket_t Socket;
+  std::string Endpoint;
+  boost::int64_t Timeout;
+  remus::common::Timer Clock;
+  AgentMap Agents;
+};
+
+//----------------------------------------------------------------------------
+void RemoteWorkerFactory::AgentTracker::refresh()
+{
+  std::vector<std::string> frames;
+  while(remus::server::detail::recv_frames(this->Socket, frames))
+    {
+    if(frames.size() >= 3 &&
+       frames[1] == remus::server::detail::agent_message::State)
+      {
+      this->handleState(frames);
+      }
+    }
+
+  const boost::int64_t now = this->Clock.elapsed();
+  for(AgentMap::iterator i = this->Agents.begin(); i != this->Agents.end(); )
+    {
+    if(now - i->second.LastHeard > this->Timeout)
+      {
+      this->Agents.erase(i++);
+      }
+    else
+      {
+      ++i;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void RemoteWorkerFactory::AgentTracker::handleState(
+                                      const std::vector<std::string>& frames)
+{
+  AgentInfo& agent = this->Agents[frames[0]];
+  agent.Name = frames[2];
+  agent.LastHeard = this->Clock.elapsed();
+
+  //the state of the agent replaces the counts we had, but we keep counting
+  //the launches we sent that it hasn't handled yet
+  SlotMap workers;
+  for(std::size_t i=3; i + 1 < frames.size(); i+=2)
+    {
+    const remus::proto::JobRequirements reqs =
+                              remus::proto::to_JobRequirements(frames[i+1]);
+    WorkerSlots& slots = workers[reqs];
+    std::istringstream counts(frames[i]);
+    counts >> slots.ReportedSpace >> slots.ReportedRunning >> slots.Launched;
+
+    SlotMap::const_iterator known = agent.Workers.find(reqs);
+    slots.Sent = (known != agent.Workers.end()) ? known->second.Sent :
+                                                  slots.Launched;
+    }
+  agent.Workers.swap(workers);
+}
+
+//----------------------------------------------------------------------------
+bool RemoteWorkerFactory::AgentTracker::send(
+                                      const std::string& identity,
+                                      const std::vector<std::string>& frames)
+{
+  std::vector<std::string> message(1, identity);
+  message.insert(message.end(), frames.begin(), frames.end());
+  try
+    {
+    return remus::server::detail::send_frames(this->Socket, message);
+    }
+  catch(zmq::error_t&)
+    { //the agent has disconnected
+    this->Agents.erase(identity);
+    return false;
+    }
+}
+
+//----------------------------------------------------------------------------
+RemoteWorkerFactory::RemoteWorkerFactory():
+  WorkerFactoryBase(),
+  Tracker(boost::make_shared<AgentTracker>("*", remus::server::AGENT_PORT))
+{
+}
+
+//----------------------------------------------------------------------------
+RemoteWorkerFactory::RemoteWorkerFactory(const std::string& host, int port):
+  WorkerFactoryBase(),
+  Tracker(boost::make_shared<AgentTracker>(host, port))
+{
+}
+
+//----------------------------------------------------------------------------
+RemoteWorkerFactory::~RemoteWorkerFactory()
+{
+  //all our workers are KillOnFactoryDeletion, the linger of the socket
+  //gives the messages time to be sent
+  const std::vector<std::string> kill(1,
+                                remus::server::detail::agent_message::Kill);
+  AgentMap agents = this->Tracker->Agents;
+  for(AgentMap::const_iterator i = agents.begin(); i != agents.end(); ++i)
+    {
+    this->Tracker->send(i->first, kill);
+    }
+}
+
+//----------------------------------------------------------------------------
+const std::string& RemoteWorkerFactory::agentEndpoint() const
+{
+  return this->Tracker->Endpoint;
+}
+
+//----------------------------------------------------------------------------
+void RemoteWorkerFactory::agentTimeout(boost::int64_t millisec)
+{
+  this->Tracker->Timeout = millisec;
+}
+
+//----------------------------------------------------------------------------
+boost::int64_t RemoteWorkerFactory::agentTimeout() const
+{
+  return this->Tracker->Timeout;
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> RemoteWorkerFactory::agentNames() const
+{
+  this->Tracker->refresh();
+  std::vector<std::string> names;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    names.push_back(i->second.Name);
+    }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+//----------------------------------------------------------------------------
+unsigned int RemoteWorkerFactory::agentWorkerCount(const std::string& name) const
+{
+  this->Tracker->refresh();
+  unsigned int count = 0;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    if(i->second.Name == name)
+      {
+      for(SlotMap::const_iterator w = i->second.Workers.begin();
+          w != i->second.Workers.end(); ++w)
+        {
+        count += w->second.running();
+        }
+      }
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+remus::common::MeshIOTypeSet RemoteWorkerFactory::supportedIOTypes() const
+{
+  this->Tracker->refresh();
+  remus::common::MeshIOTypeSet types;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    for(SlotMap::const_iterator w = i->second.Workers.begin();
+        w != i->second.Workers.end(); ++w)
+      {
+      types.insert(w->first.meshTypes());
+      }
+    }
+  return types;
+}
+
+//----------------------------------------------------------------------------
+remus::proto::JobRequirementsSet RemoteWorkerFactory::workerRequirements(
+                                        remus::common::MeshIOType type) const
+{
+  this->Tracker->refresh();
+  remus::proto::JobRequirementsSet reqs;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    for(SlotMap::const_iterator w = i->second.Workers.begin();
+        w != i->second.Workers.end(); ++w)
+      {
+      if(w->first.meshTypes() == type)
+        {
+        reqs.insert(w->first);
+        }
+      }
+    }
+  return reqs;
+}
+
+//----------------------------------------------------------------------------
+bool RemoteWorkerFactory::haveSupport(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  this->Tracker->refresh();
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    if(i->second.Workers.count(reqs) > 0)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool RemoteWorkerFactory::createWorker(
+                        const remus::proto::JobRequirements& reqs,
+                        WorkerFactoryBase::FactoryDeletionBehavior lifespan)
+{
+  //we can't kill the workers that live on after us
+  if(lifespan == WorkerFactoryBase::LiveOnFactoryDeletion)
+    {
+    return false;
+    }
+
+  this->Tracker->refresh();
+  if(!this->haveSpaceFor(reqs))
+    {
+    return false;
+    }
+
+  //spread the workers over the agents, by using the one with the most
+  //space left for the requirements
+  AgentMap::iterator best = this->Tracker->Agents.end();
+  unsigned int bestSpace = 0;
+  for(AgentMap::iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    SlotMap::const_iterator w = i->second.Workers.find(reqs);
+    if(w != i->second.Workers.end() && w->second.space() > bestSpace)
+      {
+      best = i;
+      bestSpace = w->second.space();
+      }
+    }
+  if(best == this->Tracker->Agents.end())
+    {
+    return false;
+    }
+
+  std::vector<std::string> launch;
+  launch.push_back(remus::server::detail::agent_message::Launch);
+  launch.push_back(remus::proto::to_string(reqs));
+  launch.push_back(this->workerEndpoint());
+  const std::string identity = best->first;
+  const bool sent = this->Tracker->send(identity, launch);
+  if(sent)
+    {
+    //count the worker until the agent tells us it handled the launch
+    ++best->second.Workers[reqs].Sent;
+    }
+
+  //the ZMQ_FD of the socket is edge triggered, and sending can consume
+  //the edge of messages that arrived meanwhile. Read them now, otherwise
+  //the server wouldn't be woken up for them
+  this->Tracker->refresh();
+  return sent;
+}
+
+//----------------------------------------------------------------------------
+void RemoteWorkerFactory::updateWorkerCount()
+{
+  this->Tracker->refresh();
+}
+
+//----------------------------------------------------------------------------
+int RemoteWorkerFactory::workerExitDescriptor() const
+{
+#ifndef _WIN32
+  int fd = -1;
+  std::size_t size = sizeof(fd);
+  this->Tracker->Socket.getsockopt(ZMQ_FD, &fd, &size);
+  return fd;
+#else
+  //the descriptor is a SOCKET which doesn't fit in an int
+  return -1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+unsigned int RemoteWorkerFactory::currentWorkerCount() const
+{
+  this->Tracker->refresh();
+  unsigned int count = 0;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    for(SlotMap::const_iterator w = i->second.Workers.begin();
+        w != i->second.Workers.end(); ++w)
+      {
+      count += w->second.running();
+      }
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+unsigned int RemoteWorkerFactory::workerCount(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  this->Tracker->refresh();
+  unsigned int count = 0;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end(); ++i)
+    {
+    SlotMap::const_iterator w = i->second.Workers.find(reqs);
+    if(w != i->second.Workers.end())
+      {
+      count += w->second.running();
+      }
+    }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+unsigned int RemoteWorkerFactory::spaceFor(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  const unsigned int space = this->WorkerFactoryBase::spaceFor(reqs);
+  unsigned int agentSpace = 0;
+  for(AgentMap::const_iterator i = this->Tracker->Agents.begin();
+      i != this->Tracker->Agents.end() && agentSpace < space; ++i)
+    {
+    SlotMap::const_iterator w = i->second.Workers.find(reqs);
+    if(w != i->second.Workers.end())
+      {
+      agentSpace += std::min(w->second.space(), space - agentSpace);
+      }
+    }
+  return std::min(space, agentSpace);
+}
+
+}
+}
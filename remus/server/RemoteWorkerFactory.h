@@ -0,0 +1,120 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_RemoteWorkerFactory_h
+#define remus_server_RemoteWorkerFactory_h
+
+#include <string>
+#include <vector>
+
+//included for export symbols
+#include <remus/server/ServerExports.h>
+#include <remus/server/PortNumbers.h>
+#include <remus/server/WorkerFactoryBase.h>
+
+#include <remus/common/CompilerInformation.h>
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace server{
+
+//The Remote Worker Factory.
+//Launches workers on other hosts through the remus-agent that runs on each
+//of them. Agents connect to the agent port of the factory, and tell it on
+//every heartbeat which workers they can launch, and how many more of each
+//fit on their host. createWorker asks the agent with the most space for the
+//requirements to launch the worker, which connects back to the worker
+//endpoint of the server like any other worker.
+//
+//The factory counts the workers it asked for until the agent reports its
+//own counts, and forgets about agents it hasn't heard from for the agent
+//timeout. Agents kill the workers they launched for the factory when it is
+//deleted.
+//
+//Messages from the agents are read whenever the factory is used, and the
+//workerExitDescriptor is readable when messages are waiting, so that the
+//server reads them right away.
+class REMUSSERVER_EXPORT RemoteWorkerFactory : public WorkerFactoryBase
+{
+public:
+  //listen for agents on all interfaces, on the first free port starting
+  //at remus::server::AGENT_PORT
+  RemoteWorkerFactory();
+
+  //listen for agents on the given host, on the first free port starting
+  //at the given port
+  RemoteWorkerFactory(const std::string& host, int port);
+
+  virtual ~RemoteWorkerFactory();
+
+  //the endpoint the factory is bound to, which agents connect to
+  const std::string& agentEndpoint() const;
+
+  //the time in milliseconds after the last heartbeat of an agent that we
+  //forget about it. Defaults to 5000.
+  void agentTimeout(boost::int64_t millisec);
+  boost::int64_t agentTimeout() const;
+
+  //the names of the agents we have heard from
+  std::vector<std::string> agentNames() const;
+
+  //the number of workers launched through the agent with the given name
+  unsigned int agentWorkerCount(const std::string& name) const;
+
+  virtual remus::common::MeshIOTypeSet supportedIOTypes() const;
+
+  virtual remus::proto::JobRequirementsSet workerRequirements(
+                                       remus::common::MeshIOType type) const;
+
+  virtual bool haveSupport(const remus::proto::JobRequirements& reqs) const;
+
+  //ask an agent to launch a worker. Like the WorkerFactory we can't
+  //support workers that live on after the factory is deleted
+  virtual bool createWorker(const remus::proto::JobRequirements& type,
+                            WorkerFactoryBase::FactoryDeletionBehavior lifespan);
+
+  //reads the messages from the agents, and forgets the agents that
+  //timed out
+  virtual void updateWorkerCount();
+
+  //becomes readable when messages from the agents arrive. Every use of
+  //the factory reads all waiting messages, so that the edge triggered
+  //descriptor signals the next message. Returns -1 on Windows
+  virtual int workerExitDescriptor() const;
+
+  virtual unsigned int currentWorkerCount() const;
+
+  virtual unsigned int workerCount(const remus::proto::JobRequirements& reqs) const;
+
+  //limited by the max worker count of the factory, and by the space the
+  //agents have left for the requirements
+  virtual unsigned int spaceFor(const remus::proto::JobRequirements& reqs) const;
+
+private:
+  RemoteWorkerFactory(const RemoteWorkerFactory&);
+  void operator=(const RemoteWorkerFactory&);
+
+  struct AgentTracker;
+  boost::shared_ptr<AgentTracker> Tracker;
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
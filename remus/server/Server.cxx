@@ -16,14 +16,18 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/thread.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <remus/proto/DirectTransport.h>
 #include <remus/proto/Job.h>
 #include <remus/proto/JobResult.h>
 #include <remus/proto/JobStatus.h>
 #include <remus/proto/JobRequirements.h>
 #include <remus/proto/Message.h>
+#include <remus/proto/QueueSummary.h>
 #include <remus/proto/Response.h>
 #include <remus/proto/zmqSocketIdentity.h>
 #include <remus/proto/zmqHelper.h>
@@ -35,12 +39,18 @@ REMUS_THIRDPARTY_POST_INCLUDE
 #include <remus/server/detail/uuidHelper.h>
 #include <remus/server/detail/ActiveJobs.h>
 #include <remus/server/detail/EventPublisher.h>
+#include <remus/server/detail/Federation.h>
 #include <remus/server/detail/JobQueue.h>
 #include <remus/server/detail/SocketMonitor.h>
+#include <remus/server/detail/TimingWheel.h>
+#include <remus/server/detail/WarmPool.h>
 #include <remus/server/detail/WorkerPool.h>
 #include <remus/server/WorkerFactory.h>
 
+#include <algorithm>
+#include <map>
 #include <set>
+#include <sstream>
 #include <ctime>
 
 namespace remus{
@@ -75,6 +85,69 @@ void send_terminateJob(boost::uuids::uuid jobId,
                                          workerId);
 }
 
+//------------------------------------------------------------------------------
+//messages to peers start with the client endpoint of the sender, so that
+//the peer can reach the sender through its own link to it
+std::string make_peerMessage(const std::string& endpoint,
+                             const std::string& payload)
+{
+  return endpoint + "\n" + payload;
+}
+
+//------------------------------------------------------------------------------
+void split_peerMessage(const remus::proto::Message& msg,
+                       std::string& endpoint,
+                       std::string& payload)
+{
+  const std::string data(msg.data(), msg.dataSize());
+  const std::string::size_type newline = data.find('\n');
+  endpoint = data.substr(0, newline);
+  payload = (newline == std::string::npos) ? std::string() :
+                                             data.substr(newline + 1);
+}
+
+//------------------------------------------------------------------------------
+//peers acknowledge the jobs we forward with the ids of the jobs they
+//queued, one per line
+std::string make_jobAcks(const std::vector<boost::uuids::uuid>& ids)
+{
+  std::string acks;
+  typedef std::vector<boost::uuids::uuid>::const_iterator it;
+  for(it i = ids.begin(); i != ids.end(); ++i)
+    {
+    acks += remus::to_string(*i) + "\n";
+    }
+  return acks;
+}
+
+//------------------------------------------------------------------------------
+std::vector<boost::uuids::uuid> split_jobAcks(const char* data,
+                                              std::size_t size)
+{
+  std::vector<boost::uuids::uuid> ids;
+  std::istringstream buffer(std::string(data, size));
+  std::string line;
+  while(std::getline(buffer, line))
+    {
+    const boost::uuids::uuid id = remus::to_uuid(line);
+    if(!id.is_nil())
+      {
+      ids.push_back(id);
+      }
+    }
+  return ids;
+}
+
+//------------------------------------------------------------------------------
+//keeps the earliest of two times, where a negative time is unset
+inline void keep_earliest(boost::int64_t& earliest, boost::int64_t t)
+{
+  if(t >= 0 && (earliest < 0 || t < earliest))
+    {
+    earliest = t;
+    }
+}
+
 //------------------------------------------------------------------------------
 struct UUIDManagement
 {
@@ -103,7 +176,10 @@ struct ThreadManagement
     BrokerThread( new boost::thread() ),
     BrokeringStatus(),
     BrokerStatusChanged(),
-    BrokerIsRunning(false)
+    BrokerIsRunning(false),
+    WakeupContext(),
+    WakeupEndpoint(),
+    WorkerMonitorEndpoint()
   {
   }
 
@@ -122,7 +198,8 @@ struct ThreadManagement
 
   //----------------------------------------------------------------------------
   bool start(remus::server::Server* server,
-             remus::server::Server::SignalHandling sigHandleState)
+             remus::server::Server::SignalHandling sigHandleState,
+             const boost::shared_ptr<zmq::context_t>& context)
   {
   bool launchThread = false;
 
@@ -132,6 +209,8 @@ struct ThreadManagement
     launchThread = !this->BrokerIsRunning;
     if(launchThread)
       {
+      this->WakeupContext = context;
+      this->generateEndpoints();
       boost::scoped_ptr<boost::thread> bthread(
         new  boost::thread(&Server::Brokering, server, sigHandleState) );
       this->BrokerThread.swap(bthread);
@@ -149,9 +228,35 @@ struct ThreadManagement
   void stop()
   {
   this->setIsBrokering(false);
+  this->wakeup();
   this->BrokerThread->join();
   }
 
+  //----------------------------------------------------------------------------
+  //interrupt the broker if it is blocked waiting for messages
+  void wakeup()
+  {
+  boost::shared_ptr<zmq::context_t> context;
+  std::string endpoint;
+    {
+    boost::lock_guard<boost::mutex> lock(this->BrokeringStatus);
+    context = this->WakeupContext;
+    endpoint = this->WakeupEndpoint.endpoint();
+    }
+  if(context)
+    {
+    zmq::send_wakeup(*context, endpoint);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  const zmq::socketInfo<zmq::proto::inproc>& wakeupEndpoint() const
+    { return this->WakeupEndpoint; }
+
+  //----------------------------------------------------------------------------
+  const zmq::socketInfo<zmq::proto::inproc>& workerMonitorEndpoint() const
+    { return this->WorkerMonitorEndpoint; }
+
   //----------------------------------------------------------------------------
   void waitForThreadToStart()
   {
@@ -186,12 +291,33 @@ struct ThreadManagement
   }
 
 private:
+  //----------------------------------------------------------------------------
+  //every run of the broker gets its own inproc endpoints, since closing the
+  //sockets of the previous run releases their endpoints asynchronously
+  void generateEndpoints()
+  {
+  boost::uuids::random_generator generator;
+  const std::string id = boost::uuids::to_string(generator());
+
+  //the broker binds to this inproc endpoint so that we can wake it up
+  //when we want it to stop, instead of waiting for its poll to time out
+  this->WakeupEndpoint = zmq::socketInfo<zmq::proto::inproc>(
+    "remus-server-wakeup-" + id);
+
+  //the connection events of the worker channel are published here
+  this->WorkerMonitorEndpoint = zmq::socketInfo<zmq::proto::inproc>(
+    "remus-server-worker-monitor-" + id);
+  }
+
   boost::scoped_ptr<boost::thread> BrokerThread;
 
   boost::mutex BrokeringStatus;
   boost::condition_variable BrokerStatusChanged;
   bool BrokerIsRunning;
 
+  boost::shared_ptr<zmq::context_t> WakeupContext;
+  zmq::socketInfo<zmq::proto::inproc> WakeupEndpoint;
+  zmq::socketInfo<zmq::proto::inproc> WorkerMonitorEndpoint;
 
 };
 
@@ -208,8 +334,12 @@ Server::Server():
   QueuedJobs( new remus::server::detail::JobQueue() ),
   SocketMonitor( new remus::server::detail::SocketMonitor() ),
   WorkerPool( new remus::server::detail::WorkerPool() ),
+  WarmPool( new remus::server::detail::WarmPool() ),
   ActiveJobs( new remus::server::detail::ActiveJobs () ),
   Publish( new remus::server::detail::EventPublisher() ),
+  Federation( new remus::server::detail::Federation() ),
+  ForwardJobsToPeers(true),
+  StealJobsFromPeers(true),
   UUIDGenerator( new detail::UUIDManagement() ),
   Thread( new detail::ThreadManagement() ),
   WorkerFactory( boost::make_shared<remus::server::WorkerFactory>() )
@@ -222,8 +352,12 @@ Server::Server(const boost::shared_ptr<remus::server::WorkerFactoryBase>& factor
   QueuedJobs( new remus::server::detail::JobQueue() ),
   SocketMonitor( new remus::server::detail::SocketMonitor() ),
   WorkerPool( new remus::server::detail::WorkerPool() ),
+  WarmPool( new remus::server::detail::WarmPool() ),
   ActiveJobs( new remus::server::detail::ActiveJobs () ),
   Publish( new remus::server::detail::EventPublisher() ),
+  Federation( new remus::server::detail::Federation() ),
+  ForwardJobsToPeers(true),
+  StealJobsFromPeers(true),
   UUIDGenerator( new detail::UUIDManagement() ),
   Thread( new detail::ThreadManagement() ),
   WorkerFactory( factory )
@@ -236,8 +370,12 @@ Server::Server(const remus::server::ServerPorts& ports):
   QueuedJobs( new remus::server::detail::JobQueue() ),
   SocketMonitor( new remus::server::detail::SocketMonitor() ),
   WorkerPool( new remus::server::detail::WorkerPool() ),
+  WarmPool( new remus::server::detail::WarmPool() ),
   ActiveJobs( new remus::server::detail::ActiveJobs () ),
   Publish( new remus::server::detail::EventPublisher() ),
+  Federation( new remus::server::detail::Federation() ),
+  ForwardJobsToPeers(true),
+  StealJobsFromPeers(true),
   UUIDGenerator( new detail::UUIDManagement() ),
   Thread( new detail::ThreadManagement() ),
   WorkerFactory( boost::make_shared<remus::server::WorkerFactory>() )
@@ -251,8 +389,12 @@ Server::Server(const remus::server::ServerPorts& ports,
   QueuedJobs( new remus::server::detail::JobQueue() ),
   SocketMonitor( new remus::server::detail::SocketMonitor() ),
   WorkerPool( new remus::server::detail::WorkerPool() ),
+  WarmPool( new remus::server::detail::WarmPool() ),
   ActiveJobs( new remus::server::detail::ActiveJobs () ),
   Publish( new remus::server::detail::EventPublisher() ),
+  Federation( new remus::server::detail::Federation() ),
+  ForwardJobsToPeers(true),
+  StealJobsFromPeers(true),
   UUIDGenerator( new detail::UUIDManagement() ),
   Thread( new detail::ThreadManagement() ),
   WorkerFactory( factory )
@@ -286,6 +428,105 @@ remus::server::PollingRates Server::pollingRates() const
   return remus::server::PollingRates(low,high);
 }
 
+//------------------------------------------------------------------------------
+void Server::jobBatchSize(const remus::proto::JobRequirements& reqs,
+                          std::size_t size)
+{
+  this->QueuedJobs->batchSize(reqs, size);
+}
+
+//------------------------------------------------------------------------------
+std::size_t Server::jobBatchSize(const remus::proto::JobRequirements& reqs) const
+{
+  return this->QueuedJobs->batchSize(reqs);
+}
+
+//------------------------------------------------------------------------------
+void Server::minimumProgressInterval(boost::int64_t millisec)
+{
+  this->ActiveJobs->minimumProgressInterval(millisec);
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Server::minimumProgressInterval() const
+{
+  return this->ActiveJobs->minimumProgressInterval();
+}
+
+//------------------------------------------------------------------------------
+void Server::heartbeatPublishSampling( unsigned int n )
+{
+  this->Publish->heartbeatSampling(n);
+}
+
+//------------------------------------------------------------------------------
+unsigned int Server::heartbeatPublishSampling() const
+{
+  return this->Publish->heartbeatSampling();
+}
+
+//------------------------------------------------------------------------------
+void Server::addPeer( const std::string& clientEndpoint )
+{
+  this->Federation->addPeer(clientEndpoint);
+  //a brokering server links to the new peer once woken up
+  this->Thread->wakeup();
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string> Server::peers() const
+{
+  return this->Federation->peers();
+}
+
+//------------------------------------------------------------------------------
+void Server::peerExchangeInterval( boost::int64_t millisec )
+{
+  this->Federation->exchangeInterval(millisec);
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Server::peerExchangeInterval() const
+{
+  return this->Federation->exchangeInterval();
+}
+
+//------------------------------------------------------------------------------
+void Server::peerTimeout( boost::int64_t millisec )
+{
+  this->Federation->peerTimeout(millisec);
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Server::peerTimeout() const
+{
+  return this->Federation->peerTimeout();
+}
+
+//------------------------------------------------------------------------------
+void Server::forwardJobsToPeers( bool enable )
+{
+  this->ForwardJobsToPeers = enable;
+}
+
+//------------------------------------------------------------------------------
+bool Server::forwardJobsToPeers() const
+{
+  return this->ForwardJobsToPeers;
+}
+
+//------------------------------------------------------------------------------
+void Server::stealJobsFromPeers( bool enable )
+{
+  this->StealJobsFromPeers = enable;
+}
+
+//------------------------------------------------------------------------------
+bool Server::stealJobsFromPeers() const
+{
+  return this->StealJobsFromPeers;
+}
+
 //------------------------------------------------------------------------------
 bool Server::Brokering(Server::SignalHandling sh)
   {
@@ -300,38 +541,77 @@ bool Server::Brokering(Server::SignalHandling sh)
   zmq::socket_t clientChannel(*(this->PortInfo.context()),ZMQ_ROUTER);
   zmq::socket_t workerChannel(*(this->PortInfo.context()),ZMQ_ROUTER);
   zmq::socket_t statusChannel(*(this->PortInfo.context()),ZMQ_PUB);
+  zmq::socket_t wakeupChannel(*(this->PortInfo.context()),ZMQ_PULL);
+  zmq::socket_t workerMonitor(*(this->PortInfo.context()),ZMQ_PAIR);
 
   //attempts to bind to the sockets to the desired ports
   this->PortInfo.bindClient(&clientChannel);
   this->PortInfo.bindWorker(&workerChannel);
   this->PortInfo.bindStatus(&statusChannel);
+  zmq::bindToAddress(wakeupChannel, this->Thread->wakeupEndpoint());
+
+  //watch the connections of workers, so that a worker whose connection
+  //drops is noticed right away instead of after it misses heartbeats.
+  //Heartbeats remain the fallback for workers that hang but stay connected
+  const bool monitoringWorkers = zmq::monitor_socket(workerChannel,
+                          this->Thread->workerMonitorEndpoint().endpoint(),
+                          ZMQ_EVENT_ACCEPTED | ZMQ_EVENT_DISCONNECTED);
+  if(monitoringWorkers)
+    {
+    zmq::connectToAddress(workerMonitor, this->Thread->workerMonitorEndpoint());
+    }
 
   //tell the StatusPublisher what socket to use
   this->Publish->socketToUse(&statusChannel);
 
+  //link up with our peers, which reach us back through the client endpoint
+  //we just bound to
+  this->Federation->start(this->PortInfo.context(),
+                          this->PortInfo.client().endpoint());
+
   //give to the worker factory the endpoint information so it can properly
   //setup workers. This needs to happen after the binding of the worker socket
   this->WorkerFactory->portForWorkersToUse( this->PortInfo.worker() );
 
   //construct the pollitems to have client and workers so that we process
-  //messages from both sockets.
-  zmq::pollitem_t items[2] = {
+  //messages from both sockets. The wakeup channel lets stopBrokering
+  //interrupt the poll, so that we can block without a timeout.
+  //When the factory can tell us about launched workers exiting we poll that
+  //too, so that a dead worker frees its slot in the factory right away
+  const int workerExitFd = this->WorkerFactory->workerExitDescriptor();
+  zmq::pollitem_t items[5] = {
       { clientChannel, 0, ZMQ_POLLIN, 0 },
-      { workerChannel, 0, ZMQ_POLLIN, 0 } };
+      { workerChannel, 0, ZMQ_POLLIN, 0 },
+      { wakeupChannel, 0, ZMQ_POLLIN, 0 },
+      { workerMonitor, 0, ZMQ_POLLIN, 0 },
+      { NULL, 0, ZMQ_POLLIN, 0 } };
+  int numberOfItems = 3;
+  int monitorItem = -1;
+  int workerExitItem = -1;
+  if(monitoringWorkers)
+    {
+    monitorItem = numberOfItems++;
+    }
+  if(workerExitFd >= 0)
+    {
+    workerExitItem = numberOfItems++;
+    items[workerExitItem] = items[4];
+    items[workerExitItem].fd = workerExitFd;
+    }
 
   //keeps track of what our polling interval is, and adjusts it to
   //handle operating systems that throttle our polling.
   remus::common::PollingMonitor monitor = this->SocketMonitor->pollingMonitor();
 
-  //keep track of current time since we last purged dead workers
-  //we want to clear every dead workers every 250ms.
-  boost::posix_time::ptime currentTime =
-                            boost::posix_time::microsec_clock::local_time();
+  //keep track of when we last checked for dead workers and changes in
+  //jobs. We wake up for the next heartbeat deadline, idle worker or peer
+  //exchange, so a server with nothing due doesn't wake up at all
+  boost::int64_t currentTime = detail::TimingWheel::now();
+  boost::int64_t lastCheck = currentTime;
 
-  const boost::int64_t workerCheckInterval(250);
-  boost::posix_time::ptime whenToCheckForDeadOrCompletedWorkers =
-                      boost::posix_time::microsec_clock::local_time() +
-                      boost::posix_time::milliseconds(workerCheckInterval);
+  //launch the minimum idle workers up front, afterwards they are replaced
+  //as workers take jobs, exit, or fail to start in time
+  this->ReplenishIdleWorkers();
 
   //We need to notify the Thread management that brokering is about to start.
   //This allows the calling thread to resume, as it has been waiting for this
@@ -345,11 +625,56 @@ bool Server::Brokering(Server::SignalHandling sh)
     //number of living workers. This is done
     bool worker_shutting_down = false;
 
-    zmq::poll_safely(&items[0], 2, monitor.current());
+    //block until the next message, or until we need to check for workers
+    //and jobs that have changed. If nothing can change without a message
+    //we block until one arrives, so an idle server doesn't wake up at all
+    const boost::int64_t nextCheck =
+                      this->NextTimeToCheck(lastCheck, workerExitItem >= 0);
+    boost::int64_t timeout = -1;
+    if(nextCheck >= 0)
+      {
+      currentTime = detail::TimingWheel::now();
+      timeout = std::max(boost::int64_t(0), nextCheck - currentTime);
+      }
+    //the links to our peers are polled after our own sockets. Contacting a
+    //new peer adds a link, so they are gathered on every iteration
+    std::vector<zmq::pollitem_t> pollItems(items, items + numberOfItems);
+    for(std::size_t i=0; i < this->Federation->numberOfLinks(); ++i)
+      {
+      zmq::pollitem_t linkItem = { this->Federation->link(i), 0, ZMQ_POLLIN, 0 };
+      pollItems.push_back(linkItem);
+      }
+    zmq::poll_for_events(&pollItems[0], static_cast<int>(pollItems.size()),
+                         timeout);
+    std::copy(pollItems.begin(), pollItems.begin() + numberOfItems, items);
     monitor.pollOccurred();
 
     //update the current time
-    currentTime = boost::posix_time::microsec_clock::local_time();
+    currentTime = detail::TimingWheel::now();
+
+    if (items[2].revents & ZMQ_POLLIN)
+      {
+      //we have been woken up, most likely to stop brokering, otherwise
+      //because a peer was added
+      zmq::drain_wakeups(wakeupChannel);
+      this->Federation->linkPeers();
+      }
+
+    //connection events have to be handled before worker messages, so that
+    //a new connection reusing the file descriptor of a closed one isn't
+    //mistaken for the worker that just disconnected
+    if (monitorItem >= 0 && (items[monitorItem].revents & ZMQ_POLLIN))
+      {
+      worker_shutting_down = this->HandleWorkerConnectionEvents(workerMonitor) ||
+                             worker_shutting_down;
+      }
+
+    //a worker process launched by the factory has exited, check for changes
+    //now so the factory can launch a replacement straight away
+    if (workerExitItem >= 0 && (items[workerExitItem].revents & ZMQ_POLLIN))
+      {
+      worker_shutting_down = true;
+      }
 
     if (items[0].revents & ZMQ_POLLIN)
       {
@@ -357,20 +682,35 @@ bool Server::Brokering(Server::SignalHandling sh)
       zmq::SocketIdentity clientIdentity = zmq::address_recv(clientChannel);
       this->DetermineClientResponse(clientChannel, clientIdentity, workerChannel);
       }
+    for(std::size_t i=numberOfItems; i < pollItems.size(); ++i)
+      {
+      if (pollItems[i].revents & ZMQ_POLLIN)
+        {
+        this->HandlePeerResponses(i - numberOfItems);
+        }
+      }
     if (items[1].revents & ZMQ_POLLIN)
       {
       //a worker is registering
       //we need to strip the worker address from the message
-      zmq::SocketIdentity workerIdentity = zmq::address_recv(workerChannel);
+      int connectionFd = -1;
+      zmq::SocketIdentity workerIdentity = zmq::address_recv(workerChannel,
+                                                             connectionFd);
+      this->SocketMonitor->connectedOn(workerIdentity, connectionFd);
       this->DetermineWorkerResponse(workerChannel,workerIdentity,worker_shutting_down  );
       }
 
-    //only purge dead workers every 250ms or every time a worker shuts down
-    if(whenToCheckForDeadOrCompletedWorkers <= currentTime || worker_shutting_down)
+    //only purge dead workers when something is due or a worker shuts down
+    if((nextCheck >= 0 && nextCheck <= currentTime) || worker_shutting_down)
       {
+      this->RetireIdleWorkers( workerChannel );
       this->CheckForChangeInWorkersAndJobs();
-      whenToCheckForDeadOrCompletedWorkers = currentTime +
-                      boost::posix_time::milliseconds(workerCheckInterval);
+      this->CheckForLostPeerMessages();
+      if(this->Federation->exchangeDue(detail::TimingWheel::now()))
+        {
+        this->ExchangeWithPeers();
+        }
+      lastCheck = currentTime;
       }
 
     //see if we have a worker in the pool for the next job in the queue,
@@ -378,15 +718,23 @@ bool Server::Brokering(Server::SignalHandling sh)
     if(Thread->isBrokering())
       {
       this->FindWorkerForQueuedJob( workerChannel );
+      this->ReplenishIdleWorkers();
       }
     }
 
   this->Publish->stop();
 
+  if(monitoringWorkers)
+    {
+    zmq::stop_monitoring_socket(workerChannel);
+    }
+
   //this should only happen with interrupted threads is hit; lets make sure we close
   //down all workers.
   this->WorkerFactory->setMaxWorkerCount(0);
   this->TerminateAllWorkers( workerChannel );
+  this->WarmPool->clear();
+  this->Federation->stop();
 
   if(sh == CAPTURE)
     {
@@ -399,7 +747,7 @@ bool Server::Brokering(Server::SignalHandling sh)
 //------------------------------------------------------------------------------
 bool Server::startBrokering(SignalHandling sh)
 {
-  return this->Thread->start(this, sh);
+  return this->Thread->start(this, sh, this->PortInfo.context());
 }
 
 //------------------------------------------------------------------------------
@@ -501,6 +849,15 @@ void Server::DetermineClientResponse(zmq::socket_t& clientChannel,
       //we can do nothing to stop it
       response_data = this->terminateJob(workerChannel,msg);
       break;
+    case remus::QUEUE_SUMMARY:
+    case remus::FORWARD_JOBS:
+    case remus::STEAL_JOBS:
+    case remus::FORWARDED_STATUS:
+    case remus::FORWARDED_RESULT:
+      //messages from our peer servers, which exchange their queue depths
+      //and move queued jobs between each other
+      response_data = this->peerRequest(msg, clientIdentity);
+      break;
     default:
       response_service = remus::INVALID_SERVICE;
       response_data = remus::INVALID_MSG;
@@ -526,6 +883,15 @@ std::string Server::allSupportedMeshIOTypes(const remus::proto::Message& )
 
   //combine the two sets to get all the valid requirements
   supportedTypes.insert(poolTypes.begin(),poolTypes.end());
+
+  //jobs of the types our peers support are forwarded to them
+  const remus::proto::JobRequirementsSet peerReqs =
+                                      this->Federation->peerRequirements();
+  typedef remus::proto::JobRequirementsSet::const_iterator it;
+  for(it i = peerReqs.begin(); i != peerReqs.end(); ++i)
+    {
+    supportedTypes.insert(i->meshTypes());
+    }
   std::ostringstream buffer;
   buffer << supportedTypes << '\n';
   return buffer.str();
@@ -546,8 +912,12 @@ std::string Server::canMesh(const remus::proto::Message& msg)
   bool poolSupport =
     (this->WorkerPool->waitingWorkerRequirements(msg.MeshIOType()).size() > 0);
 
+  //or a peer that has capacity for the mesh type
+  bool peerSupport =
+    (this->Federation->peerRequirements(msg.MeshIOType()).size() > 0);
+
   std::ostringstream buffer;
-  buffer << (workerSupport || poolSupport) << '\n';
+  buffer << (workerSupport || poolSupport || peerSupport) << '\n';
   return buffer.str();
 }
 
@@ -565,8 +935,11 @@ std::string Server::canMeshRequirements(const remus::proto::Message& msg)
   //workers that support the given mesh type info
   bool poolSupport = this->WorkerPool->haveWaitingWorker(reqs);
 
+  //or a peer that has capacity for the requirements
+  bool peerSupport = this->Federation->peerRequirements().count(reqs) > 0;
+
   std::ostringstream buffer;
-  buffer << (workerSupport || poolSupport) << '\n';
+  buffer << (workerSupport || poolSupport || peerSupport) << '\n';
   return buffer.str();
 }
 
@@ -586,6 +959,11 @@ std::string Server::meshRequirements(const remus::proto::Message& msg)
   //combine the two sets to get all the valid requirements
   reqSet.insert(poolSet.begin(),poolSet.end());
 
+  //along with the requirements our peers have capacity for
+  remus::proto::JobRequirementsSet peerSet =
+            this->Federation->peerRequirements(msg.MeshIOType());
+  reqSet.insert(peerSet.begin(),peerSet.end());
+
   std::ostringstream buffer;
   buffer << reqSet << '\n';
   return buffer.str();
@@ -596,7 +974,12 @@ std::string Server::meshStatus(const remus::proto::Message& msg)
 {
   remus::proto::Job job = remus::proto::to_Job(msg.data(),msg.dataSize());
   remus::proto::JobStatus js(job.id(),remus::INVALID_STATUS);
-  if(this->QueuedJobs->haveUUID(job.id()))
+  if(this->Federation->isForwarded(job.id()))
+    {
+    //the status the peer running the job sent us last
+    js = this->Federation->forwardedStatus(job.id());
+    }
+  else if(this->QueuedJobs->haveUUID(job.id()))
     {
     js = remus::proto::JobStatus(job.id(),remus::QUEUED);
     }
@@ -615,9 +998,12 @@ std::string Server::queueJob(const remus::proto::Message& msg)
   //generate an UUID
   const boost::uuids::uuid jobUUID = (*this->UUIDGenerator)();
 
-  //create a new job to place on the queue
+  //create a new job to place on the queue. Clients in our process hand
+  //us the submission itself, which only arrives on an inproc socket
+  const bool direct =
+      remus::proto::is_DirectEndpoint(this->PortInfo.client().endpoint());
   const remus::proto::JobSubmission submission =
-                  remus::proto::to_JobSubmission(msg.data(),msg.dataSize());
+      remus::proto::to_JobSubmission(msg.data(), msg.dataSize(), direct);
 
   this->QueuedJobs->addJob(jobUUID,submission);
 
@@ -638,14 +1024,23 @@ std::string Server::retrieveResult(const remus::proto::Message& msg)
   remus::proto::Job job = remus::proto::to_Job(msg.data(),msg.dataSize());
 
   remus::proto::JobResult result(job.id());
-  if( this->ActiveJobs->haveUUID(job.id()) &&
+  if(this->Federation->haveForwardedResult(job.id()))
+    {
+    result = this->Federation->takeForwardedResult(job.id());
+    }
+  else if( this->ActiveJobs->haveUUID(job.id()) &&
       this->ActiveJobs->haveResult(job.id()))
     {
     result = this->ActiveJobs->result(job.id());
     //for now we remove all references from this job being active
     this->ActiveJobs->remove(job.id());
     }
-  //return an empty result
+  //return an empty result. Clients in our process are handed the result
+  //itself
+  if(remus::proto::is_DirectEndpoint(this->PortInfo.client().endpoint()))
+    {
+    return remus::proto::to_DirectHandle(result);
+    }
   return remus::proto::to_string(result);
 }
 
@@ -655,6 +1050,25 @@ std::string Server::terminateJob(zmq::socket_t& workerChannel,
 {
   remus::proto::Job job = remus::proto::to_Job(msg.data(),msg.dataSize());
 
+  if(this->Federation->isForwarded(job.id()))
+    {
+    //ask the peer running the job to terminate it, and stop tracking the
+    //job so that the status and result the peer still sends are ignored
+    const std::size_t link =
+          this->Federation->linkTo(this->Federation->forwardedTo(job.id()));
+    if(link < this->Federation->numberOfLinks())
+      {
+      remus::proto::send_NonBlockingMessage(msg.MeshIOType(),
+                                  remus::TERMINATE_JOB,
+                                  std::string(msg.data(), msg.dataSize()),
+                                  &this->Federation->link(link));
+      }
+    this->Publish->jobTerminated(this->Federation->forwardedStatus(job.id()));
+    this->Federation->removeForwarded(job.id());
+    return remus::proto::to_string(
+                          remus::proto::JobStatus(job.id(),remus::FAILED));
+    }
+
   const bool currentlyInQueue = this->QueuedJobs->haveUUID(job.id());
   const bool currentlyActive = this->ActiveJobs->haveUUID(job.id());
   const bool eligableForTermination = currentlyInQueue || currentlyActive;
@@ -671,6 +1085,7 @@ std::string Server::terminateJob(zmq::socket_t& workerChannel,
   if(currentlyInQueue)
     {
     this->QueuedJobs->remove(job.id());
+    this->Federation->removeForeign(job.id());
 
     //publish that this job is now terminated and what it's last status was
     remus::proto::JobStatus lastStatus(job.id(),remus::QUEUED);
@@ -695,6 +1110,144 @@ std::string Server::terminateJob(zmq::socket_t& workerChannel,
   return remus::proto::to_string(jstatus);
 }
 
+//------------------------------------------------------------------------------
+std::string Server::queueSummary()
+{
+  //report every set of requirements we have queued jobs for, or could
+  //start jobs for
+  remus::proto::JobRequirementsSet reqs =
+                                    this->QueuedJobs->queuedJobRequirements();
+
+  remus::common::MeshIOTypeSet types = this->WorkerFactory->supportedIOTypes();
+  const remus::common::MeshIOTypeSet poolTypes =
+                                    this->WorkerPool->supportedIOTypes();
+  types.insert(poolTypes.begin(), poolTypes.end());
+  typedef remus::common::MeshIOTypeSet::const_iterator type_it;
+  for(type_it t = types.begin(); t != types.end(); ++t)
+    {
+    const remus::proto::JobRequirementsSet factoryReqs =
+                                  this->WorkerFactory->workerRequirements(*t);
+    const remus::proto::JobRequirementsSet poolReqs =
+                                  this->WorkerPool->waitingWorkerRequirements(*t);
+    reqs.insert(factoryReqs.begin(), factoryReqs.end());
+    reqs.insert(poolReqs.begin(), poolReqs.end());
+    }
+
+  remus::proto::QueueSummary summary;
+  typedef remus::proto::JobRequirementsSet::const_iterator it;
+  for(it r = reqs.begin(); r != reqs.end(); ++r)
+    {
+    const remus::proto::QueueDepth depth(this->QueuedJobs->numJobsJustQueued(*r),
+                                   this->CapacityFor(*r));
+    if(depth.Queued > 0 || depth.Capacity > 0)
+      {
+      summary[*r] = depth;
+      }
+    }
+  return remus::proto::to_string(summary);
+}
+
+//------------------------------------------------------------------------------
+std::string Server::peerRequest(const remus::proto::Message& msg,
+                                const zmq::SocketIdentity& peerIdentity)
+{
+  //every peer message names the client endpoint of its sender. Only our
+  //configured peers can move jobs, so anything else is rejected, apart
+  //from clients probing how loaded we are, which send no endpoint.
+  //Peers connect with their endpoint as socket identity, so a message
+  //is only trusted when it arrives over the connection of the peer
+  //it claims to come from
+  std::string endpoint, payload;
+  detail::split_peerMessage(msg, endpoint, payload);
+  const bool probe = (msg.serviceType() == remus::QUEUE_SUMMARY &&
+                      endpoint.empty());
+  if(!probe && (!this->Federation->isPeer(endpoint) ||
+     endpoint != std::string(peerIdentity.data(), peerIdentity.size())))
+    {
+    return remus::INVALID_MSG;
+    }
+  if(!probe)
+    {
+    this->Federation->heardFrom(endpoint, detail::TimingWheel::now());
+    }
+
+  switch(msg.serviceType())
+    {
+    case remus::QUEUE_SUMMARY:
+      {
+      //reply with our summary, and move jobs based on theirs
+      const std::string summary = this->queueSummary();
+      const std::size_t link = this->Federation->linkTo(endpoint);
+      if(link < this->Federation->numberOfLinks())
+        {
+        this->Federation->summary(link) = remus::proto::to_QueueSummary(payload);
+        this->BalanceWithPeer(link);
+        }
+      return summary;
+      }
+    case remus::FORWARD_JOBS:
+      {
+      //acknowledge the jobs we queued, the peer keeps the others
+      this->Federation->linkTo(endpoint);
+      const std::vector<boost::uuids::uuid> queued = this->QueueForeignJobs(
+                      remus::proto::to_WorkerJobBatch(payload), endpoint);
+      return detail::make_jobAcks(queued);
+      }
+    case remus::STEAL_JOBS:
+      {
+      //hand out the queued jobs we can't start ourselves, never the jobs
+      //another peer moved to us
+      this->Federation->linkTo(endpoint);
+      std::istringstream buffer(payload);
+      std::size_t requested = 0;
+      remus::proto::JobRequirements reqs;
+      buffer >> requested;
+      buffer >> reqs;
+
+      const remus::proto::QueueDepth depth(this->QueuedJobs->numJobsJustQueued(reqs),
+                                     this->CapacityFor(reqs));
+      const std::vector<remus::worker::Job> jobs =
+                    this->QueuedJobs->takeQueuedJobs(reqs,
+                                          std::min(requested, depth.excess()),
+                                          this->Federation->foreignJobs());
+      //the jobs are ours until the peer acknowledges them with their status
+      const boost::int64_t now = detail::TimingWheel::now();
+      typedef std::vector<remus::worker::Job>::const_iterator it;
+      for(it job = jobs.begin(); job != jobs.end(); ++job)
+        {
+        this->Federation->forwarded(*job, endpoint, now);
+        }
+      return remus::proto::to_string(jobs);
+      }
+    case remus::FORWARDED_STATUS:
+      {
+      //only the peer we moved the job to can update it
+      const remus::proto::JobStatus js =
+                    remus::proto::to_JobStatus(payload);
+      if(this->Federation->updateForwarded(js, endpoint))
+        {
+        this->Publish->jobStatus(js, peerIdentity);
+        }
+      //acknowledge the status even for jobs we stopped tracking, so that
+      //the peer stops sending it
+      return payload;
+      }
+    case remus::FORWARDED_RESULT:
+      {
+      const remus::proto::JobResult jr =
+                    remus::proto::to_JobResult(payload);
+      if(this->Federation->updateForwarded(jr, endpoint))
+        {
+        this->Publish->jobFinished(jr, peerIdentity);
+        }
+      return remus::to_string(jr.id());
+      }
+    default:
+      break;
+    }
+  return remus::INVALID_MSG;
+}
+
 //------------------------------------------------------------------------------
 void Server::DetermineWorkerResponse(zmq::socket_t& workerChannel,
                                      const zmq::SocketIdentity &workerIdentity,
@@ -725,6 +1278,7 @@ void Server::DetermineWorkerResponse(zmq::socket_t& workerChannel,
       const remus::proto::JobRequirements reqs =
             remus::proto::to_JobRequirements(msg.data(),msg.dataSize());
       this->WorkerPool->addWorker(workerIdentity,reqs);
+      this->WarmPool->registered(workerIdentity,reqs);
       this->Publish->workerRegistered(workerIdentity, reqs);
       }
       break;
@@ -736,9 +1290,35 @@ void Server::DetermineWorkerResponse(zmq::socket_t& workerChannel,
       const remus::proto::JobRequirements reqs =
             remus::proto::to_JobRequirements(msg.data(),msg.dataSize());
       this->WorkerPool->readyForWork(workerIdentity,reqs);
+      this->WarmPool->ready(workerIdentity);
       this->Publish->workerReady(workerIdentity, reqs);
       }
       break;
+    case remus::JOB_CREDITS:
+      {
+      //The worker is granting us a window of job credits, which means it is
+      //ready to accept that many jobs with the passed in set of requirements.
+      //The payload is the number of credits followed by the requirements,
+      //and optionally the number of jobs the worker processes at once
+      std::istringstream buffer(std::string(msg.data(),msg.dataSize()));
+      unsigned int credits = 0;
+      unsigned int slots = 1;
+      remus::proto::JobRequirements reqs;
+      buffer >> credits;
+      buffer >> reqs;
+      if(!(buffer >> slots))
+        {
+        slots = 1;
+        }
+      if(credits > 0)
+        {
+        this->WorkerPool->readyForWork(workerIdentity,reqs,credits);
+        this->WorkerPool->numberOfSlots(workerIdentity,slots);
+        this->WarmPool->ready(workerIdentity);
+        this->Publish->workerReady(workerIdentity, reqs);
+        }
+      }
+      break;
     case remus::MESH_STATUS:
       //store the mesh status msg which is a proto::JobStatus
       //no response needed
@@ -759,15 +1339,22 @@ void Server::DetermineWorkerResponse(zmq::socket_t& workerChannel,
       //store mesh does it's own notification
       this->storeMesh(workerIdentity, msg);
 
+      break;
+    case remus::RETRIEVE_RESULT_BATCH:
+      //same ping/pong as RETRIEVE_RESULT, but with a collection of results
+      remus::proto::send_NonBlockingResponse(remus::RETRIEVE_RESULT,
+                                             remus::INVALID_MSG,
+                                             &workerChannel,
+                                             workerIdentity);
+      this->storeMeshBatch(workerIdentity, msg);
       break;
     case remus::HEARTBEAT:
       //pass along to the worker monitor what worker just sent a heartbeat
       //message. The heartbeat message contains the msec delta for when
       //to next expect a heartbeat message from the given worker
       { //scoped so we don't get jump bypasses variable initialization errors
-      const std::string msgPayload(msg.data(),msg.dataSize());
-      boost::int64_t dur_in_milli = boost::lexical_cast<boost::int64_t>(
-                                                              msgPayload);
+      const boost::int64_t dur_in_milli =
+            remus::proto::to_HeartbeatInterval(msg.data(),msg.dataSize());
       this->SocketMonitor->heartbeat(workerIdentity,dur_in_milli);
       this->Publish->workerHeartbeat(workerIdentity);
       }
@@ -801,20 +1388,73 @@ void Server::storeMeshStatus(const zmq::SocketIdentity &workerIdentity,
   //the string in the data is actually a job status object
   remus::proto::JobStatus js = remus::proto::to_JobStatus(msg.data(),
                                                           msg.dataSize());
-  this->ActiveJobs->updateStatus(js);
-
-  this->Publish->jobStatus(js, workerIdentity);
+  //only publish the status when it was accepted, so that progress updates
+  //arriving too fast are dropped before they reach the subscribers
+  if(this->ActiveJobs->updateStatus(js))
+    {
+    this->Publish->jobStatus(js, workerIdentity);
+    if(this->Federation->isForeign(js.id()))
+      {
+      this->SendToOrigin(js);
+      }
+    }
 }
 
 //------------------------------------------------------------------------------
 void Server::storeMesh(const zmq::SocketIdentity &workerIdentity,
                        const remus::proto::Message& msg)
 {
+  const bool direct =
+      remus::proto::is_DirectEndpoint(this->PortInfo.worker().endpoint());
   remus::proto::JobResult jr = remus::proto::to_JobResult(msg.data(),
-                                                            msg.dataSize());
+                                                            msg.dataSize(),
+                                                            direct);
+  this->RecordJobDuration(jr);
   this->ActiveJobs->updateResult(jr);
 
   this->Publish->jobFinished(jr, workerIdentity);
+  if(this->Federation->isForeign(jr.id()))
+    {
+    this->SendToOrigin(jr);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::storeMeshBatch(const zmq::SocketIdentity &workerIdentity,
+                            const remus::proto::Message& msg)
+{
+  //the data is a collection of job results, each result is stored
+  //individually so clients can't tell the results came in a batch
+  const bool direct =
+      remus::proto::is_DirectEndpoint(this->PortInfo.worker().endpoint());
+  std::vector< remus::proto::JobResult > results =
+      remus::proto::to_JobResultBatch(msg.data(), msg.dataSize(), direct);
+
+  typedef std::vector< remus::proto::JobResult >::const_iterator it;
+  for(it i = results.begin(); i != results.end(); ++i)
+    {
+    this->RecordJobDuration(*i);
+    this->ActiveJobs->updateResult(*i);
+    this->Publish->jobFinished(*i, workerIdentity);
+    if(this->Federation->isForeign(i->id()))
+      {
+      this->SendToOrigin(*i);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::RecordJobDuration(const remus::proto::JobResult& result)
+{
+  //only the first result of a job that is still running counts
+  remus::proto::JobRequirements reqs;
+  boost::int64_t duration = 0;
+  if(!this->ActiveJobs->haveResult(result.id()) &&
+     this->ActiveJobs->runningTime(result.id(), reqs, duration) &&
+     this->ActiveJobs->status(result.id()).good())
+    {
+    this->WorkerFactory->jobFinished(reqs, duration);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -822,13 +1462,25 @@ void Server::assignJobToWorker(zmq::socket_t& workerChannel,
                                const zmq::SocketIdentity &workerIdentity,
                                const remus::worker::Job& job )
 {
-  this->ActiveJobs->add( workerIdentity, job.id() );
+  this->ActiveJobs->add( workerIdentity, job.id(),
+                         job.submission().requirements() );
+
+  //workers in our process are handed the job itself
+  const bool direct =
+      remus::proto::is_DirectEndpoint(this->PortInfo.worker().endpoint());
+  const std::string data = direct ? remus::proto::to_DirectHandle(job)
+                                  : remus::worker::to_string(job);
 
   remus::proto::Response response =
         remus::proto::send_NonBlockingResponse(remus::MAKE_MESH,
-                                               remus::worker::to_string(job),
+                                               data,
                                                &workerChannel,
                                                workerIdentity);
+  if(direct && !response.isValid())
+    { //the job never left, so take it back from the direct transport
+    remus::worker::Job unsent;
+    remus::proto::claim_DirectHandle(data.data(), data.size(), unsent);
+    }
   if(response.isValid())
     { //consider sending the job to be refreshing the worker
     this->SocketMonitor->refresh(workerIdentity);
@@ -840,6 +1492,83 @@ void Server::assignJobToWorker(zmq::socket_t& workerChannel,
 
 }
 
+//------------------------------------------------------------------------------
+void Server::assignJobsToWorker(zmq::socket_t& workerChannel,
+                                const zmq::SocketIdentity &workerIdentity,
+                                const std::vector<remus::worker::Job>& jobs)
+{
+  if(jobs.size() == 1)
+    {
+    this->assignJobToWorker(workerChannel, workerIdentity, jobs[0]);
+    return;
+    }
+
+  typedef std::vector<remus::worker::Job>::const_iterator it;
+  for(it job = jobs.begin(); job != jobs.end(); ++job)
+    {
+    this->ActiveJobs->add( workerIdentity, job->id(),
+                           job->submission().requirements() );
+    }
+
+  const bool direct =
+      remus::proto::is_DirectEndpoint(this->PortInfo.worker().endpoint());
+  const std::string data = direct ? remus::proto::to_DirectHandle(jobs)
+                                  : remus::proto::to_string(jobs);
+
+  remus::proto::Response response =
+        remus::proto::send_NonBlockingResponse(remus::JOB_BATCH,
+                                               data,
+                                               &workerChannel,
+                                               workerIdentity);
+  if(direct && !response.isValid())
+    { //the jobs never left, so take them back from the direct transport
+    std::vector<remus::worker::Job> unsent;
+    remus::proto::claim_DirectHandle(data.data(), data.size(), unsent);
+    }
+  if(response.isValid())
+    { //consider sending the jobs to be refreshing the worker
+    this->SocketMonitor->refresh(workerIdentity);
+    for(it job = jobs.begin(); job != jobs.end(); ++job)
+      {
+      this->Publish->jobSentToWorker(*job, workerIdentity);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool Server::assignQueuedJobs(zmq::socket_t& workerChannel,
+                              const remus::proto::JobRequirements& reqs)
+{
+  //workers can grant us multiple job credits at once, so keep handing out
+  //jobs while we have a worker with credits for this type
+  const std::size_t batchSize = this->QueuedJobs->batchSize(reqs);
+  bool assignedJob = false;
+  while(this->WorkerPool->haveWaitingWorker(reqs))
+    {
+    std::size_t numberOfJobs = batchSize;
+    const zmq::SocketIdentity workerIdentity =
+                             this->WorkerPool->takeWorker(reqs, numberOfJobs);
+
+    std::vector<remus::worker::Job> jobs =
+                               this->QueuedJobs->takeJobs(reqs, numberOfJobs);
+
+    //we might have fewer jobs queued than the worker took credits for,
+    //so return the unused credits to the worker
+    if(jobs.size() < numberOfJobs)
+      {
+      this->WorkerPool->readyForWork(workerIdentity, reqs,
+                    static_cast<unsigned int>(numberOfJobs - jobs.size()));
+      }
+    if(jobs.empty())
+      { break; }
+
+    //give these jobs to that worker
+    this->assignJobsToWorker(workerChannel, workerIdentity, jobs);
+    assignedJob = true;
+    }
+  return assignedJob;
+}
+
 //see if we have a worker in the pool for the next job in the queue,
 //otherwise ask the factory to generate a new worker to handle that job
 //------------------------------------------------------------------------------
@@ -867,13 +1596,7 @@ void Server::FindWorkerForQueuedJob(zmq::socket_t& workerChannel)
   waiting_types = this->QueuedJobs->waitingJobRequirements();
   for(it type = waiting_types.begin(); type != waiting_types.end(); ++type)
     {
-    if(this->WorkerPool->haveWaitingWorker(*type))
-      {
-      //give this job to that worker
-      this->assignJobToWorker(workerChannel,
-                              this->WorkerPool->takeWorker(*type),
-                              this->QueuedJobs->takeJob(*type));
-      }
+    this->assignQueuedJobs(workerChannel, *type);
     }
 
 
@@ -883,14 +1606,7 @@ void Server::FindWorkerForQueuedJob(zmq::socket_t& workerChannel)
   bool assignedJob = false;
   for(it type = queued_types.begin(); type != queued_types.end(); ++type)
     {
-    if(this->WorkerPool->haveWaitingWorker(*type))
-      {
-      //give this job to that worker
-      this->assignJobToWorker(workerChannel,
-                              this->WorkerPool->takeWorker(*type),
-                              this->QueuedJobs->takeJob(*type));
-      assignedJob = true;
-      }
+    assignedJob = this->assignQueuedJobs(workerChannel, *type) || assignedJob;
     }
 
   const bool workerFactoryHasSpace =
@@ -907,10 +1623,15 @@ void Server::FindWorkerForQueuedJob(zmq::socket_t& workerChannel)
     //We are not going to assign the job to the worker now, instead we will
     //move the job to the waiting queue, and give it to the worker once
     //it has registered with us through the worker port.
+    //The factory decides how many workers the queued jobs need, so that a
+    //burst of jobs is handled by launching all those workers at once
     for(it type = queued_types.begin(); type != queued_types.end(); ++type)
       {
-      if(this->WorkerFactory->createWorker(*type,
-                           WorkerFactoryBase::KillOnFactoryDeletion))
+      const unsigned int toLaunch = this->WorkerFactory->workersToLaunch(
+                        *type, this->QueuedJobs->numJobsJustQueued(*type));
+      for(unsigned int i=0; i < toLaunch &&
+          this->WorkerFactory->createWorker(*type,
+                           WorkerFactoryBase::KillOnFactoryDeletion); ++i)
         {
         this->QueuedJobs->workerDispatched(*type);
         }
@@ -918,24 +1639,117 @@ void Server::FindWorkerForQueuedJob(zmq::socket_t& workerChannel)
     }
 }
 
+//------------------------------------------------------------------------------
+void Server::ReplenishIdleWorkers()
+{
+  typedef WorkerFactoryBase::IdleWorkerCounts::const_iterator it;
+  const WorkerFactoryBase::IdleWorkerCounts& minimums =
+                                    this->WorkerFactory->minimumIdleWorkers();
+  if(minimums.empty())
+    {
+    return;
+    }
+
+  //a worker that hasn't asked for a job within the longest heartbeat
+  //interval has most likely failed to start, so stop counting it as idle
+  const boost::int64_t now = detail::TimingWheel::now();
+  const boost::int64_t startTimeout =
+            this->SocketMonitor->pollingMonitor().maxTimeOut();
+
+  for(it i = minimums.begin(); i != minimums.end(); ++i)
+    {
+    std::size_t idle = this->WorkerPool->numberOfWaitingWorkers(i->first) +
+                       this->WarmPool->starting(i->first, now, startTimeout);
+    while(idle < i->second &&
+          this->WorkerFactory->haveSpaceFor(i->first) &&
+          this->WorkerFactory->createWorker(i->first,
+                                  WorkerFactoryBase::KillOnFactoryDeletion))
+      {
+      this->WarmPool->launched(i->first, now);
+      ++idle;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::RetireIdleWorkers(zmq::socket_t& workerChannel)
+{
+  const boost::int64_t timeout =
+                        this->WorkerFactory->scalingPolicy().idleTimeout();
+  if(timeout <= 0)
+    {
+    return;
+    }
+
+  typedef std::map<remus::proto::JobRequirements,
+                   std::vector<zmq::SocketIdentity> > IdleMap;
+  const IdleMap idle = this->WorkerPool->idleWorkers(
+                              detail::TimingWheel::now() - timeout,
+                              this->ActiveJobs->busyWorkers());
+
+  for(IdleMap::const_iterator i = idle.begin(); i != idle.end(); ++i)
+    {
+    //keep enough waiting workers to satisfy the minimum idle workers
+    const std::size_t waiting =
+                      this->WorkerPool->numberOfWaitingWorkers(i->first);
+    const std::size_t keep = std::min<std::size_t>(waiting,
+                      this->WorkerFactory->minimumIdleWorkers(i->first));
+    const std::size_t retire = std::min(i->second.size(), waiting - keep);
+    for(std::size_t j=0; j < retire; ++j)
+      {
+      const zmq::SocketIdentity& worker = i->second[j];
+
+      //remove the worker right away so that no job is sent to it, the
+      //factory will notice the worker has exited on its next update
+      const boost::uuids::uuid jobId = (*this->UUIDGenerator)();
+      detail::send_terminateWorker(jobId, workerChannel, worker);
+      this->WorkerPool->removeWorker(worker);
+      this->SocketMonitor->markAsDead(worker);
+      this->Publish->workerTerminated(worker);
+      }
+    }
+}
+
 //------------------------------------------------------------------------------
 void Server::CheckForChangeInWorkersAndJobs()
 {
+  //find the workers whose heartbeat deadline has passed, or have told us
+  //they are shutting down since we last checked. This only visits the
+  //workers that have changed, not every worker we are monitoring
+  const remus::server::detail::SocketMonitor::LivenessChanges changes =
+              this->SocketMonitor->livenessChanges();
+
   //mark all jobs whose worker haven't sent a heartbeat in time
   //as a job that failed. We are returned the set of job's that are
   //expired
   std::vector< remus::proto::JobStatus > expiredJobs =
-              this->ActiveJobs->markExpiredJobs((*this->SocketMonitor));
+              this->ActiveJobs->markExpiredJobs(changes.Unresponsive);
+  std::vector< remus::proto::JobStatus > deadWorkerJobs =
+              this->ActiveJobs->markExpiredJobs(changes.Dead);
+  expiredJobs.insert(expiredJobs.end(), deadWorkerJobs.begin(),
+                     deadWorkerJobs.end());
 
   //publish the jobs that have failed
   this->Publish->jobsExpired( expiredJobs );
 
+  //the peers that moved failed jobs to us are told about it, and we stop
+  //tracking those jobs once the peer acknowledges the failure
+  typedef std::vector< remus::proto::JobStatus >::const_iterator js_it;
+  for(js_it i = expiredJobs.begin(); i != expiredJobs.end(); ++i)
+    {
+    if(this->Federation->isForeign(i->id()))
+      {
+      this->SendToOrigin(*i);
+      this->ActiveJobs->remove(i->id());
+      }
+    }
+
   //purge all pending workers that have been explicitly terminated
   //with a TERMINATE service call. No need to publish this
   //as we do that when the service call comes in. This also updates
   //the responsive state of all workers.
   // detail::ChangedWorkers updatedWorkers =
-          this->WorkerPool->purgeDeadWorkers((*this->SocketMonitor));
+          this->WorkerPool->updateWorkers(changes);
 
   //Resync the worker factory with the updated status of workers. If we have
   //purged dead workers, the factory itself needs to become aware of this!
@@ -968,6 +1782,359 @@ void Server::CheckForChangeInWorkersAndJobs()
   //  3. Alive
 }
 
+//------------------------------------------------------------------------------
+bool Server::HandleWorkerConnectionEvents(zmq::socket_t& monitor)
+{
+  bool workerDisconnected = false;
+  int event = 0;
+  int fd = -1;
+  while(zmq::recv_socket_event(monitor, event, fd))
+    {
+    if(event == ZMQ_EVENT_ACCEPTED)
+      {
+      this->SocketMonitor->connectionAccepted(fd);
+      }
+    else if(event == ZMQ_EVENT_DISCONNECTED)
+      {
+      this->SocketMonitor->connectionClosed(fd);
+      workerDisconnected = true;
+      }
+    }
+  return workerDisconnected;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Server::NextTimeToCheck(boost::int64_t lastCheck,
+                                       bool watchingWorkerExits) const
+{
+  //the factory has to be asked if the workers it launched have exited,
+  //unless it tells us itself, and queued jobs are retried with the
+  //factory. Neither has a deadline, so they are checked periodically
+  const boost::int64_t workerCheckInterval(250);
+
+  boost::int64_t next = -1;
+  detail::keep_earliest(next, this->SocketMonitor->nextChange());
+
+  if(this->QueuedJobs->numJobsJustQueued() > 0 ||
+     this->QueuedJobs->numJobsWaitingForWorkers() > 0 ||
+     (!watchingWorkerExits && this->WorkerFactory->currentWorkerCount() > 0))
+    {
+    detail::keep_earliest(next, lastCheck + workerCheckInterval);
+    }
+
+  if(!this->WorkerFactory->minimumIdleWorkers().empty())
+    {
+    //a warm worker that never asks for a job is forgotten once the start
+    //timeout passes, after which a replacement is launched
+    const boost::int64_t oldest = this->WarmPool->oldestLaunch();
+    const boost::int64_t forgotten = oldest + 1 +
+                        this->SocketMonitor->pollingMonitor().maxTimeOut();
+    if(oldest >= 0 && forgotten > lastCheck)
+      {
+      detail::keep_earliest(next, forgotten);
+      }
+    }
+
+  //workers that were idle at the last check and weren't retired are only
+  //looked at again with the next worker that becomes idle
+  const boost::int64_t idleTimeout =
+                        this->WorkerFactory->scalingPolicy().idleTimeout();
+  if(idleTimeout > 0)
+    {
+    const boost::int64_t active =
+                  this->WorkerPool->nextActiveAfter(lastCheck - idleTimeout);
+    if(active >= 0)
+      {
+      detail::keep_earliest(next, active + idleTimeout);
+      }
+    }
+
+  detail::keep_earliest(next, this->Federation->nextExchange());
+  detail::keep_earliest(next, this->Federation->nextTimeout());
+  return next;
+}
+
+//------------------------------------------------------------------------------
+void Server::ExchangeWithPeers()
+{
+  const std::string summary = detail::make_peerMessage(
+                        this->Federation->ourEndpoint(), this->queueSummary());
+  for(std::size_t i=0; i < this->Federation->numberOfLinks(); ++i)
+    {
+    remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                                          remus::QUEUE_SUMMARY,
+                                          summary,
+                                          &this->Federation->link(i));
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::HandlePeerResponses(std::size_t link)
+{
+  zmq::socket_t& socket = this->Federation->link(link);
+  zmq::pollitem_t item = { socket, 0, ZMQ_POLLIN, 0 };
+  while(zmq::poll(&item, 1, 0) > 0 && (item.revents & ZMQ_POLLIN))
+    {
+    const remus::proto::Response response =
+                                      remus::proto::receive_Response(&socket);
+    if(!response.isValid())
+      {
+      break;
+      }
+
+    const std::string endpoint = this->Federation->linkEndpoint(link);
+    this->Federation->heardFrom(endpoint, detail::TimingWheel::now());
+    switch(response.serviceType())
+      {
+      case remus::QUEUE_SUMMARY:
+        this->Federation->summary(link) = remus::proto::to_QueueSummary(
+                      std::string(response.data(), response.dataSize()));
+        this->BalanceWithPeer(link);
+        break;
+      case remus::FORWARD_JOBS:
+        {
+        //the jobs the peer queued, the others are queued with us again
+        //once they time out
+        const std::vector<boost::uuids::uuid> ids =
+              detail::split_jobAcks(response.data(), response.dataSize());
+        typedef std::vector<boost::uuids::uuid>::const_iterator it;
+        for(it i = ids.begin(); i != ids.end(); ++i)
+          {
+          this->Federation->acknowledged(*i, endpoint);
+          }
+        }
+        break;
+      case remus::STEAL_JOBS:
+        {
+        //the peer keeps the jobs until we acknowledge them, which their
+        //queued status does
+        const std::vector<boost::uuids::uuid> ids = this->QueueForeignJobs(
+              remus::proto::to_WorkerJobBatch(
+                      std::string(response.data(), response.dataSize())),
+              endpoint);
+        typedef std::vector<boost::uuids::uuid>::const_iterator it;
+        for(it i = ids.begin(); i != ids.end(); ++i)
+          {
+          this->SendToOrigin(remus::proto::JobStatus(*i, remus::QUEUED));
+          }
+        }
+        break;
+      case remus::FORWARDED_STATUS:
+        this->Federation->originAcknowledged(
+              remus::proto::to_JobStatus(response.data(), response.dataSize()),
+              endpoint);
+        break;
+      case remus::FORWARDED_RESULT:
+        this->Federation->originAcknowledged(
+              remus::to_uuid(std::string(response.data(), response.dataSize())),
+              endpoint);
+        break;
+      default:
+        break;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::BalanceWithPeer(std::size_t link)
+{
+  remus::proto::QueueSummary& peer = this->Federation->summary(link);
+  const std::string endpoint = this->Federation->linkEndpoint(link);
+  zmq::socket_t& socket = this->Federation->link(link);
+  typedef remus::proto::QueueSummary::iterator depth_it;
+
+  if(this->ForwardJobsToPeers)
+    {
+    //move the queued jobs we can't start to the peer, as far as it has
+    //capacity left for them
+    const remus::proto::JobRequirementsSet queued =
+                                    this->QueuedJobs->queuedJobRequirements();
+    std::vector<remus::worker::Job> jobs;
+    typedef remus::proto::JobRequirementsSet::const_iterator it;
+    for(it r = queued.begin(); r != queued.end(); ++r)
+      {
+      depth_it theirs = peer.find(*r);
+      if(theirs == peer.end())
+        {
+        continue;
+        }
+      const remus::proto::QueueDepth ours(this->QueuedJobs->numJobsJustQueued(*r),
+                                    this->CapacityFor(*r));
+      const std::size_t count = std::min(ours.excess(), theirs->second.spare());
+      if(count == 0)
+        {
+        continue;
+        }
+      const std::vector<remus::worker::Job> moved =
+          this->QueuedJobs->takeQueuedJobs(*r, count,
+                                           this->Federation->foreignJobs());
+      //until the peer sends its next summary count the jobs as queued there
+      theirs->second.Queued += moved.size();
+      jobs.insert(jobs.end(), moved.begin(), moved.end());
+      }
+
+    if(!jobs.empty())
+      {
+      const boost::int64_t now = detail::TimingWheel::now();
+      const remus::proto::Message sent =
+            remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                remus::FORWARD_JOBS,
+                detail::make_peerMessage(this->Federation->ourEndpoint(),
+                                         remus::proto::to_string(jobs)),
+                &socket);
+      typedef std::vector<remus::worker::Job>::const_iterator job_it;
+      for(job_it job = jobs.begin(); job != jobs.end(); ++job)
+        {
+        if(sent.isValid())
+          { //kept until the peer acknowledges it
+          this->Federation->forwarded(*job, endpoint, now);
+          }
+        else
+          { //the peer can't be reached, so keep the job ourselves
+          this->QueuedJobs->addJob(job->id(), job->submission());
+          }
+        }
+      }
+    }
+
+  if(this->StealJobsFromPeers)
+    {
+    //ask for the queued jobs the peer can't start, as far as we have
+    //capacity left for them
+    for(depth_it theirs = peer.begin(); theirs != peer.end(); ++theirs)
+      {
+      const remus::proto::QueueDepth ours(
+                          this->QueuedJobs->numJobsJustQueued(theirs->first),
+                          this->CapacityFor(theirs->first));
+      const std::size_t count = std::min(ours.spare(), theirs->second.excess());
+      if(count == 0)
+        {
+        continue;
+        }
+      std::ostringstream request;
+      request << count << std::endl << theirs->first << std::endl;
+      const remus::proto::Message sent =
+            remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                remus::STEAL_JOBS,
+                detail::make_peerMessage(this->Federation->ourEndpoint(),
+                                         request.str()),
+                &socket);
+      if(sent.isValid())
+        { //until the peer sends its next summary don't ask for them again
+        theirs->second.Queued -= count;
+        }
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+std::size_t Server::CapacityFor(const remus::proto::JobRequirements& reqs) const
+{
+  std::size_t capacity = this->WorkerPool->numberOfWaitingWorkers(reqs);
+  if(this->WorkerFactory->maxWorkerCount() > 0 &&
+     this->WorkerFactory->haveSupport(reqs))
+    {
+    capacity += this->WorkerFactory->spaceFor(reqs);
+    }
+  return capacity;
+}
+
+//------------------------------------------------------------------------------
+std::vector<boost::uuids::uuid> Server::QueueForeignJobs(
+                              const std::vector<remus::worker::Job>& jobs,
+                              const std::string& origin)
+{
+  std::vector<boost::uuids::uuid> queued;
+  typedef std::vector<remus::worker::Job>::const_iterator it;
+  for(it job = jobs.begin(); job != jobs.end(); ++job)
+    {
+    if(this->QueuedJobs->addJob(job->id(), job->submission()))
+      {
+      this->Federation->foreign(job->id(), origin);
+      this->Publish->jobQueued(remus::proto::Job(job->id(),
+                                                 job->submission().type()),
+                               job->submission().requirements());
+      queued.push_back(job->id());
+      }
+    else if(this->Federation->origin(job->id()) == origin)
+      { //the peer sent the job again, as our acknowledgement got lost
+      queued.push_back(job->id());
+      }
+    }
+  return queued;
+}
+
+//------------------------------------------------------------------------------
+void Server::SendToOrigin(const remus::proto::JobStatus& status)
+{
+  const std::size_t link =
+              this->Federation->linkTo(this->Federation->origin(status.id()));
+  if(link < this->Federation->numberOfLinks())
+    {
+    remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                  remus::FORWARDED_STATUS,
+                  detail::make_peerMessage(this->Federation->ourEndpoint(),
+                                           remus::proto::to_string(status)),
+                  &this->Federation->link(link));
+    }
+  //a failure ends the job, so it is kept until the origin has it
+  if(status.failed())
+    {
+    this->Federation->sentToOrigin(status, detail::TimingWheel::now());
+    }
+}
+
+//------------------------------------------------------------------------------
+void Server::SendToOrigin(const remus::proto::JobResult& result)
+{
+  const std::size_t link =
+              this->Federation->linkTo(this->Federation->origin(result.id()));
+  if(link < this->Federation->numberOfLinks())
+    {
+    remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                  remus::FORWARDED_RESULT,
+                  detail::make_peerMessage(this->Federation->ourEndpoint(),
+                                           remus::proto::to_string(result)),
+                  &this->Federation->link(link));
+    }
+  //the origin hands the result to its client, so we only keep it until
+  //the origin acknowledges it
+  this->ActiveJobs->remove(result.id());
+  this->Federation->sentToOrigin(result, detail::TimingWheel::now());
+}
+
+//------------------------------------------------------------------------------
+void Server::CheckForLostPeerMessages()
+{
+  const boost::int64_t now = detail::TimingWheel::now();
+
+  //jobs a peer didn't acknowledge, or that ran on a peer we lost touch
+  //with, are ours to run again
+  const std::vector<remus::worker::Job> lost =
+                                      this->Federation->takeLostJobs(now);
+  typedef std::vector<remus::worker::Job>::const_iterator job_it;
+  for(job_it job = lost.begin(); job != lost.end(); ++job)
+    {
+    this->QueuedJobs->addJob(job->id(), job->submission());
+    }
+
+  const std::vector<remus::proto::JobStatus> failures =
+                                      this->Federation->failuresToResend(now);
+  typedef std::vector<remus::proto::JobStatus>::const_iterator status_it;
+  for(status_it i = failures.begin(); i != failures.end(); ++i)
+    {
+    this->SendToOrigin(*i);
+    }
+
+  const std::vector<remus::proto::JobResult> results =
+                                      this->Federation->resultsToResend(now);
+  typedef std::vector<remus::proto::JobResult>::const_iterator result_it;
+  for(result_it i = results.begin(); i != results.end(); ++i)
+    {
+    this->SendToOrigin(*i);
+    }
+}
+
 //We are crashing we need to terminate all workers
 //------------------------------------------------------------------------------
 void Server::signalCaught( SignalCatcher::SignalType )
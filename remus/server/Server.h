@@ -25,6 +25,9 @@ REMUS_THIRDPARTY_POST_INCLUDE
 #include <remus/server/WorkerFactoryBase.h>
 #include <remus/server/ServerPorts.h>
 
+#include <string>
+#include <vector>
+
 //included for export symbols
 #include <remus/server/ServerExports.h>
 
@@ -39,6 +42,9 @@ namespace zmq { struct SocketIdentity; }
 namespace remus {
   //forward declaration of classes only the implementation needs
   namespace proto {
+  class JobRequirements;
+  class JobResult;
+  class JobStatus;
   class WorkerJob;
   class Message;
   }
@@ -54,8 +60,10 @@ namespace server{
     {
     //forward declaration of classes only the implementation needs
     class ActiveJobs;
+    class Federation;
     class JobQueue;
     class SocketMonitor;
+    class WarmPool;
     class WorkerPool;
     class EventPublisher;
 
@@ -121,6 +129,72 @@ public:
   void pollingRates( const remus::server::PollingRates& rates );
   remus::server::PollingRates pollingRates() const;
 
+  //Set the maximum number of queued jobs with the given requirements that
+  //are sent to a worker in a single message. Batching reduces the per job
+  //messaging overhead for jobs that take very little time to process.
+  //The status and result of each job in a batch is still tracked
+  //individually. The default batch size is 1, which disables batching.
+  //
+  //Note: Should be set before you start brokering
+  void jobBatchSize( const remus::proto::JobRequirements& reqs,
+                     std::size_t size );
+  std::size_t jobBatchSize( const remus::proto::JobRequirements& reqs ) const;
+
+  //Set the minimum time in milliseconds between progress updates the
+  //server accepts for a single job. Progress updates that arrive sooner
+  //are dropped instead of being merged and published, so a worker flooding
+  //the server with progress can't make it fall behind. Changes of state,
+  //such as a job failing, are always accepted. The default is zero,
+  //which accepts every update.
+  //
+  //Note: Should be set before you start brokering
+  void minimumProgressInterval( boost::int64_t millisec );
+  boost::int64_t minimumProgressInterval() const;
+
+  //Set how often worker heartbeats are published as status events. One out
+  //of every n heartbeats of each worker is published, so 1 publishes every
+  //heartbeat and 0 stops publishing heartbeats. Liveness tracking isn't
+  //affected. The default is 1.
+  void heartbeatPublishSampling( unsigned int n );
+  unsigned int heartbeatPublishSampling() const;
+
+  //Federate this server with the peer server bound to the given client
+  //endpoint. Peers exchange summaries of their queue depth, and move
+  //queued jobs from a server that can't start them to a peer that has
+  //workers or worker factory space for them. Clients keep talking to the
+  //server they submitted the job to, which hands them the status and
+  //result the peer sends back.
+  //Peers have to be added on both servers, as a server only accepts jobs,
+  //statuses and results from the peers it was configured with. Peers
+  //connected through inproc endpoints need to share the zmq context of
+  //their ServerPorts, and servers bound to a wildcard address can't be
+  //reached back by their peers.
+  //
+  //Note: Peers can be added before or while brokering
+  void addPeer( const std::string& clientEndpoint );
+  std::vector<std::string> peers() const;
+
+  //Set the time in milliseconds between exchanging queue summaries with
+  //our peers. The default is 250.
+  void peerExchangeInterval( boost::int64_t millisec );
+  boost::int64_t peerExchangeInterval() const;
+
+  //Set the time in milliseconds a peer has to acknowledge the jobs and
+  //results we move to it. Jobs a peer doesn't acknowledge in time, or that
+  //run on a peer we haven't heard from for this long, are queued with us
+  //again, and results are sent again until the peer acknowledges them.
+  //The default is 5000.
+  void peerTimeout( boost::int64_t millisec );
+  boost::int64_t peerTimeout() const;
+
+  //Control whether queued jobs that we can't start are forwarded to peers
+  //that have capacity for them, and whether we take queued jobs from peers
+  //that can't start them while we have capacity. Both default to true.
+  void forwardJobsToPeers( bool enable );
+  bool forwardJobsToPeers() const;
+  void stealJobsFromPeers( bool enable );
+  bool stealJobsFromPeers() const;
+
   //when you call start brokering the server will actually start accepting
   //worker and client requests.
   //IMPORTANT:
@@ -197,6 +271,11 @@ protected:
   std::string retrieveResult(const remus::proto::Message& msg);
   std::string terminateJob(zmq::socket_t& WorkerChannel,const remus::proto::Message& msg);
 
+  //These methods are all to do with our peer servers
+  std::string queueSummary();
+  std::string peerRequest(const remus::proto::Message& msg,
+                          const zmq::SocketIdentity& peerIdentity);
+
   //Methods for processing Worker queries
   void DetermineWorkerResponse(zmq::socket_t& clientChannel,
                                const zmq::SocketIdentity &workerIdentity,
@@ -207,9 +286,20 @@ protected:
                        const remus::proto::Message& msg);
   void storeMesh(const zmq::SocketIdentity &workerIdentity,
                  const remus::proto::Message& msg);
+  void storeMeshBatch(const zmq::SocketIdentity &workerIdentity,
+                      const remus::proto::Message& msg);
   void assignJobToWorker(zmq::socket_t& workerChannel,
                          const zmq::SocketIdentity &workerIdentity,
                          const remus::worker::Job& job);
+  void assignJobsToWorker(zmq::socket_t& workerChannel,
+                          const zmq::SocketIdentity &workerIdentity,
+                          const std::vector<remus::worker::Job>& jobs);
+
+  //hand out queued jobs with the given requirements to workers that have
+  //asked for jobs, honoring the batch size of the requirements.
+  //returns true if any job was assigned
+  bool assignQueuedJobs(zmq::socket_t& workerChannel,
+                        const remus::proto::JobRequirements& reqs);
 
   //see if we have a worker in the pool for the next job in the queue,
   //otherwise ask the factory to generate a new worker to handle that job
@@ -219,15 +309,76 @@ protected:
   //of queued jobs and workers
   virtual void FindWorkerForQueuedJob(zmq::socket_t& workerChannel);
 
+  //ask the factory to launch workers for each set of requirements that
+  //has fewer idle workers than the factory's minimum idle worker count.
+  //Idle workers are those waiting for a job, or launched by us and
+  //still starting up.
+  void ReplenishIdleWorkers();
+
+  //terminate workers that have waited for a job for longer than the idle
+  //timeout of the factory's scaling policy, keeping the factory's minimum
+  //number of idle workers
+  void RetireIdleWorkers(zmq::socket_t& workerChannel);
+
+  //tell the factory how long the job of a result took to finish, so that
+  //it can scale the number of workers to how long jobs take
+  void RecordJobDuration(const remus::proto::JobResult& result);
+
   //remove any job that has expired, remove workers that have
   //stated they are shutting down, mark workers that are
   //not sending messages back to the server, update the worker factory
   //for changes, and lastly publish this all through our event publisher
   void CheckForChangeInWorkersAndJobs();
 
+  //process the connection events of the worker channel, marking workers
+  //whose connection closed as unresponsive. Returns true if any worker
+  //connection closed.
+  bool HandleWorkerConnectionEvents(zmq::socket_t& monitor);
+
+  //returns the next time the state of workers, jobs, warm or idle workers,
+  //or peers can change without us receiving a message, which is when the
+  //brokering loop needs to wake up and run CheckForChangeInWorkersAndJobs.
+  //Returns -1 when nothing can change until a message arrives.
+  //lastCheck is when we last checked, and watchingWorkerExits is true when
+  //the factory wakes us up as soon as a worker it launched exits.
+  //Times are milliseconds on the clock of TimingWheel::now
+  boost::int64_t NextTimeToCheck(boost::int64_t lastCheck,
+                                 bool watchingWorkerExits) const;
+
   //terminate all workers that are doing jobs or waiting for jobs
   void TerminateAllWorkers(zmq::socket_t& workerChannel);
 
+  //send our queue summary to every peer
+  void ExchangeWithPeers();
+
+  //process the replies a peer sent over the link to it
+  void HandlePeerResponses(std::size_t link);
+
+  //forward the queued jobs we can't start to the peer of the link, or take
+  //the jobs it can't start, based on the last queue summary of the peer.
+  //virtual so that custom servers can decide which jobs move between peers
+  virtual void BalanceWithPeer(std::size_t link);
+
+  //the number of jobs with the given requirements we can start right
+  //away, using waiting workers and space in the worker factory
+  std::size_t CapacityFor(const remus::proto::JobRequirements& reqs) const;
+
+  //queue jobs a peer moved to us, remembering where they came from.
+  //Returns the ids of the jobs that are now queued for the peer
+  std::vector<boost::uuids::uuid> QueueForeignJobs(
+                        const std::vector<remus::worker::Job>& jobs,
+                        const std::string& origin);
+
+  //send the status or result of a job a peer moved to us back to it.
+  //A failure or result is kept until the peer acknowledges it, after which
+  //we stop tracking the job
+  void SendToOrigin(const remus::proto::JobStatus& status);
+  void SendToOrigin(const remus::proto::JobResult& result);
+
+  //queue the jobs our peers didn't acknowledge in time again, and send
+  //again the failures and results they didn't acknowledge
+  void CheckForLostPeerMessages();
+
 private:
   //explicitly state the server doesn't support copy or move semantics
   Server(const Server&);
@@ -238,9 +389,13 @@ private:
   boost::scoped_ptr<remus::server::detail::JobQueue> QueuedJobs;
   boost::scoped_ptr<remus::server::detail::SocketMonitor> SocketMonitor;
   boost::scoped_ptr<remus::server::detail::WorkerPool> WorkerPool;
+  boost::scoped_ptr<remus::server::detail::WarmPool> WarmPool;
   boost::scoped_ptr<remus::server::detail::ActiveJobs> ActiveJobs;
 
   boost::scoped_ptr<remus::server::detail::EventPublisher> Publish;
+  boost::scoped_ptr<remus::server::detail::Federation> Federation;
+  bool ForwardJobsToPeers;
+  bool StealJobsFromPeers;
 
   boost::scoped_ptr<detail::UUIDManagement> UUIDGenerator;
   boost::scoped_ptr<detail::ThreadManagement> Thread;
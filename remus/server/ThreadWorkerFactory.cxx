@@ -18,59 +18,101 @@
 #include <remus/proto/JobRequirements.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <functional>
-#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 namespace remus{
 namespace server{
 
+//A persistent pool of worker threads. Threads are started once and then
+//reused for every task, so launching a worker doesn't pay for the creation
+//of a thread. Each thread owns a deque of tasks (with more threads than
+//cores, threads share deques), new tasks are spread over the deques, and a
+//thread whose deque is empty steals from the back of the other deques.
+//
+//The pool never accepts more tasks than it has threads, so an accepted
+//task always has an idle thread that can run it right away.
 class ThreadWorkerFactory::ThreadPool
 {
 private:
-  struct FutureWithState
+  typedef std::function< void() > Task;
+
+  struct TaskQueue
   {
-    FutureWithState& operator=(std::future<void>&& future)
-    {
-      this->Future = std::move(future);
-      this->Completed = false;
-      return *this;
-    }
-  
-    std::future<void> Future;
-    bool Completed;
+    std::mutex Mutex;
+    std::deque< Task > Tasks;
   };
 
-  std::map<std::size_t, FutureWithState > Futures;
-  std::size_t PoolSize;
+  //the maximum number of tasks that can be active at once
+  std::atomic< std::size_t > PoolSize;
+  //the number of tasks that have been accepted but not finished
+  std::atomic< std::size_t > ActiveTasks;
+  //the number of tasks sitting in a deque waiting for a thread
+  std::atomic< std::size_t > PendingTasks;
+  std::atomic< std::size_t > NextQueue;
+
+  //the deques are fixed at construction, so they can be used without
+  //holding the pool mutex
+  const std::vector< std::unique_ptr<TaskQueue> > Queues;
+
+  //guards Threads, Stopping, and the sleeping of idle threads
   std::mutex Mutex;
+  std::condition_variable TaskAdded;
+  std::condition_variable TaskFinished;
+  bool Stopping;
+  std::vector< std::thread > Threads;
 
 public:
 
   /// @brief Constructor.
   ThreadPool( std::size_t poolSize ) :
-    PoolSize( poolSize )
+    PoolSize( poolSize ),
+    ActiveTasks( 0 ),
+    PendingTasks( 0 ),
+    NextQueue( 0 ),
+    Queues( make_queues( hardware_threads() ) ),
+    Mutex(),
+    TaskAdded(),
+    TaskFinished(),
+    Stopping( false ),
+    Threads()
   {
+    this->prestart_threads();
   }
 
-  /// @brief Destructor.
+  /// @brief Destructor. Waits for all the active tasks to finish.
   ~ThreadPool()
   {
-    for ( auto& f : this->Futures )
+    {
+    std::unique_lock< std::mutex > lock( this->Mutex );
+    this->TaskFinished.wait( lock,
+                             [this]{ return this->ActiveTasks == 0; } );
+    this->Stopping = true;
+    }
+    this->TaskAdded.notify_all();
+
+    for ( auto& t : this->Threads )
       {
-      f.second.Future.wait();
+      t.join();
       }
   }
 
-  /// @brief Change the maximum number of threads. If the input is smaller than
-  ///        the number of currently active threads, the pool will wait for the
-  ///        current threads to finish.
+  /// @brief Change the maximum number of active tasks. If the input is
+  ///        smaller than the number of currently active tasks, no new tasks
+  ///        are accepted until enough of the current tasks finish.
   void resize( std::size_t size )
   {
     this->PoolSize = size;
+    this->prestart_threads();
   }
 
   /// @brief Return the maximum number of active threads.
@@ -82,72 +124,141 @@ public:
   /// @brief Return the current number of active threads.
   std::size_t number_of_active_threads() const
   {
-    typedef std::pair< const std::size_t, FutureWithState > FutureElement;
-    return std::accumulate( this->Futures.cbegin(),
-			    this->Futures.cend(),
-			    0,
-			    []( int counter, const FutureElement& f )
-			    { return counter + !f.second.Completed; } );
+    return this->ActiveTasks;
   }
 
   /// @brief Adds a task to the thread pool if a thread is currently available.
-  template < typename Task >
   bool run_task( Task task )
   {
-    std::unique_lock< std::mutex > lock( this->Mutex );
-
-    // Harvest completed futures.
-    auto it = this->Futures.begin(); 
-    while ( it != this->Futures.end() )
+    // Reserve a slot for the task, if no slots are available, then return.
+    std::size_t active = this->ActiveTasks;
+    do
       {
-      if (it->second.Completed)
-	{
-	this->Futures.erase(it++);
-	}
-      else
-	{
-	++it;
-	}
+      if ( active >= this->PoolSize )
+        {
+        return false;
+        }
       }
+    while ( !this->ActiveTasks.compare_exchange_weak( active, active + 1 ) );
 
-    static std::size_t key = 0;
+    std::unique_lock< std::mutex > lock( this->Mutex );
 
-    // If no threads are available, then return.
-    if ( this->Futures.size() >= PoolSize )
+    // Make sure every active task has a thread to run on.
+    while ( this->Threads.size() < active + 1 )
       {
-      return false;
+      this->start_thread();
       }
 
-    // add a wrapped task into the list.
-    this->Futures[key] = std::async( std::launch::async,
-                                     &ThreadPool::wrap_task,
-                                     this,
-                                     std::function< void() >( task ),
-                                     key );
-    ++key;
+    TaskQueue& queue = *this->Queues[ this->NextQueue++ % this->Queues.size() ];
+    {
+    std::unique_lock< std::mutex > queueLock( queue.Mutex );
+    queue.Tasks.push_back( std::move(task) );
+    ++this->PendingTasks;
+    }
+
+    // Notify while holding the lock, so that a thread that just found no
+    // work can't miss the wakeup.
+    this->TaskAdded.notify_one();
     return true;
   }
 
 private:
-  /// @brief Wrap a task so that the available count can be increased once
-  ///        the user provided task has completed.
-  void wrap_task( std::function< void() > task, std::size_t key )
+  static std::size_t hardware_threads()
   {
-    // Run the user supplied task.
-    try
-    {
-      task();
-    }
-    // Suppress all exceptions.
-    catch ( const std::exception& ) {}
+    return std::max( std::thread::hardware_concurrency(), 1u );
+  }
+
+  static std::vector< std::unique_ptr<TaskQueue> > make_queues( std::size_t n )
+  {
+    std::vector< std::unique_ptr<TaskQueue> > queues;
+    for ( std::size_t i = 0; i < n; ++i )
+      {
+      queues.push_back( std::unique_ptr<TaskQueue>( new TaskQueue() ) );
+      }
+    return queues;
+  }
+
+  /// @brief Start threads ahead of time, so that the first tasks don't
+  ///        pay for the thread creation. We only start as many threads as
+  ///        the hardware supports, any more are started when needed.
+  void prestart_threads()
+  {
+    const std::size_t wanted =
+      std::min<std::size_t>( this->PoolSize, this->Queues.size() );
 
-    // Task has finished, so we clean up.
     std::unique_lock< std::mutex > lock( this->Mutex );
+    while ( this->Threads.size() < wanted )
+      {
+      this->start_thread();
+      }
+  }
 
-    // the future for this task is marked as Completed. We cannot simply
-    // delete it because that would force the task to return, which would
-    // result in deadlock.
-    this->Futures[ key ].Completed = true;
+  /// @brief Start a new thread. Requires the lock.
+  void start_thread()
+  {
+    const std::size_t index = this->Threads.size() % this->Queues.size();
+    this->Threads.push_back( std::thread( &ThreadPool::run, this, index ) );
+  }
+
+  /// @brief Take a task from the front of our own deque, or steal one from
+  ///        the back of another deque.
+  bool take_task( std::size_t index, Task& task )
+  {
+    const std::size_t numQueues = this->Queues.size();
+    for ( std::size_t i = 0; i < numQueues; ++i )
+      {
+      TaskQueue& queue = *this->Queues[ (index + i) % numQueues ];
+      std::unique_lock< std::mutex > queueLock( queue.Mutex );
+      if ( !queue.Tasks.empty() )
+        {
+        if ( i == 0 )
+          {
+          task = std::move( queue.Tasks.front() );
+          queue.Tasks.pop_front();
+          }
+        else
+          {
+          task = std::move( queue.Tasks.back() );
+          queue.Tasks.pop_back();
+          }
+        --this->PendingTasks;
+        return true;
+        }
+      }
+    return false;
+  }
+
+  /// @brief The loop each pool thread runs until the pool is destroyed.
+  void run( std::size_t index )
+  {
+    while ( true )
+      {
+      Task task;
+      if ( !this->take_task( index, task ) )
+        {
+        std::unique_lock< std::mutex > lock( this->Mutex );
+        this->TaskAdded.wait( lock, [this]
+          { return this->Stopping || this->PendingTasks > 0; } );
+        if ( this->Stopping )
+          {
+          return;
+          }
+        continue;
+        }
+
+      // Run the user supplied task, suppressing all exceptions.
+      try
+      {
+        task();
+      }
+      catch ( ... ) {}
+      task = Task();
+
+      // Task has finished, so the slot is available again.
+      std::unique_lock< std::mutex > lock( this->Mutex );
+      --this->ActiveTasks;
+      this->TaskFinished.notify_all();
+      }
   }
 };
 
@@ -212,8 +323,14 @@ bool ThreadWorkerFactory::haveSupport(
 bool ThreadWorkerFactory::registerWorkerType(
   const remus::proto::JobRequirements& requirements, WorkerThread worker)
 {
-  // Simply add the work thread functor to the map.
+  // Simply add the work thread functor to the map. The running count is
+  // created here so that launching workers never modifies the map.
   this->WorkerThreadTypes[requirements] = worker;
+  if (this->RunningWorkers.find(requirements) == this->RunningWorkers.end())
+    {
+    this->RunningWorkers[requirements] =
+      std::make_shared< std::atomic<unsigned int> >(0);
+    }
   return true;
 }
 
@@ -236,8 +353,9 @@ bool ThreadWorkerFactory::createWorker(
 bool ThreadWorkerFactory::launchWorkerThread(
   const remus::proto::JobRequirements& requirements)
 {
-  // Reject workers if the maximum worker count has been reached.
-  if (this->currentWorkerCount() >= this->maxWorkerCount())
+  // Reject workers if the maximum worker count of the factory or the
+  // requirements has been reached.
+  if (!this->haveSpaceFor(requirements))
     {
     return false;
     }
@@ -249,9 +367,29 @@ bool ThreadWorkerFactory::launchWorkerThread(
     return false;
     }
 
-  // Launch the worker.
-  return this->addWorker( std::bind(search->second, requirements,
-                                    this->workerEndpoint() ) );
+  // Launch the worker, keeping count of the running workers of this type.
+  RunningCount running = this->RunningWorkers.find(requirements)->second;
+  WorkerThread worker = search->second;
+  const std::string endpoint = this->workerEndpoint();
+  ++(*running);
+  const bool launched = this->addWorker( [=]()
+    {
+    try
+      {
+      worker(requirements, endpoint);
+      }
+    catch (...)
+      {
+      --(*running);
+      throw;
+      }
+    --(*running);
+    } );
+  if (!launched)
+    {
+    --(*running);
+    }
+  return launched;
 }
 
 //----------------------------------------------------------------------------
@@ -272,6 +410,14 @@ unsigned int ThreadWorkerFactory::currentWorkerCount() const
   return static_cast<unsigned int>(this->Pool->number_of_active_threads());
 }
 
+//----------------------------------------------------------------------------
+unsigned int ThreadWorkerFactory::workerCount(
+  const remus::proto::JobRequirements& reqs) const
+{
+  auto search = this->RunningWorkers.find(reqs);
+  return (search != this->RunningWorkers.end()) ? search->second->load() : 0;
+}
+
 //----------------------------------------------------------------------------
 bool ThreadWorkerFactory::addWorker(std::function<void()> workerWithTask)
 {
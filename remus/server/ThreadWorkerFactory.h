@@ -13,6 +13,7 @@
 #ifndef remus_server_ThreadWorkerFactory_h
 #define remus_server_ThreadWorkerFactory_h
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -81,6 +82,7 @@ public:
   virtual void setMaxWorkerCount(unsigned int count);
   virtual unsigned int maxWorkerCount() const;
   virtual unsigned int currentWorkerCount() const;
+  virtual unsigned int workerCount(const remus::proto::JobRequirements& reqs) const;
   virtual void updateWorkerCount() {}
 
 private:
@@ -91,6 +93,11 @@ private:
 
   std::map<JobRequirements, WorkerThread> WorkerThreadTypes;
 
+  //the number of running workers of each registered type, shared with the
+  //running workers so they can decrement it when they finish
+  typedef std::shared_ptr< std::atomic<unsigned int> > RunningCount;
+  std::map<JobRequirements, RunningCount> RunningWorkers;
+
   class ThreadPool;
   ThreadPool* Pool;
 };
@@ -17,7 +17,9 @@
 #include <remus/common/MeshIOType.h>
 #include <remus/server/FactoryFileParser.h>
 #include <remus/server/FactoryWorkerSpecification.h>
-#include <remus/server/detail/WorkerFinder.h>
+#include <remus/server/detail/ChildWatcher.h>
+#include <remus/server/detail/WorkerCatalog.h>
+#include <remus/server/detail/Zygote.h>
 
 //force to use filesystem version 3
 REMUS_THIRDPARTY_PRE_INCLUDE
@@ -27,136 +29,138 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 REMUS_THIRDPARTY_POST_INCLUDE
 
 #include <algorithm>
+#include <set>
 
 namespace
 {
   //typedefs required
   typedef remus::common::ExecuteProcess ExecuteProcess;
   typedef boost::shared_ptr<ExecuteProcess> ExecuteProcessPtr;
-  typedef std::pair<ExecuteProcessPtr,
-                    remus::server::WorkerFactoryBase::FactoryDeletionBehavior>
-              RunningProcessInfo;
+  typedef remus::server::detail::Zygote Zygote;
+  typedef boost::shared_ptr<Zygote> ZygotePtr;
+  typedef Zygote::ForkedWorkerPtr ForkedWorkerPtr;
 
-  typedef std::vector<remus::server::FactoryWorkerSpecification>::const_iterator WorkerIterator;
-  typedef std::vector< RunningProcessInfo >::iterator ProcessIterator;
-
-  //----------------------------------------------------------------------------
-  struct support_MeshIOType
+  //a worker is either a process we launched, or one forked from a zygote
+  //that we track through the pidfd the zygote handed us
+  struct RunningProcessInfo
   {
-    remus::common::MeshIOType Type;
-    support_MeshIOType(remus::common::MeshIOType type):Type(type)
+    RunningProcessInfo(ExecuteProcessPtr process,
+            remus::server::WorkerFactoryBase::FactoryDeletionBehavior lifespan,
+            const remus::server::FactoryWorkerSpecification& spec):
+      Process(process),
+      Forked(),
+      Lifespan(lifespan),
+      Requirements(spec.Requirements),
+      CpuCost(spec.CpuCost),
+      MemoryCost(spec.MemoryCost),
+      Watched(false)
       {
       }
 
-    bool operator()(const remus::server::FactoryWorkerSpecification& info)
+    RunningProcessInfo(ForkedWorkerPtr forked,
+            remus::server::WorkerFactoryBase::FactoryDeletionBehavior lifespan,
+            const remus::server::FactoryWorkerSpecification& spec):
+      Process(),
+      Forked(forked),
+      Lifespan(lifespan),
+      Requirements(spec.Requirements),
+      CpuCost(spec.CpuCost),
+      MemoryCost(spec.MemoryCost),
+      Watched(false)
       {
-      return info.Requirements.meshTypes() == this->Type;
       }
-  };
 
-  //----------------------------------------------------------------------------
-  struct support_JobReqs
-  {
-    remus::proto::JobRequirements& Requirements;
-    support_JobReqs(remus::proto::JobRequirements& reqs):
-      Requirements(reqs)
+    bool isAlive() const
       {
+      return this->Process ? this->Process->isAlive() :
+                             this->Forked->isAlive();
       }
 
-    bool operator()(const remus::server::FactoryWorkerSpecification& info)
+    bool kill() const
       {
-      return info.Requirements == this->Requirements;
+      return this->Process ? this->Process->kill() :
+                             this->Forked->kill();
       }
+
+    int processId() const
+      {
+      return this->Process ? this->Process->processId() :
+                             this->Forked->processId();
+      }
+
+    ExecuteProcessPtr Process;
+    ForkedWorkerPtr Forked;
+    remus::server::WorkerFactoryBase::FactoryDeletionBehavior Lifespan;
+    remus::proto::JobRequirements Requirements;
+    double CpuCost;
+    boost::uint64_t MemoryCost;
+    //true when the ChildWatcher will tell us when the process exits
+    bool Watched;
   };
 
+  typedef std::vector< RunningProcessInfo >::iterator ProcessIterator;
+
   //----------------------------------------------------------------------------
   struct is_dead
   {
     bool operator()(const RunningProcessInfo& process) const
       {
-      return !process.first->isAlive();
+      return !process.isAlive();
       }
   };
 
   //----------------------------------------------------------------------------
-  struct kill_on_deletion
+  //a process is dead if it has exited, watched processes are only checked
+  //when the ChildWatcher has told us they exited
+  struct has_exited
   {
-    void operator()(RunningProcessInfo& process) const
+    const std::set<int>& Exited;
+    has_exited(const std::set<int>& exited):
+      Exited(exited)
       {
-      is_dead isDead;
-      const bool shouldBeTerminated =
-        (process.second == remus::server::WorkerFactoryBase::KillOnFactoryDeletion);
-      const bool is_alive = !isDead(process);
-      if(shouldBeTerminated && is_alive)
+      }
+
+    bool operator()(const RunningProcessInfo& process) const
+      {
+      if(process.Watched &&
+         this->Exited.count(process.processId()) == 0)
         {
-        process.first->kill();
+        return false;
         }
+      return !process.isAlive();
       }
   };
 
   //----------------------------------------------------------------------------
-  struct ValidWorker
+  struct has_JobReqs
   {
-    ValidWorker(const remus::server::FactoryWorkerSpecification& w):
-      valid(true),
-      spec(w)
+    const remus::proto::JobRequirements& Requirements;
+    has_JobReqs(const remus::proto::JobRequirements& reqs):
+      Requirements(reqs)
       {
       }
 
-    ValidWorker():
-      valid(false)
+    bool operator()(const RunningProcessInfo& process) const
       {
+      return process.Requirements == this->Requirements;
       }
-
-    bool valid;
-    remus::server::FactoryWorkerSpecification spec;
   };
 
-
   //----------------------------------------------------------------------------
-  template<typename Container >
-  ValidWorker find_worker_path(remus::proto::JobRequirements reqs,
-                               Container const& container)
-  {
-    support_JobReqs pred(reqs);
-    WorkerIterator result = std::find_if(container.begin(),container.end(),pred);
-
-    if(result != container.end())
-      {
-      //return a valid work
-      return ValidWorker(*result);
-      }
-    //return an invalid worker
-    return ValidWorker();
-  }
-
-    //----------------------------------------------------------------------------
-  template<typename Container >
-  remus::common::MeshIOTypeSet
-  find_all_workers_iotypes(Container const& container)
-  {
-    typedef typename Container::const_iterator IterType;
-    remus::common::MeshIOTypeSet validIOTypes;
-    for(IterType i = container.begin(); i != container.end(); ++i)
-      { validIOTypes.insert(i->Requirements.meshTypes()); }
-    return validIOTypes;
-  }
-
-  //----------------------------------------------------------------------------
-  template<typename Container >
-  remus::proto::JobRequirementsSet
-  find_all_matching_workers(remus::common::MeshIOType type,
-                            Container const& container)
+  struct kill_on_deletion
   {
-    typedef typename Container::const_iterator IterType;
-    support_MeshIOType pred(type);
-    remus::proto::JobRequirementsSet validWorkers;
-    for(IterType i = container.begin(); i != container.end(); ++i)
+    void operator()(RunningProcessInfo& process) const
       {
-      if(pred(*i)) { validWorkers.insert(i->Requirements); }
+      is_dead isDead;
+      const bool shouldBeTerminated =
+        (process.Lifespan == remus::server::WorkerFactoryBase::KillOnFactoryDeletion);
+      const bool is_alive = !isDead(process);
+      if(shouldBeTerminated && is_alive)
+        {
+        process.kill();
+        }
       }
-    return validWorkers;
-  }
+  };
 }
 
 
@@ -166,37 +170,130 @@ namespace server{
 
 struct WorkerFactory::WorkerTracker
 {
-  WorkerTracker():
-    PossibleWorkers(),
-    CurrentProcesses()
+  WorkerTracker(const boost::shared_ptr<FactoryFileParser>& parser,
+                const std::string& ext):
+    Catalog(parser, ext),
+    CurrentProcesses(),
+    Watcher()
     {
 
     }
 
+  void refreshCatalog();
+
   bool addWorker(
     const remus::server::FactoryWorkerSpecification& workerSpec,
     WorkerFactoryBase::FactoryDeletionBehavior lifespan);
 
-  std::vector< remus::server::FactoryWorkerSpecification > PossibleWorkers;
-  std::vector< RunningProcessInfo > CurrentProcesses;
+  ForkedWorkerPtr forkFromZygote(
+    const remus::server::FactoryWorkerSpecification& workerSpec,
+    const std::vector< std::string >& arguments);
+
+  void collectForks();
 
+  remus::server::detail::WorkerCatalog Catalog;
+  std::vector< RunningProcessInfo > CurrentProcesses;
+  remus::server::detail::ChildWatcher Watcher;
+  std::map< remus::proto::JobRequirements, ZygotePtr > Zygotes;
 };
 
+//----------------------------------------------------------------------------
+//pick up the worker files that changed, and stop the zygotes of workers
+//whose file was removed or now launches something else. Workers that are
+//running keep running, only new workers use the changed files
+void WorkerFactory::WorkerTracker::refreshCatalog()
+{
+  if(!this->Catalog.refresh())
+    {
+    return;
+    }
+
+  typedef std::map< remus::proto::JobRequirements, ZygotePtr >::iterator
+          ZygoteIterator;
+  for(ZygoteIterator i = this->Zygotes.begin(); i != this->Zygotes.end(); )
+    {
+    const FactoryWorkerSpecification* spec = this->Catalog.find(i->first);
+    if(!spec || !spec->Zygote || !i->second ||
+       spec->ExecutionPath.string() != i->second->executable() ||
+       spec->EnvironmentVariables != i->second->environment())
+      {
+      this->Zygotes.erase(i++);
+      }
+    else
+      {
+      ++i;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+//fork a worker from the zygote of the spec, starting the zygote if needed.
+//Returns an empty pointer while the zygote is still initializing, so that
+//the caller launches the worker itself. The returned worker is pending
+//until collectForks picks up the answer of the zygote
+ForkedWorkerPtr WorkerFactory::WorkerTracker::forkFromZygote(
+  const remus::server::FactoryWorkerSpecification& spec,
+  const std::vector< std::string >& arguments)
+{
+  ZygotePtr& zygote = this->Zygotes[spec.Requirements];
+  if(zygote && (zygote->arguments() != arguments || !zygote->isAlive()))
+    { //the worker endpoint changed, or the zygote died
+    zygote.reset();
+    }
+
+  if(!zygote)
+    {
+    zygote = boost::make_shared<Zygote>(spec.ExecutionPath.string(),
+                                        arguments,
+                                        spec.EnvironmentVariables);
+    if(!zygote->start())
+      {
+      zygote.reset();
+      }
+    return ForkedWorkerPtr();
+    }
+
+  return zygote->fork();
+}
+
+//----------------------------------------------------------------------------
+//pick up the answers of the zygotes, and watch the workers that were
+//forked through their pidfd
+void WorkerFactory::WorkerTracker::collectForks()
+{
+  typedef std::map< remus::proto::JobRequirements, ZygotePtr >::iterator
+          ZygoteIterator;
+  for(ZygoteIterator i = this->Zygotes.begin(); i != this->Zygotes.end(); ++i)
+    {
+    if(i->second && i->second->pendingForks() > 0)
+      {
+      i->second->collect();
+      }
+    }
+
+  for(ProcessIterator i = this->CurrentProcesses.begin();
+      i != this->CurrentProcesses.end(); ++i)
+    {
+    if(i->Forked && !i->Watched && !i->Forked->pending())
+      {
+      i->Watched = this->Watcher.watch(i->Forked->processId(),
+                                       i->Forked->descriptor());
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 WorkerFactory::WorkerFactory():
   WorkerFactoryBase(),
   GlobalCommandLineArguments(),
   WorkerExtension(".RW"),
+  Capacity(HostCapacity::discover()),
   Parser( boost::make_shared<FactoryFileParser>() ),
-  Tracker(boost::make_shared<WorkerTracker>())
+  Tracker(boost::make_shared<WorkerTracker>(this->Parser,
+                                            this->WorkerExtension))
 {
   //default to current working directory
-  remus::server::detail::WorkerFinder finder(this->Parser,
-                                             this->WorkerExtension);
-  this->Tracker->PossibleWorkers.insert(this->Tracker->PossibleWorkers.end(),
-                                          finder.begin(),
-                                          finder.end());
-
+  this->Tracker->Catalog.addDirectory(boost::filesystem::current_path());
 }
 
 //----------------------------------------------------------------------------
@@ -204,15 +301,13 @@ WorkerFactory::WorkerFactory(const std::string& ext):
   WorkerFactoryBase(),
   GlobalCommandLineArguments(),
   WorkerExtension(ext),
+  Capacity(HostCapacity::discover()),
   Parser( boost::make_shared<FactoryFileParser>() ),
-  Tracker(boost::make_shared<WorkerTracker>())
+  Tracker(boost::make_shared<WorkerTracker>(this->Parser,
+                                            this->WorkerExtension))
 {
   //default to current working directory
-  remus::server::detail::WorkerFinder finder(this->Parser,
-                                             this->WorkerExtension);
-  this->Tracker->PossibleWorkers.insert(this->Tracker->PossibleWorkers.end(),
-                                        finder.begin(),
-                                        finder.end());
+  this->Tracker->Catalog.addDirectory(boost::filesystem::current_path());
 }
 
 //----------------------------------------------------------------------------
@@ -221,15 +316,13 @@ WorkerFactory::WorkerFactory(const std::string& ext,
   WorkerFactoryBase(),
   GlobalCommandLineArguments(),
   WorkerExtension(ext),
+  Capacity(HostCapacity::discover()),
   Parser( parser ),
-  Tracker(boost::make_shared<WorkerTracker>())
+  Tracker(boost::make_shared<WorkerTracker>(this->Parser,
+                                            this->WorkerExtension))
 {
   //default to current working directory
-  remus::server::detail::WorkerFinder finder(this->Parser,
-                                             this->WorkerExtension);
-  this->Tracker->PossibleWorkers.insert(this->Tracker->PossibleWorkers.end(),
-                                        finder.begin(),
-                                        finder.end());
+  this->Tracker->Catalog.addDirectory(boost::filesystem::current_path());
 }
 
 //----------------------------------------------------------------------------
@@ -245,33 +338,30 @@ WorkerFactory::~WorkerFactory()
 //----------------------------------------------------------------------------
 void WorkerFactory::addWorkerSearchDirectory(const std::string &directory)
 {
-  boost::filesystem::path dir(directory);
-  remus::server::detail::WorkerFinder finder(this->Parser,
-                                             dir,
-                                             this->WorkerExtension);
-  this->Tracker->PossibleWorkers.insert(this->Tracker->PossibleWorkers.end(),
-                                        finder.begin(),
-                                        finder.end());
+  this->Tracker->Catalog.addDirectory(boost::filesystem::path(directory));
 }
 
 //----------------------------------------------------------------------------
 remus::common::MeshIOTypeSet WorkerFactory::supportedIOTypes() const
 {
-  return find_all_workers_iotypes(this->Tracker->PossibleWorkers);
+  this->Tracker->refreshCatalog();
+  return this->Tracker->Catalog.ioTypes();
 }
 
 //----------------------------------------------------------------------------
 remus::proto::JobRequirementsSet WorkerFactory::workerRequirements(
                                        remus::common::MeshIOType type) const
 {
-  return find_all_matching_workers(type,this->Tracker->PossibleWorkers);
+  this->Tracker->refreshCatalog();
+  return this->Tracker->Catalog.requirements(type);
 }
 
 //----------------------------------------------------------------------------
 bool WorkerFactory::haveSupport(
                             const remus::proto::JobRequirements& reqs) const
 {
-  return find_worker_path(reqs, this->Tracker->PossibleWorkers).valid;
+  this->Tracker->refreshCatalog();
+  return this->Tracker->Catalog.find(reqs) != NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -283,14 +373,16 @@ bool WorkerFactory::createWorker(const remus::proto::JobRequirements& reqs,
   //slow ( milliseconds ), while the 'ValidWorker' check is
   //fast ( microseconds ).
   //This is super important as 'Server::FindWorkerForQueuedJob' can really hammer
-  //this method
-  const ValidWorker w = find_worker_path(reqs, this->Tracker->PossibleWorkers);
-  if(w.valid)
+  //this method. Picking up changed worker files is also fast, as it only
+  //reads the changes the catalog was told about
+  this->Tracker->refreshCatalog();
+  const FactoryWorkerSpecification* spec = this->Tracker->Catalog.find(reqs);
+  if(spec)
     {
     this->updateWorkerCount(); //remove dead workers
-    if(this->currentWorkerCount() < this->maxWorkerCount())
+    if(this->haveSpaceFor(reqs))
       {
-      return this->addWorker(w.spec, lifespan);
+      return this->addWorker(*spec, lifespan);
       }
     }
   return false;
@@ -299,20 +391,103 @@ bool WorkerFactory::createWorker(const remus::proto::JobRequirements& reqs,
 //----------------------------------------------------------------------------
 void WorkerFactory::updateWorkerCount()
 {
+  this->Tracker->collectForks();
+
+  //find the watched processes that have exited, so that only they and the
+  //processes we can't watch have to be asked if they are alive
+  const std::vector<int> exited = this->Tracker->Watcher.exited();
+  const std::set<int> exitedPids(exited.begin(), exited.end());
+
   //foreach current worker remove any that return they are not alive
   this->Tracker->CurrentProcesses.erase(
       std::remove_if(this->Tracker->CurrentProcesses.begin(),
                      this->Tracker->CurrentProcesses.end(),
-                     is_dead()),
+                     has_exited(exitedPids)),
       this->Tracker->CurrentProcesses.end());
 }
 
+//----------------------------------------------------------------------------
+void WorkerFactory::killWorkers()
+{
+  std::for_each(this->Tracker->CurrentProcesses.begin(),
+                this->Tracker->CurrentProcesses.end(),
+                kill_on_deletion());
+  this->updateWorkerCount();
+}
+
+//----------------------------------------------------------------------------
+int WorkerFactory::workerExitDescriptor() const
+{
+  return this->Tracker->Watcher.descriptor();
+}
+
 //----------------------------------------------------------------------------
 unsigned int WorkerFactory::currentWorkerCount() const
 {
   return static_cast<unsigned int>(this->Tracker->CurrentProcesses.size());
 }
 
+//----------------------------------------------------------------------------
+unsigned int WorkerFactory::workerCount(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  return static_cast<unsigned int>(
+    std::count_if(this->Tracker->CurrentProcesses.begin(),
+                  this->Tracker->CurrentProcesses.end(),
+                  has_JobReqs(reqs)));
+}
+
+//----------------------------------------------------------------------------
+unsigned int WorkerFactory::spaceFor(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  unsigned int space = this->WorkerFactoryBase::spaceFor(reqs);
+  const FactoryWorkerSpecification* spec = this->Tracker->Catalog.find(reqs);
+  if(space == 0 || !spec)
+    {
+    return space;
+    }
+
+  if(spec->MaxWorkerCount > 0)
+    {
+    const unsigned int count = this->workerCount(reqs);
+    space = (count >= spec->MaxWorkerCount) ? 0 :
+            std::min(space, spec->MaxWorkerCount - count);
+    }
+
+  return std::min(space,
+                  this->Capacity.workersThatFit(this->usedCores(),
+                                                this->usedMemory(),
+                                                spec->CpuCost,
+                                                spec->MemoryCost));
+}
+
+//----------------------------------------------------------------------------
+double WorkerFactory::usedCores() const
+{
+  double used = 0;
+  for(std::vector< RunningProcessInfo >::const_iterator
+        i = this->Tracker->CurrentProcesses.begin();
+        i != this->Tracker->CurrentProcesses.end(); ++i)
+    {
+    used += i->CpuCost;
+    }
+  return used;
+}
+
+//----------------------------------------------------------------------------
+boost::uint64_t WorkerFactory::usedMemory() const
+{
+  boost::uint64_t used = 0;
+  for(std::vector< RunningProcessInfo >::const_iterator
+        i = this->Tracker->CurrentProcesses.begin();
+        i != this->Tracker->CurrentProcesses.end(); ++i)
+    {
+    used += i->MemoryCost;
+    }
+  return used;
+}
+
 //----------------------------------------------------------------------------
 bool WorkerFactory::addWorker(
   const FactoryWorkerSpecification& spec,
@@ -334,6 +509,19 @@ bool WorkerFactory::addWorker(
   arguments.insert( arguments.end(), cmlArgs.begin(), cmlArgs.end() );
   arguments.insert( arguments.end(), spec.ExtraCommandLineArguments.begin(), spec.ExtraCommandLineArguments.end() );
 
+  //forked workers aren't our children, so they are only safe to track
+  //when we can hold a pidfd for them, otherwise every worker is launched
+  if(spec.Zygote && this->Tracker->Watcher.supported())
+    {
+    ForkedWorkerPtr forked = this->Tracker->forkFromZygote(spec, arguments);
+    if(forked)
+      { //the worker is counted while pending, and watched once forked
+      RunningProcessInfo p_info(forked,lifespan,spec);
+      this->Tracker->CurrentProcesses.push_back(p_info);
+      return true;
+      }
+    }
+
   ExecuteProcessPtr ep(
     boost::make_shared<ExecuteProcess>(
       spec.ExecutionPath.string(), arguments, spec.EnvironmentVariables
@@ -345,7 +533,8 @@ bool WorkerFactory::addWorker(
   //it is impossible to determine if it is still running or not
   ep->execute( );
 
-  RunningProcessInfo p_info(ep,lifespan);
+  RunningProcessInfo p_info(ep,lifespan,spec);
+  p_info.Watched = this->Tracker->Watcher.watch(ep->processId());
 
   this->Tracker->CurrentProcesses.push_back(p_info);
   return true;
@@ -15,6 +15,7 @@
 
 //included for export symbols
 #include <remus/server/ServerExports.h>
+#include <remus/server/HostCapacity.h>
 #include <remus/server/WorkerFactoryBase.h>
 
 #include <remus/common/CompilerInformation.h>
@@ -36,6 +37,18 @@ struct FactoryWorkerSpecification;
 //First it locates all files that match a given extension of the default extension
 //of .rw. These files are than parsed to determine what type of local Remus workers
 //we can launch.
+//Worker files that are added, changed or removed in the search directories
+//while the factory is running are picked up the next time the factory is
+//asked about workers, so new worker versions can be deployed without
+//restarting the server. Workers that are already running are left alone.
+//A .rw file can limit how many of its workers run at once with MaxWorkerCount,
+//and declare the cores and megabytes of memory each worker uses with CpuCost
+//and MemoryCost. Workers are only launched when their costs fit in the
+//HostCapacity left over by the workers already running.
+//A .rw file with Zygote set to true has its executable started once as a
+//zygote, and its workers forked from that process once it has initialized.
+//Forked workers are tracked through pidfds, so until the zygote is ready,
+//or on systems without pidfds, workers are launched the regular way.
 class REMUSSERVER_EXPORT WorkerFactory : public WorkerFactoryBase
 {
 public:
@@ -89,11 +102,37 @@ public:
                             WorkerFactoryBase::FactoryDeletionBehavior lifespan);
 
   //checks all current processes and removes any that have
-  //shutdown
+  //shutdown. Processes that are watched for exit are only checked once
+  //the workerExitDescriptor reports they have exited
   virtual void updateWorkerCount();
 
+  //kill all running workers whose FactoryDeletionBehavior is
+  //KillOnFactoryDeletion, like deleting the factory does
+  void killWorkers();
+
+  //readable when a launched worker process has exited. Only supported on
+  //Linux with pidfds, otherwise returns -1
+  virtual int workerExitDescriptor() const;
+
   virtual unsigned int currentWorkerCount() const;
 
+  //the number of running workers launched with the given requirements
+  virtual unsigned int workerCount(const remus::proto::JobRequirements& reqs) const;
+
+  //the number of workers with the given requirements that can be launched,
+  //also limited by the MaxWorkerCount of the worker file and the resources
+  //left on the host
+  virtual unsigned int spaceFor(const remus::proto::JobRequirements& reqs) const;
+
+  //the capacity of the host that the costs of workers are admitted against.
+  //Defaults to HostCapacity::discover()
+  void hostCapacity(const HostCapacity& capacity) { this->Capacity = capacity; }
+  const HostCapacity& hostCapacity() const { return this->Capacity; }
+
+  //the cores and megabytes of memory used by the running workers
+  double usedCores() const;
+  boost::uint64_t usedMemory() const;
+
   //return the worker file extension we have
   std::string workerExtension() const { return this->WorkerExtension;  }
 
@@ -109,6 +148,8 @@ private:
 
   std::string WorkerExtension;
 
+  HostCapacity Capacity;
+
   boost::shared_ptr<FactoryFileParser> Parser;
 
   struct WorkerTracker;
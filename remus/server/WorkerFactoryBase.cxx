@@ -14,13 +14,69 @@
 
 #include <remus/server/ServerPorts.h>
 
+#include <algorithm>
+#include <limits>
 
 namespace remus{
 namespace server{
 
+//----------------------------------------------------------------------------
+ScalingPolicy::ScalingPolicy():
+  QueueDrainTime(1000),
+  IdleTimeout(0),
+  MaxWorkerCounts()
+{
+}
+
+//----------------------------------------------------------------------------
+void ScalingPolicy::queueDrainTime(boost::int64_t millisec)
+{
+  this->QueueDrainTime = std::max(boost::int64_t(1), millisec);
+}
+
+//----------------------------------------------------------------------------
+void ScalingPolicy::maxWorkerCount(const remus::proto::JobRequirements& reqs,
+                                   unsigned int count)
+{
+  this->MaxWorkerCounts[reqs] = count;
+}
+
+//----------------------------------------------------------------------------
+unsigned int ScalingPolicy::maxWorkerCount(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  std::map<remus::proto::JobRequirements, unsigned int>::const_iterator i =
+                                              this->MaxWorkerCounts.find(reqs);
+  return (i != this->MaxWorkerCounts.end()) ?
+                          i->second : std::numeric_limits<unsigned int>::max();
+}
+
+//----------------------------------------------------------------------------
+unsigned int ScalingPolicy::workersNeeded(std::size_t queuedJobs,
+                                          boost::int64_t averageJobDuration) const
+{
+  const boost::uint64_t jobs = static_cast<boost::uint64_t>(
+     std::min(queuedJobs, std::size_t(std::numeric_limits<unsigned int>::max())));
+  if(jobs == 0 || averageJobDuration < 0)
+    { //with no history a worker per job is the fastest way to drain the queue
+    return static_cast<unsigned int>(jobs);
+    }
+
+  //the workers needed to do all the work within the drain time, rounded up
+  const boost::uint64_t work =
+                      jobs * static_cast<boost::uint64_t>(averageJobDuration);
+  const boost::uint64_t drain = static_cast<boost::uint64_t>(this->QueueDrainTime);
+  const boost::uint64_t needed = (work + drain - 1) / drain;
+  return static_cast<unsigned int>(
+                    std::max(boost::uint64_t(1), std::min(needed, jobs)));
+}
+
 //----------------------------------------------------------------------------
 WorkerFactoryBase::WorkerFactoryBase():
   MaxWorkers(1),
+  MinimumIdleWorkers(),
+  Scaling(),
+  JobDurations(),
   WorkerEndpoint()
 {
 
@@ -38,6 +94,98 @@ void WorkerFactoryBase::portForWorkersToUse(const remus::server::PortConnection&
   this->WorkerEndpoint = port.endpoint();
 }
 
+//----------------------------------------------------------------------------
+void WorkerFactoryBase::setMinimumIdleWorkers(
+                                    const remus::proto::JobRequirements& reqs,
+                                    unsigned int count)
+{
+  if(count == 0)
+    {
+    this->MinimumIdleWorkers.erase(reqs);
+    }
+  else
+    {
+    this->MinimumIdleWorkers[reqs] = count;
+    }
+}
+
+//----------------------------------------------------------------------------
+unsigned int WorkerFactoryBase::minimumIdleWorkers(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  IdleWorkerCounts::const_iterator i = this->MinimumIdleWorkers.find(reqs);
+  return (i != this->MinimumIdleWorkers.end()) ? i->second : 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned int WorkerFactoryBase::workerCount(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  (void) reqs;
+  return this->currentWorkerCount();
+}
+
+//----------------------------------------------------------------------------
+unsigned int WorkerFactoryBase::spaceFor(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  const unsigned int current = this->currentWorkerCount();
+  const unsigned int max = this->maxWorkerCount();
+  const unsigned int currentOfType = this->workerCount(reqs);
+  const unsigned int maxOfType = this->Scaling.maxWorkerCount(reqs);
+  if(current >= max || currentOfType >= maxOfType)
+    {
+    return 0;
+    }
+  return std::min(max - current, maxOfType - currentOfType);
+}
+
+//----------------------------------------------------------------------------
+void WorkerFactoryBase::jobFinished(const remus::proto::JobRequirements& reqs,
+                                    boost::int64_t durationMillisec)
+{
+  //keep an exponential moving average, so that the average follows changes
+  //in how long jobs take without being thrown off by a single slow job
+  durationMillisec = std::max(boost::int64_t(0), durationMillisec);
+  std::map<remus::proto::JobRequirements, boost::int64_t>::iterator i =
+                                                  this->JobDurations.find(reqs);
+  if(i == this->JobDurations.end())
+    {
+    this->JobDurations[reqs] = durationMillisec;
+    }
+  else
+    {
+    i->second += (durationMillisec - i->second) / 8;
+    }
+}
+
+//----------------------------------------------------------------------------
+boost::int64_t WorkerFactoryBase::averageJobDuration(
+                              const remus::proto::JobRequirements& reqs) const
+{
+  std::map<remus::proto::JobRequirements, boost::int64_t>::const_iterator i =
+                                                  this->JobDurations.find(reqs);
+  return (i != this->JobDurations.end()) ? i->second : -1;
+}
+
+//----------------------------------------------------------------------------
+unsigned int WorkerFactoryBase::workersToLaunch(
+                                    const remus::proto::JobRequirements& reqs,
+                                    std::size_t queuedJobs) const
+{
+  const unsigned int needed =
+    this->Scaling.workersNeeded(queuedJobs, this->averageJobDuration(reqs));
+
+  //workers that are already running or still starting up are going to
+  //drain the queue as well, so only launch the ones missing
+  const unsigned int current = this->workerCount(reqs);
+  if(needed <= current)
+    {
+    return 0;
+    }
+  return std::min(needed - current, this->spaceFor(reqs));
+}
+
 }
 
 }
@@ -13,11 +13,13 @@
 #ifndef remus_server_WorkeryFactoryBase_h
 #define remus_server_WorkeryFactoryBase_h
 
+#include <map>
 #include <vector>
 
 #include <remus/common/CompilerInformation.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
@@ -40,6 +42,50 @@ namespace server{
 //forward declare the port connection class
 class PortConnection;
 
+//helper class that describes how a worker factory scales the number of
+//workers it launches with the demand for them.
+//Workers are launched in proportion to the number of queued jobs and how
+//long jobs of those requirements have taken, so that the queue can be
+//drained within the queue drain time. Until a job with the requirements
+//has finished we assume jobs are slow, and launch a worker per queued job.
+//Workers that have been waiting for a job for longer than the idle timeout
+//are retired, apart from the minimum idle workers of the factory.
+class REMUSSERVER_EXPORT ScalingPolicy
+{
+public:
+  //by default queues are drained within a second, workers are never
+  //retired, and requirements are only limited by the max worker count
+  //of the factory
+  ScalingPolicy();
+
+  //the time in milliseconds we want queued jobs to be finished in
+  void queueDrainTime(boost::int64_t millisec);
+  boost::int64_t queueDrainTime() const { return this->QueueDrainTime; }
+
+  //the time in milliseconds a worker can wait for a job before it is
+  //retired. Zero or less means workers are never retired.
+  void idleTimeout(boost::int64_t millisec) { this->IdleTimeout = millisec; }
+  boost::int64_t idleTimeout() const { return this->IdleTimeout; }
+
+  //limit the number of workers with the given requirements that can be
+  //running at once. Requirements without a limit return the max value
+  //of an unsigned int.
+  void maxWorkerCount(const remus::proto::JobRequirements& reqs,
+                      unsigned int count);
+  unsigned int maxWorkerCount(const remus::proto::JobRequirements& reqs) const;
+
+  //the number of workers needed to drain the queued jobs within the queue
+  //drain time, when each job takes averageJobDuration milliseconds. A
+  //negative averageJobDuration means the duration isn't known yet.
+  unsigned int workersNeeded(std::size_t queuedJobs,
+                             boost::int64_t averageJobDuration) const;
+
+private:
+  boost::int64_t QueueDrainTime;
+  boost::int64_t IdleTimeout;
+  std::map<remus::proto::JobRequirements, unsigned int> MaxWorkerCounts;
+};
+
 
 //The Worker Factory Base task.
 //A common interface for abstracting out how the server can ask for workers
@@ -48,7 +94,12 @@ class PortConnection;
 //When is a worker is launched you can control if you want that worker terminated
 //when the WorkerFactory instance gets deleted. If you created workers that stay after
 //the factory is deleted, you better make sure they are connected to the server,
-//or you will have zombie workers
+//or you will have zombie workers.
+//You can also ask for a number of idle workers of a given requirement to be
+//kept warm by calling setMinimumIdleWorkers. The server will launch those
+//workers ahead of demand, and launch replacements as they take jobs.
+//How many workers are launched for queued jobs, and when idle workers are
+//retired is controlled by the ScalingPolicy of the factory.
 class REMUSSERVER_EXPORT WorkerFactoryBase
 {
 public:
@@ -64,8 +115,9 @@ public:
   virtual ~WorkerFactoryBase();
 
   //specify the port/endpoint that workers need to use to connect to the
-  //running server
-  void portForWorkersToUse(const remus::server::PortConnection& port);
+  //running server. virtual so that factories that own other factories can
+  //pass it on
+  virtual void portForWorkersToUse(const remus::server::PortConnection& port);
 
   const std::string& workerEndpoint() const
     { return this->WorkerEndpoint; }
@@ -84,13 +136,69 @@ public:
 
   virtual void updateWorkerCount() = 0;
 
+  //A descriptor that becomes readable when a worker launched by the factory
+  //exits, so that the server can call updateWorkerCount right away instead
+  //of waiting for its next periodic check. Factories that can't provide
+  //one return -1.
+  virtual int workerExitDescriptor() const { return -1; }
+
   //Set the maximum number of total workers that can be returning at once
   virtual void setMaxWorkerCount(unsigned int count){MaxWorkers = count;}
   virtual unsigned int maxWorkerCount() const {return MaxWorkers;}
   virtual unsigned int currentWorkerCount() const =0;
 
+  //Set the number of workers with the given requirements that should be
+  //launched and waiting for a job at all times. The idle workers count
+  //towards the max worker count, so the server will never launch more than
+  //maxWorkerCount to keep them warm. Setting a count of zero removes the
+  //requirements from the warm pool.
+  void setMinimumIdleWorkers(const remus::proto::JobRequirements& reqs,
+                             unsigned int count);
+  unsigned int minimumIdleWorkers(const remus::proto::JobRequirements& reqs) const;
+
+  typedef std::map<remus::proto::JobRequirements, unsigned int> IdleWorkerCounts;
+  const IdleWorkerCounts& minimumIdleWorkers() const
+    { return this->MinimumIdleWorkers; }
+
+  //Set the policy that controls how workers are scaled with demand
+  void scalingPolicy(const ScalingPolicy& policy) { this->Scaling = policy; }
+  const ScalingPolicy& scalingPolicy() const { return this->Scaling; }
+
+  //The number of workers with the given requirements that are running.
+  //Factories that don't track the requirements of their workers return
+  //currentWorkerCount.
+  virtual unsigned int workerCount(const remus::proto::JobRequirements& reqs) const;
+
+  //The number of workers with the given requirements that can still be
+  //launched, limited by the max worker count of the factory and of the
+  //requirements. virtual so that factories can add their own limits, such
+  //as the resources of the host.
+  virtual unsigned int spaceFor(const remus::proto::JobRequirements& reqs) const;
+
+  //returns true if both the factory and the requirements have space for
+  //another worker
+  bool haveSpaceFor(const remus::proto::JobRequirements& reqs) const
+    { return this->spaceFor(reqs) > 0; }
+
+  //record how long in milliseconds a job with the given requirements took,
+  //and the running average of those durations. The average is negative
+  //when no job with the requirements has finished.
+  void jobFinished(const remus::proto::JobRequirements& reqs,
+                   boost::int64_t durationMillisec);
+  boost::int64_t averageJobDuration(const remus::proto::JobRequirements& reqs) const;
+
+  //The number of workers to launch for the given number of queued jobs,
+  //less the workers of the requirements that are running or starting up,
+  //limited by the spaceFor the requirements.
+  //virtual so that custom factories can change how they scale
+  virtual unsigned int workersToLaunch(const remus::proto::JobRequirements& reqs,
+                                       std::size_t queuedJobs) const;
+
 private:
   unsigned int MaxWorkers;
+  IdleWorkerCounts MinimumIdleWorkers;
+  ScalingPolicy Scaling;
+  std::map<remus::proto::JobRequirements, boost::int64_t> JobDurations;
   std::string WorkerEndpoint;
 };
 
@@ -0,0 +1,514 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/WorkerProxy.h>
+
+#include <remus/common/Timer.h>
+#include <remus/proto/DirectTransport.h>
+#include <remus/proto/JobResult.h>
+#include <remus/proto/JobStatus.h>
+#include <remus/proto/Message.h>
+#include <remus/proto/Response.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/server/PortNumbers.h>
+#include <remus/server/detail/ProxiedWorkers.h>
+#include <remus/worker/Job.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool have_message(zmq::socket_t& socket)
+  {
+    zmq::pollitem_t item = { socket, 0, ZMQ_POLLIN, 0 };
+    return zmq::poll(&item, 1, 0) > 0 && (item.revents & ZMQ_POLLIN);
+  }
+}
+
+namespace remus{
+namespace server{
+
+//----------------------------------------------------------------------------
+struct WorkerProxy::ProxyState
+{
+  ProxyState(const std::string& serverEndpoint,
+             const std::string& host, int port):
+    ServerEndpoint(serverEndpoint),
+    Context(1),
+    Downstream(Context, ZMQ_ROUTER),
+    Upstream(),
+    WorkerEndpoint(),
+    HeartbeatInterval(60000),
+    Workers(),
+    Clock(),
+    LastSent(0),
+    ServerTerminated(false),
+    NumberOfWorkers(0),
+    Running(false),
+    StopRequested(false)
+    {
+    zmq::socketInfo<zmq::proto::tcp> info(host, port);
+    this->WorkerEndpoint = zmq::bindToAddress(this->Downstream, info).endpoint();
+    }
+
+  //route a message of a worker to the server
+  void handleWorker();
+
+  //route a message of the server to the workers
+  void handleServer();
+
+  //grant the server the jobs the workers asked for since the last grant
+  void grantCredits();
+
+  //fail the jobs of workers that went silent
+  void removeSilentWorkers();
+
+  //send a heartbeat if we haven't sent the server anything for a while
+  void heartbeat();
+
+  //terminate all workers, and the proxy at the server unless the server
+  //terminated us
+  void terminate();
+
+  void readyForWork(const zmq::SocketIdentity& worker,
+                    const remus::proto::JobRequirements& reqs,
+                    unsigned int numberOfJobs);
+  void dispatch(const remus::worker::Job& job);
+  void sendJob(const zmq::SocketIdentity& worker,
+               const remus::worker::Job& job);
+  void fail(const std::vector<boost::uuids::uuid>& jobs);
+
+  void sendUpstream(const remus::common::MeshIOType& type,
+                    remus::SERVICE_TYPE service,
+                    const std::string& data);
+  void forwardUpstream(const remus::proto::Message& msg);
+
+  std::string ServerEndpoint;
+  zmq::context_t Context;
+  zmq::socket_t Downstream;
+  boost::scoped_ptr<zmq::socket_t> Upstream;
+  std::string WorkerEndpoint;
+  boost::int64_t HeartbeatInterval;
+
+  remus::server::detail::ProxiedWorkers Workers;
+  remus::common::Timer Clock;
+  boost::int64_t LastSent;
+  bool ServerTerminated;
+
+  std::atomic<std::size_t> NumberOfWorkers;
+  std::atomic<bool> Running;
+  std::atomic<bool> StopRequested;
+};
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::handleWorker()
+{
+  const zmq::SocketIdentity worker = zmq::address_recv(this->Downstream);
+  const remus::proto::Message msg = remus::proto::receive_Message(&this->Downstream);
+  if(!msg.isValid())
+    {
+    return;
+    }
+
+  const boost::int64_t now = this->Clock.elapsed();
+  this->Workers.heard(worker, now);
+  switch(msg.serviceType())
+    {
+    case remus::CAN_MESH_REQUIREMENTS:
+      {
+      //the server only needs to hear about the first worker with the
+      //requirements
+      const remus::proto::JobRequirements reqs =
+            remus::proto::to_JobRequirements(msg.data(),msg.dataSize());
+      if(this->Workers.registerWorker(worker, reqs, now))
+        {
+        this->forwardUpstream(msg);
+        }
+      }
+      break;
+    case remus::MAKE_MESH:
+      this->readyForWork(worker,
+            remus::proto::to_JobRequirements(msg.data(),msg.dataSize()), 1);
+      break;
+    case remus::JOB_CREDITS:
+      {
+      std::istringstream buffer(std::string(msg.data(),msg.dataSize()));
+      unsigned int credits = 0;
+      remus::proto::JobRequirements reqs;
+      buffer >> credits;
+      buffer >> reqs;
+      if(credits > 0)
+        {
+        this->readyForWork(worker, reqs, credits);
+        }
+      }
+      break;
+    case remus::MESH_STATUS:
+      {
+      const remus::proto::JobStatus status =
+            remus::proto::to_JobStatus(msg.data(),msg.dataSize());
+      this->forwardUpstream(msg);
+      if(status.failed())
+        {
+        this->Workers.finished(status.id());
+        }
+      }
+      break;
+    case remus::RETRIEVE_RESULT:
+      {
+      //the worker waits on the server to acknowledge the result, which
+      //we pass on when it arrives
+      const remus::proto::JobResult result =
+            remus::proto::to_JobResult(msg.data(),msg.dataSize());
+      this->forwardUpstream(msg);
+      this->Workers.awaitAck(worker);
+      this->Workers.finished(result.id());
+      }
+      break;
+    case remus::RETRIEVE_RESULT_BATCH:
+      {
+      const std::vector< remus::proto::JobResult > results =
+            remus::proto::to_JobResultBatch(msg.data(),msg.dataSize());
+      this->forwardUpstream(msg);
+      this->Workers.awaitAck(worker);
+      for(std::size_t i=0; i < results.size(); ++i)
+        {
+        this->Workers.finished(results[i].id());
+        }
+      }
+      break;
+    case remus::HEARTBEAT:
+      //our own heartbeat covers the workers, so it stops here
+      this->Workers.heartbeat(worker,
+            remus::proto::to_HeartbeatInterval(msg.data(),msg.dataSize()),
+            now);
+      break;
+    case remus::TERMINATE_WORKER:
+      this->fail(this->Workers.removeWorker(worker));
+      break;
+    default:
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::handleServer()
+{
+  const remus::proto::Response response =
+                            remus::proto::receive_Response(this->Upstream.get());
+  if(!response.isValid())
+    {
+    return;
+    }
+
+  //parsing the jobs claims them when the server sent direct handles, which
+  //our workers can't use
+  const bool direct = remus::proto::is_DirectEndpoint(this->ServerEndpoint);
+  const std::string data(response.data(), response.dataSize());
+  switch(response.serviceType())
+    {
+    case remus::MAKE_MESH:
+      this->dispatch(remus::proto::to_WorkerJob(data, direct));
+      break;
+    case remus::JOB_BATCH:
+      {
+      const std::vector<remus::worker::Job> jobs =
+                              remus::proto::to_WorkerJobBatch(data, direct);
+      for(std::size_t i=0; i < jobs.size(); ++i)
+        {
+        this->dispatch(jobs[i]);
+        }
+      }
+      break;
+    case remus::TERMINATE_JOB:
+      {
+      const boost::uuids::uuid id = remus::worker::to_Job(data).id();
+      const zmq::SocketIdentity owner = this->Workers.owner(id);
+      if(owner.size() > 0)
+        {
+        remus::proto::forward_Response(response, &this->Downstream, owner);
+        }
+      else
+        { //the server already failed the job, so drop it if we hold it
+        this->Workers.removeHeld(id);
+        }
+      }
+      break;
+    case remus::RETRIEVE_RESULT:
+      {
+      const zmq::SocketIdentity worker = this->Workers.takeAck();
+      if(worker.size() > 0)
+        {
+        remus::proto::forward_Response(response, &this->Downstream, worker);
+        }
+      }
+      break;
+    case remus::TERMINATE_WORKER:
+      this->ServerTerminated = true;
+      break;
+    default:
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::readyForWork(const zmq::SocketIdentity& worker,
+                                const remus::proto::JobRequirements& reqs,
+                                unsigned int numberOfJobs)
+{
+  const boost::int64_t now = this->Clock.elapsed();
+  if(this->Workers.registerWorker(worker, reqs, now))
+    {
+    this->sendUpstream(reqs.meshTypes(), remus::CAN_MESH_REQUIREMENTS,
+                       remus::proto::to_string(reqs));
+    }
+
+  const std::vector<remus::worker::Job> jobs =
+              this->Workers.readyForWork(worker, reqs, numberOfJobs, now);
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    this->sendJob(worker, jobs[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::dispatch(const remus::worker::Job& job)
+{
+  if(!this->Workers.supports(job.submission().requirements()))
+    { //the workers that asked for the job have all left
+    this->fail(std::vector<boost::uuids::uuid>(1, job.id()));
+    return;
+    }
+
+  const zmq::SocketIdentity worker = this->Workers.assign(job);
+  if(worker.size() > 0)
+    {
+    this->sendJob(worker, job);
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::sendJob(const zmq::SocketIdentity& worker,
+                                      const remus::worker::Job& job)
+{
+  remus::proto::send_NonBlockingResponse(remus::MAKE_MESH,
+                                         remus::worker::to_string(job),
+                                         &this->Downstream,
+                                         worker);
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::fail(const std::vector<boost::uuids::uuid>& jobs)
+{
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    const remus::proto::JobStatus status(jobs[i], remus::FAILED);
+    this->sendUpstream(remus::common::MeshIOType(), remus::MESH_STATUS,
+                       remus::proto::to_string(status));
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::grantCredits()
+{
+  typedef std::map<remus::proto::JobRequirements, unsigned int> CreditMap;
+  const CreditMap credits = this->Workers.takeCredits();
+  for(CreditMap::const_iterator i = credits.begin(); i != credits.end(); ++i)
+    {
+    //we advertise zero slots, as we share our connection between however
+    //many workers connect to us, so the server never retires us as a whole
+    std::ostringstream buffer;
+    buffer << i->second << std::endl;
+    buffer << i->first << std::endl;
+    buffer << 0;
+    this->sendUpstream(i->first.meshTypes(), remus::JOB_CREDITS, buffer.str());
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::removeSilentWorkers()
+{
+  const std::vector<zmq::SocketIdentity> silent =
+                        this->Workers.silentWorkers(this->Clock.elapsed());
+  for(std::size_t i=0; i < silent.size(); ++i)
+    {
+    this->fail(this->Workers.removeWorker(silent[i]));
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::heartbeat()
+{
+  if(this->Clock.elapsed() - this->LastSent >= this->HeartbeatInterval / 2)
+    {
+    this->sendUpstream(remus::common::MeshIOType(), remus::HEARTBEAT,
+                remus::proto::to_HeartbeatPayload(this->HeartbeatInterval));
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::terminate()
+{
+  const std::vector<zmq::SocketIdentity> workers = this->Workers.workers();
+  for(std::size_t i=0; i < workers.size(); ++i)
+    {
+    remus::proto::send_NonBlockingResponse(remus::TERMINATE_WORKER,
+                                           remus::INVALID_MSG,
+                                           &this->Downstream,
+                                           workers[i]);
+    this->Workers.removeWorker(workers[i]);
+    }
+
+  if(!this->ServerTerminated)
+    { //the server fails the jobs of our workers once it knows we are gone
+    this->sendUpstream(remus::common::MeshIOType(), remus::TERMINATE_WORKER,
+                       std::string());
+    }
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::sendUpstream(const remus::common::MeshIOType& type,
+                                           remus::SERVICE_TYPE service,
+                                           const std::string& data)
+{
+  remus::proto::send_NonBlockingMessage(type, service, data,
+                                        this->Upstream.get());
+  this->LastSent = this->Clock.elapsed();
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::ProxyState::forwardUpstream(const remus::proto::Message& msg)
+{
+  remus::proto::forward_Message(msg, this->Upstream.get());
+  this->LastSent = this->Clock.elapsed();
+}
+
+//----------------------------------------------------------------------------
+WorkerProxy::WorkerProxy(const std::string& serverEndpoint):
+  State(boost::make_shared<ProxyState>(serverEndpoint, "*",
+                                       remus::server::WORKER_PORT))
+{
+}
+
+//----------------------------------------------------------------------------
+WorkerProxy::WorkerProxy(const std::string& serverEndpoint,
+                         const std::string& host, int port):
+  State(boost::make_shared<ProxyState>(serverEndpoint, host, port))
+{
+}
+
+//----------------------------------------------------------------------------
+WorkerProxy::~WorkerProxy()
+{
+}
+
+//----------------------------------------------------------------------------
+const std::string& WorkerProxy::serverEndpoint() const
+{
+  return this->State->ServerEndpoint;
+}
+
+//----------------------------------------------------------------------------
+const std::string& WorkerProxy::workerEndpoint() const
+{
+  return this->State->WorkerEndpoint;
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::heartbeatInterval(boost::int64_t millisec)
+{
+  this->State->HeartbeatInterval = millisec;
+}
+
+//----------------------------------------------------------------------------
+boost::int64_t WorkerProxy::heartbeatInterval() const
+{
+  return this->State->HeartbeatInterval;
+}
+
+//----------------------------------------------------------------------------
+std::size_t WorkerProxy::numberOfWorkers() const
+{
+  return this->State->NumberOfWorkers;
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::run()
+{
+  //the time we wait for messages before checking if we should stop
+  const long pollTimeout = 100;
+
+  ProxyState& state = *this->State;
+  state.Running = true;
+  state.ServerTerminated = false;
+
+  state.Upstream.reset(new zmq::socket_t(state.Context, ZMQ_DEALER));
+  zmq::set_socket_linger(*state.Upstream);
+  zmq::connectToAddress(*state.Upstream, state.ServerEndpoint);
+  state.LastSent = state.Clock.elapsed();
+
+  while(!state.StopRequested && !state.ServerTerminated)
+    {
+    zmq::pollitem_t items[2] = {
+      { state.Downstream, 0, ZMQ_POLLIN, 0 },
+      { *state.Upstream, 0, ZMQ_POLLIN, 0 } };
+    zmq::poll(&items[0], 2, pollTimeout);
+
+    //handle the server first, so that we don't route worker messages to
+    //a server that told us to terminate
+    while(!state.ServerTerminated && have_message(*state.Upstream))
+      {
+      state.handleServer();
+      }
+    while(!state.ServerTerminated && have_message(state.Downstream))
+      {
+      state.handleWorker();
+      }
+
+    //the credits of all workers are granted together, so a burst of
+    //workers asking for jobs is a single message per requirements
+    state.grantCredits();
+    state.removeSilentWorkers();
+    state.heartbeat();
+    state.NumberOfWorkers = state.Workers.numberOfWorkers();
+    }
+
+  state.terminate();
+  state.NumberOfWorkers = 0;
+  state.Upstream.reset();
+
+  state.StopRequested = false;
+  state.Running = false;
+}
+
+//----------------------------------------------------------------------------
+void WorkerProxy::stop()
+{
+  this->State->StopRequested = true;
+}
+
+//----------------------------------------------------------------------------
+bool WorkerProxy::isRunning() const
+{
+  return this->State->Running;
+}
+
+}
+}
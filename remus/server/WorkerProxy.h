@@ -0,0 +1,103 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_WorkerProxy_h
+#define remus_server_WorkerProxy_h
+
+#include <string>
+
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+//included for export symbols
+#include <remus/server/ServerExports.h>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace server{
+
+//An edge broker run by the remus-proxy executable next to a group of
+//workers, such as on the head node of a remote cluster. Workers connect to
+//the proxy like they connect to a server, and the proxy talks to the worker
+//endpoint of the server over a single connection, where it looks like one
+//worker with a slot for every job its workers asked for.
+//
+//The proxy registers the requirements of its workers with the server once,
+//grants the server the jobs its workers ask for as credits, and sends the
+//server a single heartbeat for all of them. Jobs are handed to a worker
+//that asked for them, or held until one does. The jobs of workers that go
+//silent or leave are reported as failed to the server.
+//
+//When the server terminates the proxy, or the proxy is stopped, its
+//workers are terminated as well.
+class REMUSSERVER_EXPORT WorkerProxy
+{
+public:
+  //proxy the worker endpoint of a server, for workers connecting on all
+  //interfaces on the first free port starting at remus::server::WORKER_PORT
+  explicit WorkerProxy(const std::string& serverEndpoint);
+
+  //proxy the worker endpoint of a server, for workers connecting on the
+  //given host on the first free port starting at the given port
+  WorkerProxy(const std::string& serverEndpoint,
+              const std::string& host, int port);
+
+  ~WorkerProxy();
+
+  //the worker endpoint of the server
+  const std::string& serverEndpoint() const;
+
+  //the endpoint the proxy is bound to, which workers connect to
+  const std::string& workerEndpoint() const;
+
+  //the time in milliseconds we promise the server between our messages,
+  //a heartbeat is sent when we have been idle for half of it. Only set it
+  //while the proxy isn't running. Defaults to 60000, like workers.
+  void heartbeatInterval(boost::int64_t millisec);
+  boost::int64_t heartbeatInterval() const;
+
+  //the number of workers connected to the proxy
+  std::size_t numberOfWorkers() const;
+
+  //connect to the server and route messages between it and the workers
+  //until stop is called, or the server terminates the proxy
+  void run();
+
+  //stop a running proxy, can be called from any thread
+  void stop();
+
+  bool isRunning() const;
+
+private:
+  WorkerProxy(const WorkerProxy&);
+  void operator=(const WorkerProxy&);
+
+  struct ProxyState;
+  boost::shared_ptr<ProxyState> State;
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/common/SignalCatcher.h>
+#include <remus/server/Agent.h>
+#include <remus/server/HostCapacity.h>
+#include <remus/server/WorkerFactory.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//stops the agent on SIGINT and SIGTERM, so that it kills its workers
+class AgentSignals : public remus::common::SignalCatcher
+{
+public:
+  AgentSignals(remus::server::Agent& agent): Agent(agent)
+    { this->StartCatchingSignals(); }
+  ~AgentSignals()
+    { this->StopCatchingSignals(); }
+
+protected:
+  virtual void SignalCaught(SignalCatcher::SignalType)
+    { this->Agent.stop(); }
+
+private:
+  remus::server::Agent& Agent;
+};
+
+void usage()
+{
+  std::cerr << "usage: remus-agent [--name <name>] [--max-workers <count>]\n"
+               "                   [--worker-endpoint <endpoint>]\n"
+               "                   [--extension <.rw>] [--heartbeat <ms>]\n"
+               "                   <factory endpoint> [worker directories...]\n"
+               "\n"
+               "Connects to the agent endpoint of a RemoteWorkerFactory, such as\n"
+               "tcp://server:50560, and launches the workers found in the worker\n"
+               "directories when the server asks for them. The name defaults to\n"
+               "the host name, and the max workers to the cores of the host."
+            << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  std::string name = boost::asio::ip::host_name();
+  std::string extension = ".rw";
+  std::string workerEndpoint;
+  int maxWorkers = -1;
+  boost::int64_t heartbeat = -1;
+  std::vector<std::string> positional;
+
+  try
+    {
+    for(int i=1; i < argc; ++i)
+      {
+      const std::string arg(argv[i]);
+      const bool hasValue = (i + 1 < argc);
+      if(arg == "--name" && hasValue)
+        { name = argv[++i]; }
+      else if(arg == "--max-workers" && hasValue)
+        { maxWorkers = boost::lexical_cast<int>(argv[++i]); }
+      else if(arg == "--worker-endpoint" && hasValue)
+        { workerEndpoint = argv[++i]; }
+      else if(arg == "--extension" && hasValue)
+        { extension = argv[++i]; }
+      else if(arg == "--heartbeat" && hasValue)
+        { heartbeat = boost::lexical_cast<boost::int64_t>(argv[++i]); }
+      else if(arg.compare(0, 2, "--") == 0)
+        { usage(); return 1; }
+      else
+        { positional.push_back(arg); }
+      }
+    }
+  catch(boost::bad_lexical_cast&)
+    {
+    usage();
+    return 1;
+    }
+
+  if(positional.empty())
+    {
+    usage();
+    return 1;
+    }
+
+  boost::shared_ptr<remus::server::WorkerFactory> factory =
+              boost::make_shared<remus::server::WorkerFactory>(extension);
+  for(std::size_t i=1; i < positional.size(); ++i)
+    {
+    factory->addWorkerSearchDirectory(positional[i]);
+    }
+  if(maxWorkers < 0)
+    {
+    maxWorkers = static_cast<int>(factory->hostCapacity().cores());
+    }
+  factory->setMaxWorkerCount(static_cast<unsigned int>(maxWorkers));
+
+  remus::server::Agent agent(name, positional[0], factory);
+  agent.workerEndpoint(workerEndpoint);
+  if(heartbeat > 0)
+    {
+    agent.heartbeatInterval(heartbeat);
+    }
+
+  AgentSignals signals(agent);
+  std::cout << "Agent " << name << " reporting to " << positional[0]
+            << std::endl;
+  agent.run();
+  return 0;
+}
@@ -12,6 +12,7 @@
 
 #include <remus/server/detail/ActiveJobs.h>
 
+#include <remus/server/detail/TimingWheel.h>
 #include <remus/server/detail/uuidHelper.h>
 
 namespace remus{
@@ -21,11 +22,15 @@ namespace detail{
 //-----------------------------------------------------------------------------
 ActiveJobs::JobState::JobState(const zmq::SocketIdentity& workerIdentity,
          const boost::uuids::uuid& id,
-         remus::STATUS_TYPE stat):
+         remus::STATUS_TYPE stat,
+         const remus::proto::JobRequirements& reqs):
   WorkerAddress(workerIdentity),
   jstatus(id,stat),
   jresult(id),
-  haveResult(false)
+  haveResult(false),
+  LastProgressUpdate(-1),
+  Requirements(reqs),
+  Started(TimingWheel::now())
 {
 
 }
@@ -44,13 +49,15 @@ bool ActiveJobs::JobState::canUpdateStatusTo(remus::proto::JobStatus s) const
 
 //-----------------------------------------------------------------------------
 bool ActiveJobs::add(const zmq::SocketIdentity &workerIdentity,
-                     const boost::uuids::uuid& id)
+                     const boost::uuids::uuid& id,
+                     const remus::proto::JobRequirements& reqs)
 {
   if(!this->haveUUID(id))
     {
-    JobState ws(workerIdentity,id,remus::QUEUED);
+    JobState ws(workerIdentity,id,remus::QUEUED,reqs);
     InfoPair pair(id,ws);
     this->Info.insert(pair);
+    this->WorkerJobs[workerIdentity].insert(id);
     return true;
     }
   return false;
@@ -59,9 +66,17 @@ bool ActiveJobs::add(const zmq::SocketIdentity &workerIdentity,
 //-----------------------------------------------------------------------------
 bool ActiveJobs::remove(const boost::uuids::uuid& id)
 {
-  if(this->haveUUID(id))
+  InfoIt item = this->Info.find(id);
+  if(item != this->Info.end())
     {
-    this->Info.erase(id);
+    WorkerJobMap::iterator jobs = this->WorkerJobs.find(item->second.WorkerAddress);
+    if(jobs != this->WorkerJobs.end())
+      {
+      jobs->second.erase(id);
+      if(jobs->second.empty())
+        { this->WorkerJobs.erase(jobs); }
+      }
+    this->Info.erase(item);
     return true;
     }
   return false;
@@ -120,17 +135,38 @@ const remus::proto::JobResult& ActiveJobs::result(
 }
 
 //-----------------------------------------------------------------------------
-void ActiveJobs::updateStatus(const remus::proto::JobStatus& s)
+bool ActiveJobs::updateStatus(const remus::proto::JobStatus& s)
 {
   InfoIt item = this->Info.find(s.id());
 
-  if(item != this->Info.end() && item->second.canUpdateStatusTo(s) )
+  if(item == this->Info.end() || !item->second.canUpdateStatusTo(s) )
     {
     //we don't want the worker to ever explicitly state it has finished the
     //job. That is why we use canUpdateStatusTo, which checks the status
     //we are moving to
-    item->second.jstatus.mergeStatus(s);
+    return false;
     }
+
+  if(s.inProgress())
+    {
+    //drop progress updates of a job that is already in progress when they
+    //arrive faster than we want to handle them, so that a worker flooding
+    //us with progress doesn't stall the server. The worker keeps sending
+    //newer progress, so nothing of value is lost
+    const boost::int64_t now = TimingWheel::now();
+    JobState& state = item->second;
+    if(this->MinimumProgressInterval > 0 &&
+       state.jstatus.inProgress() &&
+       state.LastProgressUpdate >= 0 &&
+       (now - state.LastProgressUpdate) < this->MinimumProgressInterval)
+      {
+      return false;
+      }
+    state.LastProgressUpdate = now;
+    }
+
+  item->second.jstatus.mergeStatus(s);
+  return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -176,17 +212,85 @@ ActiveJobs::markExpiredJobs(remus::server::detail::SocketMonitor monitor)
   return expiredJobs;
 }
 
+//-----------------------------------------------------------------------------
+std::vector< remus::proto::JobStatus >
+ActiveJobs::markExpiredJobs(const std::vector<zmq::SocketIdentity>& workers)
+{
+  std::vector< remus::proto::JobStatus > expiredJobs;
+  typedef std::vector<zmq::SocketIdentity>::const_iterator WorkerIt;
+  for(WorkerIt w = workers.begin(); w != workers.end(); ++w)
+    {
+    WorkerJobMap::const_iterator jobs = this->WorkerJobs.find(*w);
+    if(jobs == this->WorkerJobs.end())
+      {
+      continue;
+      }
+
+    typedef std::set<boost::uuids::uuid>::const_iterator JobIt;
+    for(JobIt id = jobs->second.begin(); id != jobs->second.end(); ++id)
+      {
+      JobState& state = this->Info.find(*id)->second;
+      //we can only mark jobs that are IN_PROGRESS or QUEUED as failed.
+      //FINISHED is more important than failed
+      if(state.jstatus.queued() || state.jstatus.inProgress())
+        {
+        state.jstatus = remus::proto::JobStatus(*id,remus::EXPIRED);
+        expiredJobs.push_back( state.jstatus );
+        }
+      }
+    }
+  return expiredJobs;
+}
+
 //-----------------------------------------------------------------------------
 std::set<zmq::SocketIdentity> ActiveJobs::activeWorkers() const
 {
   std::set<zmq::SocketIdentity> workerAddresses;
-  for(InfoConstIt item = this->Info.begin(); item != this->Info.end(); ++item)
+  for(WorkerJobMap::const_iterator item = this->WorkerJobs.begin();
+      item != this->WorkerJobs.end(); ++item)
+    {
+    workerAddresses.insert(item->first);
+    }
+  return workerAddresses;
+}
+
+//-----------------------------------------------------------------------------
+std::set<zmq::SocketIdentity> ActiveJobs::busyWorkers() const
+{
+  std::set<zmq::SocketIdentity> workerAddresses;
+  for(WorkerJobMap::const_iterator item = this->WorkerJobs.begin();
+      item != this->WorkerJobs.end(); ++item)
     {
-    workerAddresses.insert(item->second.WorkerAddress);
+    typedef std::set<boost::uuids::uuid>::const_iterator IdIt;
+    for(IdIt id = item->second.begin(); id != item->second.end(); ++id)
+      {
+      InfoConstIt job = this->Info.find(*id);
+      if(job != this->Info.end() && !job->second.haveResult &&
+         job->second.jstatus.good())
+        {
+        workerAddresses.insert(item->first);
+        break;
+        }
+      }
     }
   return workerAddresses;
 }
 
+//-----------------------------------------------------------------------------
+bool ActiveJobs::runningTime(const boost::uuids::uuid& id,
+                             remus::proto::JobRequirements& reqs,
+                             boost::int64_t& millisec) const
+{
+  InfoConstIt item = this->Info.find(id);
+  if(item == this->Info.end())
+    {
+    return false;
+    }
+  reqs = item->second.Requirements;
+  millisec = TimingWheel::now() - item->second.Started;
+  return true;
+}
+
 
 }
 }
@@ -13,12 +13,17 @@
 #ifndef remus_server_detail_ActiveJobs_h
 #define remus_server_detail_ActiveJobs_h
 
+#include <remus/proto/JobRequirements.h>
 #include <remus/proto/JobResult.h>
 #include <remus/proto/JobStatus.h>
 #include <remus/proto/zmqSocketIdentity.h>
 
 #include <remus/server/detail/SocketMonitor.h>
 
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
 #include <map>
 #include <set>
 #include <vector>
@@ -30,10 +35,12 @@ namespace detail{
 class ActiveJobs
 {
   public:
-    ActiveJobs():Info(){}
+    ActiveJobs():Info(),WorkerJobs(),MinimumProgressInterval(0){}
 
     bool add(const zmq::SocketIdentity& workerIdentity,
-             const boost::uuids::uuid& id);
+             const boost::uuids::uuid& id,
+             const remus::proto::JobRequirements& reqs =
+                                            remus::proto::JobRequirements());
 
     bool remove(const boost::uuids::uuid& id);
 
@@ -60,15 +67,45 @@ class ActiveJobs
     // EXPIRED
     // To update a job to the finished state, you have to call updateResult
     // not update status
-    void updateStatus(const remus::proto::JobStatus& s);
+    //
+    // Returns true when the status was applied. Progress updates of a job
+    // that arrive within the minimum progress interval of the last
+    // accepted progress update are dropped, and false is returned.
+    bool updateStatus(const remus::proto::JobStatus& s);
+
+    //the minimum time in milliseconds between progress updates we accept
+    //for a single job. Changes of state are always accepted. The default
+    //is zero, which accepts every update.
+    void minimumProgressInterval(boost::int64_t millisec)
+      { this->MinimumProgressInterval = millisec; }
+    boost::int64_t minimumProgressInterval() const
+      { return this->MinimumProgressInterval; }
 
     void updateResult(const remus::proto::JobResult& r);
 
+    //mark every job whose worker is unresponsive as expired, returning the
+    //jobs that have expired. This checks every job.
     std::vector< remus::proto::JobStatus > markExpiredJobs(
                                  remus::server::detail::SocketMonitor monitor);
 
+    //mark every job of the given workers as expired, returning the jobs
+    //that have expired. Only the jobs of those workers are checked.
+    std::vector< remus::proto::JobStatus > markExpiredJobs(
+                      const std::vector<zmq::SocketIdentity>& workers);
+
     std::set<zmq::SocketIdentity> activeWorkers() const;
 
+    //return the workers that have a job that is queued or in progress.
+    //Unlike activeWorkers this excludes workers whose jobs have finished
+    //or failed, but haven't been removed yet
+    std::set<zmq::SocketIdentity> busyWorkers() const;
+
+    //get the requirements of a job, and the time in milliseconds since it
+    //was added. Returns false if we don't have the job
+    bool runningTime(const boost::uuids::uuid& id,
+                     remus::proto::JobRequirements& reqs,
+                     boost::int64_t& millisec) const;
+
 private:
     struct JobState
     {
@@ -76,10 +113,17 @@ private:
       remus::proto::JobStatus jstatus;
       remus::proto::JobResult jresult;
       bool haveResult;
+      //milliseconds on the monotonic clock of TimingWheel::now, or -1
+      //when no progress has been accepted yet
+      boost::int64_t LastProgressUpdate;
+      remus::proto::JobRequirements Requirements;
+      //milliseconds on the monotonic clock of TimingWheel::now
+      boost::int64_t Started;
 
       JobState(const zmq::SocketIdentity& workerIdentity,
                const boost::uuids::uuid& id,
-               remus::STATUS_TYPE stat);
+               remus::STATUS_TYPE stat,
+               const remus::proto::JobRequirements& reqs);
 
       bool canUpdateStatusTo(remus::proto::JobStatus s) const;
     };
@@ -88,6 +132,11 @@ private:
     typedef std::map< boost::uuids::uuid, JobState>::const_iterator InfoConstIt;
     typedef std::map< boost::uuids::uuid, JobState>::iterator InfoIt;
     std::map<boost::uuids::uuid, JobState> Info;
+
+    //the jobs of each worker, so expiring a worker doesn't visit every job
+    typedef std::map< zmq::SocketIdentity, std::set<boost::uuids::uuid> > WorkerJobMap;
+    WorkerJobMap WorkerJobs;
+    boost::int64_t MinimumProgressInterval;
 };
 
 }
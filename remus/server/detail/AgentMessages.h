@@ -0,0 +1,95 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_AgentMessages_h
+#define remus_server_detail_AgentMessages_h
+
+#include <remus/proto/zmq.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//The messages sent between a RemoteWorkerFactory and its agents. Every
+//message is a multipart zmq message whose first frame is its type, the
+//ROUTER socket of the factory adds the identity of the agent in front.
+namespace agent_message
+{
+//agent -> factory: the name of the agent, followed by two frames for
+//each type of worker it can launch, "<space> <running> <launched>" and the
+//requirements of the worker. launched is the number of launch messages for
+//the requirements the agent has handled, so that the factory knows which
+//of its launches are still on the way. Sent on every heartbeat of the
+//agent, and whenever its state changes
+static const char State[] = "state";
+
+//factory -> agent: launch a worker with the requirements in the next
+//frame, which connects to the endpoint in the frame after that
+static const char Launch[] = "launch";
+
+//factory -> agent: kill all the workers launched for the factory
+static const char Kill[] = "kill";
+}
+
+//------------------------------------------------------------------------------
+//send the frames as one multipart message, without blocking. Returns false
+//if the message couldn't be queued, because the peer isn't there
+inline bool send_frames(zmq::socket_t& socket,
+                        const std::vector<std::string>& frames)
+{
+  for(std::size_t i=0; i < frames.size(); ++i)
+    {
+    zmq::message_t frame(frames[i].size());
+    if(!frames[i].empty())
+      {
+      memcpy(frame.data(), frames[i].data(), frames[i].size());
+      }
+    const int more = (i + 1 < frames.size()) ? ZMQ_SNDMORE : 0;
+    if(!socket.send(frame, ZMQ_DONTWAIT | more) && i == 0)
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+//receive a whole multipart message without blocking. Returns false when
+//no message is waiting
+inline bool recv_frames(zmq::socket_t& socket, std::vector<std::string>& frames)
+{
+  frames.clear();
+  int more = 1;
+  while(more)
+    {
+    zmq::message_t frame;
+    if(!socket.recv(&frame, frames.empty() ? ZMQ_DONTWAIT : 0))
+      {
+      return false;
+      }
+    frames.push_back(std::string(static_cast<const char*>(frame.data()),
+                                 frame.size()));
+    std::size_t size = sizeof(more);
+    socket.getsockopt(ZMQ_RCVMORE, &more, &size);
+    }
+  return true;
+}
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,191 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/ChildWatcher.h>
+
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/epoll.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+//older C libraries don't know about pidfd_open, the number is the same
+//on every architecture
+# ifndef SYS_pidfd_open
+#  define SYS_pidfd_open 434
+# endif
+#endif
+
+namespace
+{
+#ifdef __linux__
+//----------------------------------------------------------------------------
+int pidfd_open(int pid)
+{
+  return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+}
+#endif
+}
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//----------------------------------------------------------------------------
+ChildWatcher::ChildWatcher():
+  Descriptor(-1),
+  Watched()
+{
+#ifdef __linux__
+  this->Descriptor = ::epoll_create1(EPOLL_CLOEXEC);
+  if(this->Descriptor >= 0)
+    {
+    //verify the kernel supports pidfds by opening one for ourselves,
+    //otherwise the descriptor would never become readable
+    const int self = pidfd_open(static_cast<int>(::getpid()));
+    if(self < 0)
+      {
+      ::close(this->Descriptor);
+      this->Descriptor = -1;
+      }
+    else
+      {
+      ::close(self);
+      }
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+ChildWatcher::~ChildWatcher()
+{
+#ifdef __linux__
+  for(std::map<int,int>::const_iterator i = this->Watched.begin();
+      i != this->Watched.end(); ++i)
+    {
+    ::close(i->second);
+    }
+  if(this->Descriptor >= 0)
+    {
+    ::close(this->Descriptor);
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool ChildWatcher::watch(int pid)
+{
+#ifdef __linux__
+  if(!this->supported() || pid <= 0)
+    {
+    return false;
+    }
+  this->unwatch(pid);
+  return this->add(pid, pidfd_open(pid));
+#else
+  (void) pid;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool ChildWatcher::watch(int pid, int pidfd)
+{
+#ifdef __linux__
+  if(!this->supported() || pid <= 0 || pidfd < 0)
+    {
+    return false;
+    }
+  this->unwatch(pid);
+  return this->add(pid, ::fcntl(pidfd, F_DUPFD_CLOEXEC, 0));
+#else
+  (void) pid;
+  (void) pidfd;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+//add a pidfd to the epoll set, taking ownership of the descriptor
+bool ChildWatcher::add(int pid, int fd)
+{
+#ifdef __linux__
+  if(fd < 0)
+    {
+    return false;
+    }
+
+  //a pidfd is readable once the process has exited, which is level
+  //triggered so an exited process keeps the descriptor readable until
+  //it is collected by exited
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = pid;
+  if(::epoll_ctl(this->Descriptor, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+    ::close(fd);
+    return false;
+    }
+  this->Watched[pid] = fd;
+  return true;
+#else
+  (void) pid;
+  (void) fd;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void ChildWatcher::unwatch(int pid)
+{
+  std::map<int,int>::iterator i = this->Watched.find(pid);
+  if(i == this->Watched.end())
+    {
+    return;
+    }
+#ifdef __linux__
+  //closing the pidfd only removes it from the epoll set when no duplicate
+  //of it is open, so remove it explicitly
+  ::epoll_ctl(this->Descriptor, EPOLL_CTL_DEL, i->second, NULL);
+  ::close(i->second);
+#endif
+  this->Watched.erase(i);
+}
+
+//----------------------------------------------------------------------------
+std::vector<int> ChildWatcher::exited()
+{
+  std::vector<int> pids;
+#ifdef __linux__
+  if(!this->supported() || this->Watched.empty())
+    {
+    return pids;
+    }
+
+  const int maxEvents = 64;
+  struct epoll_event events[maxEvents];
+  int count = 0;
+  do
+    {
+    count = ::epoll_wait(this->Descriptor, events, maxEvents, 0);
+    for(int i=0; i < count; ++i)
+      {
+      pids.push_back(events[i].data.fd);
+      this->unwatch(events[i].data.fd);
+      }
+    } while(count == maxEvents);
+#endif
+  return pids;
+}
+
+}
+}
+}
@@ -0,0 +1,87 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_ChildWatcher_h
+#define remus_server_detail_ChildWatcher_h
+
+#include <map>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//Watches child processes for exit without polling each of them.
+//
+//On Linux every watched process gets a pidfd, and all of them are gathered
+//into a single epoll descriptor. That descriptor becomes readable as soon
+//as any watched process exits, so it can be added to a poll set to wake up
+//on a child exiting, and finding which children exited only touches the
+//ones that did.
+//
+//Where pidfds aren't available the watcher isn't supported, watch returns
+//false and callers have to fall back to checking each process.
+//
+//Watching a process never reaps it, the owner of the process still needs
+//to wait on it once it has exited.
+class ChildWatcher
+{
+public:
+  ChildWatcher();
+  ~ChildWatcher();
+
+  //returns true if processes can be watched on this system
+  bool supported() const { return this->Descriptor >= 0; }
+
+  //the descriptor that is readable while a watched process has exited,
+  //or -1 when not supported
+  int descriptor() const { return this->Descriptor; }
+
+  //start watching the process with the given pid. Returns false if the
+  //process can't be watched, because pidfds aren't supported or the pid
+  //isn't a child of ours
+  bool watch(int pid);
+
+  //start watching a process through an existing pidfd, for processes that
+  //aren't our children and so can't be safely opened by pid. The watcher
+  //uses its own duplicate of the pidfd
+  bool watch(int pid, int pidfd);
+
+  //stop watching the process with the given pid
+  void unwatch(int pid);
+
+  //returns true if the process with the given pid is being watched
+  bool watching(int pid) const { return this->Watched.count(pid) > 0; }
+
+  //the number of processes being watched
+  std::size_t size() const { return this->Watched.size(); }
+
+  //returns the pids of the watched processes that have exited, and stops
+  //watching them. Doesn't block.
+  std::vector<int> exited();
+
+private:
+  ChildWatcher(const ChildWatcher&);
+  void operator=(const ChildWatcher&);
+
+  bool add(int pid, int pidfd);
+
+  int Descriptor;
+  //maps pid to pidfd
+  std::map<int,int> Watched;
+};
+
+}
+}
+}
+
+#endif
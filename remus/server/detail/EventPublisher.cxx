@@ -53,7 +53,9 @@ namespace detail{
 //----------------------------------------------------------------------------
 EventPublisher::EventPublisher():
   socket(NULL),
-  buffer()
+  buffer(),
+  HeartbeatSampling(1),
+  HeartbeatCounts()
   {
 
   }
@@ -328,6 +330,21 @@ void EventPublisher::workerRegistered(const zmq::SocketIdentity &workerIdentity,
 //----------------------------------------------------------------------------
 void EventPublisher::workerHeartbeat(const zmq::SocketIdentity &workerIdentity)
 {
+  if(this->HeartbeatSampling == 0)
+    {
+    return;
+    }
+  else if(this->HeartbeatSampling > 1)
+    {
+    unsigned int& count = this->HeartbeatCounts[workerIdentity];
+    const bool publish = (count == 0);
+    count = (count + 1) % this->HeartbeatSampling;
+    if(!publish)
+      {
+      return;
+      }
+    }
+
   const std::string work_t = workerIdentity.name();
   const std::string serv_t = remus::proto::workevents::event_types[ remus::proto::workevents::HEARTBEAT ];
 
@@ -379,6 +396,8 @@ void EventPublisher::workerUnresponsive(const zmq::SocketIdentity &workerIdentit
 //----------------------------------------------------------------------------
 void EventPublisher::workerTerminated(const zmq::SocketIdentity &workerIdentity)
 {
+  this->HeartbeatCounts.erase(workerIdentity);
+
   const std::string work_t = workerIdentity.name();
 
   {
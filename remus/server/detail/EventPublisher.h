@@ -38,8 +38,10 @@ namespace zmq
 }
 
 #include <remus/proto/zmq.hpp>
+#include <remus/proto/zmqSocketIdentity.h>
 #include <remus/proto/EventTypes.h>
 
+#include <map>
 #include <sstream>
 #include <vector>
 #include <set>
@@ -105,6 +107,12 @@ public:
   void workerRegistered(const zmq::SocketIdentity &workerIdentity,
                                  const remus::proto::JobRequirements& reqs);
 
+  //publishes a heartbeat event for one out of every heartbeatSampling
+  //heartbeats of each worker. A value of 1 publishes every heartbeat, and
+  //0 disables heartbeat events. The default is 1.
+  void heartbeatSampling(unsigned int n) { this->HeartbeatSampling = n; }
+  unsigned int heartbeatSampling() const { return this->HeartbeatSampling; }
+
   void workerHeartbeat(const zmq::SocketIdentity &workerIdentity);
   void workerResponsive(const zmq::SocketIdentity &workerIdentity);
   void workerUnresponsive(const zmq::SocketIdentity &workerIdentity);
@@ -123,6 +131,10 @@ private:
 
   zmq::socket_t* socket;
   std::stringstream buffer;
+
+  unsigned int HeartbeatSampling;
+  //number of heartbeats since the last one we published, per worker
+  std::map< zmq::SocketIdentity, unsigned int > HeartbeatCounts;
 };
 
 }
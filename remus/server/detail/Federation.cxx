@@ -0,0 +1,505 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/Federation.h>
+
+#include <remus/proto/zmqHelper.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/thread/locks.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+
+namespace
+{
+//------------------------------------------------------------------------------
+//keeps the earliest of two times, where a negative time is unset
+inline void keep_earliest(boost::int64_t& earliest, boost::int64_t t)
+{
+  if(t >= 0 && (earliest < 0 || t < earliest))
+    {
+    earliest = t;
+    }
+}
+
+//------------------------------------------------------------------------------
+//the items that have waited longer than timeout for an acknowledgement,
+//which are considered sent again as of now
+template<typename T, typename Map>
+std::vector<T> take_due(Map& items, boost::int64_t now, boost::int64_t timeout)
+{
+  std::vector<T> due;
+  for(typename Map::iterator i = items.begin(); i != items.end(); ++i)
+    {
+    if(now - i->second.SentAt >= timeout)
+      {
+      i->second.SentAt = now;
+      due.push_back(i->second.Item);
+      }
+    }
+  return due;
+}
+}
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//------------------------------------------------------------------------------
+Federation::Federation():
+  PeersMutex(),
+  Peers(),
+  Context(),
+  OurEndpoint(),
+  ExchangeInterval(250),
+  LastExchange(0),
+  PeerTimeout(5000),
+  LastHeard(),
+  Links(),
+  Forwarded(),
+  Foreign(),
+  ForeignIds(),
+  Failures(),
+  Results()
+{
+}
+
+//------------------------------------------------------------------------------
+Federation::~Federation()
+{
+  this->stop();
+}
+
+//------------------------------------------------------------------------------
+void Federation::addPeer(const std::string& endpoint)
+{
+  boost::lock_guard<boost::mutex> lock(this->PeersMutex);
+  if(std::find(this->Peers.begin(), this->Peers.end(), endpoint) ==
+     this->Peers.end())
+    {
+    this->Peers.push_back(endpoint);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string> Federation::peers() const
+{
+  boost::lock_guard<boost::mutex> lock(this->PeersMutex);
+  return this->Peers;
+}
+
+//------------------------------------------------------------------------------
+bool Federation::isPeer(const std::string& endpoint) const
+{
+  boost::lock_guard<boost::mutex> lock(this->PeersMutex);
+  return std::find(this->Peers.begin(), this->Peers.end(), endpoint) !=
+         this->Peers.end();
+}
+
+//------------------------------------------------------------------------------
+void Federation::start(const boost::shared_ptr<zmq::context_t>& context,
+                       const std::string& ourEndpoint)
+{
+  this->stop();
+  this->Context = context;
+  this->OurEndpoint = ourEndpoint;
+  this->LastExchange = 0;
+  this->linkPeers();
+}
+
+//------------------------------------------------------------------------------
+void Federation::linkPeers()
+{
+  const std::vector<std::string> peers = this->peers();
+  typedef std::vector<std::string>::const_iterator it;
+  for(it i = peers.begin(); i != peers.end(); ++i)
+    {
+    this->linkTo(*i);
+    }
+}
+
+//------------------------------------------------------------------------------
+void Federation::stop()
+{
+  //the sockets need to be closed before the context they belong to
+  this->Links.clear();
+  this->Context.reset();
+}
+
+//------------------------------------------------------------------------------
+bool Federation::exchangeDue(boost::int64_t now)
+{
+  if(!this->isActive() || now - this->LastExchange < this->ExchangeInterval)
+    {
+    return false;
+    }
+  this->LastExchange = now;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void Federation::heardFrom(const std::string& endpoint, boost::int64_t now)
+{
+  this->LastHeard[endpoint] = now;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Federation::lastHeardFrom(const std::string& endpoint) const
+{
+  std::map<std::string, boost::int64_t>::const_iterator i =
+                                                this->LastHeard.find(endpoint);
+  return (i != this->LastHeard.end()) ? i->second : boost::int64_t(-1);
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t Federation::nextTimeout() const
+{
+  boost::int64_t next = -1;
+  typedef std::map<boost::uuids::uuid, ForwardedJob>::const_iterator fwd_it;
+  for(fwd_it i = this->Forwarded.begin(); i != this->Forwarded.end(); ++i)
+    {
+    if(!i->second.HaveResult)
+      {
+      const boost::int64_t since = i->second.Acknowledged ?
+          std::max(i->second.SentAt, this->lastHeardFrom(i->second.Endpoint)) :
+          i->second.SentAt;
+      keep_earliest(next, since + this->PeerTimeout);
+      }
+    }
+
+  typedef std::map<boost::uuids::uuid, UnacknowledgedFailure>::const_iterator
+          failure_it;
+  for(failure_it i = this->Failures.begin(); i != this->Failures.end(); ++i)
+    {
+    keep_earliest(next, i->second.SentAt + this->PeerTimeout);
+    }
+
+  typedef std::map<boost::uuids::uuid, UnacknowledgedResult>::const_iterator
+          result_it;
+  for(result_it i = this->Results.begin(); i != this->Results.end(); ++i)
+    {
+    keep_earliest(next, i->second.SentAt + this->PeerTimeout);
+    }
+  return next;
+}
+
+//------------------------------------------------------------------------------
+std::size_t Federation::linkTo(const std::string& endpoint)
+{
+  for(std::size_t i=0; i < this->Links.size(); ++i)
+    {
+    if(this->Links[i].Endpoint == endpoint)
+      {
+      return i;
+      }
+    }
+
+  //we don't link to ourselves, to anything before we are started, or to
+  //servers that aren't our configured peers
+  if(!this->Context || endpoint.empty() || endpoint == this->OurEndpoint ||
+     !this->isPeer(endpoint))
+    {
+    return this->Links.size();
+    }
+
+  Link link;
+  link.Endpoint = endpoint;
+  link.Socket.reset(new zmq::socket_t(*this->Context, ZMQ_DEALER));
+  zmq::set_socket_linger(*link.Socket);
+  try
+    {
+    //our endpoint is the identity of the link, so the peer can check that
+    //the endpoint our messages claim to come from is the one connected
+    link.Socket->setsockopt(ZMQ_IDENTITY, this->OurEndpoint.data(),
+                            this->OurEndpoint.size());
+    link.Socket->connect(endpoint.c_str());
+    }
+  catch(zmq::error_t&)
+    {
+    return this->Links.size();
+    }
+  this->Links.push_back(link);
+  return this->Links.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobRequirementsSet Federation::peerRequirements() const
+{
+  remus::proto::JobRequirementsSet reqs;
+  typedef std::vector<Link>::const_iterator it;
+  for(it link = this->Links.begin(); link != this->Links.end(); ++link)
+    {
+    for(remus::proto::QueueSummary::const_iterator i = link->Summary.begin();
+        i != link->Summary.end(); ++i)
+      {
+      if(i->second.Capacity > 0)
+        {
+        reqs.insert(i->first);
+        }
+      }
+    }
+  return reqs;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobRequirementsSet Federation::peerRequirements(
+                                  const remus::common::MeshIOType& type) const
+{
+  remus::proto::JobRequirementsSet all = this->peerRequirements();
+  remus::proto::JobRequirementsSet reqs;
+  typedef remus::proto::JobRequirementsSet::const_iterator it;
+  for(it i = all.begin(); i != all.end(); ++i)
+    {
+    if(i->meshTypes() == type)
+      {
+      reqs.insert(*i);
+      }
+    }
+  return reqs;
+}
+
+//------------------------------------------------------------------------------
+void Federation::forwarded(const remus::worker::Job& job,
+                           const std::string& endpoint,
+                           boost::int64_t now)
+{
+  this->Forwarded.erase(job.id());
+  this->Forwarded.insert(std::make_pair(job.id(),
+                                        ForwardedJob(job, endpoint, now)));
+}
+
+//------------------------------------------------------------------------------
+bool Federation::acknowledged(const boost::uuids::uuid& id,
+                              const std::string& endpoint)
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::iterator i =
+                                                      this->Forwarded.find(id);
+  if(i == this->Forwarded.end() || i->second.Endpoint != endpoint)
+    {
+    return false;
+    }
+  i->second.Acknowledged = true;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::worker::Job> Federation::takeLostJobs(boost::int64_t now)
+{
+  std::vector<remus::worker::Job> lost;
+  typedef std::map<boost::uuids::uuid, ForwardedJob>::iterator fwd_it;
+  for(fwd_it i = this->Forwarded.begin(); i != this->Forwarded.end(); )
+    {
+    //a job the peer accepted is only lost when the peer goes quiet
+    const boost::int64_t since = i->second.Acknowledged ?
+        std::max(i->second.SentAt, this->lastHeardFrom(i->second.Endpoint)) :
+        i->second.SentAt;
+    if(!i->second.HaveResult && now - since >= this->PeerTimeout)
+      {
+      lost.push_back(i->second.Job);
+      this->Forwarded.erase(i++);
+      }
+    else
+      {
+      ++i;
+      }
+    }
+  return lost;
+}
+
+//------------------------------------------------------------------------------
+bool Federation::isForwarded(const boost::uuids::uuid& id) const
+{
+  return this->Forwarded.count(id) > 0;
+}
+
+//------------------------------------------------------------------------------
+std::string Federation::forwardedTo(const boost::uuids::uuid& id) const
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::const_iterator i =
+                                                      this->Forwarded.find(id);
+  return (i != this->Forwarded.end()) ? i->second.Endpoint : std::string();
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobStatus Federation::forwardedStatus(
+                                          const boost::uuids::uuid& id) const
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::const_iterator i =
+                                                      this->Forwarded.find(id);
+  return (i != this->Forwarded.end()) ? i->second.Status :
+                        remus::proto::JobStatus(id, remus::INVALID_STATUS);
+}
+
+//------------------------------------------------------------------------------
+bool Federation::haveForwardedResult(const boost::uuids::uuid& id) const
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::const_iterator i =
+                                                      this->Forwarded.find(id);
+  return (i != this->Forwarded.end()) && i->second.HaveResult;
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobResult Federation::takeForwardedResult(
+                                                  const boost::uuids::uuid& id)
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::iterator i =
+                                                      this->Forwarded.find(id);
+  if(i == this->Forwarded.end())
+    {
+    return remus::proto::JobResult(id);
+    }
+  remus::proto::JobResult result = i->second.Result;
+  this->Forwarded.erase(i);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void Federation::removeForwarded(const boost::uuids::uuid& id)
+{
+  this->Forwarded.erase(id);
+}
+
+//------------------------------------------------------------------------------
+bool Federation::updateForwarded(const remus::proto::JobStatus& status,
+                                 const std::string& endpoint)
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::iterator i =
+                                                this->Forwarded.find(status.id());
+  if(i == this->Forwarded.end() || i->second.Endpoint != endpoint)
+    {
+    return false;
+    }
+  i->second.Status = status;
+  i->second.Acknowledged = true;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool Federation::updateForwarded(const remus::proto::JobResult& result,
+                                 const std::string& endpoint)
+{
+  std::map<boost::uuids::uuid, ForwardedJob>::iterator i =
+                                                this->Forwarded.find(result.id());
+  if(i == this->Forwarded.end() || i->second.Endpoint != endpoint)
+    {
+    return false;
+    }
+  //like a result of a local job, the result marks the job as finished
+  //unless it has already failed
+  if(!i->second.Status.failed())
+    {
+    i->second.Status = remus::proto::JobStatus(result.id(), remus::FINISHED);
+    }
+  i->second.Result = result;
+  i->second.HaveResult = true;
+  i->second.Acknowledged = true;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void Federation::foreign(const boost::uuids::uuid& id,
+                         const std::string& endpoint)
+{
+  this->Foreign[id] = endpoint;
+  this->ForeignIds.insert(id);
+}
+
+//------------------------------------------------------------------------------
+bool Federation::isForeign(const boost::uuids::uuid& id) const
+{
+  return this->ForeignIds.count(id) > 0;
+}
+
+//------------------------------------------------------------------------------
+std::string Federation::origin(const boost::uuids::uuid& id) const
+{
+  std::map<boost::uuids::uuid, std::string>::const_iterator i =
+                                                        this->Foreign.find(id);
+  return (i != this->Foreign.end()) ? i->second : std::string();
+}
+
+//------------------------------------------------------------------------------
+void Federation::removeForeign(const boost::uuids::uuid& id)
+{
+  this->Foreign.erase(id);
+  this->ForeignIds.erase(id);
+  this->Failures.erase(id);
+  this->Results.erase(id);
+}
+
+//------------------------------------------------------------------------------
+void Federation::sentToOrigin(const remus::proto::JobStatus& failure,
+                              boost::int64_t now)
+{
+  this->Failures.erase(failure.id());
+  this->Failures.insert(std::make_pair(failure.id(),
+                                       UnacknowledgedFailure(failure, now)));
+}
+
+//------------------------------------------------------------------------------
+void Federation::sentToOrigin(const remus::proto::JobResult& result,
+                              boost::int64_t now)
+{
+  this->Results.erase(result.id());
+  this->Results.insert(std::make_pair(result.id(),
+                                      UnacknowledgedResult(result, now)));
+}
+
+//------------------------------------------------------------------------------
+bool Federation::originAcknowledged(const remus::proto::JobStatus& failure,
+                                    const std::string& endpoint)
+{
+  //the origin acknowledges every status, only the failure we are waiting
+  //for ends the job
+  std::map<boost::uuids::uuid, UnacknowledgedFailure>::const_iterator i =
+                                              this->Failures.find(failure.id());
+  if(i == this->Failures.end() || i->second.Item != failure ||
+     this->origin(failure.id()) != endpoint)
+    {
+    return false;
+    }
+  this->removeForeign(failure.id());
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool Federation::originAcknowledged(const boost::uuids::uuid& resultId,
+                                    const std::string& endpoint)
+{
+  if(this->Results.count(resultId) == 0 || this->origin(resultId) != endpoint)
+    {
+    return false;
+    }
+  this->removeForeign(resultId);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::proto::JobStatus> Federation::failuresToResend(
+                                                          boost::int64_t now)
+{
+  return take_due<remus::proto::JobStatus>(this->Failures, now,
+                                           this->PeerTimeout);
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::proto::JobResult> Federation::resultsToResend(
+                                                          boost::int64_t now)
+{
+  return take_due<remus::proto::JobResult>(this->Results, now,
+                                           this->PeerTimeout);
+}
+
+}
+}
+}
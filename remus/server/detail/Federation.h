@@ -0,0 +1,252 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_Federation_h
+#define remus_server_detail_Federation_h
+
+#include <remus/common/CompilerInformation.h>
+#include <remus/common/MeshIOType.h>
+#include <remus/proto/JobRequirements.h>
+#include <remus/proto/JobResult.h>
+#include <remus/proto/JobStatus.h>
+#include <remus/proto/QueueSummary.h>
+#include <remus/proto/zmq.hpp>
+#include <remus/worker/Job.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/uuid/uuid.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//Tracks the peer servers a Server is federated with. Every peer is reached
+//through a DEALER link to its client endpoint, so peers talk to each other
+//like clients do. The federation stores the last queue summary each peer
+//sent, the jobs we moved to a peer so that their status and result can be
+//handed to our clients, and the jobs peers moved to us so that we know
+//where to send their status and result.
+//
+//Nothing that moves between peers is dropped when a message is lost. A
+//job we moved is kept until the peer acknowledges it, and is handed back
+//by takeLostJobs when the peer doesn't acknowledge it in time, or when we
+//stop hearing from the peer while it runs the job. The result and failure
+//of a job a peer moved to us are kept, and sent again, until the peer
+//acknowledges them. A job can run twice when an acknowledgement is lost,
+//but is never lost itself.
+//
+//Only configured peers are linked to, and only messages that name a
+//configured peer as their sender are accepted, so the number of links is
+//bounded by the configuration. The status and result of a job we moved
+//are only accepted from the peer we moved it to.
+//
+//Peers can be added at any time, all other methods are only called from
+//the brokering thread.
+class Federation
+{
+public:
+  Federation();
+  ~Federation();
+
+  //add the client endpoint of a peer server. Peers added once started
+  //are linked to by linkPeers
+  void addPeer(const std::string& endpoint);
+  std::vector<std::string> peers() const;
+
+  //returns true if the endpoint belongs to a configured peer
+  bool isPeer(const std::string& endpoint) const;
+
+  //create the links to the configured peers, and remember the endpoint
+  //peers use to reach us
+  void start(const boost::shared_ptr<zmq::context_t>& context,
+             const std::string& ourEndpoint);
+
+  //link to the configured peers we don't have a link to yet
+  void linkPeers();
+
+  //close all links, the jobs we track are kept
+  void stop();
+
+  //true once started with at least one link
+  bool isActive() const { return !this->Links.empty(); }
+
+  const std::string& ourEndpoint() const { return this->OurEndpoint; }
+
+  //the time in milliseconds between exchanging queue summaries
+  void exchangeInterval(boost::int64_t millisec)
+    { this->ExchangeInterval = millisec; }
+  boost::int64_t exchangeInterval() const { return this->ExchangeInterval; }
+
+  //returns true if the summaries should be exchanged, and if so resets
+  //the time of the last exchange to now
+  bool exchangeDue(boost::int64_t now);
+
+  //the time the next exchange is due, or -1 when we have no links
+  boost::int64_t nextExchange() const
+    { return this->isActive() ? this->LastExchange + this->ExchangeInterval
+                              : boost::int64_t(-1); }
+
+  //the time in milliseconds a peer has to acknowledge what we send it.
+  //A peer we haven't heard from for this long is considered lost. The
+  //default is 5000
+  void peerTimeout(boost::int64_t millisec) { this->PeerTimeout = millisec; }
+  boost::int64_t peerTimeout() const { return this->PeerTimeout; }
+
+  //note that the peer with the given endpoint sent us a message
+  void heardFrom(const std::string& endpoint, boost::int64_t now);
+
+  //the time the next job or result we sent times out, or -1 when we are
+  //waiting for no acknowledgements
+  boost::int64_t nextTimeout() const;
+
+  //the links to our peers
+  std::size_t numberOfLinks() const { return this->Links.size(); }
+  zmq::socket_t& link(std::size_t i) { return *this->Links[i].Socket; }
+  const std::string& linkEndpoint(std::size_t i) const
+    { return this->Links[i].Endpoint; }
+
+  //returns the link to the given endpoint, creating it if needed.
+  //Returns numberOfLinks() if we aren't started, or the endpoint isn't
+  //a configured peer
+  std::size_t linkTo(const std::string& endpoint);
+
+  //the last queue summary received over the link
+  remus::proto::QueueSummary& summary(std::size_t link)
+    { return this->Links[link].Summary; }
+
+  //the requirements any peer has capacity for
+  remus::proto::JobRequirementsSet peerRequirements() const;
+  remus::proto::JobRequirementsSet peerRequirements(
+                                const remus::common::MeshIOType& type) const;
+
+  //jobs we moved to the peer with the given endpoint, which starts their
+  //status at QUEUED. The job is kept so that it can be queued again if
+  //the peer doesn't acknowledge it
+  void forwarded(const remus::worker::Job& job, const std::string& endpoint,
+                 boost::int64_t now);
+
+  //the peer with the given endpoint has accepted the job, which the status
+  //and result the peer sends for the job imply as well
+  bool acknowledged(const boost::uuids::uuid& id, const std::string& endpoint);
+
+  //returns the jobs that weren't acknowledged in time, or that run on a
+  //peer we haven't heard from within the peer timeout, and stops tracking
+  //them so that they can be queued again. Jobs with a result are kept
+  std::vector<remus::worker::Job> takeLostJobs(boost::int64_t now);
+
+  bool isForwarded(const boost::uuids::uuid& id) const;
+  std::string forwardedTo(const boost::uuids::uuid& id) const;
+  remus::proto::JobStatus forwardedStatus(const boost::uuids::uuid& id) const;
+  bool haveForwardedResult(const boost::uuids::uuid& id) const;
+
+  //returns the result of the job, and stops tracking it
+  remus::proto::JobResult takeForwardedResult(const boost::uuids::uuid& id);
+  void removeForwarded(const boost::uuids::uuid& id);
+
+  //store the status or result the peer with the given endpoint sent for a
+  //job we moved to it. Returns false if we didn't move the job to that peer
+  bool updateForwarded(const remus::proto::JobStatus& status,
+                       const std::string& endpoint);
+  bool updateForwarded(const remus::proto::JobResult& result,
+                       const std::string& endpoint);
+
+  //jobs peers moved to us, and the endpoint of the peer they came from
+  void foreign(const boost::uuids::uuid& id, const std::string& endpoint);
+  bool isForeign(const boost::uuids::uuid& id) const;
+  std::string origin(const boost::uuids::uuid& id) const;
+  void removeForeign(const boost::uuids::uuid& id);
+  const std::set<boost::uuids::uuid>& foreignJobs() const
+    { return this->ForeignIds; }
+
+  //the failure or result of a foreign job that we sent to its origin. It
+  //is kept until the origin acknowledges it, after which we stop tracking
+  //the job
+  void sentToOrigin(const remus::proto::JobStatus& failure, boost::int64_t now);
+  void sentToOrigin(const remus::proto::JobResult& result, boost::int64_t now);
+  bool originAcknowledged(const remus::proto::JobStatus& failure,
+                          const std::string& endpoint);
+  bool originAcknowledged(const boost::uuids::uuid& resultId,
+                          const std::string& endpoint);
+
+  //the failures and results the origin hasn't acknowledged within the peer
+  //timeout, which are considered sent again as of now
+  std::vector<remus::proto::JobStatus> failuresToResend(boost::int64_t now);
+  std::vector<remus::proto::JobResult> resultsToResend(boost::int64_t now);
+
+private:
+  struct Link
+  {
+    std::string Endpoint;
+    boost::shared_ptr<zmq::socket_t> Socket;
+    remus::proto::QueueSummary Summary;
+  };
+
+  struct ForwardedJob
+  {
+    ForwardedJob(const remus::worker::Job& job, const std::string& endpoint,
+                 boost::int64_t now):
+      Endpoint(endpoint), Job(job), Status(job.id(), remus::QUEUED),
+      Result(job.id()), HaveResult(false), Acknowledged(false), SentAt(now) {}
+
+    std::string Endpoint;
+    remus::worker::Job Job;
+    remus::proto::JobStatus Status;
+    remus::proto::JobResult Result;
+    bool HaveResult;
+    bool Acknowledged;
+    boost::int64_t SentAt;
+  };
+
+  //a failure or result waiting for the origin to acknowledge it
+  template<typename T>
+  struct Unacknowledged
+  {
+    Unacknowledged(const T& t, boost::int64_t now): Item(t), SentAt(now) {}
+    T Item;
+    boost::int64_t SentAt;
+  };
+  typedef Unacknowledged<remus::proto::JobStatus> UnacknowledgedFailure;
+  typedef Unacknowledged<remus::proto::JobResult> UnacknowledgedResult;
+
+  boost::int64_t lastHeardFrom(const std::string& endpoint) const;
+
+  mutable boost::mutex PeersMutex;
+  std::vector<std::string> Peers;
+  boost::shared_ptr<zmq::context_t> Context;
+  std::string OurEndpoint;
+  boost::int64_t ExchangeInterval;
+  boost::int64_t LastExchange;
+  boost::int64_t PeerTimeout;
+  std::map<std::string, boost::int64_t> LastHeard;
+
+  std::vector<Link> Links;
+  std::map<boost::uuids::uuid, ForwardedJob> Forwarded;
+  std::map<boost::uuids::uuid, std::string> Foreign;
+  std::set<boost::uuids::uuid> ForeignIds;
+  std::map<boost::uuids::uuid, UnacknowledgedFailure> Failures;
+  std::map<boost::uuids::uuid, UnacknowledgedResult> Results;
+};
+
+}
+}
+}
+
+#endif
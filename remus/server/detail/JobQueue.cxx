@@ -83,6 +83,72 @@ remus::worker::Job JobQueue::takeJob(const remus::proto::JobRequirements& reqs)
   return job;
 }
 
+//------------------------------------------------------------------------------
+std::vector<remus::worker::Job> JobQueue::takeJobs(
+                                    const remus::proto::JobRequirements& reqs,
+                                    std::size_t maxJobs)
+{
+  std::vector<remus::worker::Job> jobs;
+  for(std::size_t i=0; i < maxJobs; ++i)
+    {
+    remus::worker::Job job = this->takeJob(reqs);
+    if(!job.valid())
+      {
+      break;
+      }
+    jobs.push_back(job);
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::worker::Job> JobQueue::takeQueuedJobs(
+                                    const remus::proto::JobRequirements& reqs,
+                                    std::size_t maxJobs,
+                                    const std::set<boost::uuids::uuid>& keep)
+{
+  std::vector<remus::worker::Job> jobs;
+  std::vector<QueuedJob> remaining;
+  remaining.reserve(this->QueuedJobs.size());
+
+  JobTypeMatches pred(reqs);
+  typedef std::vector<QueuedJob>::const_iterator iter;
+  for(iter i = this->QueuedJobs.begin(); i != this->QueuedJobs.end(); ++i)
+    {
+    if(jobs.size() < maxJobs && pred(*i) && keep.count(i->Id) == 0)
+      {
+      jobs.push_back(remus::worker::Job(i->Id, i->Submission));
+      this->QueuedIds.erase(i->Id);
+      }
+    else
+      {
+      remaining.push_back(*i);
+      }
+    }
+
+  if(!jobs.empty())
+    {
+    this->QueuedJobs.swap(remaining);
+    this->CachedQueuedJobRequirements.clear();
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+void JobQueue::batchSize(const remus::proto::JobRequirements& reqs,
+                         std::size_t size)
+{
+  this->BatchSizes[reqs] = std::max(size, std::size_t(1));
+}
+
+//------------------------------------------------------------------------------
+std::size_t JobQueue::batchSize(const remus::proto::JobRequirements& reqs) const
+{
+  typedef std::map<remus::proto::JobRequirements, std::size_t>::const_iterator it;
+  it i = this->BatchSizes.find(reqs);
+  return (i != this->BatchSizes.end()) ? i->second : 1;
+}
+
 //------------------------------------------------------------------------------
 remus::proto::JobRequirementsSet JobQueue::waitingJobRequirements() const
 {
@@ -25,6 +25,7 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 REMUS_THIRDPARTY_POST_INCLUDE
 
 #include <algorithm>
+#include <map>
 #include <set>
 #include <vector>
 
@@ -43,7 +44,9 @@ public:
   JobQueue():
     QueuedJobs(),
     JobsWaitingForWorker(),
-    QueuedIds()
+    QueuedIds(),
+    CachedQueuedJobRequirements(),
+    BatchSizes()
   {}
 
   //Convert a Message and UUID into a WorkerMessage.
@@ -56,6 +59,28 @@ public:
   //workers, and than take jobs that are just queued.
   remus::worker::Job takeJob(const remus::proto::JobRequirements& reqs);
 
+  //Removes up to maxJobs jobs from the queue of the given requirements,
+  //with the same priority as takeJob.
+  std::vector<remus::worker::Job> takeJobs(
+                                    const remus::proto::JobRequirements& reqs,
+                                    std::size_t maxJobs);
+
+  //Removes up to maxJobs jobs of the given requirements that don't have a
+  //worker dispatched for them, skipping the jobs whose id is in keep. Used
+  //to move jobs to a peer server without taking the jobs that the workers
+  //we launched are coming for.
+  std::vector<remus::worker::Job> takeQueuedJobs(
+                                    const remus::proto::JobRequirements& reqs,
+                                    std::size_t maxJobs,
+                                    const std::set<boost::uuids::uuid>& keep);
+
+  //Set the maximum number of jobs with the given requirements that
+  //should be sent to a worker in a single batch. Jobs that take
+  //very little time to process benefit from being batched, as the
+  //per job messaging overhead dominates. The default batch size is 1.
+  void batchSize(const remus::proto::JobRequirements& reqs, std::size_t size);
+  std::size_t batchSize(const remus::proto::JobRequirements& reqs) const;
+
   //returns the types of jobs that are waiting for a worker
   remus::proto::JobRequirementsSet waitingJobRequirements() const;
 
@@ -70,6 +95,15 @@ public:
   std::size_t numJobsJustQueued() const
     { return QueuedJobs.size(); }
 
+  //return the number of jobs with the given requirements queued but not
+  //waiting for a worker
+  std::size_t numJobsJustQueued(const remus::proto::JobRequirements& reqs) const
+    {
+    return static_cast<std::size_t>(std::count_if(QueuedJobs.begin(),
+                                                  QueuedJobs.end(),
+                                                  JobTypeMatches(reqs)));
+    }
+
   //marks the first job with the given type as having
   //a worker dispatched for it.
   bool workerDispatched(const remus::proto::JobRequirements& reqs);
@@ -136,6 +170,8 @@ private:
   std::set<boost::uuids::uuid> QueuedIds;
   std::set<remus::proto::JobRequirements> CachedQueuedJobRequirements;
 
+  std::map<remus::proto::JobRequirements, std::size_t> BatchSizes;
+
   //make copying not possible
   JobQueue (const JobQueue&);
   void operator = (const JobQueue&);
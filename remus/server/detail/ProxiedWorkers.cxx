@@ -0,0 +1,285 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/ProxiedWorkers.h>
+
+#include <algorithm>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//------------------------------------------------------------------------------
+ProxiedWorkers::ProxiedWorkers():
+  Workers(),
+  Registered(),
+  Waiting(),
+  Held(),
+  Credits(),
+  Owners(),
+  Acks()
+{
+}
+
+//------------------------------------------------------------------------------
+bool ProxiedWorkers::registerWorker(const zmq::SocketIdentity& worker,
+                                    const remus::proto::JobRequirements& reqs,
+                                    boost::int64_t now)
+{
+  WorkerInfo& info = this->Workers[worker];
+  info.LastHeard = now;
+  if(std::find(info.Reqs.begin(), info.Reqs.end(), reqs) == info.Reqs.end())
+    {
+    info.Reqs.push_back(reqs);
+    }
+  return this->Registered.insert(reqs).second;
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::worker::Job> ProxiedWorkers::readyForWork(
+                                    const zmq::SocketIdentity& worker,
+                                    const remus::proto::JobRequirements& reqs,
+                                    unsigned int numberOfJobs,
+                                    boost::int64_t now)
+{
+  this->registerWorker(worker, reqs, now);
+
+  //hand out the jobs we hold first, they were sent to us for credits
+  //that the server already counted
+  std::vector<remus::worker::Job> jobs;
+  HeldMap::iterator held = this->Held.find(reqs);
+  while(numberOfJobs > 0 && held != this->Held.end() && !held->second.empty())
+    {
+    const remus::worker::Job job = held->second.front();
+    held->second.pop_front();
+    this->Owners[job.id()] = worker;
+    jobs.push_back(job);
+    --numberOfJobs;
+    }
+
+  if(numberOfJobs > 0)
+    {
+    std::deque<zmq::SocketIdentity>& waiting = this->Waiting[reqs];
+    waiting.insert(waiting.end(), numberOfJobs, worker);
+    this->Credits[reqs] += numberOfJobs;
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+std::map<remus::proto::JobRequirements, unsigned int>
+ProxiedWorkers::takeCredits()
+{
+  std::map<remus::proto::JobRequirements, unsigned int> credits;
+  credits.swap(this->Credits);
+  return credits;
+}
+
+//------------------------------------------------------------------------------
+void ProxiedWorkers::heard(const zmq::SocketIdentity& worker,
+                           boost::int64_t now)
+{
+  WorkerMap::iterator i = this->Workers.find(worker);
+  if(i != this->Workers.end())
+    {
+    i->second.LastHeard = now;
+    }
+}
+
+//------------------------------------------------------------------------------
+void ProxiedWorkers::heartbeat(const zmq::SocketIdentity& worker,
+                               boost::int64_t interval,
+                               boost::int64_t now)
+{
+  WorkerMap::iterator i = this->Workers.find(worker);
+  if(i != this->Workers.end())
+    {
+    i->second.LastHeard = now;
+    if(interval > 0)
+      {
+      i->second.Interval = interval;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool ProxiedWorkers::supports(const remus::proto::JobRequirements& reqs) const
+{
+  for(WorkerMap::const_iterator i = this->Workers.begin();
+      i != this->Workers.end(); ++i)
+    {
+    if(std::find(i->second.Reqs.begin(), i->second.Reqs.end(), reqs) !=
+       i->second.Reqs.end())
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+zmq::SocketIdentity ProxiedWorkers::assign(const remus::worker::Job& job)
+{
+  const remus::proto::JobRequirements& reqs = job.submission().requirements();
+  WaitingMap::iterator waiting = this->Waiting.find(reqs);
+  if(waiting == this->Waiting.end() || waiting->second.empty())
+    {
+    this->Held[reqs].push_back(job);
+    return zmq::SocketIdentity();
+    }
+
+  const zmq::SocketIdentity worker = waiting->second.front();
+  waiting->second.pop_front();
+  this->Owners[job.id()] = worker;
+  return worker;
+}
+
+//------------------------------------------------------------------------------
+zmq::SocketIdentity ProxiedWorkers::owner(const boost::uuids::uuid& id) const
+{
+  std::map<boost::uuids::uuid, zmq::SocketIdentity>::const_iterator i =
+                                                        this->Owners.find(id);
+  return (i != this->Owners.end()) ? i->second : zmq::SocketIdentity();
+}
+
+//------------------------------------------------------------------------------
+bool ProxiedWorkers::removeHeld(const boost::uuids::uuid& id)
+{
+  for(HeldMap::iterator i = this->Held.begin(); i != this->Held.end(); ++i)
+    {
+    for(std::deque<remus::worker::Job>::iterator job = i->second.begin();
+        job != i->second.end(); ++job)
+      {
+      if(job->id() == id)
+        {
+        i->second.erase(job);
+        return true;
+        }
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void ProxiedWorkers::finished(const boost::uuids::uuid& id)
+{
+  this->Owners.erase(id);
+}
+
+//------------------------------------------------------------------------------
+void ProxiedWorkers::awaitAck(const zmq::SocketIdentity& worker)
+{
+  this->Acks.push_back(worker);
+}
+
+//------------------------------------------------------------------------------
+zmq::SocketIdentity ProxiedWorkers::takeAck()
+{
+  if(this->Acks.empty())
+    {
+    return zmq::SocketIdentity();
+    }
+  const zmq::SocketIdentity worker = this->Acks.front();
+  this->Acks.pop_front();
+  return worker;
+}
+
+//------------------------------------------------------------------------------
+std::vector<boost::uuids::uuid> ProxiedWorkers::removeWorker(
+                                            const zmq::SocketIdentity& worker)
+{
+  std::vector<boost::uuids::uuid> failed;
+  if(this->Workers.erase(worker) == 0)
+    {
+    return failed;
+    }
+
+  for(WaitingMap::iterator i = this->Waiting.begin();
+      i != this->Waiting.end(); ++i)
+    {
+    i->second.erase(std::remove(i->second.begin(), i->second.end(), worker),
+                    i->second.end());
+    }
+
+  typedef std::map<boost::uuids::uuid, zmq::SocketIdentity>::iterator OwnerIt;
+  for(OwnerIt i = this->Owners.begin(); i != this->Owners.end();)
+    {
+    if(i->second == worker)
+      {
+      failed.push_back(i->first);
+      this->Owners.erase(i++);
+      }
+    else
+      {
+      ++i;
+      }
+    }
+
+  //nobody is left to run the held jobs of requirements the worker was the
+  //last to support, while other held jobs wait for the next worker
+  for(HeldMap::iterator i = this->Held.begin(); i != this->Held.end(); ++i)
+    {
+    if(!this->supports(i->first))
+      {
+      for(std::deque<remus::worker::Job>::const_iterator job =
+          i->second.begin(); job != i->second.end(); ++job)
+        {
+        failed.push_back(job->id());
+        }
+      i->second.clear();
+      }
+    }
+  return failed;
+}
+
+//------------------------------------------------------------------------------
+std::vector<zmq::SocketIdentity> ProxiedWorkers::silentWorkers(
+                                                      boost::int64_t now) const
+{
+  std::vector<zmq::SocketIdentity> silent;
+  for(WorkerMap::const_iterator i = this->Workers.begin();
+      i != this->Workers.end(); ++i)
+    {
+    if(now - i->second.LastHeard > i->second.Interval * 2)
+      {
+      silent.push_back(i->first);
+      }
+    }
+  return silent;
+}
+
+//------------------------------------------------------------------------------
+std::vector<zmq::SocketIdentity> ProxiedWorkers::workers() const
+{
+  std::vector<zmq::SocketIdentity> all;
+  for(WorkerMap::const_iterator i = this->Workers.begin();
+      i != this->Workers.end(); ++i)
+    {
+    all.push_back(i->first);
+    }
+  return all;
+}
+
+//------------------------------------------------------------------------------
+std::size_t ProxiedWorkers::numberOfHeldJobs() const
+{
+  std::size_t count = 0;
+  for(HeldMap::const_iterator i = this->Held.begin(); i != this->Held.end(); ++i)
+    {
+    count += i->second.size();
+    }
+  return count;
+}
+
+}
+}
+}
@@ -0,0 +1,138 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_ProxiedWorkers_h
+#define remus_server_detail_ProxiedWorkers_h
+
+#include <remus/common/CompilerInformation.h>
+#include <remus/proto/JobRequirements.h>
+#include <remus/proto/zmqSocketIdentity.h>
+#include <remus/worker/Job.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/uuid/uuid.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//Tracks the workers connected to a WorkerProxy, so that the proxy can
+//present all of them to the server as a single worker with many slots.
+//
+//Requirements are only registered with the server by the first worker
+//that supports them, and the jobs workers ask for are granted to the
+//server as credits of the proxy. Jobs the server sends are handed to a
+//worker that asked for jobs with the requirements, or held until one
+//does. Times are milliseconds on a clock of the caller.
+class ProxiedWorkers
+{
+public:
+  ProxiedWorkers();
+
+  //the worker supports the requirements. Returns true for the first worker
+  //with the requirements, which is the registration to send to the server
+  bool registerWorker(const zmq::SocketIdentity& worker,
+                      const remus::proto::JobRequirements& reqs,
+                      boost::int64_t now);
+
+  //the worker is ready to take numberOfJobs jobs with the requirements.
+  //The jobs we hold are handed to it right away, and the rest is granted
+  //to the server by the next takeCredits
+  std::vector<remus::worker::Job> readyForWork(const zmq::SocketIdentity& worker,
+                                    const remus::proto::JobRequirements& reqs,
+                                    unsigned int numberOfJobs,
+                                    boost::int64_t now);
+
+  //the credits workers granted since the last call, by requirements
+  std::map<remus::proto::JobRequirements, unsigned int> takeCredits();
+
+  //the worker sent us a message, which keeps it alive
+  void heard(const zmq::SocketIdentity& worker, boost::int64_t now);
+
+  //the worker promises to send its next message within interval
+  void heartbeat(const zmq::SocketIdentity& worker,
+                 boost::int64_t interval,
+                 boost::int64_t now);
+
+  //true if a connected worker supports the requirements
+  bool supports(const remus::proto::JobRequirements& reqs) const;
+
+  //hand a job the server sent to a worker waiting for it. Returns an empty
+  //identity when no worker is waiting, in which case the job is held
+  zmq::SocketIdentity assign(const remus::worker::Job& job);
+
+  //the worker running the job, or an empty identity
+  zmq::SocketIdentity owner(const boost::uuids::uuid& id) const;
+
+  //stop holding the job, returns false if we didn't hold it
+  bool removeHeld(const boost::uuids::uuid& id);
+
+  //stop tracking a job that finished or failed
+  void finished(const boost::uuids::uuid& id);
+
+  //the worker sent results the server needs to acknowledge. The server
+  //acknowledges results in the order the proxy forwards them
+  void awaitAck(const zmq::SocketIdentity& worker);
+
+  //the worker the next acknowledgment of the server is for, or an empty
+  //identity if no results are waiting on one
+  zmq::SocketIdentity takeAck();
+
+  //remove a worker that left. Returns the jobs that failed with it, which
+  //are the jobs it was running, and the held jobs no worker supports anymore
+  std::vector<boost::uuids::uuid> removeWorker(const zmq::SocketIdentity& worker);
+
+  //the workers we haven't heard from for twice the interval they promised
+  std::vector<zmq::SocketIdentity> silentWorkers(boost::int64_t now) const;
+
+  std::vector<zmq::SocketIdentity> workers() const;
+  std::size_t numberOfWorkers() const { return this->Workers.size(); }
+  std::size_t numberOfHeldJobs() const;
+
+private:
+  struct WorkerInfo
+  {
+    WorkerInfo(): Reqs(), Interval(60000), LastHeard(0) {}
+
+    std::vector<remus::proto::JobRequirements> Reqs;
+    boost::int64_t Interval;
+    boost::int64_t LastHeard;
+  };
+
+  typedef std::map<zmq::SocketIdentity, WorkerInfo> WorkerMap;
+  typedef std::map<remus::proto::JobRequirements,
+                   std::deque<zmq::SocketIdentity> > WaitingMap;
+  typedef std::map<remus::proto::JobRequirements,
+                   std::deque<remus::worker::Job> > HeldMap;
+
+  WorkerMap Workers;
+  //the requirements registered with the server, which it never forgets
+  remus::proto::JobRequirementsSet Registered;
+  //a worker is listed once for every job it asked for
+  WaitingMap Waiting;
+  HeldMap Held;
+  std::map<remus::proto::JobRequirements, unsigned int> Credits;
+  std::map<boost::uuids::uuid, zmq::SocketIdentity> Owners;
+  std::deque<zmq::SocketIdentity> Acks;
+};
+
+}
+}
+}
+
+#endif
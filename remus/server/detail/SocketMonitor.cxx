@@ -12,9 +12,7 @@
 
 #include <remus/server/detail/SocketMonitor.h>
 
-REMUS_THIRDPARTY_PRE_INCLUDE
-#include <boost/date_time/posix_time/posix_time.hpp>
-REMUS_THIRDPARTY_POST_INCLUDE
+#include <remus/server/detail/TimingWheel.h>
 
 #include <algorithm>
 
@@ -25,16 +23,17 @@ namespace detail{
 //------------------------------------------------------------------------------
 class SocketMonitor::WorkerTracker
 {
-  typedef boost::posix_time::ptime ptime;
-
   struct BeatInfo
     {
-    BeatInfo(): Duration(), LastOccurrence()
+    BeatInfo(): Duration(), LastOccurrence(), ReportedUnresponsive(false),
+                Disconnected(false)
     {
     }
 
     boost::int64_t Duration;
-    ptime LastOccurrence;
+    boost::int64_t LastOccurrence; //milliseconds on a monotonic clock
+    bool ReportedUnresponsive;
+    bool Disconnected;
     };
 
 public:
@@ -42,11 +41,24 @@ public:
 
   std::map< zmq::SocketIdentity, BeatInfo > HeartBeats;
 
+  //when each socket becomes unresponsive
+  TimingWheel Deadlines;
+
+  //changes that haven't been collected by livenessChanges
+  SocketMonitor::LivenessChanges Changes;
+
+  //the socket using each connection, keyed by file descriptor
+  std::map< int, zmq::SocketIdentity > Connections;
+
   typedef std::pair< zmq::SocketIdentity, BeatInfo > InsertType;
   typedef std::map< zmq::SocketIdentity, BeatInfo >::iterator IteratorType;
 
   WorkerTracker( remus::common::PollingMonitor p):
-    PollMonitor(p)
+    PollMonitor(p),
+    HeartBeats(),
+    Deadlines(),
+    Changes(),
+    Connections()
   {}
 
   //----------------------------------------------------------------------------
@@ -66,8 +78,6 @@ public:
     IteratorType iter = (this->HeartBeats.insert(key_value)).first;
     BeatInfo& beat = iter->second;
 
-    beat.LastOccurrence = boost::posix_time::microsec_clock::local_time();
-
     //look at our current max time out and the and the current duration that
     //we last polled the worker at. Take the slower of the two.
     //
@@ -78,6 +88,8 @@ public:
     //decoding a message that is really large we don't want to mark it as
     //expired, so we always use our max time out
     beat.Duration = std::max( beat.Duration, PollMonitor.maxTimeOut() );
+
+    this->heardFrom(socket, beat);
   }
 
   //----------------------------------------------------------------------------
@@ -89,11 +101,26 @@ public:
     IteratorType iter = (this->HeartBeats.insert(key_value)).first;
     BeatInfo& beat = iter->second;
 
-    beat.LastOccurrence = boost::posix_time::microsec_clock::local_time();
-
     //Now we choose the greatest value between the poller and the sent in duration
     //from the socket.
     beat.Duration = std::max( dur, PollMonitor.maxTimeOut() );
+
+    this->heardFrom(socket, beat);
+  }
+
+  //----------------------------------------------------------------------------
+  //the socket is alive, so push back when it becomes unresponsive
+  void heardFrom( const zmq::SocketIdentity& socket, BeatInfo& beat )
+  {
+    beat.LastOccurrence = TimingWheel::now();
+    beat.Disconnected = false;
+    this->Deadlines.schedule(socket, beat.LastOccurrence + beat.Duration*2);
+
+    if(beat.ReportedUnresponsive)
+      {
+      beat.ReportedUnresponsive = false;
+      this->Changes.Responsive.push_back(socket);
+      }
   }
 
   //----------------------------------------------------------------------------
@@ -114,7 +141,52 @@ public:
   //----------------------------------------------------------------------------
   void markAsDead( const zmq::SocketIdentity& socket )
   {
-    this->HeartBeats.erase(socket);
+    if(this->HeartBeats.erase(socket) > 0)
+      {
+      this->Deadlines.cancel(socket);
+      this->Changes.Dead.push_back(socket);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void connectedOn( const zmq::SocketIdentity& socket, int fd )
+  {
+    if(fd >= 0)
+      {
+      this->Connections[fd] = socket;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void connectionAccepted( int fd )
+  {
+    this->Connections.erase(fd);
+  }
+
+  //----------------------------------------------------------------------------
+  void connectionClosed( int fd )
+  {
+    std::map< int, zmq::SocketIdentity >::iterator connection =
+                                                    this->Connections.find(fd);
+    if(connection == this->Connections.end())
+      {
+      return;
+      }
+
+    IteratorType iter = this->HeartBeats.find(connection->second);
+    if(iter != this->HeartBeats.end())
+      {
+      //we don't need a heartbeat deadline to know this socket is gone
+      BeatInfo& beat = iter->second;
+      beat.Disconnected = true;
+      this->Deadlines.cancel(iter->first);
+      if(!beat.ReportedUnresponsive)
+        {
+        beat.ReportedUnresponsive = true;
+        this->Changes.Unresponsive.push_back(iter->first);
+        }
+      }
+    this->Connections.erase(connection);
   }
 
   //----------------------------------------------------------------------------
@@ -122,22 +194,65 @@ public:
   {
     if(this->exists(socket))
       {
+      const BeatInfo& beat = this->HeartBeats.find(socket)->second;
+      if(beat.Disconnected)
+        {
+        return true;
+        }
+
       //polling has been abnormal give it a pass
       if(PollMonitor.hasAbnormalEvent())
         {
         return false;
         }
 
-      const BeatInfo& beat = this->HeartBeats.find(socket)->second;
-      const ptime current = boost::posix_time::microsec_clock::local_time();
-      const ptime expectedHB = beat.LastOccurrence +
-                               boost::posix_time::milliseconds(beat.Duration*2);
-      return current > expectedHB;
+      const boost::int64_t expectedHB = beat.LastOccurrence + beat.Duration*2;
+      return TimingWheel::now() > expectedHB;
       }
 
     //the socket isn't contained here, this socket is dead dead
     return true;
   }
+
+  //----------------------------------------------------------------------------
+  SocketMonitor::LivenessChanges livenessChanges()
+  {
+    const boost::int64_t current = TimingWheel::now();
+    std::vector<zmq::SocketIdentity> expired = this->Deadlines.advance(current);
+
+    typedef std::vector<zmq::SocketIdentity>::const_iterator ExpiredIt;
+    for(ExpiredIt i = expired.begin(); i != expired.end(); ++i)
+      {
+      BeatInfo& beat = this->HeartBeats.find(*i)->second;
+      if(PollMonitor.hasAbnormalEvent())
+        { //polling has been abnormal give it a pass, and check again
+          //once it has missed another heartbeat
+        this->Deadlines.schedule(*i, current + beat.Duration*2);
+        }
+      else
+        {
+        beat.ReportedUnresponsive = true;
+        this->Changes.Unresponsive.push_back(*i);
+        }
+      }
+
+    SocketMonitor::LivenessChanges changes;
+    std::swap(changes, this->Changes);
+    return changes;
+  }
+
+  //----------------------------------------------------------------------------
+  bool hasPendingChanges() const
+  {
+    return !this->Deadlines.empty() || !this->Changes.empty();
+  }
+
+  //----------------------------------------------------------------------------
+  boost::int64_t nextChange() const
+  {
+    return this->Changes.empty() ? this->Deadlines.nextDeadline()
+                                 : TimingWheel::now();
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -208,6 +323,24 @@ void SocketMonitor::markAsDead( const zmq::SocketIdentity& socket )
   return this->Tracker->markAsDead(socket);
 }
 
+//------------------------------------------------------------------------------
+void SocketMonitor::connectedOn( const zmq::SocketIdentity& socket, int fd )
+{
+  this->Tracker->connectedOn(socket, fd);
+}
+
+//------------------------------------------------------------------------------
+void SocketMonitor::connectionAccepted( int fd )
+{
+  this->Tracker->connectionAccepted(fd);
+}
+
+//------------------------------------------------------------------------------
+void SocketMonitor::connectionClosed( int fd )
+{
+  this->Tracker->connectionClosed(fd);
+}
+
 //------------------------------------------------------------------------------
 bool SocketMonitor::isDead( const zmq::SocketIdentity& socket ) const
 {
@@ -220,6 +353,24 @@ bool SocketMonitor::isUnresponsive( const zmq::SocketIdentity& socket ) const
   return this->Tracker->isMostlyDead(socket);
 }
 
+//------------------------------------------------------------------------------
+SocketMonitor::LivenessChanges SocketMonitor::livenessChanges()
+{
+  return this->Tracker->livenessChanges();
+}
+
+//------------------------------------------------------------------------------
+bool SocketMonitor::hasPendingChanges() const
+{
+  return this->Tracker->hasPendingChanges();
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t SocketMonitor::nextChange() const
+{
+  return this->Tracker->nextChange();
+}
+
 }
 }
 }
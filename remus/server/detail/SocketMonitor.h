@@ -24,6 +24,8 @@ REMUS_THIRDPARTY_POST_INCLUDE
 
 #include <remus/common/PollingMonitor.h>
 
+#include <vector>
+
 namespace remus{
 namespace server{
 namespace detail{
@@ -32,6 +34,22 @@ namespace detail{
 class SocketMonitor
 {
 public:
+  //The sockets whose liveness has changed since the last time
+  //livenessChanges was called. A socket can be both Responsive and
+  //Unresponsive, in that case it became Unresponsive last.
+  struct LivenessChanges
+  {
+    //sockets that have missed their heartbeat deadline
+    std::vector<zmq::SocketIdentity> Unresponsive;
+    //unresponsive sockets that we have heard from again
+    std::vector<zmq::SocketIdentity> Responsive;
+    //sockets that have been marked as dead
+    std::vector<zmq::SocketIdentity> Dead;
+
+    bool empty() const
+      { return Unresponsive.empty() && Responsive.empty() && Dead.empty(); }
+  };
+
   SocketMonitor( );
   SocketMonitor( remus::common::PollingMonitor pollingMonitor );
   SocketMonitor( const SocketMonitor& other );
@@ -62,6 +80,21 @@ public:
   //the socket as fully dead.
   void markAsDead( const zmq::SocketIdentity& socket );
 
+  //record that messages from a socket arrive on the connection with the
+  //given file descriptor, so that closing the connection can be mapped
+  //back to the socket.
+  void connectedOn( const zmq::SocketIdentity& socket, int fd );
+
+  //a new connection has been accepted with the given file descriptor.
+  //Forgets any socket that used a previous connection with the same fd.
+  void connectionAccepted( int fd );
+
+  //the connection with the given file descriptor has closed. The socket
+  //that was using it is marked as unresponsive right away, instead of
+  //waiting for it to miss heartbeats. If the socket reconnects and sends
+  //a message it becomes responsive again.
+  void connectionClosed( int fd );
+
   //returns true if a socket is fully dead, and not mostly-dead
   bool isDead( const zmq::SocketIdentity& socket ) const;
 
@@ -71,6 +104,21 @@ public:
   //and we should expect sockets to come back.
   bool isUnresponsive( const zmq::SocketIdentity& socket ) const;
 
+  //returns every socket whose liveness changed since the last call.
+  //Heartbeat deadlines are tracked with a timing wheel on a monotonic
+  //clock, so the cost of this call is proportional to the number of
+  //sockets that have changed, not the number of sockets being monitored.
+  LivenessChanges livenessChanges();
+
+  //returns true if a call to livenessChanges can return any socket, either
+  //because we have a heartbeat deadline pending or changes to report.
+  bool hasPendingChanges() const;
+
+  //returns the time at which a call to livenessChanges can next return a
+  //socket, or -1 if it can't until a socket changes. Times are
+  //milliseconds on the clock of TimingWheel::now
+  boost::int64_t nextChange() const;
+
 private:
   class WorkerTracker;
   boost::shared_ptr<WorkerTracker> Tracker;
@@ -0,0 +1,206 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/TimingWheel.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+//each level of the wheel has 2^slotBits slots
+const boost::int64_t slotBits = 8;
+const boost::int64_t slotMask = (boost::int64_t(1) << slotBits) - 1;
+const std::size_t numberOfLevels = 3;
+
+//the number of ticks a level and all the levels below it can hold
+inline boost::int64_t levelRange(std::size_t level)
+{ return boost::int64_t(1) << (slotBits * static_cast<boost::int64_t>(level+1)); }
+
+inline std::size_t slotIndex(boost::int64_t tick, std::size_t level)
+{
+  return static_cast<std::size_t>(
+    (tick >> (slotBits * static_cast<boost::int64_t>(level))) & slotMask);
+}
+}
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//------------------------------------------------------------------------------
+TimingWheel::TimingWheel(boost::int64_t tickInMilli):
+  TickInMilli( std::max(boost::int64_t(1), tickInMilli) ),
+  CurrentTick(0),
+  Levels(numberOfLevels, std::vector<Slot>(slotMask+1)),
+  Deadlines()
+{
+  this->CurrentTick = TimingWheel::now() / this->TickInMilli;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t TimingWheel::now()
+{
+  using namespace std::chrono;
+  return static_cast<boost::int64_t>(
+    duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+//------------------------------------------------------------------------------
+void TimingWheel::schedule(const zmq::SocketIdentity& socket,
+                           boost::int64_t deadline)
+{
+  this->cancel(socket);
+
+  //round the deadline up to the next tick, and make sure it lands in the
+  //future so that it is always seen by the next call to advance
+  Entry entry;
+  entry.DeadlineTick = std::max( this->toTick(deadline), this->CurrentTick+1 );
+  entry.Level = 0;
+  entry.SlotIndex = 0;
+
+  DeadlineMap::iterator item =
+    this->Deadlines.insert( DeadlineMap::value_type(socket,entry) ).first;
+  this->place(item->first, item->second);
+}
+
+//------------------------------------------------------------------------------
+bool TimingWheel::cancel(const zmq::SocketIdentity& socket)
+{
+  DeadlineMap::iterator item = this->Deadlines.find(socket);
+  if(item == this->Deadlines.end())
+    {
+    return false;
+    }
+
+  const Entry& entry = item->second;
+  this->Levels[entry.Level][entry.SlotIndex].erase(entry.Position);
+  this->Deadlines.erase(item);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool TimingWheel::contains(const zmq::SocketIdentity& socket) const
+{
+  return this->Deadlines.count(socket) > 0;
+}
+
+//------------------------------------------------------------------------------
+std::vector<zmq::SocketIdentity> TimingWheel::advance(boost::int64_t currentTime)
+{
+  std::vector<zmq::SocketIdentity> expired;
+  const boost::int64_t targetTick = currentTime / this->TickInMilli;
+
+  while(this->CurrentTick < targetTick)
+    {
+    if(this->Deadlines.empty())
+      { //nothing can expire, so skip right to the target
+      this->CurrentTick = targetTick;
+      break;
+      }
+
+    ++this->CurrentTick;
+
+    //when the lower level wraps around, move the next slot of the level
+    //above down, starting with the highest level that wrapped
+    if(slotIndex(this->CurrentTick, 0) == 0)
+      {
+      if(slotIndex(this->CurrentTick, 1) == 0)
+        {
+        this->cascade(2);
+        }
+      this->cascade(1);
+      }
+
+    Slot& slot = this->Levels[0][slotIndex(this->CurrentTick, 0)];
+    for(Slot::const_iterator i = slot.begin(); i != slot.end(); ++i)
+      {
+      expired.push_back(*i);
+      this->Deadlines.erase(*i);
+      }
+    slot.clear();
+    }
+  return expired;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t TimingWheel::nextDeadline() const
+{
+  if(this->Deadlines.empty())
+    {
+    return -1;
+    }
+
+  //look at the slots of each level in the order they come due, the first
+  //occupied slot bounds every deadline of that level and the ones above
+  for(std::size_t level=0; level < numberOfLevels; ++level)
+    {
+    const boost::int64_t shift = slotBits * static_cast<boost::int64_t>(level);
+    const boost::int64_t base = this->CurrentTick >> shift;
+    for(boost::int64_t i=1; i <= slotMask+1; ++i)
+      {
+      const std::size_t index = slotIndex((base + i) << shift, level);
+      if(!this->Levels[level][index].empty())
+        {
+        return ((base + i) << shift) * this->TickInMilli;
+        }
+      }
+    }
+  return this->CurrentTick * this->TickInMilli;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t TimingWheel::toTick(boost::int64_t time) const
+{
+  return (time + this->TickInMilli - 1) / this->TickInMilli;
+}
+
+//------------------------------------------------------------------------------
+void TimingWheel::place(const zmq::SocketIdentity& socket, Entry& entry)
+{
+  const boost::int64_t delta = entry.DeadlineTick - this->CurrentTick;
+
+  std::size_t level = 0;
+  while(level < numberOfLevels && delta >= levelRange(level))
+    {
+    ++level;
+    }
+
+  boost::int64_t tick = entry.DeadlineTick;
+  if(level == numberOfLevels)
+    { //the deadline is beyond what the wheel can hold, so park it in the
+      //last slot of the top level, it will be placed again once it cascades
+    level = numberOfLevels - 1;
+    tick = this->CurrentTick + levelRange(level) - 1;
+    }
+
+  entry.Level = level;
+  entry.SlotIndex = slotIndex(tick, level);
+  Slot& slot = this->Levels[level][entry.SlotIndex];
+  entry.Position = slot.insert(slot.end(), socket);
+}
+
+//------------------------------------------------------------------------------
+void TimingWheel::cascade(std::size_t level)
+{
+  Slot moving;
+  moving.swap( this->Levels[level][slotIndex(this->CurrentTick, level)] );
+  for(Slot::const_iterator i = moving.begin(); i != moving.end(); ++i)
+    {
+    DeadlineMap::iterator item = this->Deadlines.find(*i);
+    this->place(item->first, item->second);
+    }
+}
+
+}
+}
+}
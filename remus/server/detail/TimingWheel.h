@@ -0,0 +1,104 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_TimingWheel_h
+#define remus_server_detail_TimingWheel_h
+
+#include <remus/common/CompilerInformation.h>
+#include <remus/proto/zmqSocketIdentity.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <list>
+#include <map>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//A hierarchical timing wheel that tracks a single deadline per socket.
+//
+//Deadlines are bucketed by tick into three levels of 256 slots, each level
+//covering 256 times the range of the level below it. Scheduling and
+//cancelling a deadline is constant time apart from the socket lookup, and
+//advancing the wheel only touches the slots that have come due, so the
+//cost of finding expired sockets is proportional to the number of
+//expirations and not to the number of sockets being tracked.
+//
+//All times are milliseconds on a monotonic clock, see TimingWheel::now.
+class TimingWheel
+{
+public:
+  //construct a wheel with the given tick resolution in milliseconds.
+  //Deadlines are rounded up to the next tick, so a socket never expires
+  //before its deadline, but can expire up to one tick after it.
+  explicit TimingWheel(boost::int64_t tickInMilli = 10);
+
+  //the current time in milliseconds on a monotonic clock. Unlike wall clock
+  //time this is unaffected by changes to the system time.
+  static boost::int64_t now();
+
+  //schedule the deadline of a socket, replacing any existing deadline
+  void schedule(const zmq::SocketIdentity& socket, boost::int64_t deadline);
+
+  //remove the deadline of a socket, returns false if the socket had none
+  bool cancel(const zmq::SocketIdentity& socket);
+
+  //returns true if the socket has a deadline scheduled
+  bool contains(const zmq::SocketIdentity& socket) const;
+
+  //the number of sockets with a deadline scheduled
+  std::size_t size() const { return this->Deadlines.size(); }
+  bool empty() const { return this->Deadlines.empty(); }
+
+  //advance the wheel to the given time, returning every socket whose
+  //deadline is at or before that time. Returned sockets are no longer
+  //scheduled.
+  std::vector<zmq::SocketIdentity> advance(boost::int64_t currentTime);
+
+  //the time at which advance next has work to do, or -1 when nothing is
+  //scheduled. Deadlines in the lowest level are exact, deadlines in the
+  //higher levels report the time their slot cascades down, so the returned
+  //time is never later than the earliest deadline.
+  boost::int64_t nextDeadline() const;
+
+private:
+  typedef std::list<zmq::SocketIdentity> Slot;
+
+  struct Entry
+  {
+    boost::int64_t DeadlineTick;
+    std::size_t Level;
+    std::size_t SlotIndex;
+    Slot::iterator Position;
+  };
+
+  typedef std::map<zmq::SocketIdentity, Entry> DeadlineMap;
+
+  boost::int64_t toTick(boost::int64_t time) const;
+  void place(const zmq::SocketIdentity& socket, Entry& entry);
+  void cascade(std::size_t level);
+
+  boost::int64_t TickInMilli;
+  boost::int64_t CurrentTick;
+  std::vector< std::vector<Slot> > Levels;
+  DeadlineMap Deadlines;
+};
+
+}
+}
+}
+
+#endif
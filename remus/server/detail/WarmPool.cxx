@@ -0,0 +1,136 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/WarmPool.h>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//------------------------------------------------------------------------------
+WarmPool::WarmPool():
+  Launches(),
+  Registered()
+{
+}
+
+//------------------------------------------------------------------------------
+void WarmPool::launched(const remus::proto::JobRequirements& reqs,
+                        boost::int64_t now)
+{
+  this->Launches[reqs].push_back(now);
+}
+
+//------------------------------------------------------------------------------
+bool WarmPool::registered(const zmq::SocketIdentity& worker,
+                          const remus::proto::JobRequirements& reqs)
+{
+  LaunchMap::iterator item = this->Launches.find(reqs);
+  if(item == this->Launches.end() || this->Registered.count(worker) > 0)
+    {
+    return false;
+    }
+
+  //workers start in roughly the order they are launched, so the oldest
+  //launch is the one that has registered
+  this->Registered[worker] = std::make_pair(reqs, item->second.front());
+  item->second.pop_front();
+  if(item->second.empty())
+    {
+    this->Launches.erase(item);
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool WarmPool::ready(const zmq::SocketIdentity& worker)
+{
+  return this->Registered.erase(worker) > 0;
+}
+
+//------------------------------------------------------------------------------
+std::size_t WarmPool::starting(const remus::proto::JobRequirements& reqs,
+                               boost::int64_t now, boost::int64_t timeout)
+{
+  std::size_t count = 0;
+
+  LaunchMap::iterator item = this->Launches.find(reqs);
+  if(item != this->Launches.end())
+    {
+    std::deque<boost::int64_t>& launches = item->second;
+    while(!launches.empty() && launches.front() + timeout < now)
+      {
+      launches.pop_front();
+      }
+
+    count += launches.size();
+    if(launches.empty())
+      {
+      this->Launches.erase(item);
+      }
+    }
+
+  RegisteredMap::iterator i = this->Registered.begin();
+  while(i != this->Registered.end())
+    {
+    if(i->second.second + timeout < now)
+      {
+      this->Registered.erase(i++);
+      }
+    else
+      {
+      count += (i->second.first == reqs) ? 1 : 0;
+      ++i;
+      }
+    }
+  return count;
+}
+
+//------------------------------------------------------------------------------
+std::size_t WarmPool::size() const
+{
+  std::size_t count = this->Registered.size();
+  for(LaunchMap::const_iterator i = this->Launches.begin();
+      i != this->Launches.end(); ++i)
+    {
+    count += i->second.size();
+    }
+  return count;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t WarmPool::oldestLaunch() const
+{
+  //launches are recorded in order, so the front of each is the oldest
+  boost::int64_t oldest = -1;
+  for(LaunchMap::const_iterator i = this->Launches.begin();
+      i != this->Launches.end(); ++i)
+    {
+    if(oldest < 0 || i->second.front() < oldest)
+      {
+      oldest = i->second.front();
+      }
+    }
+  for(RegisteredMap::const_iterator i = this->Registered.begin();
+      i != this->Registered.end(); ++i)
+    {
+    if(oldest < 0 || i->second.second < oldest)
+      {
+      oldest = i->second.second;
+      }
+    }
+  return oldest;
+}
+
+}
+}
+}
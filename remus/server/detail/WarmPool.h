@@ -0,0 +1,90 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_WarmPool_h
+#define remus_server_detail_WarmPool_h
+
+#include <remus/common/CompilerInformation.h>
+#include <remus/proto/JobRequirements.h>
+#include <remus/proto/zmqSocketIdentity.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <deque>
+#include <map>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//Tracks the workers the server has launched to keep the minimum number of
+//idle workers warm, from the moment they are launched until they first
+//ask for a job. A launched worker is first only known by its requirements,
+//once it registers we know its identity, so that only its first request
+//for a job marks it as started. Once a worker asks for a job it is counted
+//as waiting by the WorkerPool, so between the two the server knows how many
+//idle workers it has for each set of requirements without launching
+//duplicates while workers are still starting up.
+//
+//All times are milliseconds on a monotonic clock, see TimingWheel::now.
+class WarmPool
+{
+public:
+  WarmPool();
+
+  //record that a worker with the given requirements was launched
+  void launched(const remus::proto::JobRequirements& reqs, boost::int64_t now);
+
+  //record that a worker with the given requirements has registered with
+  //the given identity. Returns false if no worker with the requirements
+  //was launched
+  bool registered(const zmq::SocketIdentity& worker,
+                  const remus::proto::JobRequirements& reqs);
+
+  //record that a worker has asked for a job, so it is no longer starting.
+  //Returns false if the worker wasn't starting
+  bool ready(const zmq::SocketIdentity& worker);
+
+  //the number of workers with the given requirements that are still
+  //starting. Workers launched more than timeout milliseconds ago are
+  //assumed to have failed to start and are forgotten
+  std::size_t starting(const remus::proto::JobRequirements& reqs,
+                       boost::int64_t now, boost::int64_t timeout);
+
+  //the number of workers that are still starting across all requirements
+  std::size_t size() const;
+
+  //the time the oldest worker that is still starting was launched, or -1
+  //if no worker is starting. Adding the start timeout gives the next time
+  //starting forgets a worker
+  boost::int64_t oldestLaunch() const;
+
+  //forget about all workers that are starting
+  void clear() { this->Launches.clear(); this->Registered.clear(); }
+
+private:
+  typedef std::map<remus::proto::JobRequirements,
+                   std::deque<boost::int64_t> > LaunchMap;
+  typedef std::map<zmq::SocketIdentity,
+                   std::pair<remus::proto::JobRequirements, boost::int64_t> >
+                   RegisteredMap;
+  LaunchMap Launches;
+  RegisteredMap Registered;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,401 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/WorkerCatalog.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/algorithm/string/case_conv.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+#include <set>
+
+#ifdef __linux__
+# include <sys/inotify.h>
+# include <unistd.h>
+# include <cerrno>
+#endif
+
+namespace
+{
+#ifdef __linux__
+//the changes to a directory that can add, change or remove a worker file.
+//A file that is still being written when it is created fails to parse or
+//is incomplete, and is loaded again once it is closed after writing
+const boost::uint32_t WatchedEvents = IN_CLOSE_WRITE | IN_MOVED_TO |
+                                      IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+#endif
+
+//----------------------------------------------------------------------------
+std::time_t modified_time(const boost::filesystem::path& file)
+{
+  boost::system::error_code ec;
+  const std::time_t t = boost::filesystem::last_write_time(file, ec);
+  return ec ? std::time_t(0) : t;
+}
+}
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//----------------------------------------------------------------------------
+WorkerCatalog::WorkerCatalog(const FactoryFileParserPtr& parser,
+                             const std::string& ext):
+  FileExt( boost::algorithm::to_upper_copy(ext) ),
+  Parser(parser),
+  Descriptor(-1),
+  RescanInterval(2000),
+  SinceRescan(),
+  Directories(),
+  Watches(),
+  Files(),
+  ByRequirements(),
+  ByMeshIOType()
+{
+#ifdef __linux__
+  this->Descriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+//----------------------------------------------------------------------------
+WorkerCatalog::~WorkerCatalog()
+{
+#ifdef __linux__
+  if(this->Descriptor >= 0)
+    {
+    ::close(this->Descriptor);
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void WorkerCatalog::addDirectory(const boost::filesystem::path& path)
+{
+  boost::system::error_code ec;
+  const boost::filesystem::path dir = boost::filesystem::canonical(path, ec);
+  if(ec || !boost::filesystem::is_directory(dir) ||
+     std::find(this->Directories.begin(), this->Directories.end(), dir) !=
+       this->Directories.end())
+    {
+    return;
+    }
+  this->Directories.push_back(dir);
+
+#ifdef __linux__
+  //start watching before reading the directory, so that nothing written
+  //in between is missed
+  if(this->Descriptor >= 0)
+    {
+    const int wd = ::inotify_add_watch(this->Descriptor, dir.c_str(),
+                                       WatchedEvents);
+    if(wd >= 0)
+      {
+      this->Watches[wd] = dir;
+      }
+    }
+#endif
+
+  bool changed = false;
+  boost::filesystem::directory_iterator end_itr;
+  for(boost::filesystem::directory_iterator i(dir, ec); !ec && i != end_itr;
+      i.increment(ec))
+    {
+    if(this->isWorkerFile(i->path()))
+      {
+      changed |= this->loadFile(i->path());
+      }
+    }
+  if(changed)
+    {
+    this->reindex();
+    }
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::refresh()
+{
+  if(this->watching())
+    {
+    return this->readChanges();
+    }
+  if(this->SinceRescan.elapsed() >= this->RescanInterval)
+    {
+    return this->rescan();
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+const FactoryWorkerSpecification* WorkerCatalog::find(
+                            const remus::proto::JobRequirements& reqs) const
+{
+  typedef boost::unordered_map< remus::proto::JobRequirements, std::size_t,
+                                JobRequirementsHash >::const_iterator Iter;
+  Iter i = this->ByRequirements.find(reqs);
+  return (i != this->ByRequirements.end()) ? &(this->Files[i->second].Spec)
+                                           : NULL;
+}
+
+//----------------------------------------------------------------------------
+remus::proto::JobRequirementsSet WorkerCatalog::requirements(
+                                const remus::common::MeshIOType& type) const
+{
+  typedef boost::unordered_map< remus::common::MeshIOType,
+                                remus::proto::JobRequirementsSet,
+                                MeshIOTypeHash >::const_iterator Iter;
+  Iter i = this->ByMeshIOType.find(type);
+  return (i != this->ByMeshIOType.end()) ? i->second
+                                         : remus::proto::JobRequirementsSet();
+}
+
+//----------------------------------------------------------------------------
+remus::common::MeshIOTypeSet WorkerCatalog::ioTypes() const
+{
+  typedef boost::unordered_map< remus::common::MeshIOType,
+                                remus::proto::JobRequirementsSet,
+                                MeshIOTypeHash >::const_iterator Iter;
+  remus::common::MeshIOTypeSet types;
+  for(Iter i = this->ByMeshIOType.begin(); i != this->ByMeshIOType.end(); ++i)
+    {
+    types.insert(i->first);
+    }
+  return types;
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::isWorkerFile(const boost::filesystem::path& file) const
+{
+  return file.has_extension() &&
+         boost::algorithm::to_upper_copy(file.extension().string()) ==
+           this->FileExt;
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::readChanges()
+{
+#ifdef __linux__
+  std::set< boost::filesystem::path > changedFiles;
+  bool overflowed = false;
+
+  //events are variable length, so read into a buffer aligned for them
+  union
+  {
+    struct inotify_event event;
+    char bytes[16 * 1024];
+  } buffer;
+
+  while(true)
+    {
+    const ssize_t length = ::read(this->Descriptor, buffer.bytes,
+                                  sizeof(buffer.bytes));
+    if(length < 0 && errno == EINTR)
+      {
+      continue;
+      }
+    if(length <= 0)
+      { //EAGAIN, no more events
+      break;
+      }
+
+    for(ssize_t offset = 0; offset < length; )
+      {
+      const struct inotify_event* event =
+        reinterpret_cast<const struct inotify_event*>(buffer.bytes + offset);
+      offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+      if(event->mask & IN_Q_OVERFLOW)
+        {
+        overflowed = true;
+        continue;
+        }
+
+      std::map< int, boost::filesystem::path >::iterator dir =
+        this->Watches.find(event->wd);
+      if(dir == this->Watches.end())
+        {
+        continue;
+        }
+      if(event->mask & IN_IGNORED)
+        { //the directory was removed, which the rescan below cleans up after
+        this->Watches.erase(dir);
+        overflowed = true;
+        continue;
+        }
+      if(event->len > 0)
+        {
+        const boost::filesystem::path file = dir->second / event->name;
+        if(this->isWorkerFile(file))
+          {
+          changedFiles.insert(file);
+          }
+        }
+      }
+    }
+
+  if(overflowed)
+    { //we lost track of what changed, so look at everything
+    return this->rescan();
+    }
+
+  bool changed = false;
+  for(std::set< boost::filesystem::path >::const_iterator i =
+        changedFiles.begin(); i != changedFiles.end(); ++i)
+    {
+    if(boost::filesystem::is_regular_file(*i))
+      {
+      changed |= this->loadFile(*i);
+      }
+    else
+      {
+      changed |= this->removeFile(*i);
+      }
+    }
+  if(changed)
+    {
+    this->reindex();
+    }
+  return changed;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::rescan()
+{
+  this->SinceRescan.reset();
+
+  bool changed = false;
+  std::set< boost::filesystem::path > found;
+  for(std::vector< boost::filesystem::path >::const_iterator d =
+        this->Directories.begin(); d != this->Directories.end(); ++d)
+    {
+    boost::system::error_code ec;
+    boost::filesystem::directory_iterator end_itr;
+    for(boost::filesystem::directory_iterator i(*d, ec);
+        !ec && i != end_itr; i.increment(ec))
+      {
+      const boost::filesystem::path& file = i->path();
+      if(!this->isWorkerFile(file) ||
+         !boost::filesystem::is_regular_file(file))
+        {
+        continue;
+        }
+      found.insert(file);
+
+      //only parse the files that are new or have been modified
+      const std::time_t modified = modified_time(file);
+      bool known = false;
+      for(std::vector< WorkerFile >::const_iterator f = this->Files.begin();
+          f != this->Files.end() && !known; ++f)
+        {
+        known = (f->Path == file && f->Modified == modified);
+        }
+      if(!known)
+        {
+        changed |= this->loadFile(file);
+        }
+      }
+    }
+
+  //remove the files that no longer exist
+  std::vector< boost::filesystem::path > removed;
+  for(std::vector< WorkerFile >::const_iterator f = this->Files.begin();
+      f != this->Files.end(); ++f)
+    {
+    if(found.count(f->Path) == 0)
+      {
+      removed.push_back(f->Path);
+      }
+    }
+  for(std::vector< boost::filesystem::path >::const_iterator i =
+        removed.begin(); i != removed.end(); ++i)
+    {
+    changed |= this->removeFile(*i);
+    }
+
+  if(changed)
+    {
+    this->reindex();
+    }
+  return changed;
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::loadFile(const boost::filesystem::path& file)
+{
+  WorkerFile info;
+  info.Path = file;
+  info.Modified = modified_time(file);
+  try
+    {
+    info.Spec = (*this->Parser)(file);
+    }
+  catch(boost::filesystem::filesystem_error&)
+    { //the file was removed while we read it, the removal will follow
+    info.Spec = FactoryWorkerSpecification();
+    }
+
+  //a changed file keeps its place, so it keeps its priority over other
+  //files with the same requirements
+  for(std::vector< WorkerFile >::iterator f = this->Files.begin();
+      f != this->Files.end(); ++f)
+    {
+    if(f->Path == file)
+      {
+      const bool wasValid = f->Spec.isValid;
+      *f = info;
+      return wasValid || info.Spec.isValid;
+      }
+    }
+  this->Files.push_back(info);
+  return info.Spec.isValid;
+}
+
+//----------------------------------------------------------------------------
+bool WorkerCatalog::removeFile(const boost::filesystem::path& file)
+{
+  for(std::vector< WorkerFile >::iterator f = this->Files.begin();
+      f != this->Files.end(); ++f)
+    {
+    if(f->Path == file)
+      {
+      const bool wasValid = f->Spec.isValid;
+      this->Files.erase(f);
+      return wasValid;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void WorkerCatalog::reindex()
+{
+  //worker files change rarely, so the indices are rebuilt from scratch
+  this->ByRequirements.clear();
+  this->ByMeshIOType.clear();
+  for(std::size_t i=0; i < this->Files.size(); ++i)
+    {
+    const FactoryWorkerSpecification& spec = this->Files[i].Spec;
+    if(spec.isValid && this->ByRequirements.insert(
+                         std::make_pair(spec.Requirements, i)).second)
+      {
+      this->ByMeshIOType[spec.Requirements.meshTypes()].insert(
+                                                          spec.Requirements);
+      }
+    }
+}
+
+}
+}
+}
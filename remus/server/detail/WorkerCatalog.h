@@ -0,0 +1,171 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_WorkerCatalog_h
+#define remus_server_detail_WorkerCatalog_h
+
+#include <remus/common/CompilerInformation.h>
+#include <remus/common/MeshIOType.h>
+#include <remus/common/Timer.h>
+#include <remus/proto/JobRequirements.h>
+#include <remus/server/FactoryFileParser.h>
+#include <remus/server/FactoryWorkerSpecification.h>
+
+//force to use filesystem version 3
+REMUS_THIRDPARTY_PRE_INCLUDE
+#define BOOST_FILESYSTEM_VERSION 3
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//hashes the same parts of a MeshIOType and JobRequirements that their
+//equal operators compare
+struct MeshIOTypeHash
+{
+  std::size_t operator()(const remus::common::MeshIOType& type) const
+  {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, type.inputType());
+    boost::hash_combine(seed, type.outputType());
+    return seed;
+  }
+};
+
+struct JobRequirementsHash
+{
+  std::size_t operator()(const remus::proto::JobRequirements& reqs) const
+  {
+    std::size_t seed = MeshIOTypeHash()(reqs.meshTypes());
+    boost::hash_combine(seed, static_cast<int>(reqs.sourceType()));
+    boost::hash_combine(seed, static_cast<int>(reqs.formatType()));
+    boost::hash_combine(seed, reqs.workerName());
+    boost::hash_combine(seed, reqs.tag());
+    return seed;
+  }
+};
+
+//Helper class that is used by the WorkerFactory to locate, parse and keep
+//track of worker files.
+//
+//The catalog loads every file with the worker extension in the directories
+//it is given, and indexes the specifications by requirements and by
+//MeshIOType, so that looking up a worker doesn't depend on the number of
+//worker files.
+//
+//Worker files that are added, changed or removed after they are loaded are
+//picked up by refresh, which lets new worker versions be deployed without
+//restarting the server. On Linux the directories are watched with inotify
+//and refresh only reads the changes, elsewhere refresh rescans the
+//directories once the rescan interval has passed.
+class WorkerCatalog
+{
+  typedef boost::shared_ptr< remus::server::FactoryFileParser > FactoryFileParserPtr;
+public:
+  WorkerCatalog(const FactoryFileParserPtr& parser,
+                const std::string& ext);
+  ~WorkerCatalog();
+
+  //returns true if the directories are watched for changes, instead of
+  //being rescanned
+  bool watching() const { return this->Descriptor >= 0; }
+
+  //the descriptor that is readable while a worker file has changed,
+  //or -1 when not watching
+  int descriptor() const { return this->Descriptor; }
+
+  //the minimum time in milliseconds between rescans of the directories
+  //when they can't be watched. Defaults to 2000.
+  void rescanInterval(boost::int64_t millisec)
+    { this->RescanInterval = millisec; }
+
+  //load all worker files in the directory, and follow changes to them.
+  //Adding a directory a second time does nothing.
+  void addDirectory(const boost::filesystem::path& dir);
+
+  //apply the changes to the worker files since the last refresh. Returns
+  //true if any worker file was added, changed or removed. Doesn't block.
+  bool refresh();
+
+  //the specification of the worker with the given requirements, or NULL
+  //if we have none. When multiple files have the same requirements the
+  //one loaded first is used. The pointer is only valid until the next
+  //refresh.
+  const FactoryWorkerSpecification* find(
+                          const remus::proto::JobRequirements& reqs) const;
+
+  //all the requirements of workers with the given MeshIOType
+  remus::proto::JobRequirementsSet requirements(
+                          const remus::common::MeshIOType& type) const;
+
+  //all the MeshIOTypes we have workers for
+  remus::common::MeshIOTypeSet ioTypes() const;
+
+  //the number of valid worker files
+  std::size_t size() const { return this->ByRequirements.size(); }
+
+private:
+  WorkerCatalog(const WorkerCatalog&);
+  void operator=(const WorkerCatalog&);
+
+  struct WorkerFile
+  {
+    boost::filesystem::path Path;
+    std::time_t Modified;
+    FactoryWorkerSpecification Spec;
+  };
+
+  bool isWorkerFile(const boost::filesystem::path& file) const;
+  bool readChanges();
+  bool rescan();
+  bool loadFile(const boost::filesystem::path& file);
+  bool removeFile(const boost::filesystem::path& file);
+  void reindex();
+
+  const std::string FileExt;
+  FactoryFileParserPtr Parser;
+  int Descriptor;
+  boost::int64_t RescanInterval;
+  remus::common::Timer SinceRescan;
+
+  std::vector< boost::filesystem::path > Directories;
+  //maps inotify watch descriptors to the directory they watch
+  std::map< int, boost::filesystem::path > Watches;
+
+  //every worker file we have seen, including the ones that failed to
+  //parse so that rescans don't keep parsing them, in load order
+  std::vector< WorkerFile > Files;
+
+  //indices into Files
+  boost::unordered_map< remus::proto::JobRequirements, std::size_t,
+                        JobRequirementsHash > ByRequirements;
+  boost::unordered_map< remus::common::MeshIOType,
+                        remus::proto::JobRequirementsSet,
+                        MeshIOTypeHash > ByMeshIOType;
+};
+
+}
+}
+}
+
+#endif
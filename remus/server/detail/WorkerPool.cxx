@@ -12,6 +12,7 @@
 
 #include <remus/server/detail/WorkerPool.h>
 
+#include <remus/server/detail/TimingWheel.h>
 #include <remus/server/detail/uuidHelper.h>
 #include <remus/proto/zmqSocketIdentity.h>
 
@@ -25,9 +26,11 @@ namespace detail{
 WorkerPool::WorkerInfo::WorkerInfo(const zmq::SocketIdentity& address,
                                    const remus::proto::JobRequirements& reqs):
   NumberOfDesiredJobs(0),
+  NumberOfSlots(1),
   Reqs(reqs),
   Address(address),
-  IsResponsive(true)
+  IsResponsive(true),
+  LastActive(TimingWheel::now())
 {
 }
 
@@ -86,6 +89,21 @@ bool WorkerPool::haveWaitingWorker(
   return found;
 }
 
+//------------------------------------------------------------------------------
+std::size_t WorkerPool::numberOfWaitingWorkers(
+                           const remus::proto::JobRequirements& reqs) const
+{
+  std::size_t count = 0;
+  for(ConstIt i=this->Pool.begin(); i != this->Pool.end(); ++i)
+    {
+    if( i->Reqs == reqs && i->isWaitingForWork() )
+      {
+      ++count;
+      }
+    }
+  return count;
+}
+
 //------------------------------------------------------------------------------
 bool WorkerPool::haveWorker(const zmq::SocketIdentity& address,
                             const remus::proto::JobRequirements& reqs) const
@@ -100,7 +118,8 @@ bool WorkerPool::haveWorker(const zmq::SocketIdentity& address,
 
 //------------------------------------------------------------------------------
 bool WorkerPool::readyForWork(const zmq::SocketIdentity& address,
-                              const remus::proto::JobRequirements& reqs)
+                              const remus::proto::JobRequirements& reqs,
+                              unsigned int numberOfJobs)
 {
   //a worker can be registered multiple times, we need to iterate
   //over the entire vector and find the correct address and reqs that match
@@ -113,7 +132,8 @@ bool WorkerPool::readyForWork(const zmq::SocketIdentity& address,
     if(i->Address == address && i->Reqs == reqs)
       {
       i->IsResponsive = true; //mark the worker as responsive
-      i->addJob();
+      i->addJobs(numberOfJobs);
+      i->LastActive = TimingWheel::now();
       ++count;
       }
     }
@@ -124,6 +144,15 @@ bool WorkerPool::readyForWork(const zmq::SocketIdentity& address,
 //------------------------------------------------------------------------------
 zmq::SocketIdentity WorkerPool::takeWorker(
                              const remus::proto::JobRequirements& reqs)
+{
+  std::size_t numberOfJobs = 1;
+  return this->takeWorker(reqs, numberOfJobs);
+}
+
+//------------------------------------------------------------------------------
+zmq::SocketIdentity WorkerPool::takeWorker(
+                             const remus::proto::JobRequirements& reqs,
+                             std::size_t& numberOfJobs)
 {
   bool found = false;
   It i;
@@ -141,17 +170,79 @@ zmq::SocketIdentity WorkerPool::takeWorker(
 
     //take the worker id as it matches the reqs
     workerIdentity = zmq::SocketIdentity(i->Address);
-    i->takesJob();
+    numberOfJobs = i->takesJobs(numberOfJobs);
+    i->LastActive = TimingWheel::now();
 
     //now that the worker has taken the job, we move him to the back of
     //the vector so he is the last worker to take a job of that type again,
     //this allows us to handle multiple workers taking jobs
     std::rotate(this->Pool.begin(), this->Pool.begin() + 1,this->Pool.end());
     }
+  else
+    {
+    numberOfJobs = 0;
+    }
 
   return workerIdentity;
 }
 
+//------------------------------------------------------------------------------
+void WorkerPool::numberOfSlots(const zmq::SocketIdentity& address,
+                               unsigned int slots)
+{
+  for(It i=this->Pool.begin(); i != this->Pool.end(); ++i)
+    {
+    if(i->Address == address)
+      {
+      i->NumberOfSlots = slots;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+std::map<remus::proto::JobRequirements, std::vector<zmq::SocketIdentity> >
+WorkerPool::idleWorkers(boost::int64_t idleSince,
+                        const std::set<zmq::SocketIdentity>& busy) const
+{
+  std::map<remus::proto::JobRequirements,
+           std::vector<zmq::SocketIdentity> > idle;
+  for(ConstIt i=this->Pool.begin(); i != this->Pool.end(); ++i)
+    {
+    if(i->isWaitingForWork() && i->NumberOfSlots == 1 &&
+       i->LastActive <= idleSince && busy.count(i->Address) == 0)
+      {
+      idle[i->Reqs].push_back(i->Address);
+      }
+    }
+  return idle;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t WorkerPool::nextActiveAfter(boost::int64_t idleSince) const
+{
+  boost::int64_t next = -1;
+  for(ConstIt i=this->Pool.begin(); i != this->Pool.end(); ++i)
+    {
+    if(i->isWaitingForWork() && i->NumberOfSlots == 1 &&
+       i->LastActive > idleSince && (next < 0 || i->LastActive < next))
+      {
+      next = i->LastActive;
+      }
+    }
+  return next;
+}
+
+//------------------------------------------------------------------------------
+bool WorkerPool::removeWorker(const zmq::SocketIdentity& address)
+{
+  const std::set<zmq::SocketIdentity> addresses(&address, &address + 1);
+  const std::size_t size = this->Pool.size();
+  this->Pool.erase(std::remove_if(this->Pool.begin(), this->Pool.end(),
+                                  InSet(addresses)),
+                   this->Pool.end());
+  return this->Pool.size() != size;
+}
+
 //------------------------------------------------------------------------------
 void WorkerPool::purgeDeadWorkers(remus::server::detail::SocketMonitor monitor)
 {
@@ -171,6 +262,35 @@ void WorkerPool::purgeDeadWorkers(remus::server::detail::SocketMonitor monitor)
   this->Pool.erase(newEnd,this->Pool.end());
 }
 
+//------------------------------------------------------------------------------
+void WorkerPool::updateWorkers(
+    const remus::server::detail::SocketMonitor::LivenessChanges& changes)
+{
+  if(changes.empty())
+    {
+    return;
+    }
+
+  const std::set<zmq::SocketIdentity> dead(changes.Dead.begin(),
+                                           changes.Dead.end());
+  const std::set<zmq::SocketIdentity> responsive(changes.Responsive.begin(),
+                                                 changes.Responsive.end());
+  const std::set<zmq::SocketIdentity> unresponsive(changes.Unresponsive.begin(),
+                                                   changes.Unresponsive.end());
+
+  It newEnd = std::remove_if(this->Pool.begin(),this->Pool.end(),InSet(dead));
+  for(It i=this->Pool.begin(); i != newEnd; ++i)
+    {
+    //a worker that came back and then missed another heartbeat ends up
+    //unresponsive, so unresponsive has to be applied last
+    if(responsive.count(i->Address) > 0)
+      { i->IsResponsive = true; }
+    if(unresponsive.count(i->Address) > 0)
+      { i->IsResponsive = false; }
+    }
+  this->Pool.erase(newEnd,this->Pool.end());
+}
+
 //------------------------------------------------------------------------------
 std::set<zmq::SocketIdentity> WorkerPool::allWorkers() const
 {
@@ -18,6 +18,12 @@
 
 #include <remus/server/detail/SocketMonitor.h>
 
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+#include <map>
 #include <set>
 #include <vector>
 
@@ -47,14 +53,18 @@ public:
   //do we have any worker waiting to take this type of job
   bool haveWaitingWorker(const remus::proto::JobRequirements& reqs) const;
 
+  //the number of workers waiting to take this type of job
+  std::size_t numberOfWaitingWorkers(const remus::proto::JobRequirements& reqs) const;
+
   //do we have a worker with this address?
   bool haveWorker(const zmq::SocketIdentity& address,
                   const remus::proto::JobRequirements& reqs) const;
 
-  //mark a worker with the given address ready to take a job.
+  //mark a worker with the given address ready to take numberOfJobs jobs.
   //returns false if a worker with that address wasn't found
   bool readyForWork(const zmq::SocketIdentity& address,
-                    const remus::proto::JobRequirements& reqs);
+                    const remus::proto::JobRequirements& reqs,
+                    unsigned int numberOfJobs = 1);
 
   //returns the worker address and marks that the worker has taken a job.
   //this doesn't remove the worker from the worker pool, it just decrements
@@ -62,9 +72,44 @@ public:
   //queue
   zmq::SocketIdentity takeWorker(const remus::proto::JobRequirements& reqs);
 
+  //returns the worker address and marks that the worker has taken up to
+  //numberOfJobs jobs. numberOfJobs is updated to the number of jobs the
+  //worker actually took, which is limited by how many jobs it has asked for
+  zmq::SocketIdentity takeWorker(const remus::proto::JobRequirements& reqs,
+                                 std::size_t& numberOfJobs);
+
+  //record how many jobs the worker with the given address processes at the
+  //same time, with zero meaning the address is shared by an unknown number
+  //of workers, such as a WorkerProxy. Workers process a single job at a
+  //time until told otherwise.
+  void numberOfSlots(const zmq::SocketIdentity& address, unsigned int slots);
+
+  //return the workers waiting for a job that haven't asked for or been
+  //given a job since idleSince, grouped by their requirements. Workers in
+  //busy are skipped, as they are still working on a job they were given.
+  //Only workers with a single slot are returned, since retiring a worker
+  //retires every slot of it.
+  //Times are milliseconds on the clock of TimingWheel::now
+  std::map<remus::proto::JobRequirements, std::vector<zmq::SocketIdentity> >
+  idleWorkers(boost::int64_t idleSince,
+              const std::set<zmq::SocketIdentity>& busy) const;
+
+  //return the earliest time after idleSince that a worker idleWorkers can
+  //return was last active, or -1 if there is none. Adding the idle timeout
+  //gives the next time a worker can become idle
+  boost::int64_t nextActiveAfter(boost::int64_t idleSince) const;
+
+  //remove the worker with the given address, returns false if we don't
+  //have a worker with that address
+  bool removeWorker(const zmq::SocketIdentity& address);
+
   //remove all workers that haven't responded based on the passed in monitor
   void purgeDeadWorkers(remus::server::detail::SocketMonitor monitor);
 
+  //remove the dead workers and update the responsiveness of the workers
+  //listed in changes. Does nothing when there are no changes.
+  void updateWorkers(const remus::server::detail::SocketMonitor::LivenessChanges& changes);
+
   //return the socket identity of all workers including workers that are
   //unresponsive
   std::set<zmq::SocketIdentity> allWorkers() const;
@@ -79,16 +124,25 @@ private:
   struct WorkerInfo
   {
     int NumberOfDesiredJobs;
+    unsigned int NumberOfSlots;
     remus::proto::JobRequirements Reqs;
     zmq::SocketIdentity Address;
     bool IsResponsive; //as in we are getting heartbeating from the worker
+    boost::int64_t LastActive; //when the worker last asked for or took a job
 
     WorkerInfo(const zmq::SocketIdentity& address,
                const remus::proto::JobRequirements& type);
 
     bool isWaitingForWork() const { return NumberOfDesiredJobs > 0 && IsResponsive; }
-    void addJob() { ++NumberOfDesiredJobs; }
+    void addJobs(unsigned int count) { NumberOfDesiredJobs += count; }
     void takesJob() { --NumberOfDesiredJobs; }
+    std::size_t takesJobs(std::size_t count)
+    {
+      const std::size_t taken = std::min(count,
+                              static_cast<std::size_t>(NumberOfDesiredJobs));
+      NumberOfDesiredJobs -= static_cast<int>(taken);
+      return taken;
+    }
   };
 
   struct DeadWorkers
@@ -101,6 +155,15 @@ private:
   };
 
 
+  struct InSet
+  {
+   const std::set<zmq::SocketIdentity>& Addresses;
+   InSet(const std::set<zmq::SocketIdentity>& addresses):
+     Addresses(addresses){}
+   inline bool operator()(const WorkerPool::WorkerInfo& worker)
+    { return Addresses.count(worker.Address) > 0; }
+  };
+
   typedef std::vector<WorkerInfo>::const_iterator ConstIt;
   typedef std::vector<WorkerInfo>::iterator It;
   std::vector<WorkerInfo> Pool;
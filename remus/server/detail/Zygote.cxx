@@ -0,0 +1,562 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/Zygote.h>
+
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <spawn.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <sys/wait.h>
+# include <time.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/syscall.h>
+//older C libraries don't know about pidfd_send_signal, the number is the
+//same on every architecture
+#  ifndef SYS_pidfd_send_signal
+#   define SYS_pidfd_send_signal 424
+#  endif
+# endif
+# ifdef __APPLE__
+#  include <crt_externs.h>
+#  define environ (*_NSGetEnviron())
+# else
+extern char **environ;
+# endif
+#endif
+
+#include <sstream>
+
+namespace
+{
+#ifndef _WIN32
+//The protocol spoken with remus::worker::runZygote, see remus/worker/Zygote.cxx
+const char* const ControlEnvName = "REMUS_ZYGOTE_FD";
+const char* const ReadyMessage = "R";
+const char ForkRequest[] = "F\n";
+
+//the descriptor of the zygote that the control socket is placed on
+const int ZygoteControlDescriptor = 0;
+
+//forking a pre-initialized process takes milliseconds, a zygote that
+//leaves a request unanswered for this long is considered hung
+const long long ForkTimeout = 5000;
+
+//the time we give a stopping zygote to answer the requests in flight, so
+//that the workers it forks for them aren't left running untracked
+const int StopTimeout = 250;
+
+//the most pidfds we accept with a single read of the control socket
+const std::size_t MaxDescriptorsPerRead = 16;
+
+//----------------------------------------------------------------------------
+//milliseconds on a monotonic clock, so deadlines survive changes to the
+//system time
+long long now_millisec()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+#if !defined(SOCK_CLOEXEC) || !defined(MSG_CMSG_CLOEXEC)
+//----------------------------------------------------------------------------
+void set_close_on_exec(int fd)
+{
+  const int flags = ::fcntl(fd, F_GETFD);
+  if(flags >= 0)
+    {
+    ::fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+}
+#endif
+
+//----------------------------------------------------------------------------
+//the environment of the server, with the given variables replaced or added
+std::vector<std::string> make_environment(
+                      const std::map<std::string,std::string>& environment)
+{
+  std::vector<std::string> result;
+  for(char** e = environ; e && *e; ++e)
+    {
+    const std::string entry(*e);
+    const std::string name = entry.substr(0, entry.find('='));
+    if(environment.count(name) == 0)
+      {
+      result.push_back(entry);
+      }
+    }
+  typedef std::map<std::string,std::string>::const_iterator EnvIt;
+  for(EnvIt i = environment.begin(); i != environment.end(); ++i)
+    {
+    result.push_back(i->first + "=" + i->second);
+    }
+  return result;
+}
+
+//----------------------------------------------------------------------------
+std::vector<char*> make_argv(std::vector<std::string>& strings)
+{
+  std::vector<char*> result;
+  for(std::size_t i=0; i < strings.size(); ++i)
+    {
+    result.push_back(&strings[i][0]);
+    }
+  result.push_back(NULL);
+  return result;
+}
+#endif
+}
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//----------------------------------------------------------------------------
+ForkedWorker::ForkedWorker():
+  State(Pending),
+  Pid(-1),
+  PidFd(-1),
+  KillWhenForked(false),
+  RequestTime(0)
+{
+#ifndef _WIN32
+  this->RequestTime = now_millisec();
+#endif
+}
+
+//----------------------------------------------------------------------------
+ForkedWorker::~ForkedWorker()
+{
+#ifndef _WIN32
+  if(this->PidFd >= 0)
+    {
+    ::close(this->PidFd);
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool ForkedWorker::isAlive() const
+{
+  if(this->State != Running)
+    {
+    return this->State == Pending;
+    }
+#ifndef _WIN32
+  //a pidfd becomes readable once the process has exited
+  struct pollfd item;
+  item.fd = this->PidFd;
+  item.events = POLLIN;
+  item.revents = 0;
+  int rc = 0;
+  do
+    {
+    rc = ::poll(&item, 1, 0);
+    } while(rc < 0 && errno == EINTR);
+  return rc == 0;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool ForkedWorker::kill()
+{
+  if(this->State == Pending)
+    {
+    this->KillWhenForked = true;
+    return true;
+    }
+#ifdef __linux__
+  return this->State == Running &&
+         ::syscall(SYS_pidfd_send_signal, this->PidFd, SIGKILL, NULL, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void ForkedWorker::forked(int pid, int pidfd)
+{
+  this->State = Running;
+  this->Pid = pid;
+  this->PidFd = pidfd;
+  if(this->KillWhenForked)
+    {
+    this->kill();
+    }
+}
+
+//----------------------------------------------------------------------------
+void ForkedWorker::failed()
+{
+  this->State = Failed;
+}
+
+//----------------------------------------------------------------------------
+Zygote::Zygote(const std::string& executable,
+               const std::vector<std::string>& arguments,
+               const std::map<std::string,std::string>& environment):
+  Executable(executable),
+  Arguments(arguments),
+  Environment(environment),
+  Pid(-1),
+  Control(-1),
+  Ready(false),
+  Buffer(),
+  Descriptors(),
+  Pending()
+{
+}
+
+//----------------------------------------------------------------------------
+Zygote::~Zygote()
+{
+  this->stop();
+}
+
+//----------------------------------------------------------------------------
+bool Zygote::start()
+{
+#ifndef _WIN32
+  this->stop();
+
+  int sockets[2];
+#ifdef SOCK_CLOEXEC
+  if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+    {
+    return false;
+    }
+#else
+  if(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    {
+    return false;
+    }
+  set_close_on_exec(sockets[0]);
+  set_close_on_exec(sockets[1]);
+#endif
+
+  std::vector<std::string> argStrings(1, this->Executable);
+  argStrings.insert(argStrings.end(),
+                    this->Arguments.begin(), this->Arguments.end());
+  std::vector<char*> argv = make_argv(argStrings);
+
+  std::map<std::string,std::string> environment(this->Environment);
+  std::ostringstream control;
+  control << ZygoteControlDescriptor;
+  environment[ControlEnvName] = control.str();
+  std::vector<std::string> envStrings = make_environment(environment);
+  std::vector<char*> envp = make_argv(envStrings);
+
+  //the duplicated descriptor doesn't inherit close on exec, so only the
+  //zygote gets the socket
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, sockets[1],
+                                   ZygoteControlDescriptor);
+
+  pid_t pid = -1;
+  const int result = ::posix_spawn(&pid, this->Executable.c_str(), &actions,
+                                   NULL, &argv[0], &envp[0]);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(sockets[1]);
+
+  if(result != 0)
+    {
+    ::close(sockets[0]);
+    return false;
+    }
+
+  this->Pid = static_cast<int>(pid);
+  this->Control = sockets[0];
+  return true;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Zygote::ready(int millisec)
+{
+  if(!this->Ready && this->Control >= 0)
+    {
+    std::string line;
+    if(this->readLine(line, millisec))
+      {
+      this->Ready = (line == ReadyMessage);
+      }
+    }
+  return this->Ready;
+}
+
+//----------------------------------------------------------------------------
+bool Zygote::isAlive()
+{
+#ifndef _WIN32
+  if(this->Pid <= 0)
+    {
+    return false;
+    }
+  if(::waitpid(static_cast<pid_t>(this->Pid), NULL, WNOHANG) == 0)
+    {
+    return true;
+    }
+  //the zygote exited, or was reaped by someone else
+  this->Pid = -1;
+  this->stop();
+  return false;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+Zygote::ForkedWorkerPtr Zygote::fork()
+{
+#ifndef _WIN32
+  if(!this->ready())
+    {
+    return ForkedWorkerPtr();
+    }
+
+  const std::size_t size = sizeof(ForkRequest) - 1;
+#ifdef MSG_NOSIGNAL
+  const ssize_t sent = ::send(this->Control, ForkRequest, size, MSG_NOSIGNAL);
+#else
+  const ssize_t sent = ::write(this->Control, ForkRequest, size);
+#endif
+  if(sent != static_cast<ssize_t>(size))
+    { //the zygote has gone away
+    this->disconnect();
+    return ForkedWorkerPtr();
+    }
+
+  ForkedWorkerPtr worker(new ForkedWorker());
+  this->Pending.push_back(worker);
+  return worker;
+#else
+  return ForkedWorkerPtr();
+#endif
+}
+
+//----------------------------------------------------------------------------
+void Zygote::collect(int millisec)
+{
+#ifndef _WIN32
+  this->answerForks(millisec);
+  if(!this->Pending.empty() &&
+     now_millisec() - this->Pending.front()->RequestTime > ForkTimeout)
+    { //a zygote that doesn't answer is of no use to us
+    this->stop();
+    }
+#else
+  (void) millisec;
+#endif
+}
+
+//----------------------------------------------------------------------------
+//fill in the pending workers in the order they were requested, the zygote
+//answers each request with a line holding the pid of the worker, and the
+//pidfd of the worker attached to that line
+void Zygote::answerForks(int millisec)
+{
+#ifndef _WIN32
+  const long long deadline = now_millisec() + millisec;
+  std::string line;
+  while(!this->Pending.empty())
+    {
+    const long long remaining = deadline - now_millisec();
+    if(!this->readLine(line, remaining > 0 ? static_cast<int>(remaining) : 0))
+      {
+      break;
+      }
+
+    ForkedWorkerPtr worker = this->Pending.front();
+    this->Pending.pop_front();
+    const int pid = ::atoi(line.c_str());
+    if(pid > 0 && !this->Descriptors.empty())
+      {
+      worker->forked(pid, this->Descriptors.front());
+      this->Descriptors.pop_front();
+      }
+    else
+      {
+      worker->failed();
+      }
+    }
+#else
+  (void) millisec;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Zygote::receive(int millisec)
+{
+#ifndef _WIN32
+  struct pollfd item;
+  item.fd = this->Control;
+  item.events = POLLIN;
+  item.revents = 0;
+  int rc = 0;
+  do
+    {
+    rc = ::poll(&item, 1, millisec);
+    } while(rc < 0 && errno == EINTR);
+  if(rc <= 0)
+    {
+    return false;
+    }
+
+  char data[64];
+  struct iovec io;
+  io.iov_base = data;
+  io.iov_len = sizeof(data);
+
+  union
+    {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int) * MaxDescriptorsPerRead)];
+    } control;
+
+  struct msghdr message;
+  ::memset(&message, 0, sizeof(message));
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof(control.buffer);
+
+  int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+  ssize_t count = 0;
+  do
+    {
+    count = ::recvmsg(this->Control, &message, flags);
+    } while(count < 0 && errno == EINTR);
+  if(count <= 0)
+    { //the zygote has gone away
+    this->disconnect();
+    return false;
+    }
+
+  for(struct cmsghdr* c = CMSG_FIRSTHDR(&message); c != NULL;
+      c = CMSG_NXTHDR(&message, c))
+    {
+    if(c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+      {
+      continue;
+      }
+    const std::size_t n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const unsigned char* fds = CMSG_DATA(c);
+    for(std::size_t i=0; i < n; ++i)
+      {
+      int fd;
+      ::memcpy(&fd, fds + i * sizeof(int), sizeof(int));
+#ifndef MSG_CMSG_CLOEXEC
+      set_close_on_exec(fd);
+#endif
+      this->Descriptors.push_back(fd);
+      }
+    }
+
+  this->Buffer.append(data, static_cast<std::size_t>(count));
+  return true;
+#else
+  (void) millisec;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool Zygote::readLine(std::string& line, int millisec)
+{
+#ifndef _WIN32
+  const long long deadline = now_millisec() + millisec;
+  std::string::size_type end = this->Buffer.find('\n');
+  while(end == std::string::npos)
+    {
+    const long long remaining = deadline - now_millisec();
+    if(this->Control < 0 ||
+       !this->receive(remaining > 0 ? static_cast<int>(remaining) : 0))
+      {
+      return false;
+      }
+    end = this->Buffer.find('\n');
+    }
+
+  line = this->Buffer.substr(0, end);
+  this->Buffer.erase(0, end + 1);
+  return true;
+#else
+  (void) line;
+  (void) millisec;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+//close the control socket, the requests the zygote hasn't answered yet
+//will never be answered
+void Zygote::disconnect()
+{
+#ifndef _WIN32
+  if(this->Control >= 0)
+    {
+    ::close(this->Control);
+    this->Control = -1;
+    }
+#endif
+  this->Ready = false;
+  for(std::size_t i=0; i < this->Pending.size(); ++i)
+    {
+    this->Pending[i]->failed();
+    }
+  this->Pending.clear();
+}
+
+//----------------------------------------------------------------------------
+void Zygote::stop()
+{
+#ifndef _WIN32
+  if(this->Control >= 0 && !this->Pending.empty())
+    {
+    this->answerForks(StopTimeout);
+    }
+  this->disconnect();
+  if(this->Pid > 0)
+    {
+    //the zygote might still be initializing, so don't wait for it to
+    //notice the control socket closing
+    ::kill(static_cast<pid_t>(this->Pid), SIGKILL);
+    ::waitpid(static_cast<pid_t>(this->Pid), NULL, 0);
+    this->Pid = -1;
+    }
+  for(std::size_t i=0; i < this->Descriptors.size(); ++i)
+    {
+    ::close(this->Descriptors[i]);
+    }
+#endif
+  this->Descriptors.clear();
+  this->Buffer.clear();
+}
+
+}
+}
+}
@@ -0,0 +1,162 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_server_detail_Zygote_h
+#define remus_server_detail_Zygote_h
+
+#include <remus/common/CompilerInformation.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/shared_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace remus{
+namespace server{
+namespace detail{
+
+//A worker forked from a zygote.
+//
+//The worker is a child of the zygote and not of ours, so its pid can be
+//reused as soon as the zygote reaps it. Instead the zygote hands us a pidfd
+//for each worker, which always refers to the worker it was opened for, and
+//is used both to check if the worker is alive and to kill it.
+//
+//Forking is asynchronous, a ForkedWorker is pending until its zygote has
+//answered the fork request, see Zygote::collect.
+class ForkedWorker
+{
+public:
+  ForkedWorker();
+  ~ForkedWorker();
+
+  //returns true until the zygote has answered the fork request
+  bool pending() const { return this->State == Pending; }
+
+  //returns true while the worker is pending or running
+  bool isAlive() const;
+
+  //kill the worker, a pending worker is killed once it has been forked.
+  //Returns false if the worker has already exited or couldn't be forked
+  bool kill();
+
+  //the pid of the worker, or -1 while pending or when the fork failed
+  int processId() const { return this->Pid; }
+
+  //the pidfd of the worker, which is readable once the worker has exited.
+  //Is -1 while pending or when the fork failed. The descriptor is owned
+  //by the ForkedWorker
+  int descriptor() const { return this->PidFd; }
+
+private:
+  ForkedWorker(const ForkedWorker&);
+  void operator=(const ForkedWorker&);
+
+  friend class Zygote;
+  void forked(int pid, int pidfd);
+  void failed();
+
+  enum ForkState { Pending, Running, Failed };
+  ForkState State;
+  int Pid;
+  int PidFd;
+  bool KillWhenForked;
+  long long RequestTime;
+};
+
+//A pre-initialized worker process that workers are forked from.
+//
+//start launches the worker executable with a control socket as its stdin,
+//and the descriptor number in the REMUS_ZYGOTE_FD environment variable.
+//Once the executable has initialized it calls remus::worker::runZygote,
+//which tells us it is ready and then forks a worker for each request we
+//send. The zygote answers each request with the pid of the worker, and
+//passes a pidfd of the worker along with it over the control socket.
+//
+//Fork requests never wait for the zygote, fork returns a pending worker
+//that is filled in by collect once the answer has arrived.
+//
+//Destroying the Zygote kills the zygote process, but not the workers that
+//were forked from it.
+//
+//Zygotes need fork, so on Windows start always fails.
+class Zygote
+{
+public:
+  typedef boost::shared_ptr<ForkedWorker> ForkedWorkerPtr;
+
+  Zygote(const std::string& executable,
+         const std::vector<std::string>& arguments,
+         const std::map<std::string,std::string>& environment);
+  ~Zygote();
+
+  //launch the zygote process, returns false if it couldn't be launched
+  bool start();
+
+  //returns true once the zygote is waiting for fork requests, waiting up
+  //to millisec for it to become ready
+  bool ready(int millisec = 0);
+
+  //returns true while the zygote process is running
+  bool isAlive();
+
+  //ask the zygote to fork a worker. Returns the pending worker, or an
+  //empty pointer if the zygote isn't ready
+  ForkedWorkerPtr fork();
+
+  //fill in the pending workers the zygote has answered for, waiting up to
+  //millisec for every pending worker to be answered. A zygote that leaves
+  //a request unanswered for too long is stopped, failing its pending workers
+  void collect(int millisec = 0);
+
+  //the number of fork requests the zygote hasn't answered yet
+  std::size_t pendingForks() const { return this->Pending.size(); }
+
+  //the pid of the zygote process, or -1 when it isn't running
+  int processId() const { return this->Pid; }
+
+  const std::string& executable() const { return this->Executable; }
+  const std::vector<std::string>& arguments() const { return this->Arguments; }
+  const std::map<std::string,std::string>& environment() const
+    { return this->Environment; }
+
+private:
+  Zygote(const Zygote&);
+  void operator=(const Zygote&);
+
+  bool receive(int millisec);
+  bool readLine(std::string& line, int millisec);
+  void answerForks(int millisec);
+  void disconnect();
+  void stop();
+
+  std::string Executable;
+  std::vector<std::string> Arguments;
+  std::map<std::string,std::string> Environment;
+  int Pid;
+  int Control;
+  bool Ready;
+  std::string Buffer;
+  //pidfds that arrived, in the order of the answers they belong to
+  std::deque<int> Descriptors;
+  std::deque<ForkedWorkerPtr> Pending;
+};
+
+}
+}
+}
+
+#endif
@@ -361,6 +361,78 @@ void verify_expire_jobs()
 
 }
 
+void verify_expire_worker_jobs()
+{
+  //verify that expiring a set of workers only expires their jobs
+  const zmq::SocketIdentity expiringWorker = make_socketId();
+  const zmq::SocketIdentity otherWorker = make_socketId();
+
+  std::vector< boost::uuids::uuid > uuids_used;
+  for(int i=0; i < 4; ++i)
+    { uuids_used.push_back( remus::testing::UUIDGenerator() ); }
+
+  remus::server::detail::ActiveJobs jobs;
+  REMUS_ASSERT( (jobs.add(expiringWorker, uuids_used[0]) == true) );
+  REMUS_ASSERT( (jobs.add(expiringWorker, uuids_used[1]) == true) );
+  REMUS_ASSERT( (jobs.add(expiringWorker, uuids_used[2]) == true) );
+  REMUS_ASSERT( (jobs.add(otherWorker, uuids_used[3]) == true) );
+  REMUS_ASSERT( (jobs.activeWorkers().size() == 2) );
+
+  //finished jobs can't be expired
+  jobs.updateResult( remus::proto::make_JobResult(uuids_used[2],"data") );
+
+  std::vector<zmq::SocketIdentity> workers(1, expiringWorker);
+  std::vector< remus::proto::JobStatus > expired = jobs.markExpiredJobs(workers);
+  REMUS_ASSERT( (expired.size() == 2) );
+  REMUS_ASSERT( (jobs.status(uuids_used[0]).status() == remus::EXPIRED) );
+  REMUS_ASSERT( (jobs.status(uuids_used[1]).status() == remus::EXPIRED) );
+  REMUS_ASSERT( (jobs.status(uuids_used[2]).status() == remus::FINISHED) );
+  REMUS_ASSERT( (jobs.status(uuids_used[3]).status() == remus::QUEUED) );
+
+  //removing every job of a worker stops tracking the worker
+  jobs.remove(uuids_used[3]);
+  REMUS_ASSERT( (jobs.activeWorkers().size() == 1) );
+  workers[0] = otherWorker;
+  REMUS_ASSERT( (jobs.markExpiredJobs(workers).empty()) );
+}
+
+void verify_progress_rate_limit()
+{
+  boost::uuids::uuid uuid_used = remus::testing::UUIDGenerator();
+  remus::server::detail::ActiveJobs jobs;
+  REMUS_ASSERT( (jobs.minimumProgressInterval() == 0) );
+  jobs.minimumProgressInterval(200);
+  REMUS_ASSERT( (jobs.minimumProgressInterval() == 200) );
+
+  REMUS_ASSERT( (jobs.add(make_socketId(), uuid_used) == true) );
+
+  //the first progress update moves us to IN_PROGRESS and is always accepted
+  remus::proto::JobStatus wjs(uuid_used, remus::proto::JobProgress(5) );
+  REMUS_ASSERT( (jobs.updateStatus(wjs) == true) );
+  REMUS_ASSERT( (jobs.status(uuid_used).progress().value() == 5) );
+
+  //progress that arrives too soon is dropped
+  wjs.updateProgress( remus::proto::JobProgress(10) );
+  REMUS_ASSERT( (jobs.updateStatus(wjs) == false) );
+  REMUS_ASSERT( (jobs.status(uuid_used).progress().value() == 5) );
+
+  //once the interval has passed we accept progress again
+  remus::common::SleepForMillisec(250);
+  wjs.updateProgress( remus::proto::JobProgress(15) );
+  REMUS_ASSERT( (jobs.updateStatus(wjs) == true) );
+  REMUS_ASSERT( (jobs.status(uuid_used).progress().value() == 15) );
+
+  //changes of state are never dropped
+  remus::proto::JobStatus failed(uuid_used,remus::FAILED);
+  REMUS_ASSERT( (jobs.updateStatus(failed) == true) );
+  REMUS_ASSERT( (jobs.status(uuid_used).failed() == true) );
+
+  //updates to jobs we don't have are rejected
+  remus::proto::JobStatus unknown(remus::testing::UUIDGenerator(),
+                                  remus::proto::JobProgress(5));
+  REMUS_ASSERT( (jobs.updateStatus(unknown) == false) );
+}
+
 } //namespace
 
 int UnitTestActiveJobs(int, char *[])
@@ -374,6 +446,9 @@ int UnitTestActiveJobs(int, char *[])
   verify_refresh_jobs();
 
   verify_expire_jobs();
+  verify_expire_worker_jobs();
+
+  verify_progress_rate_limit();
 
   return 0;
 }
@@ -0,0 +1,111 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/ChildWatcher.h>
+
+#include <remus/testing/Testing.h>
+
+#ifdef __linux__
+# include <poll.h>
+# include <signal.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+typedef remus::server::detail::ChildWatcher ChildWatcher;
+
+#ifdef __linux__
+//start a child that exits after the given number of milliseconds
+int start_child(int millisec)
+{
+  const pid_t pid = ::fork();
+  if(pid == 0)
+    {
+    ::usleep(static_cast<useconds_t>(millisec) * 1000);
+    ::_exit(0);
+    }
+  return static_cast<int>(pid);
+}
+
+//wait for the descriptor of the watcher to become readable
+bool wait_for_exit(const ChildWatcher& watcher, int millisec)
+{
+  struct pollfd item;
+  item.fd = watcher.descriptor();
+  item.events = POLLIN;
+  item.revents = 0;
+  return ::poll(&item, 1, millisec) == 1 && (item.revents & POLLIN);
+}
+
+void verify_exit_is_reported()
+{
+  ChildWatcher watcher;
+  if(!watcher.supported())
+    { //kernels before 5.3 don't have pidfds
+    return;
+    }
+  REMUS_ASSERT( (watcher.descriptor() >= 0) );
+  REMUS_ASSERT( (watcher.exited().empty()) );
+
+  const int fast = start_child(50);
+  const int slow = start_child(5000);
+  REMUS_ASSERT( (watcher.watch(fast)) );
+  REMUS_ASSERT( (watcher.watch(slow)) );
+  REMUS_ASSERT( (watcher.size() == 2) );
+
+  //only the child that exited is reported, and only once
+  REMUS_ASSERT( (wait_for_exit(watcher, 5000)) );
+  std::vector<int> exited = watcher.exited();
+  REMUS_ASSERT( (exited.size() == 1) );
+  REMUS_ASSERT( (exited[0] == fast) );
+  REMUS_ASSERT( (!watcher.watching(fast)) );
+  REMUS_ASSERT( (watcher.watching(slow)) );
+  REMUS_ASSERT( (watcher.exited().empty()) );
+  REMUS_ASSERT( (!wait_for_exit(watcher, 0)) );
+
+  //the watcher doesn't reap, so the child is still ours to wait on
+  REMUS_ASSERT( (::waitpid(fast, NULL, 0) == fast) );
+
+  //unwatched children aren't reported
+  watcher.unwatch(slow);
+  REMUS_ASSERT( (watcher.size() == 0) );
+  ::kill(slow, SIGKILL);
+  ::waitpid(slow, NULL, 0);
+  REMUS_ASSERT( (watcher.exited().empty()) );
+}
+
+void verify_invalid_pids()
+{
+  ChildWatcher watcher;
+  REMUS_ASSERT( (!watcher.watch(-1)) );
+  REMUS_ASSERT( (!watcher.watch(0)) );
+  REMUS_ASSERT( (watcher.size() == 0) );
+}
+#endif
+
+}
+
+int UnitTestChildWatcher(int, char *[])
+{
+#ifdef __linux__
+  verify_exit_is_reported();
+  verify_invalid_pids();
+#else
+  //without pidfds nothing can be watched
+  ChildWatcher watcher;
+  REMUS_ASSERT( (!watcher.supported()) );
+  REMUS_ASSERT( (!watcher.watch(1)) );
+#endif
+  return 0;
+}
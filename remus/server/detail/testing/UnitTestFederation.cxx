@@ -0,0 +1,231 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/Federation.h>
+
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+#include <boost/uuid/random_generator.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+using remus::server::detail::Federation;
+using remus::proto::QueueDepth;
+
+const remus::proto::JobRequirements worker_type2D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh2D()),
+                                                  "", "" );
+const remus::proto::JobRequirements worker_type3D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh3D()),
+                                                  "a", "b" );
+
+void verify_links()
+{
+  Federation federation;
+  federation.addPeer("inproc://peer_a");
+  federation.addPeer("inproc://peer_a");
+  federation.addPeer("inproc://peer_b");
+  REMUS_ASSERT( (federation.peers().size() == 2) );
+
+  //nothing is linked before we start
+  REMUS_ASSERT( (!federation.isActive()) );
+  REMUS_ASSERT( (federation.linkTo("inproc://peer_a") == 0) );
+  REMUS_ASSERT( (!federation.exchangeDue(1000)) );
+
+  boost::shared_ptr<zmq::context_t> context =
+                                      boost::make_shared<zmq::context_t>(1);
+  federation.start(context, "inproc://us");
+  REMUS_ASSERT( (federation.isActive()) );
+  REMUS_ASSERT( (federation.numberOfLinks() == 2) );
+  REMUS_ASSERT( (federation.linkTo("inproc://peer_b") == 1) );
+
+  //we never link to ourselves, or to servers that aren't our peers
+  REMUS_ASSERT( (federation.linkTo("inproc://us") == 2) );
+  REMUS_ASSERT( (federation.linkTo("inproc://peer_c") == 2) );
+  REMUS_ASSERT( (!federation.isPeer("inproc://peer_c")) );
+  REMUS_ASSERT( (federation.numberOfLinks() == 2) );
+
+  //peers added once started are linked to by linkPeers
+  federation.addPeer("inproc://peer_c");
+  REMUS_ASSERT( (federation.isPeer("inproc://peer_c")) );
+  REMUS_ASSERT( (federation.numberOfLinks() == 2) );
+  federation.linkPeers();
+  REMUS_ASSERT( (federation.numberOfLinks() == 3) );
+  REMUS_ASSERT( (federation.linkEndpoint(2) == "inproc://peer_c") );
+
+  //only requirements peers have capacity for are supported
+  federation.summary(0)[worker_type2D] = QueueDepth(3, 0);
+  federation.summary(1)[worker_type3D] = QueueDepth(0, 1);
+  REMUS_ASSERT( (federation.peerRequirements().size() == 1) );
+  REMUS_ASSERT( (federation.peerRequirements().count(worker_type3D) == 1) );
+  REMUS_ASSERT( (federation.peerRequirements(
+                    MeshIOType(Edges(),Mesh2D())).size() == 0) );
+
+  federation.exchangeInterval(100);
+  REMUS_ASSERT( (federation.exchangeDue(1000)) );
+  REMUS_ASSERT( (!federation.exchangeDue(1050)) );
+  REMUS_ASSERT( (federation.exchangeDue(1100)) );
+
+  federation.stop();
+  REMUS_ASSERT( (!federation.isActive()) );
+  REMUS_ASSERT( (federation.peers().size() == 3) );
+}
+
+void verify_jobs()
+{
+  boost::uuids::random_generator generator;
+  const boost::uuids::uuid ours = generator();
+  const boost::uuids::uuid theirs = generator();
+
+  Federation federation;
+  const remus::worker::Job ourJob(ours, remus::proto::JobSubmission(worker_type2D));
+
+  //jobs we moved start out queued, until the peer sends their status
+  federation.forwarded(ourJob, "inproc://peer_a", 0);
+  REMUS_ASSERT( (federation.isForwarded(ours)) );
+  REMUS_ASSERT( (!federation.isForwarded(theirs)) );
+  REMUS_ASSERT( (federation.forwardedTo(ours) == "inproc://peer_a") );
+  REMUS_ASSERT( (federation.forwardedStatus(ours).status() == remus::QUEUED) );
+  REMUS_ASSERT( (federation.forwardedStatus(theirs).status() ==
+                 remus::INVALID_STATUS) );
+
+  //only the peer the job was moved to can update it
+  const remus::proto::JobStatus progress(ours, remus::proto::JobProgress(10));
+  REMUS_ASSERT( (!federation.updateForwarded(progress, "inproc://peer_b")) );
+  REMUS_ASSERT( (federation.forwardedStatus(ours).status() == remus::QUEUED) );
+  REMUS_ASSERT( (federation.updateForwarded(progress, "inproc://peer_a")) );
+  REMUS_ASSERT( (!federation.updateForwarded(
+                      remus::proto::JobStatus(theirs, remus::IN_PROGRESS),
+                      "inproc://peer_a")) );
+  REMUS_ASSERT( (federation.forwardedStatus(ours) == progress) );
+  REMUS_ASSERT( (!federation.haveForwardedResult(ours)) );
+
+  //the result finishes the job, and taking it stops tracking the job
+  REMUS_ASSERT( (!federation.updateForwarded(
+                  remus::proto::make_JobResult(ours, "forged"),
+                  "inproc://peer_b")) );
+  REMUS_ASSERT( (!federation.haveForwardedResult(ours)) );
+  REMUS_ASSERT( (federation.updateForwarded(
+                  remus::proto::make_JobResult(ours, "result"),
+                  "inproc://peer_a")) );
+  REMUS_ASSERT( (federation.haveForwardedResult(ours)) );
+  REMUS_ASSERT( (federation.forwardedStatus(ours).status() == remus::FINISHED) );
+  const remus::proto::JobResult result = federation.takeForwardedResult(ours);
+  REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == "result") );
+  REMUS_ASSERT( (!federation.isForwarded(ours)) );
+
+  //a failed job stays failed when its result arrives
+  federation.forwarded(ourJob, "inproc://peer_a", 0);
+  federation.updateForwarded(remus::proto::JobStatus(ours, remus::FAILED),
+                             "inproc://peer_a");
+  federation.updateForwarded(remus::proto::JobResult(ours), "inproc://peer_a");
+  REMUS_ASSERT( (federation.forwardedStatus(ours).status() == remus::FAILED) );
+  federation.removeForwarded(ours);
+  REMUS_ASSERT( (!federation.isForwarded(ours)) );
+
+  //jobs peers moved to us remember where they came from
+  federation.foreign(theirs, "inproc://peer_b");
+  REMUS_ASSERT( (federation.isForeign(theirs)) );
+  REMUS_ASSERT( (!federation.isForeign(ours)) );
+  REMUS_ASSERT( (federation.origin(theirs) == "inproc://peer_b") );
+  REMUS_ASSERT( (federation.foreignJobs().size() == 1) );
+  federation.removeForeign(theirs);
+  REMUS_ASSERT( (!federation.isForeign(theirs)) );
+  REMUS_ASSERT( (federation.origin(theirs).empty()) );
+  REMUS_ASSERT( (federation.foreignJobs().empty()) );
+}
+
+void verify_acknowledgements()
+{
+  boost::uuids::random_generator generator;
+  const remus::worker::Job unacked(generator(),
+                                   remus::proto::JobSubmission(worker_type2D));
+  const remus::worker::Job acked(generator(),
+                                 remus::proto::JobSubmission(worker_type2D));
+  const remus::worker::Job finished(generator(),
+                                    remus::proto::JobSubmission(worker_type2D));
+
+  Federation federation;
+  federation.peerTimeout(100);
+  REMUS_ASSERT( (federation.nextTimeout() == -1) );
+
+  //only the peer we moved a job to can acknowledge it
+  federation.forwarded(unacked, "inproc://peer_a", 1000);
+  federation.forwarded(acked, "inproc://peer_a", 1000);
+  federation.forwarded(finished, "inproc://peer_a", 1000);
+  REMUS_ASSERT( (!federation.acknowledged(acked.id(), "inproc://peer_b")) );
+  REMUS_ASSERT( (federation.acknowledged(acked.id(), "inproc://peer_a")) );
+  REMUS_ASSERT( (federation.updateForwarded(
+                  remus::proto::make_JobResult(finished.id(), "result"),
+                  "inproc://peer_a")) );
+  REMUS_ASSERT( (federation.nextTimeout() == 1100) );
+
+  //a job that isn't acknowledged in time is handed back, while a job the
+  //peer accepted is kept as long as we hear from the peer
+  federation.heardFrom("inproc://peer_a", 1080);
+  REMUS_ASSERT( (federation.takeLostJobs(1099).empty()) );
+  std::vector<remus::worker::Job> lost = federation.takeLostJobs(1100);
+  REMUS_ASSERT( (lost.size() == 1 && lost[0].id() == unacked.id()) );
+  REMUS_ASSERT( (lost[0].submission() == unacked.submission()) );
+  REMUS_ASSERT( (!federation.isForwarded(unacked.id())) );
+  REMUS_ASSERT( (federation.nextTimeout() == 1180) );
+
+  //once the peer goes quiet the jobs it runs are handed back, but not the
+  //jobs it has sent the result of
+  lost = federation.takeLostJobs(1180);
+  REMUS_ASSERT( (lost.size() == 1 && lost[0].id() == acked.id()) );
+  REMUS_ASSERT( (federation.haveForwardedResult(finished.id())) );
+  REMUS_ASSERT( (federation.nextTimeout() == -1) );
+
+  //failures and results of foreign jobs are sent again until the origin
+  //acknowledges them
+  const boost::uuids::uuid failedId = generator();
+  const boost::uuids::uuid resultId = generator();
+  federation.foreign(failedId, "inproc://peer_b");
+  federation.foreign(resultId, "inproc://peer_b");
+  const remus::proto::JobStatus failure(failedId, remus::FAILED);
+  federation.sentToOrigin(failure, 2000);
+  federation.sentToOrigin(remus::proto::make_JobResult(resultId, "r"), 2050);
+  REMUS_ASSERT( (federation.nextTimeout() == 2100) );
+  REMUS_ASSERT( (federation.failuresToResend(2099).empty()) );
+  REMUS_ASSERT( (federation.failuresToResend(2100).size() == 1) );
+  REMUS_ASSERT( (federation.resultsToResend(2100).empty()) );
+  REMUS_ASSERT( (federation.resultsToResend(2150).size() == 1) );
+  REMUS_ASSERT( (federation.nextTimeout() == 2200) );
+
+  //an acknowledgement of an earlier status or from another peer doesn't
+  //count, the right one stops tracking the job
+  REMUS_ASSERT( (!federation.originAcknowledged(
+                  remus::proto::JobStatus(failedId, remus::QUEUED),
+                  "inproc://peer_b")) );
+  REMUS_ASSERT( (!federation.originAcknowledged(failure, "inproc://peer_a")) );
+  REMUS_ASSERT( (federation.originAcknowledged(failure, "inproc://peer_b")) );
+  REMUS_ASSERT( (!federation.isForeign(failedId)) );
+  REMUS_ASSERT( (federation.originAcknowledged(resultId, "inproc://peer_b")) );
+  REMUS_ASSERT( (!federation.isForeign(resultId)) );
+  REMUS_ASSERT( (federation.nextTimeout() == -1) );
+}
+
+}
+
+int UnitTestFederation(int, char *[])
+{
+  verify_links();
+  verify_jobs();
+  verify_acknowledgements();
+  return 0;
+}
@@ -0,0 +1,159 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/ProxiedWorkers.h>
+
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/random_generator.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+using remus::server::detail::ProxiedWorkers;
+
+const remus::proto::JobRequirements worker_type2D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh2D()),
+                                                  "", "" );
+const remus::proto::JobRequirements worker_type3D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh3D()),
+                                                  "", "" );
+
+//makes a socket identity from a number
+zmq::SocketIdentity make_socketId(int i)
+{
+  const std::string str_id = boost::lexical_cast<std::string>(i);
+  return zmq::SocketIdentity(str_id.c_str(),str_id.size());
+}
+
+remus::worker::Job make_job(const remus::proto::JobRequirements& reqs)
+{
+  static boost::uuids::random_generator generator;
+  return remus::worker::Job(generator(), remus::proto::JobSubmission(reqs));
+}
+
+void verify_registration_and_credits()
+{
+  ProxiedWorkers workers;
+
+  //only the first worker with the requirements is registered upstream
+  REMUS_ASSERT( (workers.registerWorker(make_socketId(0), worker_type2D, 0)) );
+  REMUS_ASSERT( (!workers.registerWorker(make_socketId(1), worker_type2D, 0)) );
+  REMUS_ASSERT( (!workers.registerWorker(make_socketId(0), worker_type2D, 0)) );
+  REMUS_ASSERT( (workers.numberOfWorkers() == 2) );
+  REMUS_ASSERT( (workers.supports(worker_type2D)) );
+  REMUS_ASSERT( (!workers.supports(worker_type3D)) );
+
+  //the credits of all workers are granted together
+  REMUS_ASSERT( (workers.readyForWork(make_socketId(0), worker_type2D, 2, 0).empty()) );
+  REMUS_ASSERT( (workers.readyForWork(make_socketId(1), worker_type2D, 1, 0).empty()) );
+  std::map<remus::proto::JobRequirements, unsigned int> credits =
+                                                      workers.takeCredits();
+  REMUS_ASSERT( (credits.size() == 1) );
+  REMUS_ASSERT( (credits[worker_type2D] == 3) );
+  REMUS_ASSERT( (workers.takeCredits().empty()) );
+
+  //jobs go to the workers in the order they asked for them
+  const remus::worker::Job first = make_job(worker_type2D);
+  const remus::worker::Job second = make_job(worker_type2D);
+  const remus::worker::Job third = make_job(worker_type2D);
+  REMUS_ASSERT( (workers.assign(first) == make_socketId(0)) );
+  REMUS_ASSERT( (workers.assign(second) == make_socketId(0)) );
+  REMUS_ASSERT( (workers.assign(third) == make_socketId(1)) );
+  REMUS_ASSERT( (workers.owner(third.id()) == make_socketId(1)) );
+
+  //results are acknowledged in the order they were sent
+  workers.awaitAck(make_socketId(1));
+  workers.awaitAck(make_socketId(0));
+  REMUS_ASSERT( (workers.takeAck() == make_socketId(1)) );
+  REMUS_ASSERT( (workers.takeAck() == make_socketId(0)) );
+  REMUS_ASSERT( (workers.takeAck().size() == 0) );
+
+  workers.finished(third.id());
+  REMUS_ASSERT( (workers.owner(third.id()).size() == 0) );
+}
+
+void verify_held_jobs()
+{
+  ProxiedWorkers workers;
+  workers.registerWorker(make_socketId(0), worker_type2D, 0);
+
+  //jobs nobody is waiting for are held until a worker asks
+  const remus::worker::Job held = make_job(worker_type2D);
+  const remus::worker::Job dropped = make_job(worker_type2D);
+  REMUS_ASSERT( (workers.assign(held).size() == 0) );
+  REMUS_ASSERT( (workers.assign(dropped).size() == 0) );
+  REMUS_ASSERT( (workers.numberOfHeldJobs() == 2) );
+  REMUS_ASSERT( (workers.removeHeld(dropped.id())) );
+  REMUS_ASSERT( (!workers.removeHeld(dropped.id())) );
+
+  //held jobs don't need new credits from the server
+  std::vector<remus::worker::Job> jobs =
+            workers.readyForWork(make_socketId(0), worker_type2D, 2, 0);
+  REMUS_ASSERT( (jobs.size() == 1) );
+  REMUS_ASSERT( (jobs[0].id() == held.id()) );
+  REMUS_ASSERT( (workers.owner(held.id()) == make_socketId(0)) );
+  REMUS_ASSERT( (workers.takeCredits()[worker_type2D] == 1) );
+  REMUS_ASSERT( (workers.numberOfHeldJobs() == 0) );
+}
+
+void verify_removal()
+{
+  ProxiedWorkers workers;
+  workers.registerWorker(make_socketId(0), worker_type2D, 0);
+  workers.registerWorker(make_socketId(1), worker_type2D, 0);
+  workers.registerWorker(make_socketId(1), worker_type3D, 0);
+  workers.readyForWork(make_socketId(1), worker_type2D, 1, 0);
+
+  const remus::worker::Job running = make_job(worker_type2D);
+  const remus::worker::Job held2D = make_job(worker_type2D);
+  const remus::worker::Job held3D = make_job(worker_type3D);
+  REMUS_ASSERT( (workers.assign(running) == make_socketId(1)) );
+  workers.assign(held2D);
+  workers.assign(held3D);
+
+  //the jobs of the worker fail with it, and so do the held jobs nobody
+  //else supports
+  std::vector<boost::uuids::uuid> failed =
+                                  workers.removeWorker(make_socketId(1));
+  REMUS_ASSERT( (failed.size() == 2) );
+  REMUS_ASSERT( (std::count(failed.begin(), failed.end(), running.id()) == 1) );
+  REMUS_ASSERT( (std::count(failed.begin(), failed.end(), held3D.id()) == 1) );
+  REMUS_ASSERT( (workers.numberOfHeldJobs() == 1) );
+  REMUS_ASSERT( (workers.removeWorker(make_socketId(1)).empty()) );
+  REMUS_ASSERT( (workers.numberOfWorkers() == 1) );
+
+  //workers are silent once they miss two of the heartbeats they promised
+  workers.heartbeat(make_socketId(0), 100, 1000);
+  REMUS_ASSERT( (workers.silentWorkers(1200).empty()) );
+  REMUS_ASSERT( (workers.silentWorkers(1201).size() == 1) );
+  workers.heard(make_socketId(0), 1200);
+  REMUS_ASSERT( (workers.silentWorkers(1300).empty()) );
+  REMUS_ASSERT( (workers.removeWorker(make_socketId(0)).size() == 1) );
+  REMUS_ASSERT( (workers.numberOfWorkers() == 0) );
+}
+
+}
+
+int UnitTestProxiedWorkers(int, char *[])
+{
+  verify_registration_and_credits();
+  verify_held_jobs();
+  verify_removal();
+  return 0;
+}
@@ -162,6 +162,9 @@ void verify_dispatch_jobs()
 
   REMUS_ASSERT( (queue.numJobsWaitingForWorkers() == 4) );
   REMUS_ASSERT( (queue.numJobsJustQueued() == 3) );
+  REMUS_ASSERT( (queue.numJobsJustQueued(worker_type1D) == 0) );
+  REMUS_ASSERT( (queue.numJobsJustQueued(worker_type2D) +
+                 queue.numJobsJustQueued(worker_type3D) == 3) );
 
   //verify the state of both queues
   REMUS_ASSERT( (queue.queuedJobRequirements().size() == 2) );
@@ -212,6 +215,82 @@ void verify_dispatch_jobs()
   REMUS_ASSERT( (queue.waitingJobRequirements().count(worker_type3D) == 0) );
 }
 
+void verify_batch_jobs()
+{
+  remus::server::detail::JobQueue queue;
+
+  //verify the default batch size is a single job, and that we can't
+  //set a batch size of zero
+  REMUS_ASSERT( (queue.batchSize(worker_type2D) == 1) );
+  queue.batchSize(worker_type2D, 0);
+  REMUS_ASSERT( (queue.batchSize(worker_type2D) == 1) );
+  queue.batchSize(worker_type2D, 3);
+  REMUS_ASSERT( (queue.batchSize(worker_type2D) == 3) );
+  REMUS_ASSERT( (queue.batchSize(worker_type3D) == 1) );
+
+  for(int i=0; i < 4; ++i)
+    {
+    queue.addJob(make_id(), make_jobSubmission(Edges(),Mesh2D()));
+    }
+  queue.addJob(make_id(), make_jobSubmission(Edges(),Mesh3D()));
+
+  //verify that we only take jobs of the given type, and no more than asked
+  std::vector<remus::worker::Job> jobs = queue.takeJobs(worker_type2D, 3);
+  REMUS_ASSERT( (jobs.size() == 3) );
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    REMUS_ASSERT( (jobs[i].valid() == true) );
+    REMUS_ASSERT( (jobs[i].submission().requirements() == worker_type2D) );
+    }
+
+  jobs = queue.takeJobs(worker_type2D, 3);
+  REMUS_ASSERT( (jobs.size() == 1) );
+  jobs = queue.takeJobs(worker_type2D, 3);
+  REMUS_ASSERT( (jobs.size() == 0) );
+  REMUS_ASSERT( (queue.numJobsJustQueued() == 1) );
+}
+
+void verify_take_queued_jobs()
+{
+  remus::server::detail::JobQueue queue;
+
+  //jobs a worker has been dispatched for aren't taken
+  queue.addJob(make_id(), make_jobSubmission(Edges(),Mesh2D()));
+  queue.workerDispatched(worker_type2D);
+
+  const boost::uuids::uuid kept = make_id();
+  queue.addJob(kept, make_jobSubmission(Edges(),Mesh2D()));
+  for(int i=0; i < 2; ++i)
+    {
+    queue.addJob(make_id(), make_jobSubmission(Edges(),Mesh2D()));
+    }
+  queue.addJob(make_id(), make_jobSubmission(Edges(),Mesh3D()));
+  REMUS_ASSERT( (queue.numJobsJustQueued(worker_type2D) == 3) );
+
+  //verify that we only take jobs of the given type, that we skip the jobs
+  //we are asked to keep, and take no more than asked
+  std::set<boost::uuids::uuid> keep;
+  keep.insert(kept);
+  std::vector<remus::worker::Job> jobs =
+                                queue.takeQueuedJobs(worker_type2D, 5, keep);
+  REMUS_ASSERT( (jobs.size() == 2) );
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    REMUS_ASSERT( (jobs[i].id() != kept) );
+    REMUS_ASSERT( (jobs[i].submission().requirements() == worker_type2D) );
+    REMUS_ASSERT( (queue.haveUUID(jobs[i].id()) == false) );
+    }
+  REMUS_ASSERT( (queue.haveUUID(kept) == true) );
+  REMUS_ASSERT( (queue.numJobsJustQueued(worker_type2D) == 1) );
+  REMUS_ASSERT( (queue.numJobsWaitingForWorkers() == 1) );
+
+  jobs = queue.takeQueuedJobs(worker_type3D, 0, keep);
+  REMUS_ASSERT( (jobs.size() == 0) );
+  jobs = queue.takeQueuedJobs(worker_type3D, 1, keep);
+  REMUS_ASSERT( (jobs.size() == 1) );
+  REMUS_ASSERT( (queue.queuedJobRequirements().count(worker_type3D) == 0) );
+}
+
 } //namespace
 
 int UnitTestServerJobQueue(int, char *[])
@@ -221,6 +300,9 @@ int UnitTestServerJobQueue(int, char *[])
 
   verify_dispatch_jobs();
 
+  verify_batch_jobs();
+
+  verify_take_queued_jobs();
 
   return 0;
 }
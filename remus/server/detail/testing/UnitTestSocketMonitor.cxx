@@ -11,6 +11,7 @@
 //=============================================================================
 
 #include <remus/server/detail/SocketMonitor.h>
+#include <remus/server/detail/TimingWheel.h>
 
 #include <remus/common/SleepFor.h>
 #include <remus/proto/zmqSocketIdentity.h>
@@ -237,6 +238,89 @@ void verify_responiveness()
   }
 }
 
+void verify_liveness_changes()
+{
+  zmq::SocketIdentity sid = make_socketId();
+  zmq::SocketIdentity other = make_socketId();
+  SocketMonitor monitor;
+  monitor.pollingMonitor().changeTimeOutRates(25,50);
+  REMUS_ASSERT( (monitor.hasPendingChanges() == false) );
+  REMUS_ASSERT( (monitor.nextChange() == -1) );
+
+  const boost::int64_t start = remus::server::detail::TimingWheel::now();
+  monitor.heartbeat(sid, make_heartbeat(50) );
+  monitor.heartbeat(other, make_heartbeat(5000) );
+  REMUS_ASSERT( (monitor.hasPendingChanges() == true) );
+
+  //the next change is sid missing its deadline, twice its interval
+  REMUS_ASSERT( (monitor.nextChange() >= start + 100) );
+  REMUS_ASSERT( (monitor.nextChange() <= start + 200) );
+  REMUS_ASSERT( (monitor.livenessChanges().empty()) );
+
+  //after twice the interval sid will be reported as unresponsive, while
+  //other hasn't reached its deadline
+  remus::common::SleepForMillisec(150);
+  SocketMonitor::LivenessChanges changes = monitor.livenessChanges();
+  REMUS_ASSERT( (changes.Unresponsive.size() == 1) );
+  REMUS_ASSERT( (changes.Unresponsive[0] == sid) );
+  REMUS_ASSERT( (changes.Responsive.empty()) );
+  REMUS_ASSERT( (changes.Dead.empty()) );
+
+  //changes are only reported once
+  REMUS_ASSERT( (monitor.livenessChanges().empty()) );
+
+  //hearing from sid again reports it as responsive
+  monitor.refresh(sid);
+  changes = monitor.livenessChanges();
+  REMUS_ASSERT( (changes.Responsive.size() == 1) );
+  REMUS_ASSERT( (changes.Responsive[0] == sid) );
+  REMUS_ASSERT( (changes.Unresponsive.empty()) );
+
+  //marking a socket as dead is reported, and stops tracking its deadline
+  monitor.markAsDead(sid);
+  monitor.markAsDead(other);
+  changes = monitor.livenessChanges();
+  REMUS_ASSERT( (changes.Dead.size() == 2) );
+  REMUS_ASSERT( (monitor.hasPendingChanges() == false) );
+  REMUS_ASSERT( (monitor.nextChange() == -1) );
+}
+
+void verify_connection_closed()
+{
+  zmq::SocketIdentity sid = make_socketId();
+  zmq::SocketIdentity other = make_socketId();
+  SocketMonitor monitor;
+  monitor.pollingMonitor().changeTimeOutRates(1000,60000);
+
+  monitor.refresh(sid);
+  monitor.refresh(other);
+  monitor.connectedOn(sid, 7);
+  monitor.connectedOn(other, 8);
+  REMUS_ASSERT( (monitor.livenessChanges().empty()) );
+
+  //closing a connection makes its socket unresponsive right away
+  monitor.connectionClosed(7);
+  REMUS_ASSERT( (monitor.isDead(sid) == false) );
+  REMUS_ASSERT( (monitor.isUnresponsive(sid) == true) );
+  REMUS_ASSERT( (monitor.isUnresponsive(other) == false) );
+  SocketMonitor::LivenessChanges changes = monitor.livenessChanges();
+  REMUS_ASSERT( (changes.Unresponsive.size() == 1) );
+  REMUS_ASSERT( (changes.Unresponsive[0] == sid) );
+
+  //a new connection that reuses the file descriptor of an old one
+  //isn't mistaken for the socket that used the old one
+  monitor.connectionAccepted(8);
+  monitor.connectionClosed(8);
+  REMUS_ASSERT( (monitor.isUnresponsive(other) == false) );
+  REMUS_ASSERT( (monitor.livenessChanges().empty()) );
+
+  //reconnecting and sending a message makes the socket responsive again
+  monitor.refresh(sid);
+  monitor.connectedOn(sid, 9);
+  REMUS_ASSERT( (monitor.isUnresponsive(sid) == false) );
+  changes = monitor.livenessChanges();
+  REMUS_ASSERT( (changes.Responsive.size() == 1) );
+}
 
 }
 int UnitTestSocketMonitor(int, char *[])
@@ -250,6 +334,8 @@ int UnitTestSocketMonitor(int, char *[])
   verify_resurrection();
   verify_heartbeat_interval();
   verify_responiveness();
+  verify_liveness_changes();
+  verify_connection_closed();
 
   return 0;
 }
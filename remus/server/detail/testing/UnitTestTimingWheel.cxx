@@ -0,0 +1,164 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/TimingWheel.h>
+
+#include <remus/proto/zmqSocketIdentity.h>
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <map>
+
+namespace
+{
+typedef remus::server::detail::TimingWheel TimingWheel;
+
+//makes a socket identity from a number
+zmq::SocketIdentity make_socketId(int i)
+{
+  const std::string str_id = boost::lexical_cast<std::string>(i);
+  return zmq::SocketIdentity(str_id.c_str(),str_id.size());
+}
+
+void verify_basic_expiry()
+{
+  TimingWheel wheel(10);
+  const boost::int64_t start = TimingWheel::now();
+  REMUS_ASSERT( (wheel.empty()) );
+
+  wheel.schedule(make_socketId(0), start + 50);
+  wheel.schedule(make_socketId(1), start + 500);
+  REMUS_ASSERT( (wheel.size() == 2) );
+  REMUS_ASSERT( (wheel.contains(make_socketId(0))) );
+
+  REMUS_ASSERT( (wheel.advance(start + 40).empty()) );
+
+  std::vector<zmq::SocketIdentity> expired = wheel.advance(start + 60);
+  REMUS_ASSERT( (expired.size() == 1) );
+  REMUS_ASSERT( (expired[0] == make_socketId(0)) );
+  REMUS_ASSERT( (!wheel.contains(make_socketId(0))) );
+
+  expired = wheel.advance(start + 600);
+  REMUS_ASSERT( (expired.size() == 1) );
+  REMUS_ASSERT( (expired[0] == make_socketId(1)) );
+  REMUS_ASSERT( (wheel.empty()) );
+
+  //a deadline in the past expires on the next advance
+  wheel.schedule(make_socketId(2), start);
+  REMUS_ASSERT( (wheel.advance(start + 620).size() == 1) );
+}
+
+void verify_reschedule_and_cancel()
+{
+  TimingWheel wheel(10);
+  const boost::int64_t start = TimingWheel::now();
+
+  //rescheduling replaces the old deadline
+  wheel.schedule(make_socketId(0), start + 50);
+  wheel.schedule(make_socketId(0), start + 1000);
+  REMUS_ASSERT( (wheel.size() == 1) );
+  REMUS_ASSERT( (wheel.advance(start + 100).empty()) );
+  REMUS_ASSERT( (wheel.contains(make_socketId(0))) );
+
+  //cancelled sockets never expire
+  REMUS_ASSERT( (wheel.cancel(make_socketId(0)) == true) );
+  REMUS_ASSERT( (wheel.cancel(make_socketId(0)) == false) );
+  REMUS_ASSERT( (wheel.advance(start + 2000).empty()) );
+  REMUS_ASSERT( (wheel.empty()) );
+}
+
+void verify_many_deadlines()
+{
+  //spread deadlines across every level of the wheel, and verify each
+  //socket expires at its deadline and not before
+  TimingWheel wheel(1);
+  const boost::int64_t start = TimingWheel::now();
+
+  std::map<zmq::SocketIdentity, boost::int64_t> deadlines;
+  for(int i=0; i < 5000; ++i)
+    {
+    const boost::int64_t deadline = start + 1 + (i * 7919) % 200000;
+    deadlines[make_socketId(i)] = deadline;
+    wheel.schedule(make_socketId(i), deadline);
+    }
+
+  std::size_t numExpired = 0;
+  for(boost::int64_t t = start; t <= start + 200000; t += 97)
+    {
+    std::vector<zmq::SocketIdentity> expired = wheel.advance(t);
+    for(std::size_t i=0; i < expired.size(); ++i)
+      {
+      const boost::int64_t deadline = deadlines[expired[i]];
+      REMUS_ASSERT( (deadline <= t) );
+      REMUS_ASSERT( (deadline > t - 97) );
+      }
+    numExpired += expired.size();
+    }
+  numExpired += wheel.advance(start + 200001).size();
+  REMUS_ASSERT( (numExpired == deadlines.size()) );
+  REMUS_ASSERT( (wheel.empty()) );
+}
+
+void verify_far_deadline()
+{
+  //a deadline beyond the range of the wheel is held until it comes due
+  TimingWheel wheel(1);
+  const boost::int64_t start = TimingWheel::now();
+  const boost::int64_t far = start + (boost::int64_t(1) << 24) + 5000;
+
+  wheel.schedule(make_socketId(0), far);
+  REMUS_ASSERT( (wheel.advance(far - 1).empty()) );
+  REMUS_ASSERT( (wheel.advance(far).size() == 1) );
+}
+
+void verify_next_deadline()
+{
+  TimingWheel wheel(10);
+  const boost::int64_t start = TimingWheel::now();
+  REMUS_ASSERT( (wheel.nextDeadline() == -1) );
+
+  //deadlines in the lowest level are reported rounded up to their tick
+  wheel.schedule(make_socketId(0), start + 1000);
+  wheel.schedule(make_socketId(1), start + 50);
+  const boost::int64_t next = wheel.nextDeadline();
+  REMUS_ASSERT( (next >= start + 50 && next < start + 60) );
+  REMUS_ASSERT( (wheel.advance(next).size() == 1) );
+
+  //a deadline in a higher level is never reported late, and waking up at
+  //the reported times eventually reaches the deadline
+  boost::int64_t wakeups = 0;
+  std::size_t numExpired = 0;
+  while(!wheel.empty() && wakeups < 10)
+    {
+    const boost::int64_t t = wheel.nextDeadline();
+    REMUS_ASSERT( (t <= start + 1010) );
+    numExpired += wheel.advance(t).size();
+    ++wakeups;
+    }
+  REMUS_ASSERT( (numExpired == 1) );
+  REMUS_ASSERT( (wheel.nextDeadline() == -1) );
+}
+
+}
+
+int UnitTestTimingWheel(int, char *[])
+{
+  verify_basic_expiry();
+  verify_reschedule_and_cancel();
+  verify_many_deadlines();
+  verify_far_deadline();
+  verify_next_deadline();
+  return 0;
+}
@@ -0,0 +1,97 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/WarmPool.h>
+
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+
+typedef remus::server::detail::WarmPool WarmPool;
+
+const remus::proto::JobRequirements worker_type2D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh2D()),
+                                                  "", "" );
+const remus::proto::JobRequirements worker_type3D(ContentFormat::User,
+                                                  MeshIOType(Edges(),Mesh3D()),
+                                                  "", "" );
+
+//makes a socket identity from a number
+zmq::SocketIdentity make_socketId(int i)
+{
+  const std::string str_id = boost::lexical_cast<std::string>(i);
+  return zmq::SocketIdentity(str_id.c_str(),str_id.size());
+}
+
+void verify_launch_and_ready()
+{
+  WarmPool pool;
+  REMUS_ASSERT( (pool.size() == 0) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 0, 1000) == 0) );
+  REMUS_ASSERT( (pool.registered(make_socketId(0), worker_type2D) == false) );
+
+  pool.launched(worker_type2D, 0);
+  pool.launched(worker_type2D, 10);
+  pool.launched(worker_type3D, 10);
+  REMUS_ASSERT( (pool.size() == 3) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 20, 1000) == 2) );
+  REMUS_ASSERT( (pool.starting(worker_type3D, 20, 1000) == 1) );
+
+  //a registered worker is still starting until it asks for a job
+  REMUS_ASSERT( (pool.registered(make_socketId(0), worker_type2D) == true) );
+  REMUS_ASSERT( (pool.registered(make_socketId(0), worker_type2D) == false) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 20, 1000) == 2) );
+  REMUS_ASSERT( (pool.ready(make_socketId(0)) == true) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 20, 1000) == 1) );
+
+  //asking for more jobs later doesn't count as another worker starting
+  REMUS_ASSERT( (pool.ready(make_socketId(0)) == false) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 20, 1000) == 1) );
+
+  REMUS_ASSERT( (pool.registered(make_socketId(1), worker_type3D) == true) );
+  REMUS_ASSERT( (pool.ready(make_socketId(1)) == true) );
+  REMUS_ASSERT( (pool.starting(worker_type3D, 20, 1000) == 0) );
+  REMUS_ASSERT( (pool.size() == 1) );
+
+  pool.clear();
+  REMUS_ASSERT( (pool.size() == 0) );
+}
+
+void verify_failed_launches_expire()
+{
+  //workers that never ask for a job are forgotten once the timeout passes,
+  //so that the server will launch replacements for them
+  WarmPool pool;
+  pool.launched(worker_type2D, 0);
+  pool.launched(worker_type2D, 500);
+  pool.registered(make_socketId(0), worker_type2D);
+  REMUS_ASSERT( (pool.starting(worker_type2D, 1000, 1000) == 2) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 1001, 1000) == 1) );
+  REMUS_ASSERT( (pool.starting(worker_type2D, 1501, 1000) == 0) );
+  REMUS_ASSERT( (pool.size() == 0) );
+}
+
+}
+
+int UnitTestWarmPool(int, char *[])
+{
+  verify_launch_and_ready();
+  verify_failed_launches_expire();
+  return 0;
+}
@@ -13,6 +13,7 @@
 
 #include <remus/common/SleepFor.h>
 #include <remus/proto/zmqSocketIdentity.h>
+#include <remus/server/detail/TimingWheel.h>
 #include <remus/server/detail/uuidHelper.h>
 
 #include <remus/testing/Testing.h>
@@ -85,6 +86,7 @@ void verify_has_workers()
   pool.readyForWork(worker1_id, worker_type3D);
   REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == true) );
   REMUS_ASSERT( (pool.haveWaitingWorker(worker_type3D) == true) );
+  REMUS_ASSERT( (pool.numberOfWaitingWorkers(worker_type2D) == 1) );
   REMUS_ASSERT( (pool.supportedIOTypes().size() == 2) )
 
 }
@@ -178,6 +180,40 @@ void verify_purge_workers()
   REMUS_ASSERT( (pool.allWorkersWantingWork().size() == 1) );
 }
 
+void verify_update_workers()
+{
+  //verify that liveness changes from the monitor are applied to the pool
+  remus::server::detail::WorkerPool pool;
+  zmq::SocketIdentity worker1_id = make_socketId();
+  zmq::SocketIdentity worker2_id = make_socketId();
+
+  pool.addWorker(worker1_id, worker_type2D);
+  pool.addWorker(worker2_id, worker_type3D);
+  pool.readyForWork(worker1_id, worker_type2D);
+  pool.readyForWork(worker2_id, worker_type3D);
+
+  typedef remus::server::detail::SocketMonitor::LivenessChanges ChangesType;
+  ChangesType changes;
+  changes.Unresponsive.push_back(worker1_id);
+  pool.updateWorkers(changes);
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == false) );
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type3D) == true) );
+  REMUS_ASSERT( (pool.allResponsiveWorkers().size() == 1) );
+
+  //a worker that came back is responsive again
+  changes = ChangesType();
+  changes.Responsive.push_back(worker1_id);
+  pool.updateWorkers(changes);
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == true) );
+
+  //dead workers are removed
+  changes = ChangesType();
+  changes.Dead.push_back(worker2_id);
+  pool.updateWorkers(changes);
+  REMUS_ASSERT( (pool.allWorkers().size() == 1) );
+  REMUS_ASSERT( (pool.haveWorker(worker2_id, worker_type3D) == false) );
+}
+
 void verify_taking_works()
 {
   remus::server::detail::WorkerPool pool;
@@ -263,6 +299,86 @@ void verify_taking_works()
 
 } //namespace
 
+void verify_job_credits()
+{
+  remus::server::detail::WorkerPool pool;
+  zmq::SocketIdentity worker1_id = make_socketId();
+  pool.addWorker(worker1_id, worker_type2D);
+
+  //verify that granting a window of credits lets us take the worker
+  //once per credit
+  pool.readyForWork(worker1_id, worker_type2D, 3);
+  for(int i=0; i < 3; ++i)
+    {
+    REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == true) );
+    zmq::SocketIdentity id = pool.takeWorker(worker_type2D);
+    REMUS_ASSERT( (id == worker1_id) );
+    }
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == false) );
+  REMUS_ASSERT( (pool.allWorkersWantingWork().size() == 0) );
+
+  //verify that credits accumulate across grants
+  pool.readyForWork(worker1_id, worker_type2D, 2);
+  pool.readyForWork(worker1_id, worker_type2D);
+  for(int i=0; i < 3; ++i)
+    {
+    REMUS_ASSERT( (pool.takeWorker(worker_type2D) == worker1_id) );
+    }
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == false) );
+
+  //verify that taking a batch of jobs is limited by the credits
+  pool.readyForWork(worker1_id, worker_type2D, 2);
+  std::size_t numberOfJobs = 5;
+  REMUS_ASSERT( (pool.takeWorker(worker_type2D, numberOfJobs) == worker1_id) );
+  REMUS_ASSERT( (numberOfJobs == 2) );
+  REMUS_ASSERT( (pool.haveWaitingWorker(worker_type2D) == false) );
+
+  numberOfJobs = 5;
+  REMUS_ASSERT( (pool.takeWorker(worker_type2D, numberOfJobs) ==
+                 zmq::SocketIdentity()) );
+  REMUS_ASSERT( (numberOfJobs == 0) );
+}
+
+void verify_idle_workers()
+{
+  remus::server::detail::WorkerPool pool;
+  zmq::SocketIdentity worker1_id = make_socketId();
+  zmq::SocketIdentity worker2_id = make_socketId();
+  pool.addWorker(worker1_id, worker_type2D);
+  pool.addWorker(worker2_id, worker_type2D);
+
+  //workers that haven't asked for a job aren't idle
+  const boost::int64_t future = remus::server::detail::TimingWheel::now() + 1000;
+  std::set<zmq::SocketIdentity> busy;
+  REMUS_ASSERT( (pool.idleWorkers(future, busy).empty()) );
+
+  pool.readyForWork(worker1_id, worker_type2D);
+  pool.readyForWork(worker2_id, worker_type2D);
+  REMUS_ASSERT( (pool.idleWorkers(future, busy)[worker_type2D].size() == 2) );
+
+  //workers that became active after the idle time aren't idle, and
+  //busy workers are skipped
+  const boost::int64_t past = remus::server::detail::TimingWheel::now() - 1000;
+  REMUS_ASSERT( (pool.idleWorkers(past, busy).empty()) );
+  busy.insert(worker1_id);
+  REMUS_ASSERT( (pool.idleWorkers(future, busy)[worker_type2D].size() == 1) );
+
+  //workers with multiple slots, or shared by unknown workers, are never
+  //idle as a whole
+  pool.numberOfSlots(worker2_id, 4);
+  REMUS_ASSERT( (pool.idleWorkers(future, busy).empty()) );
+  pool.numberOfSlots(worker2_id, 0);
+  REMUS_ASSERT( (pool.idleWorkers(future, busy).empty()) );
+  pool.numberOfSlots(worker2_id, 1);
+  REMUS_ASSERT( (pool.idleWorkers(future, busy)[worker_type2D].size() == 1) );
+
+  //removed workers are gone from the pool
+  REMUS_ASSERT( (pool.removeWorker(worker2_id) == true) );
+  REMUS_ASSERT( (pool.removeWorker(worker2_id) == false) );
+  REMUS_ASSERT( (pool.allWorkers().size() == 1) );
+  REMUS_ASSERT( (pool.idleWorkers(future, busy).empty()) );
+}
+
 int UnitTestWorkerPool(int, char *[])
 {
   verify_has_workers();
@@ -270,8 +386,13 @@ int UnitTestWorkerPool(int, char *[])
   verify_has_worker_type();
 
   verify_purge_workers();
+  verify_update_workers();
 
   verify_taking_works();
 
+  verify_job_credits();
+
+  verify_idle_workers();
+
   return 0;
 }
@@ -0,0 +1,177 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/detail/Zygote.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+
+#ifdef __linux__
+# include <fstream>
+# include <sstream>
+#endif
+
+#ifndef _WIN32
+# include <signal.h>
+#endif
+
+namespace
+{
+typedef remus::server::detail::Zygote Zygote;
+
+//the pid of the parent of the given process, or -1 if it can't be found
+int parent_of(int pid)
+{
+#ifdef __linux__
+  std::ostringstream path;
+  path << "/proc/" << pid << "/stat";
+  std::ifstream stat(path.str().c_str());
+
+  //the command name can hold spaces, so skip to the closing parenthesis
+  std::string line;
+  std::getline(stat, line);
+  const std::string::size_type end = line.rfind(')');
+  if(end == std::string::npos)
+    {
+    return -1;
+    }
+  std::istringstream fields(line.substr(end + 1));
+  char state;
+  int ppid = -1;
+  fields >> state >> ppid;
+  return ppid;
+#else
+  (void) pid;
+  return -1;
+#endif
+}
+
+//wait for a worker that was killed to exit
+bool wait_for_exit(const remus::server::detail::ForkedWorker& worker)
+{
+  for(int i=0; i < 100 && worker.isAlive(); ++i)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  return !worker.isAlive();
+}
+
+void verify_forking()
+{
+  std::vector<std::string> args(1, "LOOP_FOREVER");
+  std::map<std::string,std::string> env;
+  Zygote zygote(REMUS_TEST_WORKER, args, env);
+
+  //nothing can be forked before the zygote is started
+  REMUS_ASSERT( (!zygote.isAlive()) );
+  REMUS_ASSERT( (!zygote.fork()) );
+
+  REMUS_ASSERT( (zygote.start()) );
+  REMUS_ASSERT( (zygote.isAlive()) );
+  REMUS_ASSERT( (zygote.ready(10000)) );
+
+  //forking doesn't wait for the zygote, the workers are pending until
+  //the answers are collected
+  Zygote::ForkedWorkerPtr first = zygote.fork();
+  Zygote::ForkedWorkerPtr second = zygote.fork();
+  REMUS_ASSERT( (first && second) );
+  REMUS_ASSERT( (zygote.pendingForks() == 2) );
+  REMUS_ASSERT( (first->isAlive() && first->processId() == -1) );
+
+  zygote.collect(5000);
+  REMUS_ASSERT( (zygote.pendingForks() == 0) );
+  REMUS_ASSERT( (!first->pending() && !second->pending()) );
+  REMUS_ASSERT( (first->processId() > 0) );
+  REMUS_ASSERT( (second->processId() > 0) );
+  REMUS_ASSERT( (first->processId() != second->processId()) );
+  REMUS_ASSERT( (first->descriptor() >= 0) );
+  REMUS_ASSERT( (first->isAlive()) );
+  REMUS_ASSERT( (second->isAlive()) );
+
+#ifdef __linux__
+  REMUS_ASSERT( (parent_of(first->processId()) == zygote.processId()) );
+#endif
+
+  //the pidfd sees the worker exit once the zygote has reaped it
+  REMUS_ASSERT( (first->kill()) );
+  REMUS_ASSERT( (wait_for_exit(*first)) );
+  REMUS_ASSERT( (!first->kill()) );
+  REMUS_ASSERT( (second->isAlive()) );
+
+  //a worker killed while pending is killed once it is forked
+  Zygote::ForkedWorkerPtr third = zygote.fork();
+  REMUS_ASSERT( (third && third->kill()) );
+  zygote.collect(5000);
+  REMUS_ASSERT( (third->processId() > 0) );
+  REMUS_ASSERT( (wait_for_exit(*third)) );
+
+  //workers outlive their zygote
+  const int zygotePid = zygote.processId();
+  zygote.start();
+  REMUS_ASSERT( (zygote.processId() != zygotePid) );
+  REMUS_ASSERT( (second->isAlive()) );
+  REMUS_ASSERT( (second->kill()) );
+  REMUS_ASSERT( (wait_for_exit(*second)) );
+
+  //requests the zygote can no longer answer fail their workers
+  REMUS_ASSERT( (zygote.ready(10000)) );
+  Zygote::ForkedWorkerPtr orphan = zygote.fork();
+  REMUS_ASSERT( (orphan) );
+  ::kill(zygote.processId(), SIGKILL);
+  for(int i=0; i < 100 && orphan->pending(); ++i)
+    {
+    zygote.collect(50);
+    }
+  if(orphan->processId() > 0)
+    { //the zygote answered before it was killed
+    REMUS_ASSERT( (orphan->kill()) );
+    }
+  else
+    {
+    REMUS_ASSERT( (!orphan->pending() && !orphan->isAlive()) );
+    }
+}
+
+void verify_invalid_executable()
+{
+  std::vector<std::string> args;
+  std::map<std::string,std::string> env;
+  Zygote zygote("/asdaaf/TestWorker", args, env);
+
+  //posix_spawn either fails outright, or the child exits before it is ready
+  if(zygote.start())
+    {
+    REMUS_ASSERT( (!zygote.ready(5000)) );
+    }
+  REMUS_ASSERT( (!zygote.fork()) );
+  REMUS_ASSERT( (zygote.pendingForks() == 0) );
+}
+
+}
+
+int UnitTestZygote(int, char *[])
+{
+#ifndef _WIN32
+  //forked workers are handed to us as pidfds
+#ifdef __linux__
+  verify_forking();
+#endif
+  verify_invalid_executable();
+#else
+  //zygotes need fork
+  std::vector<std::string> args;
+  std::map<std::string,std::string> env;
+  Zygote zygote(REMUS_TEST_WORKER, args, env);
+  REMUS_ASSERT( (!zygote.start()) );
+#endif
+  return 0;
+}
@@ -0,0 +1,105 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/common/SignalCatcher.h>
+#include <remus/server/PortNumbers.h>
+#include <remus/server/WorkerProxy.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <iostream>
+#include <string>
+
+namespace
+{
+//stops the proxy on SIGINT and SIGTERM, so that it terminates its workers
+class ProxySignals : public remus::common::SignalCatcher
+{
+public:
+  ProxySignals(remus::server::WorkerProxy& proxy): Proxy(proxy)
+    { this->StartCatchingSignals(); }
+  ~ProxySignals()
+    { this->StopCatchingSignals(); }
+
+protected:
+  virtual void SignalCaught(SignalCatcher::SignalType)
+    { this->Proxy.stop(); }
+
+private:
+  remus::server::WorkerProxy& Proxy;
+};
+
+void usage()
+{
+  std::cerr << "usage: remus-proxy [--host <host>] [--port <port>]\n"
+               "                   [--heartbeat <ms>] <server worker endpoint>\n"
+               "\n"
+               "Connects to the worker endpoint of a server, such as\n"
+               "tcp://server:50510, and lets workers connect to the proxy\n"
+               "instead. The server sees a single worker with a slot for every\n"
+               "job the workers of the proxy ask for. Workers connect on all\n"
+               "interfaces, on the first free port starting at 50510."
+            << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  std::string host = "*";
+  int port = remus::server::WORKER_PORT;
+  boost::int64_t heartbeat = -1;
+  std::string serverEndpoint;
+
+  try
+    {
+    for(int i=1; i < argc; ++i)
+      {
+      const std::string arg(argv[i]);
+      const bool hasValue = (i + 1 < argc);
+      if(arg == "--host" && hasValue)
+        { host = argv[++i]; }
+      else if(arg == "--port" && hasValue)
+        { port = boost::lexical_cast<int>(argv[++i]); }
+      else if(arg == "--heartbeat" && hasValue)
+        { heartbeat = boost::lexical_cast<boost::int64_t>(argv[++i]); }
+      else if(arg.compare(0, 2, "--") == 0 || !serverEndpoint.empty())
+        { usage(); return 1; }
+      else
+        { serverEndpoint = arg; }
+      }
+    }
+  catch(boost::bad_lexical_cast&)
+    {
+    usage();
+    return 1;
+    }
+
+  if(serverEndpoint.empty())
+    {
+    usage();
+    return 1;
+    }
+
+  remus::server::WorkerProxy proxy(serverEndpoint, host, port);
+  if(heartbeat > 0)
+    {
+    proxy.heartbeatInterval(heartbeat);
+    }
+
+  ProxySignals signals(proxy);
+  std::cout << "Proxy for " << serverEndpoint << " accepting workers on "
+            << proxy.workerEndpoint() << std::endl;
+  proxy.run();
+  return 0;
+}
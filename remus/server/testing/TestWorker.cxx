@@ -14,6 +14,7 @@
 
 #include <remus/common/SleepFor.h>
 #include <remus/testing/Testing.h>
+#include <remus/worker/Zygote.h>
 
 #include <stdlib.h>
 
@@ -21,6 +22,16 @@
 
 int main(int argc, char** argv)
 {
+  //when launched as a zygote only the forked workers return
+  remus::worker::runZygote();
+
+  //workers launched for a server get its endpoint as the first argument
+  if(argc == 3 && std::string(argv[1]).find("://") != std::string::npos)
+    {
+    --argc;
+    ++argv;
+    }
+
   if(argc == 2)
     {
     std::string prog_type(argv[1]);
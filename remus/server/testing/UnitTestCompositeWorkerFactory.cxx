@@ -0,0 +1,216 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/CompositeWorkerFactory.h>
+#include <remus/server/ThreadWorkerFactory.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+//configured file that gives us the path to the worker to test with
+#include "UnitTestWorkerFactoryPaths.h"
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+using remus::server::CompositeWorkerFactory;
+using remus::server::RoutingPolicy;
+using remus::server::ThreadWorkerFactory;
+
+const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+template<typename In, typename Out>
+remus::proto::JobRequirements make_Reqs(In in, Out out, const std::string& wname = "TestWorker")
+{
+  return remus::proto::make_JobRequirements( MeshIOType(in,out),
+                                             wname,
+                                             std::string());
+}
+
+void sleep_worker(const remus::proto::JobRequirements&, const std::string&)
+{
+  SleepForMillisec(500);
+}
+
+//a composite of two thread factories, one standing in for a factory that
+//isolates crashes, so that the test doesn't depend on launching processes
+struct Composite
+{
+  Composite():
+    Factory(),
+    Threads(boost::make_shared<ThreadWorkerFactory>()),
+    Isolated(boost::make_shared<ThreadWorkerFactory>())
+  {
+    this->Threads->setMaxWorkerCount(2);
+    this->Isolated->setMaxWorkerCount(2);
+    this->Factory.setMaxWorkerCount(10);
+    this->Factory.addFactory(this->Threads, false);
+    this->Factory.addFactory(this->Isolated, true);
+  }
+
+  void registerWorkerType(const remus::proto::JobRequirements& reqs,
+                          bool threads, bool isolated)
+  {
+    if(threads) { this->Threads->registerWorkerType(reqs, &sleep_worker); }
+    if(isolated) { this->Isolated->registerWorkerType(reqs, &sleep_worker); }
+  }
+
+  CompositeWorkerFactory Factory;
+  boost::shared_ptr<ThreadWorkerFactory> Threads;
+  boost::shared_ptr<ThreadWorkerFactory> Isolated;
+};
+
+void test_routing_policy()
+{
+  remus::proto::JobRequirements reqs = make_Reqs(Edges(),Mesh2D());
+  RoutingPolicy policy;
+
+  //jobs without any history are assumed to be expensive
+  REMUS_ASSERT( (policy.estimatedCost(reqs) == -1) );
+  REMUS_ASSERT( (policy.preferIsolation(reqs, -1)) );
+  REMUS_ASSERT( (!policy.preferIsolation(reqs, 50)) );
+  REMUS_ASSERT( (policy.preferIsolation(reqs, 500)) );
+
+  //an estimate wins over the history
+  policy.estimatedCost(reqs, 10);
+  REMUS_ASSERT( (!policy.preferIsolation(reqs, 500)) );
+
+  //large payloads are isolated
+  REMUS_ASSERT( (policy.estimatedPayloadSize(reqs) == 0) );
+  policy.estimatedPayloadSize(reqs, 2 * policy.cheapPayloadSize());
+  REMUS_ASSERT( (policy.preferIsolation(reqs, 500)) );
+  policy.estimatedPayloadSize(reqs, 1);
+
+  //as are workers that ask for it
+  policy.crashIsolation(reqs, RoutingPolicy::PreferIsolation);
+  REMUS_ASSERT( (policy.preferIsolation(reqs, 10)) );
+  policy.crashIsolation(reqs, RoutingPolicy::DecideByCost);
+  REMUS_ASSERT( (!policy.preferIsolation(reqs, 10)) );
+}
+
+void test_aggregation()
+{
+  remus::proto::JobRequirements edges = make_Reqs(Edges(),Mesh2D());
+  remus::proto::JobRequirements model = make_Reqs(Model(),Mesh3D());
+  remus::proto::JobRequirements other = make_Reqs(Model(),Mesh3D(),"Other");
+
+  Composite c;
+  c.registerWorkerType(edges, true, true);
+  c.registerWorkerType(model, true, false);
+  c.registerWorkerType(other, false, true);
+
+  REMUS_ASSERT( (c.Factory.numberOfFactories() == 2) );
+  REMUS_ASSERT( (c.Factory.supportedIOTypes().size() == 2) );
+  REMUS_ASSERT( (c.Factory.workerRequirements(model.meshTypes()).size() == 2) );
+  REMUS_ASSERT( (c.Factory.haveSupport(edges)) );
+  REMUS_ASSERT( (c.Factory.haveSupport(other)) );
+  REMUS_ASSERT( (!c.Factory.haveSupport(make_Reqs(Edges(),Mesh3D()))) );
+
+  //the space of both children adds up, limited by the composite
+  REMUS_ASSERT( (c.Factory.spaceFor(edges) == 4) );
+  REMUS_ASSERT( (c.Factory.spaceFor(model) == 2) );
+  c.Factory.setMaxWorkerCount(3);
+  REMUS_ASSERT( (c.Factory.spaceFor(edges) == 3) );
+
+  REMUS_ASSERT( (c.Factory.createWorker(edges, kill)) );
+  REMUS_ASSERT( (c.Factory.createWorker(model, kill)) );
+  REMUS_ASSERT( (c.Factory.currentWorkerCount() == 2) );
+  REMUS_ASSERT( (c.Factory.workerCount(edges) == 1) );
+  REMUS_ASSERT( (c.Factory.workerCount(model) == 1) );
+  REMUS_ASSERT( (c.Factory.spaceFor(edges) == 1) );
+}
+
+void test_cost_based_routing()
+{
+  remus::proto::JobRequirements reqs = make_Reqs(Edges(),Mesh2D());
+  Composite c;
+  c.registerWorkerType(reqs, true, true);
+
+  //unknown jobs go to the isolating factory
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Factory.lastFactoryUsed() == c.Isolated.get()) );
+
+  //once jobs are known to be cheap they run as threads
+  c.Factory.jobFinished(reqs, 5);
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Factory.lastFactoryUsed() == c.Threads.get()) );
+  REMUS_ASSERT( (c.Threads->currentWorkerCount() == 1) );
+
+  //and expensive estimates go back to being isolated
+  RoutingPolicy policy;
+  policy.estimatedCost(reqs, 60000);
+  c.Factory.routingPolicy(policy);
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Factory.lastFactoryUsed() == c.Isolated.get()) );
+  REMUS_ASSERT( (c.Isolated->currentWorkerCount() == 2) );
+
+  //a full preferred factory falls back to the other one
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Factory.lastFactoryUsed() == c.Threads.get()) );
+}
+
+void test_required_isolation()
+{
+  remus::proto::JobRequirements reqs = make_Reqs(Edges(),Mesh2D());
+  remus::proto::JobRequirements threadOnly = make_Reqs(Edges(),Mesh2D(),"Threads");
+  Composite c;
+  c.registerWorkerType(reqs, true, true);
+  c.registerWorkerType(threadOnly, true, false);
+
+  RoutingPolicy policy;
+  policy.crashIsolation(reqs, RoutingPolicy::RequireIsolation);
+  policy.crashIsolation(threadOnly, RoutingPolicy::RequireIsolation);
+  c.Factory.routingPolicy(policy);
+
+  //workers that require isolation never run as threads
+  REMUS_ASSERT( (!c.Factory.haveSupport(threadOnly)) );
+  REMUS_ASSERT( (c.Factory.spaceFor(reqs) == 2) );
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (!c.Factory.createWorker(reqs, kill)) );
+  REMUS_ASSERT( (c.Threads->currentWorkerCount() == 0) );
+}
+
+void test_process_children()
+{
+  //a composite with a process factory exposes its exit descriptor
+  boost::shared_ptr<remus::server::WorkerFactory> processes =
+                      boost::make_shared<remus::server::WorkerFactory>(".tst");
+  processes->addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+
+  CompositeWorkerFactory factory;
+  REMUS_ASSERT( (factory.workerExitDescriptor() == -1) );
+  factory.addFactory(processes, true);
+  REMUS_ASSERT( ((factory.workerExitDescriptor() >= 0) ==
+                 (processes->workerExitDescriptor() >= 0)) );
+  REMUS_ASSERT( (factory.haveSupport(make_Reqs(Edges(),Mesh2D()))) );
+  REMUS_ASSERT( (factory.supportedIOTypes().size() == 1) );
+}
+
+}
+
+int UnitTestCompositeWorkerFactory(int, char *[])
+{
+  test_routing_policy();
+  test_aggregation();
+  test_cost_based_routing();
+  test_required_isolation();
+  test_process_children();
+  return 0;
+}
@@ -19,6 +19,7 @@
 #include <remus/server/detail/WorkerPool.h>
 
 #include <iostream>
+#include <limits>
 
 namespace {
 
@@ -150,6 +151,72 @@ void test_derived_factory()
   REMUS_ASSERT( (factory.currentWorkerCount() <  factory.maxWorkerCount()) );
 }
 
+void test_scaling_policy()
+{
+  remus::server::ScalingPolicy policy;
+  REMUS_ASSERT( (policy.queueDrainTime() == 1000) );
+  REMUS_ASSERT( (policy.idleTimeout() == 0) );
+
+  //with no job history we want a worker per queued job
+  REMUS_ASSERT( (policy.workersNeeded(0, -1) == 0) );
+  REMUS_ASSERT( (policy.workersNeeded(1000, -1) == 1000) );
+
+  //otherwise just enough workers to drain the queue in time
+  REMUS_ASSERT( (policy.workersNeeded(1000, 10) == 10) );
+  REMUS_ASSERT( (policy.workersNeeded(1001, 10) == 11) );
+  REMUS_ASSERT( (policy.workersNeeded(5, 10) == 1) );
+  REMUS_ASSERT( (policy.workersNeeded(5, 0) == 1) );
+  REMUS_ASSERT( (policy.workersNeeded(5, 60000) == 5) );
+  policy.queueDrainTime(100);
+  REMUS_ASSERT( (policy.workersNeeded(1000, 10) == 100) );
+
+  remus::proto::JobRequirements edges_twod = make_Reqs(Edges(),Mesh2D());
+  remus::proto::JobRequirements twod_twod = make_Reqs(Mesh2D(),Mesh2D());
+  REMUS_ASSERT( (policy.maxWorkerCount(edges_twod) ==
+                 std::numeric_limits<unsigned int>::max()) );
+  policy.maxWorkerCount(edges_twod, 10);
+  REMUS_ASSERT( (policy.maxWorkerCount(edges_twod) == 10) );
+}
+
+void test_factory_scaling()
+{
+  DoNothingFactory factory;
+  factory.setMaxWorkerCount(100);
+
+  remus::proto::JobRequirements edges_twod = make_Reqs(Edges(),Mesh2D());
+  remus::proto::JobRequirements twod_twod = make_Reqs(Mesh2D(),Mesh2D());
+
+  remus::server::ScalingPolicy policy;
+  policy.maxWorkerCount(edges_twod, 10);
+  factory.scalingPolicy(policy);
+  REMUS_ASSERT( (factory.scalingPolicy().maxWorkerCount(edges_twod) == 10) );
+
+  //a burst of jobs ramps to the cap of the requirements, or the max of
+  //the factory, in a single step
+  REMUS_ASSERT( (factory.workersToLaunch(edges_twod, 0) == 0) );
+  REMUS_ASSERT( (factory.workersToLaunch(edges_twod, 1000) == 10) );
+  REMUS_ASSERT( (factory.workersToLaunch(twod_twod, 1000) == 100) );
+  REMUS_ASSERT( (factory.haveSpaceFor(edges_twod)) );
+
+  //once jobs have finished, we scale to how long they take
+  REMUS_ASSERT( (factory.averageJobDuration(twod_twod) < 0) );
+  factory.jobFinished(twod_twod, 10);
+  REMUS_ASSERT( (factory.averageJobDuration(twod_twod) == 10) );
+  REMUS_ASSERT( (factory.workersToLaunch(twod_twod, 1000) == 10) );
+  REMUS_ASSERT( (factory.workersToLaunch(twod_twod, 5) == 1) );
+
+  //the average follows changes in duration
+  for(int i=0; i < 100; ++i)
+    { factory.jobFinished(twod_twod, 1000); }
+  REMUS_ASSERT( (factory.averageJobDuration(twod_twod) > 900) );
+  REMUS_ASSERT( (factory.workersToLaunch(twod_twod, 50) == 50) );
+
+  //a full factory launches nothing
+  factory.setMaxWorkerCount(0);
+  REMUS_ASSERT( (factory.workersToLaunch(twod_twod, 50) == 0) );
+  REMUS_ASSERT( (!factory.haveSpaceFor(twod_twod)) );
+}
+
 void test_server_using_derived_factory()
 {
   boost::shared_ptr<DoNothingFactory> factory(new DoNothingFactory());
@@ -177,6 +244,9 @@ int UnitTestCustomWorkerFactory(int, char *[])
   //Test server construction
   test_derived_factory();
 
+  test_scaling_policy();
+  test_factory_scaling();
+
   test_server_using_derived_factory();
   return 0;
 }
@@ -0,0 +1,205 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/server/Agent.h>
+#include <remus/server/PortNumbers.h>
+#include <remus/server/RemoteWorkerFactory.h>
+#include <remus/server/ServerPorts.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/common/ExecuteProcess.h>
+#include <remus/common/SleepFor.h>
+#include <remus/common/Timer.h>
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+
+//configured file that gives us the path to the worker to test with
+#include "UnitTestWorkerFactoryPaths.h"
+
+namespace
+{
+using namespace remus::common;
+using namespace remus::meshtypes;
+using remus::server::Agent;
+using remus::server::RemoteWorkerFactory;
+
+const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+//the time we wait for agents to report, which is far longer than their
+//heartbeat
+const boost::int64_t reportTimeout = 10000;
+
+//an agent launching the ".agt" test workers, running on its own thread
+//like it would in its own process on another host
+struct RunningAgent
+{
+  RunningAgent(const std::string& name, const std::string& endpoint):
+    Factory(boost::make_shared<remus::server::WorkerFactory>(".agt")),
+    Instance(name, endpoint, Factory),
+    Thread()
+  {
+    this->Factory->addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+    this->Factory->setMaxWorkerCount(2);
+    this->Instance.heartbeatInterval(100);
+    this->Thread.reset(new boost::thread(&Agent::run, &this->Instance));
+  }
+
+  ~RunningAgent()
+  {
+    this->stop();
+  }
+
+  void stop()
+  {
+    if(this->Thread)
+      {
+      this->Instance.stop();
+      this->Thread->join();
+      this->Thread.reset();
+      }
+  }
+
+  boost::shared_ptr<remus::server::WorkerFactory> Factory;
+  Agent Instance;
+  boost::scoped_ptr<boost::thread> Thread;
+};
+
+remus::proto::JobRequirements agent_worker()
+{
+  remus::server::WorkerFactory factory(".agt");
+  factory.addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+  remus::proto::JobRequirementsSet reqs =
+                      factory.workerRequirements(MeshIOType(Edges(),Mesh2D()));
+  REMUS_ASSERT( (reqs.size() == 1) );
+  return *reqs.begin();
+}
+
+//wait until the agents have reported the given number of agents and workers
+bool wait_for(const RemoteWorkerFactory& factory,
+              std::size_t agents, unsigned int workers)
+{
+  Timer timer;
+  while(timer.elapsed() < reportTimeout)
+    {
+    if(factory.agentNames().size() == agents &&
+       factory.currentWorkerCount() == workers)
+      {
+      return true;
+      }
+    SleepForMillisec(50);
+    }
+  return false;
+}
+
+void test_agents(const remus::proto::JobRequirements& reqs)
+{
+  boost::scoped_ptr<RemoteWorkerFactory> factory(
+    new RemoteWorkerFactory("127.0.0.1", remus::server::AGENT_PORT) );
+  factory->setMaxWorkerCount(10);
+  factory->portForWorkersToUse( remus::server::PortConnection(
+    zmq::socketInfo<zmq::proto::tcp>("127.0.0.1", remus::server::WORKER_PORT)) );
+  const std::string endpoint = factory->agentEndpoint();
+
+  //nothing is supported until agents report
+  REMUS_ASSERT( (factory->agentNames().empty()) );
+  REMUS_ASSERT( (!factory->haveSupport(reqs)) );
+  REMUS_ASSERT( (!factory->createWorker(reqs, kill)) );
+
+  RunningAgent a("a", endpoint);
+  RunningAgent b("b", endpoint);
+  REMUS_ASSERT( (wait_for(*factory, 2, 0)) );
+
+  std::vector<std::string> names = factory->agentNames();
+  REMUS_ASSERT( (names[0] == "a" && names[1] == "b") );
+  REMUS_ASSERT( (factory->haveSupport(reqs)) );
+  REMUS_ASSERT( (factory->supportedIOTypes().size() == 1) );
+  REMUS_ASSERT( (factory->workerRequirements(reqs.meshTypes()).size() == 1) );
+  REMUS_ASSERT( (factory->spaceFor(reqs) == 4) );
+
+  //workers that outlive the factory can't be supported
+  REMUS_ASSERT( (!factory->createWorker(reqs,
+                 remus::server::WorkerFactoryBase::LiveOnFactoryDeletion)) );
+
+  //workers are spread over the agents, until they are all full
+  REMUS_ASSERT( (factory->createWorker(reqs, kill)) );
+  REMUS_ASSERT( (factory->createWorker(reqs, kill)) );
+  REMUS_ASSERT( (factory->agentWorkerCount("a") == 1) );
+  REMUS_ASSERT( (factory->agentWorkerCount("b") == 1) );
+  REMUS_ASSERT( (factory->createWorker(reqs, kill)) );
+  REMUS_ASSERT( (factory->createWorker(reqs, kill)) );
+  REMUS_ASSERT( (!factory->createWorker(reqs, kill)) );
+  REMUS_ASSERT( (factory->workerCount(reqs) == 4) );
+
+  //the agents confirm the workers they launched
+  REMUS_ASSERT( (wait_for(*factory, 2, 4)) );
+  REMUS_ASSERT( (factory->agentWorkerCount("a") == 2) );
+  REMUS_ASSERT( (factory->agentWorkerCount("b") == 2) );
+  REMUS_ASSERT( (factory->spaceFor(reqs) == 0) );
+
+  //deleting the factory kills the workers, which the agents report to the
+  //next factory bound to the same endpoint
+  factory.reset();
+  factory.reset( new RemoteWorkerFactory("127.0.0.1", remus::server::AGENT_PORT) );
+  REMUS_ASSERT( (factory->agentEndpoint() == endpoint) );
+  factory->setMaxWorkerCount(10);
+  REMUS_ASSERT( (wait_for(*factory, 2, 0)) );
+  REMUS_ASSERT( (factory->spaceFor(reqs) == 4) );
+
+  //agents that stop reporting are forgotten
+  factory->agentTimeout(500);
+  b.stop();
+  REMUS_ASSERT( (wait_for(*factory, 1, 0)) );
+  REMUS_ASSERT( (factory->agentNames()[0] == "a") );
+  REMUS_ASSERT( (factory->spaceFor(reqs) == 2) );
+}
+
+void test_agent_executable()
+{
+  RemoteWorkerFactory factory("127.0.0.1", remus::server::AGENT_PORT);
+
+  std::vector<std::string> args;
+  args.push_back("--name");
+  args.push_back("process");
+  args.push_back("--max-workers");
+  args.push_back("1");
+  args.push_back("--extension");
+  args.push_back(".agt");
+  args.push_back("--heartbeat");
+  args.push_back("100");
+  args.push_back(factory.agentEndpoint());
+  args.push_back(remus::server::testing::worker_factory::locationToSearch());
+
+  remus::common::ExecuteProcess agent(REMUS_AGENT_EXECUTABLE, args);
+  agent.execute();
+  REMUS_ASSERT( (wait_for(factory, 1, 0)) );
+  REMUS_ASSERT( (factory.agentNames()[0] == "process") );
+  REMUS_ASSERT( (factory.spaceFor(agent_worker()) == 1) );
+  agent.kill();
+}
+
+}
+
+int UnitTestRemoteWorkerFactory(int, char *[])
+{
+  test_agents(agent_worker());
+  test_agent_executable();
+  return 0;
+}
@@ -15,6 +15,12 @@
 #include <remus/server/WorkerFactory.h>
 #include <remus/testing/Testing.h>
 
+#include <remus/common/SleepFor.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/date_time/posix_time/posix_time.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
 namespace {
 
 //presumes a != b
@@ -99,6 +105,20 @@ void test_server_poll_rates()
   REMUS_ASSERT( (server.pollingRates().maxRate() == original_rates.maxRate()) );
 }
 
+void test_server_heartbeat_sampling()
+{
+  remus::server::Server server;
+
+  //by default every heartbeat is published
+  REMUS_ASSERT( (server.heartbeatPublishSampling() == 1) );
+
+  server.heartbeatPublishSampling(10);
+  REMUS_ASSERT( (server.heartbeatPublishSampling() == 10) );
+
+  server.heartbeatPublishSampling(0);
+  REMUS_ASSERT( (server.heartbeatPublishSampling() == 0) );
+}
+
 void test_server_sig_catching()
 {
   void (*prev_sig_func)(int);
@@ -272,6 +292,25 @@ void test_server_brokering()
 
 }
 
+void test_server_idle_stop()
+{
+  //an idle server blocks waiting for messages instead of waking up on
+  //every poll timeout, so stopping it has to wake the broker up
+  remus::Server s;
+  s.pollingRates( remus::server::PollingRates(60000,60000) );
+  s.startBrokering();
+  remus::common::SleepForMillisec(100);
+
+  const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time();
+  s.stopBrokering();
+  const boost::posix_time::time_duration elapsed =
+      boost::posix_time::microsec_clock::local_time() - start;
+
+  REMUS_ASSERT( (!s.isBrokering()) );
+  REMUS_ASSERT( (elapsed.total_milliseconds() < 5000) );
+}
+
 } //namespace
 
 int UnitTestServer(int, char *[])
@@ -282,6 +321,9 @@ int UnitTestServer(int, char *[])
   //Test server rate changes
   test_server_poll_rates();
 
+  //Test server heartbeat publication sampling
+  test_server_heartbeat_sampling();
+
   //Test server signal catching
   test_server_sig_catching();
 
@@ -290,5 +332,8 @@ int UnitTestServer(int, char *[])
 
   //Test server brokering
   test_server_brokering();
+
+  //Test stopping an idle server doesn't wait for the poll timeout
+  test_server_idle_stop();
   return 0;
 }
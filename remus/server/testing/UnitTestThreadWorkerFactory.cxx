@@ -51,6 +51,15 @@ struct Sleep
   }
 };
 
+struct ThrowInt
+{
+  void operator()(const remus::proto::JobRequirements&,
+                  const std::string&) const
+  {
+    throw 42;
+  }
+};
+
 void test_factory_constructors()
 {
   //verify that all the constructors exist, and behave in the
@@ -190,6 +199,66 @@ void test_shutdown_with_active_killOnFactoryDel_workers()
   //now exit with worker still active
 }
 
+void test_factory_reuses_worker_slots()
+{
+  const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+  remus::server::ThreadWorkerFactory f_def;
+  f_def.setMaxWorkerCount(4);
+
+  remus::proto::JobRequirements raw_edges = make_Reqs(Edges(),Mesh2D());
+  f_def.registerWorkerType(raw_edges,
+                           std::bind(Sleep(),
+                                     std::placeholders::_1,
+                                     std::placeholders::_2,
+                                     50));
+
+  //launch many rounds of short workers, every round should fill the pool
+  //and be rejected once it is full, and the slots should be free again once
+  //the workers have finished
+  for(int round=0; round < 5; ++round)
+    {
+    for(int i=0; i < 4; ++i)
+      {
+      REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+      }
+    REMUS_ASSERT( (f_def.currentWorkerCount() == 4) );
+    REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == false) );
+
+    for(int i=0; i < 100 && f_def.currentWorkerCount() > 0; ++i)
+      {
+      SleepForMillisec(10);
+      }
+    REMUS_ASSERT( (f_def.currentWorkerCount() == 0) );
+    }
+}
+
+void test_workers_throwing_non_std_exceptions()
+{
+  const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+  remus::server::ThreadWorkerFactory f_def;
+  f_def.setMaxWorkerCount(2);
+
+  remus::proto::JobRequirements raw_edges = make_Reqs(Edges(),Mesh2D());
+  f_def.registerWorkerType(raw_edges, ThrowInt());
+
+  //a worker throwing something that isn't a std::exception must not take
+  //down the pool thread, and must still free its slot
+  for(int round=0; round < 3; ++round)
+    {
+    REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+    REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+    for(int i=0; i < 100 && f_def.currentWorkerCount() > 0; ++i)
+      {
+      SleepForMillisec(10);
+      }
+    REMUS_ASSERT( (f_def.currentWorkerCount() == 0) );
+    }
+}
+
 }//namespace
 
 
@@ -205,6 +274,10 @@ int UnitTestThreadWorkerFactory(int, char *[])
 
   test_shutdown_with_active_killOnFactoryDel_workers();
 
+  test_factory_reuses_worker_slots();
+
+  test_workers_throwing_non_std_exceptions();
+
   //if we have reached this line we have a proper worker factory
   return 0;
 }
@@ -14,6 +14,15 @@
 #include <remus/server/WorkerFactory.h>
 #include <remus/testing/Testing.h>
 #include <remus/common/SleepFor.h>
+#include <remus/proto/zmq.hpp>
+
+//force to use filesystem version 3
+REMUS_THIRDPARTY_PRE_INCLUDE
+#define BOOST_FILESYSTEM_VERSION 3
+#include <boost/filesystem.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <fstream>
 
 //configured file that gives us the path to the worker to test with
 #include "UnitTestWorkerFactoryPaths.h"
@@ -115,6 +124,77 @@ void test_factory_worker_finder()
 
 }
 
+void write_worker_file(const boost::filesystem::path& file,
+                       const std::string& outputType,
+                       const std::string& workerName)
+{
+  std::ofstream f(file.string().c_str());
+  f << "{ \"ExecutableName\": \"worker\","
+    << "  \"InputType\": \"Edges\","
+    << "  \"OutputType\": \"" << outputType << "\","
+    << "  \"WorkerName\": \"" << workerName << "\" }";
+}
+
+//keep asking the factory until it picks up the change to the worker files,
+//which is immediate when the directory is watched, and otherwise happens
+//on the next rescan
+bool wait_for_support(remus::server::WorkerFactory& factory,
+                      const remus::proto::JobRequirements& reqs,
+                      bool supported)
+{
+  for(int i=0; i < 100 && factory.haveSupport(reqs) != supported; ++i)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  return factory.haveSupport(reqs) == supported;
+}
+
+void test_factory_worker_reload()
+{
+  boost::filesystem::path dir(
+                  remus::server::testing::worker_factory::locationToSearch() );
+  dir /= "reload_workers";
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directory(dir);
+
+  //worker files are only valid when their executable exists, which is
+  //found next to the worker file
+  std::ofstream((dir / "worker").string().c_str());
+
+  remus::server::WorkerFactory f_def(".hot");
+  f_def.addWorkerSearchDirectory(dir.string());
+  REMUS_ASSERT( (f_def.supportedIOTypes().size() == 0) );
+
+  //a worker file added while the factory runs is picked up
+  remus::proto::JobRequirements first = make_Reqs(Edges(),Mesh2D(),"First");
+  write_worker_file(dir / "first.hot", "Mesh2D", "First");
+  REMUS_ASSERT( (wait_for_support(f_def, first, true)) );
+
+  //changing the worker file replaces the old worker
+  remus::proto::JobRequirements changed = make_Reqs(Edges(),Mesh3D(),"First");
+  write_worker_file(dir / "first.hot", "Mesh3D", "First");
+  REMUS_ASSERT( (wait_for_support(f_def, changed, true)) );
+  REMUS_ASSERT( (f_def.haveSupport(first) == false) );
+  REMUS_ASSERT( (f_def.supportedIOTypes().size() == 1) );
+
+  //worker files moved into place are picked up, and indexed by type
+  remus::proto::JobRequirements second = make_Reqs(Edges(),Mesh2D(),"Second");
+  write_worker_file(dir / "second.tmp", "Mesh2D", "Second");
+  boost::filesystem::rename(dir / "second.tmp", dir / "second.hot");
+  REMUS_ASSERT( (wait_for_support(f_def, second, true)) );
+  REMUS_ASSERT( (f_def.supportedIOTypes().size() == 2) );
+  REMUS_ASSERT( (f_def.workerRequirements(second.meshTypes()).size() == 1) );
+  REMUS_ASSERT( (f_def.workerRequirements(changed.meshTypes()).size() == 1) );
+
+  //removing a worker file removes the worker
+  boost::filesystem::remove(dir / "first.hot");
+  REMUS_ASSERT( (wait_for_support(f_def, changed, false)) );
+  REMUS_ASSERT( (f_def.haveSupport(second)) );
+  REMUS_ASSERT( (f_def.supportedIOTypes().size() == 1) );
+
+  boost::filesystem::remove_all(dir);
+}
+
 void test_factory_worker_args_env_tag()
 {
   //give our worker factory a unique extension to look for
@@ -294,6 +374,141 @@ void test_factory_worker_launching()
     }
 }
 
+void test_factory_worker_exit_descriptor()
+{
+  const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+  remus::server::WorkerFactory f_def(".tst");
+  f_def.addCommandLineArgument("SLEEP_AND_EXIT");
+  f_def.addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+
+  const int fd = f_def.workerExitDescriptor();
+  if(fd < 0)
+    { //exit notification isn't supported on this system
+    return;
+    }
+
+  remus::proto::JobRequirements raw_edges = make_Reqs(Edges(),Mesh2D());
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.currentWorkerCount() == 1) );
+
+  //the descriptor becomes readable once the worker exits, at which point
+  //a single update frees the slot
+  zmq::pollitem_t item = { NULL, 0, ZMQ_POLLIN, 0 };
+  item.fd = fd;
+  REMUS_ASSERT( (zmq::poll(&item, 1, 10000) == 1) );
+  f_def.updateWorkerCount();
+  REMUS_ASSERT( (f_def.currentWorkerCount() == 0) );
+}
+
+void test_factory_zygote_workers()
+{
+  const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+  remus::server::WorkerFactory f_def(".zyg");
+  f_def.setMaxWorkerCount(3);
+  f_def.addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+
+  //the first worker is launched while the zygote starts up
+  remus::proto::JobRequirements raw_edges = make_Reqs(Edges(),Mesh2D());
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.currentWorkerCount() == 1) );
+
+  //once the zygote is ready workers are forked from it, and they are
+  //tracked just like launched workers
+  remus::common::SleepForMillisec(500);
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == false) );
+
+  remus::common::SleepForMillisec(250);
+  f_def.updateWorkerCount();
+  REMUS_ASSERT( (f_def.currentWorkerCount() == 3) );
+}
+
+void test_host_capacity()
+{
+  //the default capacity is unlimited
+  remus::server::HostCapacity unlimited;
+  REMUS_ASSERT( (unlimited.cores() == 0) );
+  REMUS_ASSERT( (unlimited.memory() == 0) );
+  REMUS_ASSERT( (unlimited.workersThatFit(64, 1024, 1, 512) > 1000) );
+
+  //an unreadable proc directory leaves the capacity unlimited
+  remus::server::HostCapacity missing =
+        remus::server::HostCapacity::fromProc("/asdaaf/proc");
+  REMUS_ASSERT( (missing.cores() == 0) );
+  REMUS_ASSERT( (missing.memory() == 0) );
+
+  //the machine we are running on has at least one core
+  REMUS_ASSERT( (remus::server::HostCapacity::discover().cores() >= 1) );
+
+  remus::server::HostCapacity host(4, 1024);
+  REMUS_ASSERT( (host.workersThatFit(0, 0, 1.5, 0) == 2) );
+  REMUS_ASSERT( (host.workersThatFit(3, 0, 1.5, 0) == 0) );
+  REMUS_ASSERT( (host.workersThatFit(0, 0, 0.5, 256) == 4) );
+  REMUS_ASSERT( (host.workersThatFit(0, 900, 0.5, 256) == 0) );
+  REMUS_ASSERT( (host.workersThatFit(0.1+0.2, 0, 0.1, 0) == 37) );
+
+  //a worker bigger than the host can only run by itself
+  REMUS_ASSERT( (host.workersThatFit(0, 0, 8, 0) == 1) );
+  REMUS_ASSERT( (host.workersThatFit(1, 0, 8, 0) == 0) );
+}
+
+void test_factory_worker_limits()
+{
+  const remus::server::WorkerFactoryBase::FactoryDeletionBehavior kill =
+                remus::server::WorkerFactoryBase::KillOnFactoryDeletion;
+
+  //the lim worker file allows 3 workers, each using 1.5 cores and 256MB
+  remus::server::WorkerFactory f_def(".lim");
+  f_def.addCommandLineArgument("SLEEP_AND_EXIT");
+  f_def.addWorkerSearchDirectory(
+                  remus::server::testing::worker_factory::locationToSearch() );
+  f_def.setMaxWorkerCount(10);
+
+  remus::proto::JobRequirements raw_edges = make_Reqs(Edges(),Mesh2D());
+  REMUS_ASSERT( (f_def.haveSupport(raw_edges)) );
+
+  //with an unlimited host the worker file limit applies
+  f_def.hostCapacity( remus::server::HostCapacity() );
+  REMUS_ASSERT( (f_def.spaceFor(raw_edges) == 3) );
+  REMUS_ASSERT( (f_def.workersToLaunch(raw_edges, 10) == 3) );
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.usedCores() == 1.5) );
+  REMUS_ASSERT( (f_def.usedMemory() == 256) );
+  REMUS_ASSERT( (f_def.spaceFor(raw_edges) == 2) );
+
+  //the running worker is enough to drain a queue of fast jobs
+  f_def.jobFinished(raw_edges, 1);
+  REMUS_ASSERT( (f_def.workersToLaunch(raw_edges, 1000) == 0) );
+  REMUS_ASSERT( (f_def.workersToLaunch(raw_edges, 2000) == 1) );
+
+  //a host with 4 cores only has room for one more worker
+  f_def.hostCapacity( remus::server::HostCapacity(4, 0) );
+  REMUS_ASSERT( (f_def.spaceFor(raw_edges) == 1) );
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == true) );
+  REMUS_ASSERT( (f_def.createWorker(raw_edges,kill) == false) );
+  REMUS_ASSERT( (f_def.currentWorkerCount() == 2) );
+
+  //and a host with 512MB of memory is already full
+  f_def.hostCapacity( remus::server::HostCapacity(0, 512) );
+  REMUS_ASSERT( (f_def.haveSpaceFor(raw_edges) == false) );
+
+  //once the workers exit their resources are available again
+  while (f_def.currentWorkerCount() > 0)
+    {
+    SleepForMillisec(5);
+    f_def.updateWorkerCount();
+    }
+  REMUS_ASSERT( (f_def.usedCores() == 0) );
+  REMUS_ASSERT( (f_def.spaceFor(raw_edges) == 2) );
+}
+
 void test_shutdown_with_active_killOnFactoryDel_workers()
 {
   //give our worker factory a unique extension to look for
@@ -358,6 +573,8 @@ int UnitTestWorkerFactory(int, char *[])
 
   test_factory_worker_finder();
 
+  test_factory_worker_reload();
+
   test_factory_worker_file_based_requirements();
 
   test_factory_worker_args_env_tag();
@@ -366,6 +583,14 @@ int UnitTestWorkerFactory(int, char *[])
 
   test_factory_worker_launching();
 
+  test_factory_worker_exit_descriptor();
+
+  test_factory_zygote_workers();
+
+  test_host_capacity();
+
+  test_factory_worker_limits();
+
   std::cout << __LINE__ << std::endl;
   test_shutdown_with_active_killOnFactoryDel_workers();
 
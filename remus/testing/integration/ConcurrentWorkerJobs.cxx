@@ -0,0 +1,197 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/ConcurrentWorker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/uuid/uuid_io.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <vector>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+  const std::size_t numberOfSlots = 4;
+
+//------------------------------------------------------------------------------
+//tracks how many jobs the worker is processing at the same time
+class SlotTracker
+{
+public:
+  SlotTracker(): Mutex(), Active(0), MaxActive(0) { }
+
+  void jobStarted()
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    ++this->Active;
+    this->MaxActive = std::max(this->MaxActive, this->Active);
+  }
+
+  void jobFinished()
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    --this->Active;
+  }
+
+  std::size_t maxActive() const
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    return this->MaxActive;
+  }
+
+private:
+  mutable boost::mutex Mutex;
+  std::size_t Active;
+  std::size_t MaxActive;
+};
+
+//------------------------------------------------------------------------------
+void process_job(SlotTracker* tracker,
+                 remus::worker::ConcurrentWorker& worker,
+                 const remus::worker::Job& job)
+{
+  tracker->jobStarted();
+
+  //hold onto the job until every slot is busy, or we have waited long enough
+  //that we know the worker isn't running the jobs concurrently
+  for(int i=0; i < 100 && tracker->maxActive() < numberOfSlots; ++i)
+    {
+    worker.sendProgress(job, i, "waiting for other slots");
+    remus::common::SleepForMillisec(50);
+    }
+
+  std::ostringstream buffer;
+  buffer << job.id();
+  worker.returnResult( remus::proto::make_JobResult(job.id(), buffer.str()) );
+
+  tracker->jobFinished();
+}
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create the server and start brokering, with a factory that can launch
+  //no workers, so we have to use workers that connect in only
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::Job > submit_Jobs(boost::shared_ptr<remus::Client> client,
+                                             const remus::proto::JobRequirements& reqs)
+{
+  std::vector< remus::proto::Job > jobs;
+  for(std::size_t i=0; i < numberOfSlots; ++i)
+    {
+    remus::proto::JobSubmission sub(reqs);
+    jobs.push_back( client->submitJob(sub) );
+    REMUS_ASSERT( jobs.back().valid() )
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+void verify_results(boost::shared_ptr<remus::Client> client,
+                    const std::vector< remus::proto::Job >& jobs)
+{
+  typedef std::vector< remus::proto::Job >::const_iterator it;
+  for(it job = jobs.begin(); job != jobs.end(); ++job)
+    {
+    bool finished = false;
+    for(int i=0; i < 100 && !finished; ++i)
+      {
+      finished = client->jobStatus(*job).finished();
+      if(!finished)
+        { remus::common::SleepForMillisec(100); }
+      }
+    REMUS_ASSERT( finished )
+
+    std::ostringstream buffer;
+    buffer << job->id();
+
+    remus::proto::JobResult result = client->retrieveResults(*job);
+    REMUS_ASSERT( (result.valid()) )
+    REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == buffer.str()) )
+    }
+}
+
+}
+
+//Verify that a single ConcurrentWorker processes multiple jobs at
+//the same time and reports results for each of them
+int ConcurrentWorkerJobs(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "ConcurrentWorker", "");
+
+  remus::worker::ServerConnection conn =
+              remus::worker::make_ServerConnection(ports.worker().endpoint());
+  remus::worker::ConcurrentWorker worker(reqs, conn, numberOfSlots);
+  REMUS_ASSERT( (worker.numberOfSlots() == numberOfSlots) )
+  REMUS_ASSERT( (worker.activeJobCount() == 0) )
+
+  SlotTracker tracker;
+  boost::thread processing( &remus::worker::ConcurrentWorker::processJobs,
+                            &worker,
+                            remus::worker::ConcurrentWorker::JobProcessor(
+                              boost::bind(process_job, &tracker, _1, _2) ) );
+
+  //wait for the server to process the job requests of the worker, so that
+  //the server knows it can handle jobs with our requirements
+  remus::common::SleepForMillisec(250);
+
+  std::vector< remus::proto::Job > jobs = submit_Jobs(client, reqs);
+  verify_results(client, jobs);
+
+  //every job should have been running at the same time
+  REMUS_ASSERT( (tracker.maxActive() == numberOfSlots) )
+
+  //stopping the server tells the worker to terminate, which should make
+  //processJobs return
+  server->stopBrokering();
+  if(server->isBrokering())
+    {
+    server->waitForBrokeringToFinish();
+    }
+  processing.join();
+  REMUS_ASSERT( (worker.activeJobCount() == 0) )
+
+  return 0;
+}
@@ -22,6 +22,8 @@
 //required to use custom contexts
 #include <remus/proto/zmq.hpp>
 
+#include <remus/proto/DirectTransport.h>
+
 #include <remus/common/SleepFor.h>
 #include <remus/testing/Testing.h>
 #include <remus/testing/integration/detail/Helpers.h>
@@ -203,6 +205,10 @@ void verify_different_connection_types( remus::server::ServerPorts serverPorts )
   remus::proto::Job job = verify_job_submission(client,worker);
   verify_job_processing(job,client,worker);
   verify_job_result(job,client,worker);
+
+  //over inproc connections the jobs and results are handed over directly,
+  //verify that every one of them was claimed by its receiver
+  REMUS_ASSERT( (remus::proto::parked_DirectObjectCount() == 0) )
 }
 
 }
@@ -0,0 +1,198 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/common/Timer.h>
+#include <remus/proto/Message.h>
+#include <remus/proto/Response.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//the time we wait for the servers to exchange their queue summaries and
+//move jobs, which is far longer than the exchange interval
+const boost::int64_t federationTimeout = 10000;
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( const std::string& peer,
+                                              bool forward, bool steal )
+{
+  //create a server with a factory that can launch no workers, so that the
+  //only worker is the one connecting to the peer
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  boost::shared_ptr<remus::Server> server(
+                new remus::Server(remus::server::ServerPorts(),factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  if(!peer.empty())
+    {
+    server->addPeer(peer);
+    }
+  server->peerExchangeInterval(100);
+  server->forwardJobsToPeers(forward);
+  server->stealJobsFromPeers(steal);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+void wait_for_peer_support(boost::shared_ptr<remus::Client> client,
+                           const remus::common::MeshIOType& io_type)
+{
+  remus::common::Timer timer;
+  while(!client->canMesh(io_type) && timer.elapsed() < federationTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (client->canMesh(io_type) == true) );
+}
+
+//------------------------------------------------------------------------------
+//act as a plain client that claims to be the peer running the job, and
+//verify the server doesn't accept the result since it doesn't arrive over
+//the connection of that peer
+void verify_spoofed_result(const remus::server::ServerPorts& ports,
+                           const std::string& peer,
+                           boost::shared_ptr<remus::Client> client,
+                           const remus::proto::Job& clientJob)
+{
+  using namespace remus::proto;
+
+  zmq::context_t context(1);
+  zmq::socket_t spoofer(context, ZMQ_REQ);
+  zmq::connectToAddress(spoofer, ports.client().endpoint());
+  const std::string spoofed = peer + "\n" +
+                      to_string(make_JobResult(clientJob.id(), "spoofed"));
+  send_Message(remus::common::MeshIOType(), remus::FORWARDED_RESULT,
+               spoofed, &spoofer);
+  const Response response = receive_Response(&spoofer);
+  REMUS_ASSERT( (std::string(response.data(), response.dataSize()) ==
+                 remus::INVALID_MSG) )
+  const int linger_duration = 0;
+  spoofer.setsockopt(ZMQ_LINGER, &linger_duration, sizeof(int) );
+
+  REMUS_ASSERT( (client->jobStatus(clientJob).status()!=remus::FINISHED) )
+}
+
+//------------------------------------------------------------------------------
+//submit a job to the server without workers, and verify the worker of its
+//peer runs it while the client only talks to the server it submitted to
+void verify_federated_job(const remus::server::ServerPorts& ports,
+                          const std::string& peer,
+                          boost::shared_ptr<remus::Client> client,
+                          boost::shared_ptr<remus::Worker> worker,
+                          const remus::common::MeshIOType& io_type)
+{
+  using namespace remus::proto;
+
+  //the requirements of the worker on the peer are reported to our client
+  JobRequirementsSet reqsFromServer = client->retrieveRequirements(io_type);
+  REMUS_ASSERT( (reqsFromServer.size()==1) )
+
+  JobSubmission sub((*reqsFromServer.begin()));
+  sub["extra_stuff"] = make_JobContent("random data");
+  Job clientJob = client->submitJob(sub);
+  REMUS_ASSERT( clientJob.valid() )
+
+  //wait for the job to reach the worker of the peer
+  remus::common::Timer timer;
+  while(worker->pendingJobCount() == 0 && timer.elapsed() < federationTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (worker->pendingJobCount()==1) )
+
+  remus::worker::Job workerJob = worker->takePendingJob();
+  REMUS_ASSERT( (workerJob.id() == clientJob.id()) )
+  REMUS_ASSERT( (workerJob.submission() == sub) )
+
+  //only the peer running the job can report on it
+  verify_spoofed_result(ports, peer, client, clientJob);
+
+  //the progress of the worker is proxied back to our client
+  JobStatus workerStatus(clientJob.id(), JobProgress(50));
+  worker->updateStatus(workerStatus);
+  detail::verify_job_status(clientJob,client,remus::IN_PROGRESS);
+  REMUS_ASSERT( (client->jobStatus(clientJob)==workerStatus) )
+
+  //and so is the result
+  const std::string ascii_data = remus::testing::AsciiStringGenerator(4096);
+  worker->returnResult(make_JobResult(clientJob.id(),ascii_data));
+  detail::verify_job_status(clientJob,client,remus::FINISHED);
+
+  JobResult client_results = client->retrieveResults(clientJob);
+  REMUS_ASSERT( (client_results.valid()==true) )
+  const std::string resultText(client_results.data(), client_results.dataSize());
+  REMUS_ASSERT( (resultText==ascii_data) )
+
+  //retrieving the result stops the tracking of the job
+  REMUS_ASSERT( (client->jobStatus(clientJob).status()==remus::INVALID_STATUS) )
+}
+
+//------------------------------------------------------------------------------
+void verify_federation(bool forward, bool steal)
+{
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+
+  //the endpoint of a server is only known once it brokers, so the server
+  //with the worker is told about its peer while brokering
+  boost::shared_ptr<remus::Server> busy, idle;
+  idle = make_Server(std::string(), !forward, steal);
+  busy = make_Server(idle->serverPortInfo().client().endpoint(),
+                     forward, !steal);
+  idle->addPeer(busy->serverPortInfo().client().endpoint());
+  REMUS_ASSERT( (busy->peers().size() == 1) );
+  REMUS_ASSERT( (idle->peers().size() == 1) );
+
+  boost::shared_ptr<remus::Client> client =
+                              detail::make_Client( busy->serverPortInfo() );
+  boost::shared_ptr<remus::Worker> worker =
+        detail::make_Worker( idle->serverPortInfo(), io_type, "FederatedWorker" );
+  worker->askForJobs(1);
+
+  wait_for_peer_support(client, io_type);
+  verify_federated_job(busy->serverPortInfo(),
+                       idle->serverPortInfo().client().endpoint(),
+                       client, worker, io_type);
+}
+
+}
+
+//Verifies that queued jobs move between federated servers, both when the
+//busy server forwards them and when the idle server steals them
+int FederatedServers(int argc, char* argv[])
+{
+  (void) argc;
+  (void) argv;
+
+  //the busy server forwards the job
+  verify_federation(true, false);
+
+  //the idle server steals the job
+  verify_federation(false, true);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Factories.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/uuid/uuid_io.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+  const std::size_t batchSize = 4;
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create a server whose factory claims to support everything but never
+  //creates a worker, so jobs stay queued until our worker asks for them
+  boost::shared_ptr<detail::AlwaysSupportFactory> factory(
+                            new detail::AlwaysSupportFactory("BatchWorker"));
+
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::Job > submit_Jobs(boost::shared_ptr<remus::Client> client,
+                                             const remus::proto::JobRequirements& reqs)
+{
+  std::vector< remus::proto::Job > jobs;
+  for(std::size_t i=0; i < batchSize; ++i)
+    {
+    remus::proto::JobSubmission sub(reqs);
+    jobs.push_back( client->submitJob(sub) );
+    REMUS_ASSERT( jobs.back().valid() )
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+void verify_results(boost::shared_ptr<remus::Client> client,
+                    const std::vector< remus::proto::Job >& jobs)
+{
+  typedef std::vector< remus::proto::Job >::const_iterator it;
+  for(it job = jobs.begin(); job != jobs.end(); ++job)
+    {
+    bool finished = false;
+    for(int i=0; i < 100 && !finished; ++i)
+      {
+      finished = client->jobStatus(*job).finished();
+      if(!finished)
+        { remus::common::SleepForMillisec(50); }
+      }
+    REMUS_ASSERT( finished )
+
+    std::ostringstream buffer;
+    buffer << job->id();
+
+    remus::proto::JobResult result = client->retrieveResults(*job);
+    REMUS_ASSERT( (result.valid()) )
+    REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == buffer.str()) )
+    }
+}
+
+}
+
+//Verify that the server sends queued jobs with the same requirements to a
+//worker in a single batch, and that a batch of results updates each job
+int JobBatching(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "BatchWorker", "");
+
+  REMUS_ASSERT( (server->jobBatchSize(reqs) == 1) )
+  server->jobBatchSize(reqs, batchSize);
+  REMUS_ASSERT( (server->jobBatchSize(reqs) == batchSize) )
+
+  //queue every job before a worker exists
+  std::vector< remus::proto::Job > jobs = submit_Jobs(client, reqs);
+
+  boost::shared_ptr<remus::Worker> worker =
+                        detail::make_Worker( ports, io_type, "BatchWorker" );
+  worker->askForJobs( static_cast<unsigned int>(batchSize) );
+
+  for(int i=0; i < 100 && worker->pendingJobCount() < batchSize; ++i)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (worker->pendingJobCount() == batchSize) )
+
+  //every job is still tracked individually by the server
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    REMUS_ASSERT( client->jobStatus(jobs[i]).good() )
+    }
+
+  //send back all the results in a single message
+  std::vector< remus::proto::JobResult > results;
+  for(std::size_t i=0; i < batchSize; ++i)
+    {
+    remus::worker::Job job = worker->takePendingJob();
+    REMUS_ASSERT( job.valid() )
+
+    std::ostringstream buffer;
+    buffer << job.id();
+    results.push_back( remus::proto::make_JobResult(job.id(), buffer.str()) );
+    }
+  worker->returnResults(results);
+
+  verify_results(client, jobs);
+  return 0;
+}
@@ -0,0 +1,110 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create the server and start brokering, with a factory that can launch
+  //no workers, so we have to use workers that connect in only
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+void submit_Jobs(boost::shared_ptr<remus::Client> client, int numberOfJobs)
+{
+  using namespace remus::meshtypes;
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "PrefetchWorker", "");
+
+  for(int i=0; i < numberOfJobs; ++i)
+    {
+    remus::proto::JobSubmission sub(reqs);
+    REMUS_ASSERT( client->submitJob(sub).valid() )
+    }
+}
+
+//------------------------------------------------------------------------------
+void wait_for_pending_jobs(boost::shared_ptr<remus::Worker> worker,
+                           std::size_t count)
+{
+  for(int i=0; i < 100 && worker->pendingJobCount() < count; ++i)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (worker->pendingJobCount() == count) )
+}
+
+}
+
+//Verify that a worker with a prefetch depth keeps exactly that many jobs
+//requested, and that taking a job automatically requests a replacement
+int JobPrefetching(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+  boost::shared_ptr<remus::Worker> worker = detail::make_Worker( ports, io_type, "PrefetchWorker" );
+
+  REMUS_ASSERT( (worker->jobPrefetchDepth() == 0) )
+  worker->jobPrefetchDepth(2);
+  REMUS_ASSERT( (worker->jobPrefetchDepth() == 2) )
+
+  //wait for the server to process the job credits of the worker, so that
+  //the server knows it can handle jobs with our requirements
+  remus::common::SleepForMillisec(250);
+  submit_Jobs(client, 3);
+
+  //the worker should only be sent as many jobs as it has credits for
+  wait_for_pending_jobs(worker, 2);
+  remus::common::SleepForMillisec(500);
+  REMUS_ASSERT( (worker->pendingJobCount() == 2) )
+
+  //taking a job should grant a credit for the last job
+  REMUS_ASSERT( worker->takePendingJob().valid() )
+  wait_for_pending_jobs(worker, 2);
+
+  REMUS_ASSERT( worker->getJob().valid() )
+  REMUS_ASSERT( worker->getJob().valid() )
+  REMUS_ASSERT( (worker->pendingJobCount() == 0) )
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Factories.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/uuid/uuid_io.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+  const std::size_t numberOfJobs = 4;
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create a server whose factory claims to support everything but never
+  //creates a worker, so jobs stay queued until our worker asks for them
+  boost::shared_ptr<detail::AlwaysSupportFactory> factory(
+                            new detail::AlwaysSupportFactory("PipelinedWorker"));
+
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+std::vector< remus::proto::Job > submit_Jobs(boost::shared_ptr<remus::Client> client,
+                                             const remus::proto::JobRequirements& reqs)
+{
+  std::vector< remus::proto::Job > jobs;
+  for(std::size_t i=0; i < numberOfJobs; ++i)
+    {
+    remus::proto::JobSubmission sub(reqs);
+    jobs.push_back( client->submitJob(sub) );
+    REMUS_ASSERT( jobs.back().valid() )
+    }
+  return jobs;
+}
+
+//------------------------------------------------------------------------------
+void verify_results(boost::shared_ptr<remus::Client> client,
+                    const std::vector< remus::proto::Job >& jobs)
+{
+  typedef std::vector< remus::proto::Job >::const_iterator it;
+  for(it job = jobs.begin(); job != jobs.end(); ++job)
+    {
+    bool finished = false;
+    for(int i=0; i < 100 && !finished; ++i)
+      {
+      finished = client->jobStatus(*job).finished();
+      if(!finished)
+        { remus::common::SleepForMillisec(50); }
+      }
+    REMUS_ASSERT( finished )
+
+    std::ostringstream buffer;
+    buffer << job->id();
+
+    remus::proto::JobResult result = client->retrieveResults(*job);
+    REMUS_ASSERT( (result.valid()) )
+    REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == buffer.str()) )
+    }
+}
+
+}
+
+//Verify that a worker with a result window can return results without
+//waiting for each acknowledgement, and that every result still arrives
+int PipelinedResults(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "PipelinedWorker", "");
+
+  std::vector< remus::proto::Job > jobs = submit_Jobs(client, reqs);
+
+  boost::shared_ptr<remus::Worker> worker =
+                        detail::make_Worker( ports, io_type, "PipelinedWorker" );
+  REMUS_ASSERT( (worker->resultWindowSize() == 0) )
+  worker->resultWindowSize( static_cast<unsigned int>(numberOfJobs) );
+  REMUS_ASSERT( (worker->resultWindowSize() == numberOfJobs) )
+  REMUS_ASSERT( (worker->resultsInFlight() == 0) )
+
+  worker->askForJobs( static_cast<unsigned int>(numberOfJobs) );
+  for(std::size_t i=0; i < numberOfJobs; ++i)
+    {
+    remus::worker::Job job = worker->getJob();
+    REMUS_ASSERT( job.valid() )
+
+    std::ostringstream buffer;
+    buffer << job.id();
+    worker->returnResult( remus::proto::make_JobResult(job.id(), buffer.str()) );
+
+    //we never block on a result until the window is full
+    REMUS_ASSERT( (worker->resultsInFlight() <= numberOfJobs) )
+    }
+
+  worker->waitForResultAcks();
+  REMUS_ASSERT( (worker->resultsInFlight() == 0) )
+
+  verify_results(client, jobs);
+  return 0;
+}
@@ -0,0 +1,211 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/PortNumbers.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/server/WorkerProxy.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/common/Timer.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/uuid/uuid_io.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+const std::size_t numberOfWorkers = 3;
+
+//the time we wait for messages to pass through the proxy
+const boost::int64_t proxyTimeout = 10000;
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server()
+{
+  //create a server with a factory that can launch no workers, so that
+  //the only workers are the ones connected through the proxy
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  boost::shared_ptr<remus::Server> server(
+                new remus::Server(remus::server::ServerPorts(),factory) );
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Worker> make_ProxiedWorker(
+                                  const remus::server::WorkerProxy& proxy,
+                                  const remus::proto::JobRequirements& reqs)
+{
+  remus::worker::ServerConnection conn =
+            remus::worker::make_ServerConnection(proxy.workerEndpoint());
+  boost::shared_ptr<remus::Worker> w(new remus::Worker(reqs,conn));
+  return w;
+}
+
+//------------------------------------------------------------------------------
+void wait_for_job(boost::shared_ptr<remus::Worker> worker)
+{
+  remus::common::Timer timer;
+  while(worker->pendingJobCount() == 0 && timer.elapsed() < proxyTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (worker->pendingJobCount() == 1) )
+}
+
+//------------------------------------------------------------------------------
+void wait_for_status(const remus::proto::Job& job,
+                     boost::shared_ptr<remus::Client> client,
+                     remus::STATUS_TYPE statusType)
+{
+  remus::common::Timer timer;
+  while(client->jobStatus(job).status() != statusType &&
+        timer.elapsed() < proxyTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (client->jobStatus(job).status() == statusType) )
+}
+
+//------------------------------------------------------------------------------
+//every worker behind the proxy runs one of the jobs, and their results
+//reach the client through the single connection of the proxy
+void verify_proxied_jobs(boost::shared_ptr<remus::Client> client,
+                         const std::vector< boost::shared_ptr<remus::Worker> >& workers,
+                         const remus::proto::JobRequirements& reqs)
+{
+  using namespace remus::proto;
+
+  std::vector<Job> jobs;
+  for(std::size_t i=0; i < workers.size(); ++i)
+    {
+    JobSubmission sub(reqs);
+    sub["index"] = make_JobContent(boost::lexical_cast<std::string>(i));
+    jobs.push_back(client->submitJob(sub));
+    REMUS_ASSERT( jobs.back().valid() )
+    }
+
+  std::vector<remus::worker::Job> workerJobs;
+  for(std::size_t i=0; i < workers.size(); ++i)
+    {
+    wait_for_job(workers[i]);
+    workerJobs.push_back(workers[i]->takePendingJob());
+    }
+
+  for(std::size_t i=0; i < workers.size(); ++i)
+    {
+    const std::string id = boost::uuids::to_string(workerJobs[i].id());
+    workers[i]->updateStatus(JobStatus(workerJobs[i].id(), JobProgress(50)));
+    workers[i]->returnResult(make_JobResult(workerJobs[i].id(), "result " + id));
+    }
+
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    wait_for_status(jobs[i], client, remus::FINISHED);
+    JobResult result = client->retrieveResults(jobs[i]);
+    REMUS_ASSERT( (result.valid()) )
+    const std::string expected = "result " + boost::uuids::to_string(jobs[i].id());
+    REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == expected) )
+    }
+}
+
+//------------------------------------------------------------------------------
+//a job fails when the worker running it leaves the proxy
+void verify_worker_leaving(boost::shared_ptr<remus::Client> client,
+                           boost::shared_ptr<remus::Worker>& worker,
+                           const remus::server::WorkerProxy& proxy,
+                           const remus::proto::JobRequirements& reqs)
+{
+  using namespace remus::proto;
+
+  const std::size_t workersBefore = proxy.numberOfWorkers();
+  worker->askForJobs(1);
+  Job job = client->submitJob(JobSubmission(reqs));
+  REMUS_ASSERT( job.valid() )
+  wait_for_job(worker);
+
+  //the worker sends the proxy a TERMINATE_WORKER when it is destroyed
+  worker.reset();
+  wait_for_status(job, client, remus::FAILED);
+
+  remus::common::Timer timer;
+  while(proxy.numberOfWorkers() == workersBefore &&
+        timer.elapsed() < proxyTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (proxy.numberOfWorkers() == workersBefore - 1) )
+}
+
+}
+
+//Verifies that workers connected to a WorkerProxy run the jobs of the
+//server the proxy is connected to
+int ProxiedWorkers(int argc, char* argv[])
+{
+  (void) argc;
+  (void) argv;
+
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  const remus::proto::JobRequirements reqs =
+          remus::proto::make_JobRequirements(io_type, "ProxiedWorker", "");
+
+  boost::shared_ptr<remus::Server> server = make_Server();
+  boost::shared_ptr<remus::Client> client =
+                          detail::make_Client( server->serverPortInfo() );
+
+  remus::server::WorkerProxy proxy(server->serverPortInfo().worker().endpoint(),
+                                   "127.0.0.1", remus::server::WORKER_PORT);
+  boost::thread proxyThread(&remus::server::WorkerProxy::run, &proxy);
+
+  std::vector< boost::shared_ptr<remus::Worker> > workers;
+  for(std::size_t i=0; i < numberOfWorkers; ++i)
+    {
+    workers.push_back(make_ProxiedWorker(proxy, reqs));
+    workers.back()->askForJobs(1);
+    }
+
+  //wait for all workers to ask the proxy for a job
+  remus::common::Timer timer;
+  while((proxy.numberOfWorkers() < numberOfWorkers || !client->canMesh(reqs)) &&
+        timer.elapsed() < proxyTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (proxy.numberOfWorkers() == numberOfWorkers) )
+  REMUS_ASSERT( (client->canMesh(reqs)) )
+
+  verify_proxied_jobs(client, workers, reqs);
+  boost::shared_ptr<remus::Worker> leaving = workers.back();
+  workers.pop_back();
+  verify_worker_leaving(client, leaving, proxy, reqs);
+  workers.clear();
+
+  proxy.stop();
+  proxyThread.join();
+  REMUS_ASSERT( (!proxy.isRunning()) )
+  return 0;
+}
@@ -0,0 +1,215 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/client/ShardedClient.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/common/Timer.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+#include <set>
+#include <sstream>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+const std::size_t numberOfServers = 3;
+
+//the time we wait for a worker to be registered with its server
+const boost::int64_t workerTimeout = 10000;
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server()
+{
+  //create a server with a factory that can launch no workers, so that
+  //submitted jobs stay queued unless a worker connects to the server
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  boost::shared_ptr<remus::Server> server(
+                new remus::Server(remus::server::ServerPorts(),factory) );
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+remus::client::ShardedServerConnection make_Connection(
+    const std::vector< boost::shared_ptr<remus::Server> >& servers,
+    remus::client::ShardedServerConnection::Policy policy)
+{
+  std::ostringstream dests;
+  for(std::size_t i=0; i < servers.size(); ++i)
+    {
+    dests << (i > 0 ? "," : "")
+          << servers[i]->serverPortInfo().client().endpoint();
+    }
+  return remus::client::make_ShardedServerConnection(dests.str(), policy);
+}
+
+//------------------------------------------------------------------------------
+remus::proto::JobSubmission make_Submission(const remus::proto::JobRequirements& reqs,
+                                            std::size_t index)
+{
+  std::ostringstream content;
+  content << "submission " << index;
+
+  remus::proto::JobSubmission sub(reqs);
+  sub["data"] = remus::proto::make_JobContent(content.str());
+  return sub;
+}
+
+//------------------------------------------------------------------------------
+//verify that submissions are placed by their content, and that each job is
+//tracked through the server that owns it
+void verify_content_hash(const std::vector< boost::shared_ptr<remus::Server> >& servers,
+                         const remus::proto::JobRequirements& reqs)
+{
+  using namespace remus::proto;
+  remus::client::ShardedClient client(
+      make_Connection(servers, remus::client::ShardedServerConnection::ContentHash));
+
+  //the same content always goes to the same server
+  const JobSubmission sub = make_Submission(reqs, 0);
+  const std::size_t server = client.serverFor(sub);
+  REMUS_ASSERT( (server < servers.size()) )
+  REMUS_ASSERT( (client.serverFor(sub) == server) )
+
+  Job job = client.submitJob(sub);
+  REMUS_ASSERT( job.valid() )
+  REMUS_ASSERT( (client.ownerOf(job) == server) )
+  REMUS_ASSERT( (client.jobStatus(job).status() == remus::QUEUED) )
+
+  //only the owner knows about the job
+  for(std::size_t i=0; i < servers.size(); ++i)
+    {
+    boost::shared_ptr<remus::Client> direct =
+                      detail::make_Client( servers[i]->serverPortInfo() );
+    const bool known = !direct->jobStatus(job).invalid();
+    REMUS_ASSERT( (known == (i == server)) )
+    }
+
+  //a client that didn't submit the job finds its owner
+  remus::client::ShardedClient other(
+      make_Connection(servers, remus::client::ShardedServerConnection::ContentHash));
+  REMUS_ASSERT( (other.ownerOf(job) == servers.size()) )
+  REMUS_ASSERT( (other.jobStatus(job).status() == remus::QUEUED) )
+  REMUS_ASSERT( (other.ownerOf(job) == server) )
+
+  //different content is spread over the servers
+  std::set<std::size_t> owners;
+  for(std::size_t i=1; i <= 20; ++i)
+    {
+    Job j = client.submitJob(make_Submission(reqs, i));
+    REMUS_ASSERT( j.valid() )
+    owners.insert(client.ownerOf(j));
+    REMUS_ASSERT( (client.terminate(j).failed()) )
+    }
+  REMUS_ASSERT( (owners.size() > 1) )
+
+  //terminating a job forgets its owner
+  REMUS_ASSERT( (client.terminate(job).failed()) )
+  REMUS_ASSERT( (client.ownerOf(job) == servers.size()) )
+  REMUS_ASSERT( (client.jobStatus(job).invalid()) )
+}
+
+//------------------------------------------------------------------------------
+//verify that the server with a waiting worker is sent the submission, and
+//that the result is retrieved from it
+void verify_least_loaded(const std::vector< boost::shared_ptr<remus::Server> >& servers,
+                         const remus::proto::JobRequirements& reqs,
+                         const remus::common::MeshIOType& io_type)
+{
+  using namespace remus::proto;
+
+  const std::size_t idle = servers.size() - 1;
+  boost::shared_ptr<remus::Worker> worker = detail::make_Worker(
+                servers[idle]->serverPortInfo(), io_type, reqs.workerName() );
+  worker->askForJobs(1);
+
+  //wait for the server to know about the worker
+  boost::shared_ptr<remus::Client> direct =
+                    detail::make_Client( servers[idle]->serverPortInfo() );
+  remus::common::Timer timer;
+  while(!direct->canMesh(reqs) && timer.elapsed() < workerTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (direct->canMesh(reqs)) )
+
+  remus::client::ShardedClient client(
+      make_Connection(servers, remus::client::ShardedServerConnection::LeastLoaded));
+  REMUS_ASSERT( (client.canMesh(reqs)) )
+
+  const JobSubmission sub = make_Submission(reqs, 0);
+  Job job = client.submitJob(sub);
+  REMUS_ASSERT( job.valid() )
+  REMUS_ASSERT( (client.ownerOf(job) == idle) )
+
+  timer.reset();
+  while(worker->pendingJobCount() == 0 && timer.elapsed() < workerTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (worker->pendingJobCount()==1) )
+  remus::worker::Job workerJob = worker->takePendingJob();
+  REMUS_ASSERT( (workerJob.id() == job.id()) )
+
+  const std::string ascii_data = remus::testing::AsciiStringGenerator(4096);
+  worker->returnResult(make_JobResult(job.id(),ascii_data));
+
+  timer.reset();
+  while(client.jobStatus(job).status() != remus::FINISHED &&
+        timer.elapsed() < workerTimeout)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (client.jobStatus(job).status() == remus::FINISHED) )
+
+  JobResult result = client.retrieveResults(job);
+  REMUS_ASSERT( (result.valid()) )
+  REMUS_ASSERT( (std::string(result.data(), result.dataSize()) == ascii_data) )
+  REMUS_ASSERT( (client.ownerOf(job) == servers.size()) )
+}
+
+}
+
+//Verifies that a sharded client spreads submissions over multiple servers,
+//both by the content of the submissions and by the load of the servers
+int ShardedClients(int argc, char* argv[])
+{
+  (void) argc;
+  (void) argv;
+
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  const remus::proto::JobRequirements reqs =
+          remus::proto::make_JobRequirements(io_type, "ShardedWorker", "");
+
+  std::vector< boost::shared_ptr<remus::Server> > servers;
+  for(std::size_t i=0; i < numberOfServers; ++i)
+    {
+    servers.push_back(make_Server());
+    }
+
+  verify_content_hash(servers, reqs);
+  verify_least_loaded(servers, reqs, io_type);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Factories.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create a server whose factory claims to support everything but never
+  //creates a worker, so jobs stay queued until our worker asks for them
+  boost::shared_ptr<detail::AlwaysSupportFactory> factory(
+                            new detail::AlwaysSupportFactory("CoalescingWorker"));
+
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(1500,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+//------------------------------------------------------------------------------
+//wait for the client to see the job with a status that passes the predicate
+template<typename Predicate>
+bool wait_for_status(boost::shared_ptr<remus::Client> client,
+                     const remus::proto::Job& job,
+                     Predicate pred)
+{
+  for(int i=0; i < 100; ++i)
+    {
+    if(pred(client->jobStatus(job)))
+      { return true; }
+    remus::common::SleepForMillisec(50);
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+struct HasProgress
+{
+  explicit HasProgress(int v): Value(v) {}
+  bool operator()(const remus::proto::JobStatus& s) const
+    { return s.inProgress() && s.progress().value() == Value; }
+  int Value;
+};
+
+//------------------------------------------------------------------------------
+bool has_failed(const remus::proto::JobStatus& s) { return s.failed(); }
+
+}
+
+//Verify that a worker coalescing progress updates still delivers the
+//latest progress of a job, and sends state changes immediately
+int StatusCoalescing(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "CoalescingWorker", "");
+  remus::proto::Job clientJob = client->submitJob( remus::proto::JobSubmission(reqs) );
+  REMUS_ASSERT( clientJob.valid() )
+
+  boost::shared_ptr<remus::Worker> worker =
+                        detail::make_Worker( ports, io_type, "CoalescingWorker" );
+  REMUS_ASSERT( (worker->statusUpdateInterval() == 0) )
+  worker->statusUpdateInterval(100);
+  REMUS_ASSERT( (worker->statusUpdateInterval() == 100) )
+
+  remus::worker::Job job = worker->getJob();
+  REMUS_ASSERT( job.valid() )
+
+  //flood the worker with progress, only the latest progress should matter
+  for(int i=0; i < 5000; ++i)
+    {
+    worker->sendProgress(job, (i % 99) + 1, std::string());
+    }
+  worker->sendProgress(job, 42, std::string());
+
+  //the final progress is sent by the worker once the interval has passed,
+  //without the worker sending anything else
+  REMUS_ASSERT( wait_for_status(client, clientJob, HasProgress(42)) )
+
+  //progress held for a long interval is sent when asked for
+  worker->statusUpdateInterval(60000);
+  worker->sendProgress(job, 43, std::string());
+  worker->sendProgress(job, 44, std::string());
+  worker->flushStatus();
+  REMUS_ASSERT( wait_for_status(client, clientJob, HasProgress(44)) )
+
+  //failures are a change of state and are sent immediately
+  worker->sendJobFailure(job, "coalescing test failure");
+  REMUS_ASSERT( wait_for_status(client, clientJob, has_failed) )
+  return 0;
+}
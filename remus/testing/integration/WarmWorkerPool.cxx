@@ -0,0 +1,108 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Factories.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+namespace
+{
+  namespace factory
+  {
+  using remus::testing::integration::detail::ThreadPoolWorkerFactory;
+  }
+
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//------------------------------------------------------------------------------
+remus::proto::JobRequirements make_Reqs()
+{
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  return remus::proto::make_JobRequirements(io_type, "WarmWorker", "");
+}
+
+//------------------------------------------------------------------------------
+void wait_for_worker_count(boost::shared_ptr<factory::ThreadPoolWorkerFactory> f,
+                           unsigned int count)
+{
+  for(int i=0; i < 100 && f->currentWorkerCount() != count; ++i)
+    {
+    remus::common::SleepForMillisec(50);
+    }
+  REMUS_ASSERT( (f->currentWorkerCount() == count) )
+}
+
+}
+
+//Verify that the server keeps the minimum number of idle workers launched
+//before any job is submitted, and launches a replacement when one of them
+//takes a job
+int WarmWorkerPool(int argc, char* argv[])
+{
+  (void) argc;
+  (void) argv;
+
+  const remus::proto::JobRequirements reqs = make_Reqs();
+
+  boost::shared_ptr<factory::ThreadPoolWorkerFactory> factory(
+            new factory::ThreadPoolWorkerFactory(reqs, 3));
+  factory->setMinimumIdleWorkers(reqs, 2);
+  REMUS_ASSERT( (factory->minimumIdleWorkers(reqs) == 2) )
+
+  boost::shared_ptr<remus::Server> server(
+                    new remus::Server(remus::server::ServerPorts(),factory) );
+  server->startBrokering();
+
+  //the idle workers are launched without any job being submitted, and we
+  //don't launch more than asked for while they are starting up
+  wait_for_worker_count(factory, 2);
+  remus::common::SleepForMillisec(500);
+  REMUS_ASSERT( (factory->currentWorkerCount() == 2) )
+
+  //the idle workers have registered, so the client can see their type
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+  REMUS_ASSERT( client->canMesh(reqs) )
+
+  //a warm worker takes the job, and once it finishes the pool is back
+  //to two idle workers
+  remus::proto::Job job = client->submitJob( remus::proto::JobSubmission(reqs) );
+  REMUS_ASSERT( job.valid() )
+
+  bool finished = false;
+  for(int i=0; i < 200 && !finished; ++i)
+    {
+    finished = client->jobStatus(job).finished();
+    if(!finished)
+      { remus::common::SleepForMillisec(25); }
+    }
+  REMUS_ASSERT( finished )
+  REMUS_ASSERT( (client->retrieveResults(job).dataSize() > 0) )
+
+  wait_for_worker_count(factory, 2);
+  remus::common::SleepForMillisec(500);
+  REMUS_ASSERT( (factory->currentWorkerCount() == 2) )
+
+  server->stopBrokering();
+
+  //a count of zero removes the requirements from the warm pool
+  factory->setMinimumIdleWorkers(reqs, 0);
+  REMUS_ASSERT( (factory->minimumIdleWorkers().empty()) )
+  return 0;
+}
@@ -0,0 +1,98 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/proto/Message.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//------------------------------------------------------------------------------
+boost::shared_ptr<remus::Server> make_Server( remus::server::ServerPorts ports )
+{
+  //create the server and start brokering, with a factory that can launch
+  //no workers, so we have to use workers that connect in only
+  boost::shared_ptr<remus::server::WorkerFactory> factory(new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+
+  //use a slow heartbeat rate, so that a worker can only be noticed as
+  //gone in time by its connection closing
+  boost::shared_ptr<remus::Server> server( new remus::Server(ports,factory) );
+  remus::server::PollingRates newRates(30000,60000);
+  server->pollingRates(newRates);
+  server->startBrokering();
+  return server;
+}
+
+}
+
+//Verify that a worker whose connection drops has its jobs expired right
+//away, instead of once it has missed its heartbeats
+int WorkerDisconnect(int argc, char* argv[])
+{
+  using namespace remus::meshtypes;
+  (void) argc;
+  (void) argv;
+
+  boost::shared_ptr<remus::Server> server = make_Server( remus::server::ServerPorts() );
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Client> client = detail::make_Client( ports );
+
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  remus::proto::JobRequirements reqs =
+      remus::proto::make_JobRequirements(io_type, "DisconnectingWorker", "");
+
+  //act as a worker over tcp using our own context, so that closing the
+  //socket drops the connection without telling the server
+  zmq::context_t context(1);
+  boost::shared_ptr<zmq::socket_t> worker(new zmq::socket_t(context, ZMQ_DEALER));
+  zmq::connectToAddress(*worker, ports.worker().endpoint());
+  remus::proto::send_Message(io_type, remus::CAN_MESH_REQUIREMENTS,
+                             remus::proto::to_string(reqs), worker.get());
+  remus::proto::send_Message(io_type, remus::MAKE_MESH,
+                             remus::proto::to_string(reqs), worker.get());
+  remus::common::SleepForMillisec(250);
+
+  remus::proto::Job job = client->submitJob( remus::proto::JobSubmission(reqs) );
+  REMUS_ASSERT( job.valid() )
+
+  //wait for the job to be sent to our worker
+  remus::common::SleepForMillisec(250);
+  REMUS_ASSERT( client->jobStatus(job).good() )
+
+  //drop the connection
+  const int linger_duration = 0;
+  worker->setsockopt(ZMQ_LINGER, &linger_duration, sizeof(int) );
+  worker.reset();
+
+  bool expired = false;
+  for(int i=0; i < 50 && !expired; ++i)
+    {
+    expired = (client->jobStatus(job).status() == remus::EXPIRED);
+    if(!expired)
+      { remus::common::SleepForMillisec(20); }
+    }
+  REMUS_ASSERT( expired )
+
+  return 0;
+}
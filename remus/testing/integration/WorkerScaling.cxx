@@ -0,0 +1,156 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+#include <remus/client/Client.h>
+#include <remus/server/Server.h>
+#include <remus/server/ThreadWorkerFactory.h>
+#include <remus/server/WorkerFactory.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+#include <remus/testing/integration/detail/Helpers.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  namespace detail
+  {
+  using namespace remus::testing::integration::detail;
+  }
+
+//------------------------------------------------------------------------------
+remus::proto::JobRequirements make_Reqs()
+{
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType io_type = remus::common::make_MeshIOType(Mesh2D(),Mesh3D());
+  return remus::proto::make_JobRequirements(io_type, "ScalingWorker", "");
+}
+
+//------------------------------------------------------------------------------
+void do_single_job(const remus::proto::JobRequirements& reqs,
+                   const std::string& endpoint)
+{
+  remus::Worker worker(reqs, remus::worker::make_ServerConnection(endpoint));
+  remus::worker::Job job = worker.getJob();
+  if(job.valid())
+    {
+    remus::common::SleepForMillisec(100);
+    worker.returnResult( remus::proto::make_JobResult(job.id(), "done") );
+    }
+}
+
+//------------------------------------------------------------------------------
+void verify_burst_respects_cap()
+{
+  const remus::proto::JobRequirements reqs = make_Reqs();
+
+  boost::shared_ptr<remus::server::ThreadWorkerFactory> factory(
+                                    new remus::server::ThreadWorkerFactory());
+  factory->registerWorkerType(reqs, do_single_job);
+  factory->setMaxWorkerCount(8);
+
+  remus::server::ScalingPolicy policy;
+  policy.maxWorkerCount(reqs, 3);
+  factory->scalingPolicy(policy);
+
+  boost::shared_ptr<remus::Server> server(
+                    new remus::Server(remus::server::ServerPorts(),factory) );
+  server->startBrokering();
+  boost::shared_ptr<remus::Client> client =
+                          detail::make_Client( server->serverPortInfo() );
+
+  std::vector<remus::proto::Job> jobs;
+  for(int i=0; i < 12; ++i)
+    {
+    jobs.push_back( client->submitJob( remus::proto::JobSubmission(reqs) ) );
+    REMUS_ASSERT( jobs.back().valid() )
+    }
+
+  //the burst of jobs ramps the workers up to the cap of the requirements,
+  //and never past it, even though the factory has more space
+  unsigned int peak = 0;
+  std::size_t numFinished = 0;
+  for(int i=0; i < 1000 && numFinished < jobs.size(); ++i)
+    {
+    peak = std::max(peak, factory->workerCount(reqs));
+    numFinished = 0;
+    for(std::size_t j=0; j < jobs.size(); ++j)
+      {
+      numFinished += client->jobStatus(jobs[j]).finished() ? 1 : 0;
+      }
+    remus::common::SleepForMillisec(10);
+    }
+  REMUS_ASSERT( (numFinished == jobs.size()) )
+  REMUS_ASSERT( (peak == 3) )
+
+  //we have learned how long the jobs take
+  REMUS_ASSERT( (factory->averageJobDuration(reqs) >= 100) )
+}
+
+//------------------------------------------------------------------------------
+void verify_idle_workers_retire()
+{
+  const remus::proto::JobRequirements reqs = make_Reqs();
+
+  //a factory that launches no workers, so we only use workers that
+  //connect in. Workers that are idle for a quarter second are retired,
+  //but we keep one around
+  boost::shared_ptr<remus::server::WorkerFactory> factory(
+                                        new remus::server::WorkerFactory());
+  factory->setMaxWorkerCount(0);
+  factory->setMinimumIdleWorkers(reqs, 1);
+  remus::server::ScalingPolicy policy;
+  policy.idleTimeout(250);
+  factory->scalingPolicy(policy);
+
+  boost::shared_ptr<remus::Server> server(
+                    new remus::Server(remus::server::ServerPorts(),factory) );
+  server->startBrokering();
+
+  const remus::server::ServerPorts& ports = server->serverPortInfo();
+  boost::shared_ptr<remus::Worker> first =
+                    detail::make_Worker( ports, reqs.meshTypes(), "ScalingWorker" );
+  boost::shared_ptr<remus::Worker> second =
+                    detail::make_Worker( ports, reqs.meshTypes(), "ScalingWorker" );
+  first->askForJobs(1);
+  second->askForJobs(1);
+
+  //one of the workers is told to terminate, the other is kept
+  for(int i=0; i < 100 &&
+      (first->pendingJobCount() + second->pendingJobCount()) == 0; ++i)
+    {
+    remus::common::SleepForMillisec(20);
+    }
+  remus::common::SleepForMillisec(500);
+  REMUS_ASSERT( ((first->pendingJobCount() + second->pendingJobCount()) == 1) )
+
+  boost::shared_ptr<remus::Worker> retired =
+                          (first->pendingJobCount() == 1) ? first : second;
+  REMUS_ASSERT( (retired->takePendingJob().validityReason() ==
+                 remus::worker::Job::TERMINATE_WORKER) )
+}
+
+}
+
+//Verify that the server launches workers in proportion to the queued jobs,
+//up to the cap of the requirements, and retires workers that are idle
+int WorkerScaling(int argc, char* argv[])
+{
+  (void) argc;
+  (void) argv;
+
+  verify_burst_respects_cap();
+  verify_idle_workers_retire();
+  return 0;
+}
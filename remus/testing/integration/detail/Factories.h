@@ -128,6 +128,10 @@ public:
 
   ~ThreadPoolWorkerFactory()
     {
+    //wait for the running workers to finish, as they use our members
+    this->IOService.stop();
+    this->ThreadPool.join_all();
+
     typedef std::map< ::boost::thread::id, std::size_t >::const_iterator c_it;
     for (c_it i = this->JobsPerThread.begin(); i != this->JobsPerThread.end(); ++i )
       {
@@ -0,0 +1,207 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/worker/ConcurrentWorker.h>
+
+//suppress warnings inside boost headers for gcc and clang
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/locks.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <deque>
+
+namespace
+{
+//how long the dispatcher waits for a job before it verifies that every
+//free slot still has a job request outstanding with the server
+const boost::int64_t dispatchTimeoutMillisec = 250;
+}
+
+namespace remus{
+namespace worker{
+
+//-----------------------------------------------------------------------------
+class ConcurrentWorker::ConcurrentWorkerImplementation
+{
+public:
+  ConcurrentWorkerImplementation(std::size_t numberOfSlots):
+    NumberOfSlots( numberOfSlots > 0 ? numberOfSlots : 1),
+    SlotMutex(),
+    JobsChanged(),
+    PendingJobs(),
+    ActiveJobs(0),
+    Shutdown(false)
+  {
+  }
+
+  //------------------------------------------------------------------------------
+  //Ask the server for enough jobs to fill every free slot. The worker
+  //tracks the credits we have granted against the jobs it has received,
+  //so we only need to tell it how many slots are free
+  void requestJobs(remus::worker::ConcurrentWorker* worker)
+  {
+    std::size_t freeSlots = 0;
+    {
+    boost::lock_guard<boost::mutex> lock(this->SlotMutex);
+    const std::size_t busy = this->PendingJobs.size() + this->ActiveJobs;
+    if(!this->Shutdown && busy < this->NumberOfSlots)
+      {
+      freeSlots = this->NumberOfSlots - busy;
+      }
+    }
+
+    if(freeSlots > 0)
+      {
+      worker->keepJobsRequested(freeSlots);
+      }
+  }
+
+  //------------------------------------------------------------------------------
+  //Each slot of the thread pool runs this method until the worker
+  //is told to terminate
+  void processSlot(remus::worker::ConcurrentWorker* worker,
+                   ConcurrentWorker::JobProcessor processor)
+  {
+    while(true)
+      {
+      remus::worker::Job job;
+      {
+      boost::unique_lock<boost::mutex> lock(this->SlotMutex);
+      while(this->PendingJobs.empty() && !this->Shutdown)
+        {
+        this->JobsChanged.wait(lock);
+        }
+      if(this->PendingJobs.empty())
+        { //we have been told to shutdown, and have no more work
+        return;
+        }
+      job = this->PendingJobs.front();
+      this->PendingJobs.pop_front();
+      ++this->ActiveJobs;
+      }
+
+      //the job could have been terminated while it was waiting for a slot
+      if(!worker->jobShouldBeTerminated(job))
+        {
+        processor(*worker, job);
+        }
+
+      {
+      boost::lock_guard<boost::mutex> lock(this->SlotMutex);
+      --this->ActiveJobs;
+      }
+
+      //the slot is free, so request a job to replace the one we finished
+      this->requestJobs(worker);
+      }
+  }
+
+  std::size_t NumberOfSlots;
+
+  mutable boost::mutex SlotMutex;
+  boost::condition_variable JobsChanged;
+  std::deque< remus::worker::Job > PendingJobs;
+  std::size_t ActiveJobs;
+  bool Shutdown;
+};
+
+//-----------------------------------------------------------------------------
+ConcurrentWorker::ConcurrentWorker(remus::common::MeshIOType mtype,
+                                   const remus::worker::ServerConnection& conn,
+                                   std::size_t numberOfSlots):
+  Worker(mtype, conn),
+  Implementation( new ConcurrentWorkerImplementation(numberOfSlots) )
+{
+  this->advertiseSlots(this->Implementation->NumberOfSlots);
+}
+
+//-----------------------------------------------------------------------------
+ConcurrentWorker::ConcurrentWorker(
+                           const remus::proto::JobRequirements& requirements,
+                           const remus::worker::ServerConnection& conn,
+                           std::size_t numberOfSlots):
+  Worker(requirements, conn),
+  Implementation( new ConcurrentWorkerImplementation(numberOfSlots) )
+{
+  this->advertiseSlots(this->Implementation->NumberOfSlots);
+}
+
+//-----------------------------------------------------------------------------
+ConcurrentWorker::~ConcurrentWorker()
+{
+}
+
+//-----------------------------------------------------------------------------
+std::size_t ConcurrentWorker::numberOfSlots() const
+{
+  return this->Implementation->NumberOfSlots;
+}
+
+//-----------------------------------------------------------------------------
+std::size_t ConcurrentWorker::activeJobCount() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Implementation->SlotMutex);
+  return this->Implementation->ActiveJobs;
+}
+
+//-----------------------------------------------------------------------------
+void ConcurrentWorker::processJobs(const JobProcessor& processor)
+{
+  ConcurrentWorkerImplementation* impl = this->Implementation.get();
+
+  {
+  boost::lock_guard<boost::mutex> lock(impl->SlotMutex);
+  impl->Shutdown = false;
+  }
+
+  boost::thread_group pool;
+  for(std::size_t i=0; i < impl->NumberOfSlots; ++i)
+    {
+    pool.create_thread( boost::bind(
+                          &ConcurrentWorkerImplementation::processSlot,
+                          impl, this, processor) );
+    }
+
+  impl->requestJobs(this);
+  while(!this->workerShouldTerminate())
+    {
+    remus::worker::Job job = this->waitForJob(dispatchTimeoutMillisec);
+    if(job.validityReason() == remus::worker::Job::TERMINATE_WORKER)
+      {
+      break;
+      }
+    else if(job.valid())
+      {
+      boost::lock_guard<boost::mutex> lock(impl->SlotMutex);
+      impl->PendingJobs.push_back(job);
+      impl->JobsChanged.notify_one();
+      }
+    else
+      { //we timed out waiting for a job, so top off the job requests
+      impl->requestJobs(this);
+      }
+    }
+
+  //let the slots finish their active jobs and any jobs we have already
+  //handed off, after that they will exit
+  {
+  boost::lock_guard<boost::mutex> lock(impl->SlotMutex);
+  impl->Shutdown = true;
+  impl->JobsChanged.notify_all();
+  }
+  pool.join_all();
+}
+
+}
+}
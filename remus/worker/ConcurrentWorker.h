@@ -0,0 +1,95 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_worker_ConcurrentWorker_h
+#define remus_worker_ConcurrentWorker_h
+
+#include <remus/worker/Worker.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+//included for export symbols
+#include <remus/worker/WorkerExports.h>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace worker{
+
+//The concurrent worker is a worker that processes multiple jobs at the same
+//time. It has a fixed number of slots, each backed by a thread in an internal
+//thread pool. The worker will keep asking the server for jobs while it
+//has free slots, and runs the JobProcessor for each job on a slot thread.
+//
+//This allows a single worker process to fully use a large machine, rather
+//than having a process per core that each load the same libraries and data.
+//
+//The JobProcessor is called from multiple threads at the same time, and
+//should use the thread safe methods of the worker (updateStatus,
+//sendProgress, sendJobFailure, returnResult) to report back to the server.
+//Termination is routed per job, so a processor should periodically check
+//jobShouldBeTerminated for the job it is processing.
+class REMUSWORKER_EXPORT ConcurrentWorker : public remus::worker::Worker
+{
+public:
+  typedef boost::function< void (remus::worker::ConcurrentWorker&,
+                                 const remus::worker::Job&) > JobProcessor;
+
+  //construct a concurrent worker that can mesh a single type with
+  //numberOfSlots jobs running at the same time.
+  ConcurrentWorker(remus::common::MeshIOType mtype,
+                   const remus::worker::ServerConnection& conn,
+                   std::size_t numberOfSlots);
+
+  //construct a concurrent worker that can mesh only an exact set of
+  //requirements with numberOfSlots jobs running at the same time.
+  ConcurrentWorker(const remus::proto::JobRequirements& requirements,
+                   const remus::worker::ServerConnection& conn,
+                   std::size_t numberOfSlots);
+
+  virtual ~ConcurrentWorker();
+
+  //the number of jobs this worker will process at the same time
+  std::size_t numberOfSlots() const;
+
+  //the number of jobs currently being processed
+  std::size_t activeJobCount() const;
+
+  //Blocking call that fills every slot with jobs from the server and runs
+  //processor for each job on the internal thread pool. Returns once the
+  //server has told the worker to terminate and every active job has
+  //finished processing.
+  void processJobs(const JobProcessor& processor);
+
+private:
+  class ConcurrentWorkerImplementation;
+  boost::scoped_ptr<ConcurrentWorkerImplementation> Implementation;
+
+  //explicitly state the worker doesn't support copy or move semantics
+  ConcurrentWorker(const ConcurrentWorker&);
+  void operator=(const ConcurrentWorker&);
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
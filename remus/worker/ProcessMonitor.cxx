@@ -0,0 +1,263 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/worker/ProcessMonitor.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/proto/JobStatus.h>
+#include <remus/worker/Worker.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace
+{
+//how often in seconds we check if the job was terminated, or the
+//program has stalled, while it isn't writing anything
+const double CheckInterval = 0.25;
+
+//the number of lines tail returns
+const std::size_t TailLength = 20;
+}
+
+namespace remus{
+namespace worker{
+
+//----------------------------------------------------------------------------
+bool ProcessMonitor::percentProgress(const std::string& line,
+                                     remus::proto::JobProgress& progress)
+{
+  std::string::size_type percent = line.rfind('%');
+  while(percent != std::string::npos && percent > 0)
+    {
+    //walk back over the number, which can have a fraction
+    std::string::size_type start = percent;
+    while(start > 0 &&
+          (std::isdigit(static_cast<unsigned char>(line[start-1])) ||
+           line[start-1] == '.'))
+      {
+      --start;
+      }
+    if(start < percent &&
+       std::isdigit(static_cast<unsigned char>(line[start])))
+      {
+      const double value =
+          std::atof(line.substr(start, percent - start).c_str());
+      progress = remus::proto::JobProgress(static_cast<int>(value), line);
+      return true;
+      }
+    percent = line.rfind('%', percent - 1);
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+ProcessMonitor::ProcessMonitor(remus::worker::Worker& worker,
+                               const remus::worker::Job& job):
+  Owner(worker),
+  MonitoredJob(job),
+  Extractor(&ProcessMonitor::percentProgress),
+  ProgressInterval(1000),
+  StallTimeout(0),
+  LogPath(),
+  Log(),
+  Stalled(false),
+  Terminated(false),
+  HavePendingProgress(false),
+  PendingProgress(),
+  SentProgress(),
+  LastSent(-1),
+  Clock(),
+  Tail()
+{
+}
+
+//----------------------------------------------------------------------------
+bool ProcessMonitor::monitor(remus::common::ExecuteProcess& process)
+{
+  typedef remus::common::ProcessPipe ProcessPipe;
+
+  this->Stalled = false;
+  this->Terminated = false;
+  this->HavePendingProgress = false;
+  this->LastSent = -1;
+  this->Tail.clear();
+  this->Clock.reset();
+
+  if(!this->LogPath.empty())
+    {
+    this->Log.close();
+    this->Log.clear();
+    this->Log.open(this->LogPath.c_str(),
+                   std::ios::out | std::ios::trunc | std::ios::binary);
+    }
+
+  std::string out, err;
+  boost::int64_t lastOutput = 0;
+  bool reading = true;
+  while(true)
+    {
+    //wake up in time to send progress that is waiting on the interval
+    double timeout = CheckInterval;
+    if(this->HavePendingProgress && this->LastSent >= 0)
+      {
+      const boost::int64_t due =
+        this->LastSent + this->ProgressInterval - this->Clock.elapsed();
+      timeout = std::min(timeout,
+                         std::max(static_cast<double>(due) / 1000.0, 0.0));
+      }
+
+    if(reading)
+      {
+      ProcessPipe data = process.poll(timeout);
+      if(data.type == ProcessPipe::STDOUT)
+        {
+        this->handleOutput(out, data.text);
+        lastOutput = this->Clock.elapsed();
+        }
+      else if(data.type == ProcessPipe::STDERR)
+        {
+        this->handleOutput(err, data.text);
+        lastOutput = this->Clock.elapsed();
+        }
+      else if(data.type == ProcessPipe::None)
+        { //all the output has been read
+        reading = false;
+        }
+      }
+    else if(process.isAlive())
+      {
+      remus::common::SleepForMillisec(static_cast<int>(timeout * 1000));
+      }
+    else
+      {
+      break;
+      }
+
+    this->sendProgress(false);
+
+    if(this->Owner.jobShouldBeTerminated(this->MonitoredJob))
+      {
+      this->Terminated = true;
+      process.kill();
+      break;
+      }
+    if(this->StallTimeout > 0 &&
+       (this->Clock.elapsed() - lastOutput) > this->StallTimeout)
+      {
+      this->Stalled = true;
+      process.kill();
+      break;
+      }
+    }
+
+  //the last line of each pipe might not end with a newline
+  if(!out.empty()) { this->handleLine(out); }
+  if(!err.empty()) { this->handleLine(err); }
+  this->sendProgress(true);
+  this->Log.close();
+
+  if(this->Stalled || this->Terminated)
+    {
+    return false;
+    }
+  return process.exitedNormally();
+}
+
+//----------------------------------------------------------------------------
+std::string ProcessMonitor::tail() const
+{
+  std::string result;
+  for(std::deque<std::string>::const_iterator i = this->Tail.begin();
+      i != this->Tail.end(); ++i)
+    {
+    result += (result.empty() ? "" : "\n") + *i;
+    }
+  return result;
+}
+
+//----------------------------------------------------------------------------
+void ProcessMonitor::handleOutput(std::string& buffer, const std::string& text)
+{
+  buffer += text;
+  std::string::size_type start = 0;
+  std::string::size_type end = buffer.find('\n');
+  while(end != std::string::npos)
+    {
+    std::string::size_type length = end - start;
+    if(length > 0 && buffer[end-1] == '\r')
+      {
+      --length;
+      }
+    this->handleLine(buffer.substr(start, length));
+    start = end + 1;
+    end = buffer.find('\n', start);
+    }
+  buffer.erase(0, start);
+
+  //keep the log current, so that it can be followed while the program runs
+  if(this->Log.is_open())
+    {
+    this->Log.flush();
+    }
+}
+
+//----------------------------------------------------------------------------
+void ProcessMonitor::handleLine(const std::string& line)
+{
+  if(this->Log.is_open())
+    {
+    this->Log << line << '\n';
+    }
+
+  this->Tail.push_back(line);
+  if(this->Tail.size() > TailLength)
+    {
+    this->Tail.pop_front();
+    }
+
+  remus::proto::JobProgress progress;
+  if(this->Extractor && this->Extractor(line, progress))
+    {
+    this->PendingProgress = progress;
+    this->HavePendingProgress = true;
+    }
+}
+
+//----------------------------------------------------------------------------
+void ProcessMonitor::sendProgress(bool force)
+{
+  if(!this->HavePendingProgress)
+    {
+    return;
+    }
+
+  const boost::int64_t now = this->Clock.elapsed();
+  if(!force && this->LastSent >= 0 &&
+     (now - this->LastSent) < this->ProgressInterval)
+    {
+    return;
+    }
+
+  if(this->PendingProgress != this->SentProgress || this->LastSent < 0)
+    {
+    this->Owner.updateStatus(
+      remus::proto::JobStatus(this->MonitoredJob.id(), this->PendingProgress));
+    this->SentProgress = this->PendingProgress;
+    this->LastSent = now;
+    }
+  this->HavePendingProgress = false;
+}
+
+}
+}
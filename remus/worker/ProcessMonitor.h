@@ -0,0 +1,144 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_worker_ProcessMonitor_h
+#define remus_worker_ProcessMonitor_h
+
+#include <remus/common/ExecuteProcess.h>
+#include <remus/common/Timer.h>
+#include <remus/proto/JobProgress.h>
+#include <remus/worker/Job.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <deque>
+#include <fstream>
+#include <string>
+
+//included for export symbols
+#include <remus/worker/WorkerExports.h>
+
+#ifdef REMUS_MSVC
+ #pragma warning(push)
+ #pragma warning(disable:4251)  /*dll-interface missing on stl type*/
+#endif
+
+namespace remus{
+namespace worker{
+
+class Worker;
+
+//The process monitor follows an external program that a worker runs for a
+//job, and turns its output into progress of the job.
+//
+//The standard output and error of the program are read as they are written
+//and split into lines. Each line is given to the progress extractor, and
+//the progress it finds is sent to the server, at most once per progress
+//interval. Every line is also written to the log file, so that the full
+//output of long runs can be looked at afterwards.
+//
+//If the program writes nothing for longer than the stall timeout, or the
+//job is terminated by the client, the program is killed.
+//
+//The ExecuteProcess has to be executed before it is handed to monitor, and
+//keep its output piped to us, which is the default.
+class REMUSWORKER_EXPORT ProcessMonitor
+{
+public:
+  //Looks for progress in a line of output, returns true and fills in the
+  //progress when the line has any
+  typedef boost::function< bool (const std::string& line,
+                                 remus::proto::JobProgress& progress) >
+          ProgressExtractor;
+
+  //The default extractor, which uses the last percentage in the line, such
+  //as "meshing volume 3 of 8 (37%)", as the progress value, and the line
+  //as the progress message
+  static bool percentProgress(const std::string& line,
+                              remus::proto::JobProgress& progress);
+
+  ProcessMonitor(remus::worker::Worker& worker,
+                 const remus::worker::Job& job);
+
+  void progressExtractor(const ProgressExtractor& extractor)
+    { this->Extractor = extractor; }
+
+  //The minimum time in milliseconds between progress updates, progress
+  //found sooner is sent once the interval has passed. Defaults to 1000.
+  void progressInterval(boost::int64_t millisec)
+    { this->ProgressInterval = millisec; }
+  boost::int64_t progressInterval() const { return this->ProgressInterval; }
+
+  //Write all the output of the program to the given file, which is
+  //replaced if it exists. By default the output isn't kept.
+  void logFile(const std::string& path) { this->LogPath = path; }
+  const std::string& logFile() const { return this->LogPath; }
+
+  //Kill the program when it writes nothing for longer than the given
+  //number of milliseconds. Zero, the default, waits forever.
+  void stallTimeout(boost::int64_t millisec) { this->StallTimeout = millisec; }
+  boost::int64_t stallTimeout() const { return this->StallTimeout; }
+
+  //Follow the program until it exits, sending progress as it runs.
+  //Returns true if the program exited normally, and false if it crashed,
+  //stalled, or was killed because the job was terminated.
+  bool monitor(remus::common::ExecuteProcess& process);
+
+  //true when the last monitored program was killed for stalling
+  bool stalled() const { return this->Stalled; }
+
+  //true when the last monitored program was killed because its job
+  //was terminated
+  bool terminated() const { return this->Terminated; }
+
+  //the last lines the program wrote, newest last, which makes for a useful
+  //message when the program fails
+  std::string tail() const;
+
+private:
+  void handleOutput(std::string& buffer, const std::string& text);
+  void handleLine(const std::string& line);
+  void sendProgress(bool force);
+
+  remus::worker::Worker& Owner;
+  remus::worker::Job MonitoredJob;
+  ProgressExtractor Extractor;
+  boost::int64_t ProgressInterval;
+  boost::int64_t StallTimeout;
+  std::string LogPath;
+  std::ofstream Log;
+
+  bool Stalled;
+  bool Terminated;
+  bool HavePendingProgress;
+  remus::proto::JobProgress PendingProgress;
+  remus::proto::JobProgress SentProgress;
+  boost::int64_t LastSent;
+  remus::common::Timer Clock;
+  std::deque<std::string> Tail;
+
+  //explicitly state the monitor doesn't support copy or move semantics
+  ProcessMonitor(const ProcessMonitor&);
+  void operator=(const ProcessMonitor&);
+};
+
+}
+}
+
+#ifdef REMUS_MSVC
+  #pragma warning(pop)
+#endif
+
+#endif
@@ -12,12 +12,15 @@
 
 #include <remus/worker/Worker.h>
 
+#include <remus/proto/DirectTransport.h>
 #include <remus/proto/Message.h>
 #include <remus/proto/Response.h>
 #include <remus/proto/zmqHelper.h>
 #include <remus/worker/detail/JobQueue.h>
 #include <remus/worker/detail/MessageRouter.h>
+#include <remus/worker/detail/StatusCoalescer.h>
 
+#include <map>
 #include <string>
 
 //suppress warnings inside boost headers for gcc and clang
@@ -25,6 +28,8 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
 namespace remus{
@@ -33,26 +38,46 @@ namespace worker{
 //lightweight struct to hide zmq from leaking into libraries that link
 //to remus client
 namespace detail{
+
 struct ZmqManagement
 {
   //use auto generated channel names, this allows multiple workers to share
   //the same context.
   boost::shared_ptr<zmq::context_t> InterWorkerContext;
   zmq::socket_t Server;
+  //zmq sockets aren't thread safe, so every send/recv on Server needs
+  //to hold this lock. This allows multiple threads to report status
+  //and results for different jobs at the same time
+  boost::mutex ServerMutex;
   std::string WorkerChannelUUID;
-  std::string JobChannelUUID;
+  //total number of job credits we have granted the server, and how many
+  //jobs we want to keep requested ahead of what we are processing.
+  //Both are guarded by the ServerMutex
+  std::size_t CreditsGranted;
+  unsigned int PrefetchDepth;
+  //the number of jobs we process at once, sent along with our credits.
+  //Guarded by the ServerMutex
+  std::size_t Slots;
+  //number of result messages the server hasn't acknowledged, and how many
+  //we allow before returnResult blocks. Both are guarded by the ServerMutex
+  std::size_t ResultsInFlight;
+  unsigned int ResultWindow;
   ZmqManagement( remus::worker::ServerConnection const& conn ):
     InterWorkerContext( conn.context() ),
     Server( *InterWorkerContext, ZMQ_PAIR),
+    ServerMutex(),
     WorkerChannelUUID(),
-    JobChannelUUID()
+    CreditsGranted(0),
+    PrefetchDepth(0),
+    Slots(1),
+    ResultsInFlight(0),
+    ResultWindow(0)
   {
   boost::uuids::random_generator generator;
 
   //the goal here is to produce unique socket names. The current solution
   //is to use uuids for the channel names
   WorkerChannelUUID = boost::uuids::to_string(generator());
-  JobChannelUUID = boost::uuids::to_string(generator());
 
   //We have to bind to the inproc socket before the MessageRouter class does
   zmq::socketInfo<zmq::proto::inproc> sInfo( this->WorkerChannelUUID );
@@ -70,11 +95,10 @@ Worker::Worker(remus::common::MeshIOType mtype,
   MeshRequirements( remus::proto::make_JobRequirements(mtype,"","") ),
   ConnectionInfo(conn),
   Zmq( new detail::ZmqManagement( conn ) ),
+  JobQueue( new remus::worker::detail::JobQueue() ),
   MessageRouter( new remus::worker::detail::MessageRouter(
                     zmq::socketInfo<zmq::proto::inproc>(Zmq->WorkerChannelUUID),
-                    zmq::socketInfo<zmq::proto::inproc>(Zmq->JobChannelUUID))),
-  JobQueue( new remus::worker::detail::JobQueue( *Zmq->InterWorkerContext,
-                    zmq::socketInfo<zmq::proto::inproc>(Zmq->JobChannelUUID)))
+                    *JobQueue) )
 {
   //build the buffer before we start the message router. This shortens the
   //duration that the worker is stalling, while the message router is active
@@ -99,11 +123,10 @@ Worker::Worker(const remus::proto::JobRequirements& requirements,
   MeshRequirements(requirements),
   ConnectionInfo(conn),
   Zmq( new detail::ZmqManagement( conn ) ),
+  JobQueue( new remus::worker::detail::JobQueue() ),
   MessageRouter( new remus::worker::detail::MessageRouter(
                     zmq::socketInfo<zmq::proto::inproc>(Zmq->WorkerChannelUUID),
-                    zmq::socketInfo<zmq::proto::inproc>(Zmq->JobChannelUUID)) ),
-  JobQueue( new remus::worker::detail::JobQueue( *Zmq->InterWorkerContext,
-                    zmq::socketInfo<zmq::proto::inproc>(Zmq->JobChannelUUID)) )
+                    *JobQueue) )
 {
   //build the buffer before we start the message router. This shortens the
   //duration that the worker is stalling, while the message router is active
@@ -128,8 +151,12 @@ Worker::~Worker()
 {
   if(this->MessageRouter->valid())
     {
-    //send message that we are shutting down communication, and we can stop
-    //polling the server
+    //wait for the server to acknowledge all of our results, otherwise
+    //results still in transit would be dropped when the sockets close.
+    //Than send message that we are shutting down communication, and we
+    //can stop polling the server
+    boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+    this->collectResultAcks(0);
     remus::proto::send_Message(this->MeshRequirements.meshTypes(),
                                remus::TERMINATE_WORKER,
                                &this->Zmq->Server);
@@ -166,29 +193,25 @@ remus::worker::PollingRates Worker::pollingRates() const
 //-----------------------------------------------------------------------------
 void Worker::askForJobs( unsigned int numberOfJobs )
 {
-  if(this->MessageRouter->isForwardingToServer())
-    {
-    //next we send the MAKE_MESH call with the shorter version of the reqs,
-    //which have none of the heavy data.
-    proto::JobRequirements lightReqs(this->MeshRequirements.formatType(),
-                                     this->MeshRequirements.meshTypes(),
-                                     this->MeshRequirements.workerName(),
-                                     "");
-    //override the source type
-    lightReqs.SourceType = this->MeshRequirements.sourceType();
-    lightReqs.Tag = this->MeshRequirements.tag();
-
-    std::ostringstream input_buffer;
-    input_buffer << lightReqs;
-
-    for(unsigned int i=0; i < numberOfJobs; ++i)
-      {
-      proto::send_Message(this->MeshRequirements.meshTypes(),
-                          remus::MAKE_MESH,
-                          input_buffer.str(),
-                          &this->Zmq->Server);
-      }
-    }
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  this->grantJobCredits(numberOfJobs);
+}
+
+//-----------------------------------------------------------------------------
+void Worker::jobPrefetchDepth( unsigned int depth )
+{
+  {
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  this->Zmq->PrefetchDepth = depth;
+  }
+  this->topUpJobCredits();
+}
+
+//-----------------------------------------------------------------------------
+unsigned int Worker::jobPrefetchDepth() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  return this->Zmq->PrefetchDepth;
 }
 
 //-----------------------------------------------------------------------------
@@ -200,17 +223,25 @@ std::size_t Worker::pendingJobCount() const
 //-----------------------------------------------------------------------------
 remus::worker::Job Worker::takePendingJob()
 {
-  return this->JobQueue->take();
+  remus::worker::Job job = this->JobQueue->take();
+  this->topUpJobCredits();
+  return job;
 }
 
 //-----------------------------------------------------------------------------
 remus::worker::Job Worker::getJob()
 {
-  if(this->pendingJobCount() == 0)
+  if(this->jobPrefetchDepth() > 0)
+    {
+    this->topUpJobCredits();
+    }
+  else if(this->pendingJobCount() == 0)
     {
     this->askForJobs(1);
     }
-  return this->JobQueue->waitAndTakeJob();
+  remus::worker::Job job = this->JobQueue->waitAndTakeJob();
+  this->topUpJobCredits();
+  return job;
 }
 
 //-----------------------------------------------------------------------------
@@ -218,13 +249,39 @@ void Worker::updateStatus(const remus::proto::JobStatus& info)
 {
   if(this->MessageRouter->valid())
     {
-    //We want to send status as non blocking so we don't waste cycles
-    //waiting to hear back from zmq that the message left its inbox
-    std::string msg = remus::proto::to_string(info);
-    remus::proto::send_NonBlockingMessage(this->MeshRequirements.meshTypes(),
-                              remus::MESH_STATUS,
-                              msg,
-                              &this->Zmq->Server);
+    //progress we hold back is sent by the MessageRouter once it is due
+    boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+    if(this->MessageRouter->statusCoalescer().shouldSend(info))
+      {
+      this->sendStatus(info);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Worker::statusUpdateInterval( boost::int64_t millisec )
+{
+  this->MessageRouter->statusCoalescer().interval(millisec);
+}
+
+//-----------------------------------------------------------------------------
+boost::int64_t Worker::statusUpdateInterval() const
+{
+  return this->MessageRouter->statusCoalescer().interval();
+}
+
+//-----------------------------------------------------------------------------
+void Worker::flushStatus()
+{
+  if(this->MessageRouter->valid())
+    {
+    boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+    const std::vector<remus::proto::JobStatus> held =
+                    this->MessageRouter->statusCoalescer().takeDue(true);
+    for(std::size_t i=0; i < held.size(); ++i)
+      {
+      this->sendStatus(held[i]);
+      }
     }
 }
 
@@ -254,20 +311,71 @@ void Worker::returnResult(const remus::proto::JobResult& result)
 {
   if(this->MessageRouter->valid())
     {
-    //send a message that contains, the path to the resulting file
-    std::string msg = remus::proto::to_string(result);
-    remus::proto::send_Message(this->MeshRequirements.meshTypes(),
-                               remus::RETRIEVE_RESULT,
-                               msg,
-                               &this->Zmq->Server);
+    //the job is finished, so any progress we haven't sent is stale
+    this->MessageRouter->statusCoalescer().forget(result.id());
+
+    //send a message that contains, the path to the resulting file. When
+    //the server is in our process we hand it the result itself
+    const bool direct =
+        remus::proto::is_DirectEndpoint(this->ConnectionInfo.endpoint());
+    this->sendResults(remus::RETRIEVE_RESULT,
+                      direct ? remus::proto::to_DirectHandle(result)
+                             : remus::proto::to_string(result));
+    }
+}
 
-    //we need to block on waiting for the server to notify it has our result.
-    //Otherwise it is possible to delete a worker before it is done transimiting
-    //really large results to the server. Don't worry if the server terminates
-    //the worker before this is over the MessageRouter spoofs the response.
-    remus::proto::Response response =
-        remus::proto::receive_Response(&this->Zmq->Server);
-    (void) response;
+//-----------------------------------------------------------------------------
+void Worker::returnResults(const std::vector<remus::proto::JobResult>& results)
+{
+  if(results.size() == 1)
+    {
+    this->returnResult(results[0]);
+    }
+  else if(!results.empty() && this->MessageRouter->valid())
+    {
+    for(std::size_t i=0; i < results.size(); ++i)
+      {
+      this->MessageRouter->statusCoalescer().forget(results[i].id());
+      }
+
+    //the server acknowledges the entire batch with a single response
+    const bool direct =
+        remus::proto::is_DirectEndpoint(this->ConnectionInfo.endpoint());
+    this->sendResults(remus::RETRIEVE_RESULT_BATCH,
+                      direct ? remus::proto::to_DirectHandle(results)
+                             : remus::proto::to_string(results));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Worker::resultWindowSize( unsigned int size )
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  this->Zmq->ResultWindow = size;
+  this->collectResultAcks(size);
+}
+
+//-----------------------------------------------------------------------------
+unsigned int Worker::resultWindowSize() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  return this->Zmq->ResultWindow;
+}
+
+//-----------------------------------------------------------------------------
+std::size_t Worker::resultsInFlight() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  return this->Zmq->ResultsInFlight;
+}
+
+//-----------------------------------------------------------------------------
+void Worker::waitForResultAcks()
+{
+  if(this->MessageRouter->valid())
+    {
+    boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+    this->collectResultAcks(0);
     }
 }
 
@@ -283,5 +391,150 @@ bool Worker::jobShouldBeTerminated(const remus::worker::Job& job) const
   return this->JobQueue->isATerminatedJob(job);
 }
 
+//-----------------------------------------------------------------------------
+void Worker::grantJobCredits( unsigned int numberOfJobs )
+{
+  //requires the caller to hold the ServerMutex
+  if(numberOfJobs == 0 || !this->MessageRouter->isForwardingToServer())
+    {
+    return;
+    }
+
+  //we send the credits with the shorter version of the reqs,
+  //which have none of the heavy data.
+  proto::JobRequirements lightReqs(this->MeshRequirements.formatType(),
+                                   this->MeshRequirements.meshTypes(),
+                                   this->MeshRequirements.workerName(),
+                                   "");
+  //override the source type
+  lightReqs.SourceType = this->MeshRequirements.sourceType();
+  lightReqs.Tag = this->MeshRequirements.tag();
+
+  //a single message grants the entire window of credits, instead
+  //of sending a MAKE_MESH message per job
+  std::ostringstream input_buffer;
+  input_buffer << numberOfJobs << std::endl;
+  input_buffer << lightReqs << std::endl;
+  input_buffer << this->Zmq->Slots;
+
+  proto::send_Message(this->MeshRequirements.meshTypes(),
+                      remus::JOB_CREDITS,
+                      input_buffer.str(),
+                      &this->Zmq->Server);
+  this->Zmq->CreditsGranted += numberOfJobs;
+}
+
+//-----------------------------------------------------------------------------
+void Worker::grantMissingCredits( std::size_t numberOfJobs )
+{
+  //requires the caller to hold the ServerMutex.
+  //credits the server hasn't used yet plus the jobs waiting in our queue
+  //are the jobs we have ready to go. Jobs the server terminated while they
+  //were in our queue are counted as received, so their credits are
+  //replaced as well
+  const std::size_t received = this->JobQueue->numberOfJobsReceived();
+  const std::size_t outstanding = (this->Zmq->CreditsGranted > received) ?
+                                  (this->Zmq->CreditsGranted - received) : 0;
+  const std::size_t requested = outstanding + this->JobQueue->size();
+  if(requested < numberOfJobs)
+    {
+    this->grantJobCredits( static_cast<unsigned int>(numberOfJobs - requested) );
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Worker::topUpJobCredits()
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  if(this->Zmq->PrefetchDepth > 0)
+    {
+    this->grantMissingCredits(this->Zmq->PrefetchDepth);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Worker::keepJobsRequested( std::size_t numberOfJobs )
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  this->grantMissingCredits(numberOfJobs);
+}
+
+//-----------------------------------------------------------------------------
+void Worker::advertiseSlots( std::size_t numberOfSlots )
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  this->Zmq->Slots = numberOfSlots;
+}
+
+//-----------------------------------------------------------------------------
+remus::worker::Job Worker::waitForJob( boost::int64_t millisec )
+{
+  remus::worker::Job job = this->JobQueue->waitAndTakeJob(millisec);
+  this->topUpJobCredits();
+  return job;
+}
+
+//-----------------------------------------------------------------------------
+void Worker::sendStatus( const remus::proto::JobStatus& info )
+{
+  //We want to send status as non blocking so we don't waste cycles
+  //waiting to hear back from zmq that the message left its inbox
+  remus::proto::send_NonBlockingMessage(this->MeshRequirements.meshTypes(),
+                                        remus::MESH_STATUS,
+                                        remus::proto::to_string(info),
+                                        &this->Zmq->Server);
+}
+
+//-----------------------------------------------------------------------------
+void Worker::sendResults( remus::SERVICE_TYPE type, const std::string& msg )
+{
+  boost::lock_guard<boost::mutex> lock(this->Zmq->ServerMutex);
+  const remus::proto::Message sent =
+      remus::proto::send_Message(this->MeshRequirements.meshTypes(),
+                                 type,
+                                 msg,
+                                 &this->Zmq->Server);
+  if(!sent.isValid())
+    { //the results never left, so take them back from the direct transport
+    remus::proto::release_DirectHandle(msg);
+    }
+  ++this->Zmq->ResultsInFlight;
+
+  //we need to block on waiting for the server to notify it has our results
+  //once the window is full. Otherwise it is possible to delete a worker
+  //before it is done transmitting really large results to the server.
+  //Don't worry if the server terminates the worker before this is over the
+  //MessageRouter spoofs the responses.
+  this->collectResultAcks(this->Zmq->ResultWindow);
+}
+
+//-----------------------------------------------------------------------------
+void Worker::collectResultAcks( std::size_t maxInFlight )
+{
+  //requires the caller to hold the ServerMutex. The only responses the
+  //MessageRouter sends the worker are result acknowledgements, so we
+  //don't need to look at what we receive.
+
+  //first take every acknowledgement that has already arrived without blocking
+  zmq::pollitem_t item = { this->Zmq->Server,  0, ZMQ_POLLIN, 0 };
+  while(this->Zmq->ResultsInFlight > 0 &&
+        zmq_poll(&item, 1, 0) > 0 && (item.revents & ZMQ_POLLIN))
+    {
+    remus::proto::Response response =
+        remus::proto::receive_Response(&this->Zmq->Server);
+    (void) response;
+    --this->Zmq->ResultsInFlight;
+    }
+
+  //now block until we are back within the window
+  while(this->Zmq->ResultsInFlight > maxInFlight)
+    {
+    remus::proto::Response response =
+        remus::proto::receive_Response(&this->Zmq->Server);
+    (void) response;
+    --this->Zmq->ResultsInFlight;
+    }
+}
+
 }
 }
@@ -14,6 +14,7 @@
 #define remus_worker_h
 
 #include <remus/common/MeshIOType.h>
+#include <remus/common/ServiceTypes.h>
 
 //Workers include everything from proto, so that
 //users don't need as many includes
@@ -28,6 +29,8 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/scoped_ptr.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <vector>
+
 //included for export symbols
 #include <remus/worker/WorkerExports.h>
 
@@ -104,10 +107,18 @@ public:
   void pollingRates( const remus::worker::PollingRates& rates );
   remus::worker::PollingRates pollingRates() const;
 
-  //send a message to the server stating how many jobs
-  //that we want to be sent to process
+  //grant the server credits for how many jobs we want to be sent to
+  //process. All the credits are sent to the server in a single message.
   void askForJobs( unsigned int numberOfJobs = 1 );
 
+  //Set how many jobs the worker keeps requested from the server ahead of
+  //the jobs it has taken. When the depth is non zero the worker
+  //automatically tops up its job credits whenever a job is taken, so that
+  //the next job is already on its way while the current job is processed.
+  //The default depth is zero, which disables automatic top ups.
+  void jobPrefetchDepth( unsigned int depth );
+  unsigned int jobPrefetchDepth() const;
+
   //query to see how many pending jobs we need to process
   std::size_t pendingJobCount( ) const;
 
@@ -119,9 +130,26 @@ public:
   //Blocking fetch a pending job and return it
   remus::worker::Job getJob();
 
-  //update the status of the worker
+  //update the status of the worker.
+  //Note: updateStatus, sendProgress, sendJobFailure, and returnResult are
+  //thread safe, and can be called for different jobs from multiple threads
   void updateStatus(const remus::proto::JobStatus& info);
 
+  //Set the minimum time in milliseconds between progress updates sent to
+  //the server for a single job. Progress updates that arrive sooner are
+  //coalesced, so that only the latest progress of each job is sent once
+  //the interval has passed. Changes of state, such as a job failing, are
+  //always sent immediately. The default interval is zero, which sends
+  //every update.
+  //
+  //Note: coalesced progress is sent by the worker's polling thread once
+  //the interval has passed, or immediately by calling flushStatus
+  void statusUpdateInterval( boost::int64_t millisec );
+  boost::int64_t statusUpdateInterval() const;
+
+  //send the latest coalesced progress of every job to the server
+  void flushStatus();
+
   //send a progress status update. This is a convenience method
   //so the user doesn't have to manually create JobStatus object
   void sendProgress( const remus::worker::Job&,
@@ -132,9 +160,31 @@ public:
   //JobStatus object and mark it as failed
   void sendJobFailure( const remus::worker::Job&, const std::string& reason );
 
-  //send to the server the mesh results.
+  //send to the server the mesh results. Blocks until the number of results
+  //the server hasn't acknowledged is within the result window.
   void returnResult(const remus::proto::JobResult& result);
 
+  //send to the server the mesh results of multiple jobs in a single
+  //message. This is designed for workers processing batches of jobs that
+  //take very little time, where the per result overhead dominates.
+  void returnResults(const std::vector<remus::proto::JobResult>& results);
+
+  //Set how many result messages can be in transit to the server without
+  //being acknowledged. When the window is non zero returnResult only
+  //blocks once the window is full, allowing the worker to start on the next
+  //job while earlier results are still being uploaded. The default
+  //window is zero, which makes returnResult wait for every acknowledgement.
+  void resultWindowSize( unsigned int size );
+  unsigned int resultWindowSize() const;
+
+  //the number of result messages the server hasn't acknowledged yet
+  std::size_t resultsInFlight() const;
+
+  //Blocks until the server has acknowledged every result we have sent.
+  //This is called automatically when the worker is destroyed, so that
+  //large results aren't dropped while they are still in transit.
+  void waitForResultAcks();
+
   //ask the worker API if the server has told us we should shutdown.
   //This means that the server has shutdown and all jobs the worker
   //has are invalid and can be terminated.
@@ -145,15 +195,56 @@ public:
   //the job
   bool jobShouldBeTerminated( const remus::worker::Job& job ) const;
 
+protected:
+  //grant the server enough credits so that numberOfJobs jobs are either
+  //requested or waiting to be taken. This allows derived workers that
+  //process multiple jobs at once to keep a job requested for every free
+  //slot, using the same credit accounting as jobPrefetchDepth
+  void keepJobsRequested( std::size_t numberOfJobs );
+
+  //fetch a pending job, waiting up to millisec for a job from the server.
+  //Returns an invalid job if the wait timed out
+  remus::worker::Job waitForJob( boost::int64_t millisec );
+
+  //tell the server how many jobs this worker processes at the same time.
+  //The server only retires idle workers that process a single job, as
+  //retiring a worker terminates every job slot it has
+  void advertiseSlots( std::size_t numberOfSlots );
+
 private:
+  //send the server a single message granting numberOfJobs credits.
+  //requires the caller to hold the server socket lock
+  void grantJobCredits( unsigned int numberOfJobs );
+
+  //grant the credits missing to have numberOfJobs jobs requested or
+  //waiting in the queue. requires the caller to hold the server socket lock
+  void grantMissingCredits( std::size_t numberOfJobs );
+
+  //grant enough credits to keep jobPrefetchDepth jobs requested
+  void topUpJobCredits();
+
+  //send a status message to the server.
+  //requires the caller to hold the server socket lock
+  void sendStatus( const remus::proto::JobStatus& info );
+
+  //send a result message to the server, and wait for enough acknowledgements
+  //so that the results in flight fit in the result window
+  void sendResults( remus::SERVICE_TYPE type, const std::string& msg );
+
+  //receive acknowledgements until at most maxInFlight results are
+  //unacknowledged. requires the caller to hold the server socket lock
+  void collectResultAcks( std::size_t maxInFlight );
+
   //holds the type of mesh we support
   const remus::proto::JobRequirements MeshRequirements;
 
   remus::worker::ServerConnection ConnectionInfo;
 
   boost::scoped_ptr<detail::ZmqManagement> Zmq;
-  boost::scoped_ptr<remus::worker::detail::MessageRouter> MessageRouter;
+  //the JobQueue is filled by the MessageRouter, so it must be constructed
+  //before and destroyed after the MessageRouter
   boost::scoped_ptr<remus::worker::detail::JobQueue> JobQueue;
+  boost::scoped_ptr<remus::worker::detail::MessageRouter> MessageRouter;
 
   //explicitly state the worker doesn't support copy or move semantics
   Worker(const Worker&);
@@ -0,0 +1,252 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/worker/Zygote.h>
+
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <sys/wait.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/syscall.h>
+//older C libraries don't know about pidfd_open, the number is the same
+//on every architecture
+#  ifndef SYS_pidfd_open
+#   define SYS_pidfd_open 434
+#  endif
+# endif
+#endif
+
+namespace
+{
+#ifndef _WIN32
+//The protocol spoken with remus::server::detail::Zygote. The factory
+//passes the control descriptor in the environment, the zygote sends
+//ReadyMessage once it is waiting, and answers each ForkRequest with the
+//pid of the forked worker on a line of its own, or -1 if fork failed.
+//The line of a forked worker carries a pidfd of the worker, so that the
+//factory can track the worker even after we have reaped it.
+const char* const ControlEnvName = "REMUS_ZYGOTE_FD";
+const char* const ReadyMessage = "R\n";
+const char ForkRequest = 'F';
+
+//----------------------------------------------------------------------------
+bool write_all(int fd, const char* data, std::size_t size)
+{
+  while(size > 0)
+    {
+    const ssize_t written = ::write(fd, data, size);
+    if(written < 0 && errno == EINTR)
+      {
+      continue;
+      }
+    if(written <= 0)
+      {
+      return false;
+      }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+//send the answer to a fork request, passing the pidfd of the worker along
+//with the first byte of the answer
+bool send_reply(int control, int pid, int pidfd)
+{
+  char reply[32];
+  const int length = ::snprintf(reply, sizeof(reply), "%d\n", pid);
+  if(pidfd < 0)
+    {
+    return write_all(control, reply, static_cast<std::size_t>(length));
+    }
+
+  struct iovec io;
+  io.iov_base = reply;
+  io.iov_len = static_cast<std::size_t>(length);
+
+  union
+    {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int))];
+    } rights;
+  ::memset(&rights, 0, sizeof(rights));
+
+  struct msghdr message;
+  ::memset(&message, 0, sizeof(message));
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = rights.buffer;
+  message.msg_controllen = sizeof(rights.buffer);
+
+  struct cmsghdr* c = CMSG_FIRSTHDR(&message);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int));
+  ::memcpy(CMSG_DATA(c), &pidfd, sizeof(int));
+
+  ssize_t sent = 0;
+  do
+    {
+    sent = ::sendmsg(control, &message, 0);
+    } while(sent < 0 && errno == EINTR);
+  if(sent <= 0)
+    {
+    return false;
+    }
+  return write_all(control, reply + sent, static_cast<std::size_t>(length - sent));
+}
+
+//----------------------------------------------------------------------------
+//a descriptor that refers to the process with the given pid for as long as
+//the descriptor is open, or -1 when pidfds aren't supported
+int pidfd_open(pid_t pid)
+{
+#ifdef __linux__
+  return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+  (void) pid;
+  return -1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+//reap every worker that has exited
+void reap_workers(int)
+{
+  const int savedErrno = errno;
+  while(::waitpid(-1, NULL, WNOHANG) > 0)
+    {
+    }
+  errno = savedErrno;
+}
+
+//----------------------------------------------------------------------------
+void set_child_handler(void (*handler)(int))
+{
+  struct sigaction action;
+  ::memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  ::sigaction(SIGCHLD, &action, NULL);
+}
+
+//----------------------------------------------------------------------------
+//the forked worker doesn't talk to the factory, so give it nothing to
+//read instead of the control descriptor
+void detach_control(int control)
+{
+  const int devnull = ::open("/dev/null", O_RDONLY);
+  if(devnull >= 0)
+    {
+    ::dup2(devnull, control);
+    ::close(devnull);
+    }
+  else
+    {
+    ::close(control);
+    }
+}
+#endif
+}
+
+namespace remus{
+namespace worker{
+
+//----------------------------------------------------------------------------
+bool runZygote()
+{
+#ifndef _WIN32
+  const char* controlText = ::getenv(ControlEnvName);
+  if(!controlText || !controlText[0])
+    {
+    return false;
+    }
+  const int control = ::atoi(controlText);
+  //the workers we fork aren't zygotes
+  ::unsetenv(ControlEnvName);
+
+  //the workers are reaped as they exit. They can't be reaped before we
+  //have opened their pidfd, as the pid could be reused by then, so the
+  //signal is blocked while forking
+  set_child_handler(reap_workers);
+  sigset_t childSignal;
+  sigemptyset(&childSignal);
+  sigaddset(&childSignal, SIGCHLD);
+
+  if(!write_all(control, ReadyMessage, ::strlen(ReadyMessage)))
+    {
+    ::exit(0);
+    }
+
+  while(true)
+    {
+    char request = 0;
+    const ssize_t count = ::read(control, &request, 1);
+    if(count < 0 && errno == EINTR)
+      {
+      continue;
+      }
+    if(count <= 0)
+      { //the factory has gone away
+      ::exit(0);
+      }
+    if(request != ForkRequest)
+      {
+      continue;
+      }
+
+    sigset_t previous;
+    ::sigprocmask(SIG_BLOCK, &childSignal, &previous);
+    pid_t pid = ::fork();
+    if(pid == 0)
+      {
+      set_child_handler(SIG_DFL);
+      ::sigprocmask(SIG_SETMASK, &previous, NULL);
+      detach_control(control);
+      return true;
+      }
+
+    int pidfd = (pid > 0) ? pidfd_open(pid) : -1;
+    if(pid > 0 && pidfd < 0)
+      { //a worker the factory can't track safely is of no use to it
+      ::kill(pid, SIGKILL);
+      pid = -1;
+      }
+    ::sigprocmask(SIG_SETMASK, &previous, NULL);
+
+    const bool sent = send_reply(control, static_cast<int>(pid > 0 ? pid : -1),
+                                 pidfd);
+    if(pidfd >= 0)
+      {
+      ::close(pidfd);
+      }
+    if(!sent)
+      {
+      ::exit(0);
+      }
+    }
+#else
+  return false;
+#endif
+}
+
+}
+}
@@ -0,0 +1,45 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_worker_Zygote_h
+#define remus_worker_Zygote_h
+
+//included for export symbols
+#include <remus/worker/WorkerExports.h>
+
+namespace remus{
+namespace worker{
+
+//Workers that take a long time to start, because of the libraries they load
+//or the licenses they check out, can be launched by the WorkerFactory as a
+//zygote, by setting "Zygote" to true in their worker file.
+//
+//The factory starts the executable once, and when the executable calls
+//runZygote after it has initialized, the process becomes a template that
+//waits for the factory to ask for workers. Each request forks the template,
+//and runZygote returns true in the forked process, which carries on to
+//connect to the server like any other worker. The template itself never
+//returns, and exits when the factory goes away.
+//
+//When the executable wasn't launched as a zygote, or on platforms without
+//fork, runZygote returns false right away, so a worker can always call it.
+//
+//Only the calling thread survives a fork, so runZygote has to be called
+//before any threads are started, which includes constructing a Worker or
+//the zmq context of a ServerConnection.
+REMUSWORKER_EXPORT
+bool runZygote();
+
+}
+}
+
+#endif
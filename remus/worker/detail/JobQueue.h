@@ -13,13 +13,16 @@
 #ifndef remus_worker_detail_JobQueue_h
 #define remus_worker_detail_JobQueue_h
 
-#include <remus/proto/zmqHelper.h>
 #include <remus/worker/Job.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/uuid/uuid.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <vector>
+
 namespace remus{
 namespace worker{
 namespace detail{
@@ -28,16 +31,29 @@ namespace detail{
 //If the TermianteWorker job is sent to the job queue, we will clear the
 //entire queue and only have a TerminateJob on the queue.
 //
+//The JobQueue is filled directly by the polling thread of the MessageRouter,
+//so jobs are handed to the worker without another socket or thread hop.
+//
 //Once a JobQueue is sent a TerminateWorker, it will not accept any new jobs
-//and will refuse to start back up looking for jobs
 class JobQueue
 {
 public:
-  JobQueue(zmq::context_t& context,
-           const zmq::socketInfo<zmq::proto::inproc>& queue_info);
+  JobQueue();
   ~JobQueue();
 
-  std::string endpoint() const;
+  //Add a job the server has sent us to the end of the queue
+  void addJob( const remus::worker::Job& job );
+
+  //Add a batch of jobs the server has sent us to the end of the queue
+  void addJobs( const std::vector< remus::worker::Job >& jobs );
+
+  //Mark the job with the given id as terminated, and remove it from
+  //the queue if it hasn't been taken yet
+  void terminateJob( const boost::uuids::uuid& id );
+
+  //Clear every job from the queue and replace them with a single
+  //TerminateWorker job. After this the queue won't accept any new jobs
+  void terminateWorker();
 
   //Returns true if the job is part of the queue and job status
   //has been marked as terminate. This is allows people to peek at the queue
@@ -52,15 +68,22 @@ public:
   //job is present, it waits for a job to enter the queue
   remus::worker::Job waitAndTakeJob();
 
+  //Removes the first job from the queue, If no job is present, it waits
+  //up to millisec for a job to enter the queue. Will return an invalid
+  //job if the wait timed out
+  remus::worker::Job waitAndTakeJob(boost::int64_t millisec);
+
+  //return the number of jobs the server has sent to the queue. This
+  //includes jobs that were terminated before they were taken from the queue
+  std::size_t numberOfJobsReceived() const;
+
   //return the number of jobs waiting for work
   std::size_t size() const;
 
-  //has finished setting up and is ready for jobs
+  //is ready for jobs, which is true until the queue is terminated
   bool isReady() const;
 
-  //has job queue been told to shutdown and terminate this is only true
-  //if the job queue has been started and than has been stopped. If the
-  //job queue is still launching this will return false
+  //has job queue been told to shutdown and terminate
   bool isShutdown() const;
 
 private:
@@ -12,6 +12,7 @@
 
 #include <remus/worker/detail/MessageRouter.h>
 
+#include <remus/proto/DirectTransport.h>
 #include <remus/proto/Message.h>
 #include <remus/proto/Response.h>
 #include <remus/proto/zmqHelper.h>
@@ -19,6 +20,8 @@
 #include <remus/common/CompilerInformation.h>
 #include <remus/common/PollingMonitor.h>
 #include <remus/worker/Job.h>
+#include <remus/worker/detail/JobQueue.h>
+#include <remus/worker/detail/StatusCoalescer.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/thread.hpp>
@@ -26,6 +29,8 @@ REMUS_THIRDPARTY_PRE_INCLUDE
 #include <boost/uuid/uuid.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
+#include <algorithm>
+
 namespace remus{
 namespace worker{
 namespace detail{
@@ -34,9 +39,18 @@ namespace detail{
 class MessageRouter::MessageRouterImplementation
 {
   std::string WorkerEndpoint;
-  std::string QueueEndpoint;
+  zmq::socketInfo<zmq::proto::inproc> WakeupEndpoint;
+  zmq::context_t* WakeupContext;
+  remus::worker::detail::JobQueue* Queue;
   std::size_t OutstandingResults;
 
+  //true when the server is in our process, so that jobs and results can
+  //be direct handles instead of serialized objects
+  bool DirectToServer;
+
+  //progress the worker is holding back, which we send once it is due
+  remus::worker::detail::StatusCoalescer Statuses;
+
   //kept as a member variable so that we can allow the user to specify
   //custom polling rates for workers
   remus::common::PollingMonitor PollMonitor;
@@ -60,10 +74,14 @@ public:
 //-----------------------------------------------------------------------------
 MessageRouterImplementation(
                       const zmq::socketInfo<zmq::proto::inproc>& worker_info,
-                      const zmq::socketInfo<zmq::proto::inproc>& queue_info):
+                      remus::worker::detail::JobQueue& queue):
   WorkerEndpoint(worker_info.endpoint()),
-  QueueEndpoint(queue_info.endpoint()),
+  WakeupEndpoint(worker_info.host() + "-wakeup"),
+  WakeupContext(NULL),
+  Queue(&queue),
   OutstandingResults(0),
+  DirectToServer(false),
+  Statuses(),
   PollMonitor(boost::int64_t(250), boost::int64_t(60000)), //assign a low floor for faster testing
   ThreadMutex(),
   ThreadStatusChanged(),
@@ -84,6 +102,9 @@ MessageRouterImplementation(
 //------------------------------------------------------------------------------
 remus::common::PollingMonitor monitor() const { return PollMonitor; }
 
+//------------------------------------------------------------------------------
+remus::worker::detail::StatusCoalescer& statuses() { return Statuses; }
+
 //-----------------------------------------------------------------------------
 bool isTalking() const
 {
@@ -114,6 +135,7 @@ bool startTalking(const remus::worker::ServerConnection& server_info,
     launchThread = !this->ContinuePolling && !threadIsRunning;
     if(launchThread)
       {
+      this->WakeupContext = &internal_inproc_context;
       boost::scoped_ptr<boost::thread> pollthread(
         new boost::thread( &MessageRouterImplementation::poll, this,
                             server_info,
@@ -138,6 +160,8 @@ void stop()
   if(this->PollingThread && this->isTalking())
     {
     this->setIsTalking(false);
+    //interrupt the polling thread so we don't wait for the poll to time out
+    zmq::send_wakeup(*this->WakeupContext, this->WakeupEndpoint.endpoint());
     this->PollingThread->join();
     }
 }
@@ -172,18 +196,31 @@ void poll(remus::worker::ServerConnection server_info,
 
   zmq::socket_t serverComm(*(server_info.context()),ZMQ_DEALER);
   zmq::connectToAddress(serverComm, server_info.endpoint());
-
-  zmq::socket_t queueComm(*internal_inproc_context,ZMQ_PAIR);
-  zmq::connectToAddress(queueComm,  this->QueueEndpoint);
+  this->DirectToServer =
+                  remus::proto::is_DirectEndpoint(server_info.endpoint());
 
   zmq::socket_t workerComm(*internal_inproc_context,ZMQ_PAIR);
   zmq::connectToAddress(workerComm, this->WorkerEndpoint);
 
-  zmq::pollitem_t items[2]  = {
+  zmq::socket_t wakeupComm(*internal_inproc_context,ZMQ_PULL);
+  zmq::bindToAddress(wakeupComm, this->WakeupEndpoint);
+
+  zmq::pollitem_t items[3]  = {
                                 { workerComm,  0, ZMQ_POLLIN, 0 },
-                                { serverComm,  0, ZMQ_POLLIN, 0 }
+                                { serverComm,  0, ZMQ_POLLIN, 0 },
+                                { wakeupComm,  0, ZMQ_POLLIN, 0 }
                               };
 
+  //we only wake up for messages, or when we need to send the server a
+  //heartbeat since we have gone long enough without sending it a message.
+  //Every message we forward tells the server we are alive, so an explicit
+  //heartbeat is only needed once the link has been idle for half of the
+  //interval we promise the server in each heartbeat. We also wake up when
+  //progress the worker is holding back is due to be sent.
+  //All times are in milliseconds on a monotonic clock
+  const boost::int64_t idleGap = std::max(this->PollMonitor.minTimeOut(),
+                                          this->PollMonitor.maxTimeOut() / 2);
+  boost::int64_t nextHeartbeat = StatusCoalescer::now();
 
   //We need to notify the Thread management that polling is about to start.
   //This allows the calling thread to resume, as it has been waiting for this
@@ -192,25 +229,37 @@ void poll(remus::worker::ServerConnection server_info,
   this->setIsTalking(true);
   while( this->isTalking() )
     {
-    zmq::poll_safely(&items[0],2,this->PollMonitor.current());
+    boost::int64_t now = StatusCoalescer::now();
+    boost::int64_t timeout = std::max(boost::int64_t(0), nextHeartbeat - now);
+    const boost::int64_t statusDue = this->Statuses.timeUntilDue();
+    if(statusDue >= 0)
+      {
+      timeout = std::min(timeout, statusDue);
+      }
+    zmq::poll_for_events(&items[0],3,timeout);
     this->PollMonitor.pollOccurred();
 
-    //handle taking
-    bool notSentToServer = true;
+    if(items[2].revents & ZMQ_POLLIN)
+        {
+        //we have been woken up, most likely to stop polling
+        zmq::drain_wakeups(wakeupComm);
+        }
     if(items[1].revents & ZMQ_POLLIN)
         {
         //handle accepting message from the server and forwarding
         //them to the server. Handle server messages before worker
         //messages so that we don't send messages to a server
         //that is now telling us to shut down
-        this->handleServerMessage(workerComm, serverComm, queueComm);
+        this->handleServerMessage(workerComm, serverComm);
         }
+
+    now = StatusCoalescer::now();
     if(items[0].revents & ZMQ_POLLIN)
         {
-        notSentToServer = false;
         //handle accepting messages from the worker and forwarding
-        //them to the server
-        this->handleWorkerMessage(workerComm, serverComm, queueComm);
+        //them to the server. This counts as a heartbeat
+        this->handleWorkerMessage(workerComm, serverComm);
+        nextHeartbeat = now + idleGap;
         if(!ContinueForwardingToServer)
           {
           //we are shutting down so we mark that we will not accept any
@@ -219,11 +268,19 @@ void poll(remus::worker::ServerConnection server_info,
           }
         }
 
-     if(notSentToServer)
+    //the progress is sent after the worker messages we have forwarded, so
+    //that the server never sees progress older than what it already has
+    if(this->sendHeldStatus(serverComm, false))
+        {
+        nextHeartbeat = now + idleGap;
+        }
+
+     if(nextHeartbeat <= now)
         {
         //we are going to send a heartbeat now since we have gone long enough
         //without sending a message to the server
         this->sendHeartBeat(serverComm, this->PollMonitor);
+        nextHeartbeat = now + idleGap;
         }
     }
 }
@@ -231,8 +288,7 @@ void poll(remus::worker::ServerConnection server_info,
 //------------------------------------------------------------------------------
 //handles taking messages from the worker
 void handleWorkerMessage(zmq::socket_t& workerComm,
-                         zmq::socket_t& serverComm,
-                         zmq::socket_t& queueComm)
+                         zmq::socket_t& serverComm)
 {
   //first we take the message from the worker socket so it
   //doesn't hang around, and makes the worker think it
@@ -245,6 +301,13 @@ void handleWorkerMessage(zmq::socket_t& workerComm,
   //use block on destruction of the socket
   if( this->ContinueForwardingToServer )
     {
+    //the worker is shutting down, so send the progress it is holding
+    //back before we tell the server
+    if(message.serviceType()==remus::TERMINATE_WORKER)
+      {
+      this->sendHeldStatus(serverComm, true);
+      }
+
     //first we need to forward all message to the server
     remus::proto::forward_Message(message,&serverComm);
 
@@ -253,22 +316,17 @@ void handleWorkerMessage(zmq::socket_t& workerComm,
     //so we need to prepare for that
     if(message.serviceType()==remus::TERMINATE_WORKER)
       {
-      //In theory the JobQueue will shutdown whenever the worker is destroyed.
-      //We don't care about blocking our shutdown based on if the job queue
-      //received this message, as it could already be shutting down, and has
-      //stopped polling.
-      remus::worker::Job terminateJob;
-      remus::proto::send_NonBlockingResponse(remus::TERMINATE_WORKER,
-                                             remus::worker::to_string(terminateJob),
-                                             &queueComm,
-                                             (zmq::SocketIdentity()) );
+      //In theory the JobQueue will shutdown whenever the worker is destroyed,
+      //but we terminate it now so nobody waits on a job that will never come
+      this->Queue->terminateWorker();
 
       //we are in the process of cleaning up we need to stop everything.
       //we first check if we have any outstanding job results that
       //are waiting around to be sent
       this->ContinueForwardingToWorker = false;
       }
-    else if(message.serviceType()==remus::RETRIEVE_RESULT)
+    else if(message.serviceType()==remus::RETRIEVE_RESULT ||
+            message.serviceType()==remus::RETRIEVE_RESULT_BATCH)
       {
       //Mark that we need a response from the server, this is required so that
       //we can send back really large result data. When we don't wait for the
@@ -278,13 +336,20 @@ void handleWorkerMessage(zmq::socket_t& workerComm,
       ++this->OutstandingResults;
       }
     }
+  else if(this->DirectToServer &&
+          (message.serviceType()==remus::RETRIEVE_RESULT ||
+           message.serviceType()==remus::RETRIEVE_RESULT_BATCH))
+    {
+    //the results are dropped, so don't leave them parked
+    remus::proto::release_DirectHandle(
+                        std::string(message.data(), message.dataSize()));
+    }
 }
 
 //------------------------------------------------------------------------------
 //handles taking messages from the server
 void handleServerMessage( zmq::socket_t& workerComm,
-                          zmq::socket_t& serverComm,
-                          zmq::socket_t& queueComm)
+                          zmq::socket_t& serverComm)
 {
   remus::proto::Response response = remus::proto::receive_Response(&serverComm);
   const bool goodToForward = response.isValid();
@@ -298,9 +363,7 @@ void handleServerMessage( zmq::socket_t& workerComm,
       {
       if(goodToForwardToQueue)
         {
-        remus::proto::forward_Response(response,
-                                       &queueComm,
-                                       zmq::SocketIdentity());
+        this->Queue->terminateWorker();
         }
       //if the server is shutting down the worker and the worker
       //is still waiting for a response to a RETRIEVE_RESULT we
@@ -321,11 +384,18 @@ void handleServerMessage( zmq::socket_t& workerComm,
       }
     else if(goodToForwardToQueue &&
             ( response.serviceType() == remus::TERMINATE_JOB ||
-              response.serviceType() == remus::MAKE_MESH ) )
+              response.serviceType() == remus::MAKE_MESH ||
+              response.serviceType() == remus::JOB_BATCH ) )
       {
-      remus::proto::forward_Response(response,
-                                     &queueComm,
-                                     zmq::SocketIdentity());
+      this->forwardToQueue(response);
+      }
+    else if(this->DirectToServer &&
+            ( response.serviceType() == remus::MAKE_MESH ||
+              response.serviceType() == remus::JOB_BATCH ) )
+      {
+      //we are shutting down and drop the jobs, so don't leave them parked
+      remus::proto::release_DirectHandle(
+                        std::string(response.data(), response.dataSize()));
       }
     else if ( response.serviceType() == remus::RETRIEVE_RESULT)
       { //the worker is notifying us that it recieved our results, so decrement
@@ -337,8 +407,57 @@ void handleServerMessage( zmq::socket_t& workerComm,
       --this->OutstandingResults;
       }
       // do nothing if it isn't terminate_job, terminate_worker,
-      // make_mesh or retrieve result
+      // make_mesh, job_batch or retrieve result
+    }
+}
+
+//------------------------------------------------------------------------------
+//parses the jobs the server has sent and hands them directly to the job
+//queue, so that jobs don't need another socket and thread to reach the worker
+void forwardToQueue(const remus::proto::Response& response)
+{
+  //required to use the char*, len constructor as response's data can
+  //be binary data with lots of null terminators.
+  const std::string data(response.data(), response.dataSize());
+  switch(response.serviceType())
+    {
+    case remus::MAKE_MESH:
+      this->Queue->addJob( remus::proto::to_WorkerJob(data,
+                                                      this->DirectToServer) );
+      break;
+    case remus::JOB_BATCH:
+      this->Queue->addJobs( remus::proto::to_WorkerJobBatch(data,
+                                                      this->DirectToServer) );
+      break;
+    case remus::TERMINATE_JOB:
+      this->Queue->terminateJob( remus::worker::to_Job(data).id() );
+      break;
+    default:
+      break;
+    }
+}
+
+//------------------------------------------------------------------------------
+//sends the held progress that is due, or all held progress when force is
+//true. Returns true if anything was sent
+bool sendHeldStatus(zmq::socket_t& serverComm, bool force)
+{
+  if(!this->ContinueForwardingToServer)
+    {
+    return false;
     }
+
+  const std::vector<remus::proto::JobStatus> due =
+                                          this->Statuses.takeDue(force);
+  for(std::size_t i=0; i < due.size(); ++i)
+    {
+    //the server doesn't use the mesh types of a status message
+    remus::proto::send_NonBlockingMessage(remus::common::MeshIOType(),
+                                          remus::MESH_STATUS,
+                                          remus::proto::to_string(due[i]),
+                                          &serverComm);
+    }
+  return !due.empty();
 }
 
 //------------------------------------------------------------------------------
@@ -359,7 +478,7 @@ void sendHeartBeat(zmq::socket_t& serverComm,
     //send the heartbeat to the server
     remus::proto::send_Message(remus::common::MeshIOType(),
                                remus::HEARTBEAT,
-                               boost::lexical_cast<std::string>(polldur),
+                               remus::proto::to_HeartbeatPayload(polldur),
                                &serverComm);
     }
 }
@@ -370,8 +489,8 @@ void sendHeartBeat(zmq::socket_t& serverComm,
 //-----------------------------------------------------------------------------
 MessageRouter::MessageRouter(
                 const zmq::socketInfo<zmq::proto::inproc>& worker_info,
-                const zmq::socketInfo<zmq::proto::inproc>& queue_info):
-Implementation( new MessageRouterImplementation(worker_info, queue_info) )
+                remus::worker::detail::JobQueue& queue):
+Implementation( new MessageRouterImplementation(worker_info, queue) )
 {
 
 }
@@ -413,6 +532,12 @@ remus::common::PollingMonitor MessageRouter::pollingMonitor() const
   return this->Implementation->monitor();
 }
 
+//-----------------------------------------------------------------------------
+remus::worker::detail::StatusCoalescer& MessageRouter::statusCoalescer()
+{
+  return this->Implementation->statuses();
+}
+
 }
 }
 }
@@ -28,9 +28,17 @@ namespace remus{
 namespace worker{
 namespace detail{
 
+class JobQueue;
+class StatusCoalescer;
+
 //Routes messages from the server to the worker class or the job queue,
 //based on the message type. The message router also handles send heartbeat
 //message back to the server
+//
+//The polling thread of the message router is the only I/O thread of a
+//worker. Jobs from the server are parsed on this thread and added directly
+//to the JobQueue, while messages from the worker arrive on an inproc socket.
+//The JobQueue must outlive the MessageRouter.
 
 //Once a MessageRouter is sent a TerminateWorker message,it will not accept any
 //new messages from the Server and trying to start back up the server. Also
@@ -39,7 +47,7 @@ class MessageRouter
 {
 public:
   MessageRouter(const zmq::socketInfo<zmq::proto::inproc>& worker_info,
-                const zmq::socketInfo<zmq::proto::inproc>& queue_info);
+                remus::worker::detail::JobQueue& queue);
 
   ~MessageRouter();
 
@@ -68,6 +76,11 @@ public:
   //modify the message router instance.
   remus::common::PollingMonitor pollingMonitor() const;
 
+  //Returns the coalescer of the progress the worker holds back. The
+  //polling thread sends the held progress once it is due, so progress
+  //reaches the server even when the worker sends nothing else
+  remus::worker::detail::StatusCoalescer& statusCoalescer();
+
 private:
   class MessageRouterImplementation;
   boost::scoped_ptr<MessageRouterImplementation> Implementation;
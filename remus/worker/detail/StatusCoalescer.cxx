@@ -0,0 +1,148 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/worker/detail/StatusCoalescer.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/thread/locks.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <algorithm>
+#include <chrono>
+
+namespace remus{
+namespace worker{
+namespace detail{
+
+//------------------------------------------------------------------------------
+StatusCoalescer::StatusCoalescer():
+  Mutex(),
+  Interval(0),
+  Items()
+{
+}
+
+//------------------------------------------------------------------------------
+void StatusCoalescer::interval(boost::int64_t millisec)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->Interval = millisec;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t StatusCoalescer::interval() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->Interval;
+}
+
+//------------------------------------------------------------------------------
+bool StatusCoalescer::shouldSend(const remus::proto::JobStatus& status)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if(this->Interval <= 0 || !status.inProgress())
+    {
+    //a change of state, or progress we send right away, supersedes
+    //any progress of the job we haven't sent
+    this->Items.erase(status.id());
+    return true;
+    }
+
+  const boost::int64_t current = StatusCoalescer::now();
+  ItemMap::iterator item = this->Items.find(status.id());
+  if(item == this->Items.end())
+    {
+    this->Items.insert(std::make_pair(status.id(), Item(current, status)));
+    return true;
+    }
+  if(current - item->second.LastSent >= this->Interval)
+    {
+    item->second.LastSent = current;
+    item->second.HaveUnsent = false;
+    return true;
+    }
+
+  item->second.Latest = status;
+  item->second.HaveUnsent = true;
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void StatusCoalescer::forget(const boost::uuids::uuid& id)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->Items.erase(id);
+}
+
+//------------------------------------------------------------------------------
+std::vector<remus::proto::JobStatus> StatusCoalescer::takeDue(bool force)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  const boost::int64_t current = StatusCoalescer::now();
+  std::vector<remus::proto::JobStatus> due;
+  for(ItemMap::iterator i = this->Items.begin(); i != this->Items.end(); )
+    {
+    Item& item = i->second;
+    const bool intervalPassed = (current - item.LastSent) >= this->Interval;
+    if(item.HaveUnsent && (force || intervalPassed))
+      {
+      due.push_back(item.Latest);
+      item.LastSent = current;
+      item.HaveUnsent = false;
+      ++i;
+      }
+    else if(!item.HaveUnsent && intervalPassed)
+      {
+      //the next progress of the job is sent right away, so we can forget
+      //about the job. This is how finished jobs are cleaned up
+      this->Items.erase(i++);
+      }
+    else
+      {
+      ++i;
+      }
+    }
+  return due;
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t StatusCoalescer::timeUntilDue() const
+{
+  //we also wake up for jobs without held progress, so that they are
+  //forgotten, and progress held right after a job was sent is on time
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if(this->Items.empty())
+    {
+    return -1;
+    }
+
+  boost::int64_t next = this->Items.begin()->second.LastSent;
+  for(ItemMap::const_iterator i = this->Items.begin();
+      i != this->Items.end(); ++i)
+    {
+    next = std::min(next, i->second.LastSent);
+    }
+  next += this->Interval;
+  return std::max(boost::int64_t(0), next - StatusCoalescer::now());
+}
+
+//------------------------------------------------------------------------------
+boost::int64_t StatusCoalescer::now()
+{
+  using namespace std::chrono;
+  return static_cast<boost::int64_t>(
+    duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+}
+}
+}
@@ -0,0 +1,93 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#ifndef remus_worker_detail_StatusCoalescer_h
+#define remus_worker_detail_StatusCoalescer_h
+
+#include <remus/proto/JobStatus.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/uuid/uuid.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <map>
+#include <vector>
+
+namespace remus{
+namespace worker{
+namespace detail{
+
+//Coalesces the progress updates of jobs, so that progress of a job is sent
+//to the server at most once per update interval. Threads reporting status
+//ask the coalescer if a status should be sent, and the polling thread of
+//the MessageRouter sends the latest held progress once the interval has
+//passed, even when the worker doesn't send anything else.
+//
+//Times are milliseconds on a monotonic clock, so that changes to the wall
+//clock don't hold back progress. All methods are thread safe.
+class StatusCoalescer
+{
+public:
+  StatusCoalescer();
+
+  //the minimum time in milliseconds between progress updates of a job.
+  //Zero or less sends every update.
+  void interval(boost::int64_t millisec);
+  boost::int64_t interval() const;
+
+  //returns true if the status should be sent now. Progress that arrives
+  //within the interval of the last progress of the job is held instead.
+  //Changes of state are always sent, and replace any held progress
+  bool shouldSend(const remus::proto::JobStatus& status);
+
+  //forget the held progress of a job, used when its result is sent
+  void forget(const boost::uuids::uuid& id);
+
+  //take the held progress whose interval has passed, or all held progress
+  //when force is true. The caller is responsible for sending it
+  std::vector<remus::proto::JobStatus> takeDue(bool force);
+
+  //milliseconds until takeDue has work to do, or -1 when there is nothing
+  //to wait for
+  boost::int64_t timeUntilDue() const;
+
+  //the current time in milliseconds on a monotonic clock
+  static boost::int64_t now();
+
+private:
+  struct Item
+  {
+    boost::int64_t LastSent;
+    remus::proto::JobStatus Latest;
+    bool HaveUnsent;
+
+    Item(boost::int64_t lastSent, const remus::proto::JobStatus& status):
+      LastSent(lastSent), Latest(status), HaveUnsent(false) {}
+  };
+  typedef std::map< boost::uuids::uuid, Item > ItemMap;
+
+  mutable boost::mutex Mutex;
+  boost::int64_t Interval;
+  ItemMap Items;
+
+  //make copying not possible
+  StatusCoalescer(const StatusCoalescer&);
+  void operator=(const StatusCoalescer&);
+};
+
+}
+}
+}
+
+#endif
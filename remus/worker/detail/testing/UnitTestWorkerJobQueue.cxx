@@ -10,18 +10,12 @@
 //
 //=============================================================================
 
-#include <remus/worker/detail/MessageRouter.h>
-
-#include <remus/common/SleepFor.h>
-#include <remus/proto/Message.h>
-#include <remus/proto/Response.h>
 #include <remus/worker/detail/JobQueue.h>
 
-#include <remus/proto/zmq.hpp>
-
 #include <remus/testing/Testing.h>
 
 REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/thread.hpp>
 #include <boost/uuid/uuid.hpp>
 REMUS_THIRDPARTY_POST_INCLUDE
 
@@ -30,39 +24,17 @@ using namespace remus::worker::detail;
 namespace {
 
 //------------------------------------------------------------------------------
-void verify_basic_comms(zmq::context_t& context)
+void verify_basic_queue()
 {
-  zmq::socketInfo<zmq::proto::inproc> queue_channel(
-                                                remus::testing::UniqueString());
-  JobQueue jq(context,queue_channel); //bind the jobqueue to the worker channel
-
-  //we need to pause for some time to all the JobQueue
-  //to properly bind to the socket before we connect
-  while(!jq.isReady())
-    { remus::common::SleepForMillisec(10); }
-
-  //create the socket to send info to the job queue
-  zmq::socket_t jobSocket(context,ZMQ_PAIR);
-  jobSocket.connect(queue_channel.endpoint().c_str());
-
-  zmq::SocketIdentity sid;
-
+  JobQueue jq;
+  REMUS_ASSERT( (jq.isReady()) );
+  REMUS_ASSERT( (!jq.isShutdown()) );
+  REMUS_ASSERT( (jq.size() == 0) );
 
   boost::uuids::uuid jobId = remus::testing::UUIDGenerator();
   remus::worker::Job fakeJob(jobId,
                              remus::proto::JobSubmission());
-
-  {
-  remus::proto::Response r =
-      remus::proto::send_NonBlockingResponse(remus::MAKE_MESH,
-                                             remus::worker::to_string(fakeJob),
-                                             &jobSocket,
-                                             sid);
-  REMUS_ASSERT( (r.isValid()) );
-  }
-
-  while(jq.size()<1){}
-  REMUS_ASSERT( (jq.size()>0) );
+  jq.addJob(fakeJob);
   REMUS_ASSERT( (jq.size()==1) );
 
   //now add multiple more jobs to the queue
@@ -75,101 +47,89 @@ void verify_basic_comms(zmq::context_t& context)
           );
   remus::proto::JobSubmission sub(reqs);
 
-  remus::worker::Job fakeJob2(remus::testing::UUIDGenerator(), sub);
-  remus::worker::Job fakeJob3(remus::testing::UUIDGenerator(), sub);
-
-  {
-  remus::proto::Response r =
-      remus::proto::send_NonBlockingResponse(remus::MAKE_MESH,
-                                             remus::worker::to_string(fakeJob2),
-                                             &jobSocket,
-                                             sid);
-  REMUS_ASSERT( (r.isValid()) );
-  }
-
-  {
-  remus::proto::Response r =
-      remus::proto::send_NonBlockingResponse(remus::MAKE_MESH,
-                                            remus::worker::to_string(fakeJob3),
-                                            &jobSocket,
-                                            sid);
-  REMUS_ASSERT( (r.isValid()) );
-  }
-
-  //now send a terminate job command for the first job
-  //and verify that the correct job was terminated by pulling
-  //all the jobs off the stack
-  {
-  remus::worker::Job terminateJob(jobId,
-                                  remus::proto::JobSubmission());
-  remus::proto::Response r =
-      remus::proto::send_NonBlockingResponse(remus::TERMINATE_JOB,
-                                             remus::worker::to_string(terminateJob),
-                                             &jobSocket,
-                                             sid);
-  REMUS_ASSERT( (r.isValid()) );
-  }
-
-  //gotta wait for all three messages to come in
-  remus::common::SleepForMillisec(2000);
+  std::vector< remus::worker::Job > batch;
+  batch.push_back( remus::worker::Job(remus::testing::UUIDGenerator(), sub) );
+  batch.push_back( remus::worker::Job(remus::testing::UUIDGenerator(), sub) );
+  jq.addJobs(batch);
+  REMUS_ASSERT( (jq.size()==3) );
+  REMUS_ASSERT( (jq.numberOfJobsReceived()==3) );
+
+  //now terminate the first job and verify that the correct job was
+  //terminated by pulling all the jobs off the stack
+  jq.terminateJob(jobId);
 
   REMUS_ASSERT( (jq.isATerminatedJob( fakeJob ) ==true ))
-  REMUS_ASSERT( (jq.isATerminatedJob( fakeJob2 ) ==false ))
-  REMUS_ASSERT( (jq.isATerminatedJob( fakeJob3) ==false ))
+  REMUS_ASSERT( (jq.isATerminatedJob( batch[0] ) ==false ))
+  REMUS_ASSERT( (jq.isATerminatedJob( batch[1] ) ==false ))
+  REMUS_ASSERT( (jq.size()==2) );
+  REMUS_ASSERT( (jq.numberOfJobsReceived()==3) );
 
   while(jq.size()>0)
     {
     remus::worker::Job j = jq.take();
     REMUS_ASSERT( (j.valid() == true) )
+    REMUS_ASSERT( (j.id() != jobId) )
     }
+
+  //taking from an empty queue gives an invalid job
+  REMUS_ASSERT( (jq.take().valid() == false) )
+  REMUS_ASSERT( (jq.waitAndTakeJob(10).valid() == false) )
 }
 
 //------------------------------------------------------------------------------
-void verify_term(zmq::context_t& context)
+void add_job_later(JobQueue* jq, remus::worker::Job job)
 {
-  zmq::socketInfo<zmq::proto::inproc> queue_channel(
-                                                remus::testing::UniqueString());
-  JobQueue jq(context,queue_channel); //bind the jobqueue to the worker channel
-
-  //we need to pause for some time to all the JobQueue
-  //to properly bind to the socket before we connect
-  while(!jq.isReady())
-    { remus::common::SleepForMillisec(10); }
-
-  //create the socket to send info to the job queue
-  zmq::socket_t jobSocket(context,ZMQ_PAIR);
-  jobSocket.connect(queue_channel.endpoint().c_str());
+  boost::this_thread::sleep( boost::posix_time::milliseconds(100) );
+  jq->addJob(job);
+}
 
-  REMUS_ASSERT( (jq.size() == 0) );
+//------------------------------------------------------------------------------
+void verify_wait_for_job()
+{
+  //jobs are added from the MessageRouter thread, so verify a thread
+  //waiting on the queue is woken up when a job arrives
+  JobQueue jq;
+  remus::worker::Job fakeJob(remus::testing::UUIDGenerator(),
+                             remus::proto::JobSubmission());
+  boost::thread producer(add_job_later, &jq, fakeJob);
 
-  //now send it a terminate message over the worker channel
-  remus::worker::Job terminateJob;
-  remus::proto::Response r=
-      remus::proto::send_NonBlockingResponse(remus::TERMINATE_WORKER,
-                                             remus::worker::to_string(terminateJob),
-                                             &jobSocket,
-                                             (zmq::SocketIdentity()));
-  REMUS_ASSERT( (r.isValid()) );
+  remus::worker::Job j = jq.waitAndTakeJob();
+  REMUS_ASSERT( (j.id() == fakeJob.id()) )
+  producer.join();
+}
 
-  //cheap block while we wait for the router thread to get the message
-  while(jq.size()<1){}
+//------------------------------------------------------------------------------
+void verify_term()
+{
+  JobQueue jq;
+  jq.addJob( remus::worker::Job(remus::testing::UUIDGenerator(),
+                                remus::proto::JobSubmission()) );
+  REMUS_ASSERT( (jq.size() == 1) );
+
+  //terminating the worker replaces every job with a terminate job
+  jq.terminateWorker();
+  REMUS_ASSERT( (jq.isShutdown()) );
+  REMUS_ASSERT( (!jq.isReady()) );
+  REMUS_ASSERT( (jq.size() == 1) )
 
+  //once terminated we don't accept new jobs
+  jq.addJob( remus::worker::Job(remus::testing::UUIDGenerator(),
+                                remus::proto::JobSubmission()) );
   REMUS_ASSERT( (jq.size() == 1) )
+
   remus::worker::Job invalid_job = jq.take();
   REMUS_ASSERT( (!invalid_job.valid()) )
   REMUS_ASSERT( (invalid_job.validityReason() ==
                  remus::worker::Job::TERMINATE_WORKER) )
-
 }
 
 }
 
 int UnitTestWorkerJobQueue(int, char *[])
 {
-  zmq::context_t context(1);
-
-  verify_basic_comms(context);
-  verify_term(context);
+  verify_basic_queue();
+  verify_wait_for_job();
+  verify_term();
 
   return 0;
 }
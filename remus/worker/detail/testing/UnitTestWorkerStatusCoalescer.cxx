@@ -0,0 +1,98 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/worker/detail/StatusCoalescer.h>
+
+#include <remus/common/SleepFor.h>
+#include <remus/testing/Testing.h>
+
+using namespace remus::worker::detail;
+
+namespace {
+
+//------------------------------------------------------------------------------
+remus::proto::JobStatus make_progress(const boost::uuids::uuid& id, int value)
+{
+  return remus::proto::JobStatus(id, remus::proto::JobProgress(value));
+}
+
+//------------------------------------------------------------------------------
+void verify_no_interval()
+{
+  StatusCoalescer sc;
+  REMUS_ASSERT( (sc.interval() == 0) );
+  REMUS_ASSERT( (sc.timeUntilDue() == -1) );
+
+  boost::uuids::uuid id = remus::testing::UUIDGenerator();
+  REMUS_ASSERT( (sc.shouldSend(make_progress(id,1))) );
+  REMUS_ASSERT( (sc.shouldSend(make_progress(id,2))) );
+  REMUS_ASSERT( (sc.takeDue(true).empty()) );
+  REMUS_ASSERT( (sc.timeUntilDue() == -1) );
+}
+
+//------------------------------------------------------------------------------
+void verify_held_progress()
+{
+  StatusCoalescer sc;
+  sc.interval(100);
+  boost::uuids::uuid id = remus::testing::UUIDGenerator();
+
+  //the first progress is sent, the following are held
+  REMUS_ASSERT( (sc.shouldSend(make_progress(id,1))) );
+  REMUS_ASSERT( (!sc.shouldSend(make_progress(id,2))) );
+  REMUS_ASSERT( (!sc.shouldSend(make_progress(id,3))) );
+  REMUS_ASSERT( (sc.timeUntilDue() >= 0 && sc.timeUntilDue() <= 100) );
+  REMUS_ASSERT( (sc.takeDue(false).empty()) );
+
+  //once the interval has passed only the latest progress is due
+  remus::common::SleepForMillisec(150);
+  REMUS_ASSERT( (sc.timeUntilDue() == 0) );
+  std::vector<remus::proto::JobStatus> due = sc.takeDue(false);
+  REMUS_ASSERT( (due.size() == 1) );
+  REMUS_ASSERT( (due[0].progress().value() == 3) );
+
+  //a change of state is always sent and drops the held progress
+  REMUS_ASSERT( (!sc.shouldSend(make_progress(id,4))) );
+  remus::proto::JobStatus failed(id, remus::proto::JobProgress("failed"));
+  failed.markAsFailed();
+  REMUS_ASSERT( (sc.shouldSend(failed)) );
+  REMUS_ASSERT( (sc.takeDue(true).empty()) );
+  REMUS_ASSERT( (sc.timeUntilDue() == -1) );
+}
+
+//------------------------------------------------------------------------------
+void verify_forget()
+{
+  StatusCoalescer sc;
+  sc.interval(60000);
+  boost::uuids::uuid id = remus::testing::UUIDGenerator();
+  REMUS_ASSERT( (sc.shouldSend(make_progress(id,1))) );
+  REMUS_ASSERT( (!sc.shouldSend(make_progress(id,2))) );
+
+  //forcing sends the held progress without waiting for the interval
+  REMUS_ASSERT( (sc.takeDue(true).size() == 1) );
+  REMUS_ASSERT( (!sc.shouldSend(make_progress(id,3))) );
+
+  sc.forget(id);
+  REMUS_ASSERT( (sc.takeDue(true).empty()) );
+  REMUS_ASSERT( (sc.timeUntilDue() == -1) );
+}
+
+}
+
+int UnitTestWorkerStatusCoalescer(int, char *[])
+{
+  verify_no_interval();
+  verify_held_progress();
+  verify_forget();
+  return 0;
+}
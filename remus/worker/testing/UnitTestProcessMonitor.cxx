@@ -0,0 +1,239 @@
+//=============================================================================
+//
+//  Copyright (c) Kitware, Inc.
+//  All rights reserved.
+//  See LICENSE.txt for details.
+//
+//  This software is distributed WITHOUT ANY WARRANTY; without even
+//  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//  PURPOSE.  See the above copyright notice for more information.
+//
+//=============================================================================
+
+#include <remus/common/Timer.h>
+#include <remus/proto/zmqHelper.h>
+#include <remus/worker/ProcessMonitor.h>
+#include <remus/worker/ServerConnection.h>
+#include <remus/worker/Worker.h>
+
+#include <remus/testing/Testing.h>
+
+REMUS_THIRDPARTY_PRE_INCLUDE
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+REMUS_THIRDPARTY_POST_INCLUDE
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+using remus::proto::JobProgress;
+using remus::worker::ProcessMonitor;
+
+//a server that records everything the workers send it
+class recording_server
+{
+public:
+  recording_server(zmq::socketInfo<zmq::proto::inproc>& conn,
+                   boost::shared_ptr<zmq::context_t> context):
+    WorkerComm((*context),ZMQ_ROUTER),
+    PollingThread(),
+    ContinuePolling(true),
+    Mutex(),
+    Received()
+  {
+    zmq::bindToAddress(this->WorkerComm, conn);
+    this->PollingThread.reset(
+                    new boost::thread( &recording_server::poll, this) );
+  }
+
+  ~recording_server()
+  {
+    this->ContinuePolling = false;
+    this->PollingThread->join();
+  }
+
+  bool received(const std::string& text)
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    return this->Received.find(text) != std::string::npos;
+  }
+
+private:
+  void poll()
+  {
+    zmq::pollitem_t item  = { this->WorkerComm,  0, ZMQ_POLLIN, 0 };
+    while( this->ContinuePolling )
+      {
+      zmq::poll_safely(&item,1,50);
+      if(item.revents & ZMQ_POLLIN)
+        {
+        zmq::message_t frame;
+        this->WorkerComm.recv(&frame);
+        boost::lock_guard<boost::mutex> lock(this->Mutex);
+        this->Received.append(static_cast<const char*>(frame.data()),
+                              frame.size());
+        }
+      }
+  }
+
+  zmq::socket_t WorkerComm;
+  boost::scoped_ptr<boost::thread> PollingThread;
+  bool ContinuePolling;
+  boost::mutex Mutex;
+  std::string Received;
+};
+
+remus::worker::Job make_job()
+{
+  using namespace remus::meshtypes;
+  remus::common::MeshIOType mtype =
+                        remus::common::make_MeshIOType(Mesh1D(),Mesh3D());
+  remus::proto::JobRequirements r =
+                      remus::proto::make_JobRequirements(mtype," ", " ");
+  return remus::worker::Job(remus::testing::UUIDGenerator(),
+                            remus::proto::JobSubmission(r));
+}
+
+//counts the lines it is given, and finds no progress in them
+bool count_lines(int* count, const std::string&, JobProgress&)
+{
+  ++(*count);
+  return false;
+}
+
+void verify_percent_progress()
+{
+  JobProgress progress;
+  REMUS_ASSERT( (!ProcessMonitor::percentProgress("no progress here", progress)) );
+  REMUS_ASSERT( (!ProcessMonitor::percentProgress("100 % 5", progress)) );
+  REMUS_ASSERT( (!ProcessMonitor::percentProgress("%", progress)) );
+
+  REMUS_ASSERT( (ProcessMonitor::percentProgress("meshing 37%", progress)) );
+  REMUS_ASSERT( (progress.value() == 37) );
+  REMUS_ASSERT( (progress.message() == "meshing 37%") );
+
+  //the last percentage wins, and fractions are truncated
+  REMUS_ASSERT( (ProcessMonitor::percentProgress("vol 10% total 62.8%", progress)) );
+  REMUS_ASSERT( (progress.value() == 62) );
+}
+
+#ifndef _WIN32
+remus::common::ExecuteProcess* make_shell(const std::string& script)
+{
+  std::vector<std::string> args;
+  args.push_back("-c");
+  args.push_back(script);
+  return new remus::common::ExecuteProcess("/bin/sh", args);
+}
+
+void verify_streaming(remus::worker::Worker& worker,
+                      recording_server& server)
+{
+  const std::string logPath("UnitTestProcessMonitor.log");
+
+  boost::scoped_ptr<remus::common::ExecuteProcess> process(make_shell(
+    "echo setup; echo 'meshing 10%'; sleep 1; echo 'meshing 50%';"
+    "echo 'warning: sliver' 1>&2; printf 'done 100%%'"));
+  process->execute();
+
+  ProcessMonitor monitor(worker, make_job());
+  monitor.progressInterval(0);
+  monitor.logFile(logPath);
+  REMUS_ASSERT( (monitor.monitor(*process)) );
+  REMUS_ASSERT( (!monitor.stalled()) );
+  REMUS_ASSERT( (!monitor.terminated()) );
+
+  //the last line is kept even without a newline
+  const std::string tail = monitor.tail();
+  REMUS_ASSERT( (tail.find("setup") == 0) );
+  REMUS_ASSERT( (tail.find("warning: sliver") != std::string::npos) );
+  REMUS_ASSERT( (tail.rfind("done 100%") == tail.size() - 9) );
+
+  //every line made it into the log
+  std::ifstream log(logPath.c_str());
+  std::string line;
+  int lines = 0;
+  while(std::getline(log, line)) { ++lines; }
+  REMUS_ASSERT( (lines == 5) );
+  log.close();
+  std::remove(logPath.c_str());
+
+  //progress was sent while the program ran, and when it finished
+  for(int i=0; i < 40 && !server.received("done 100%"); ++i)
+    {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    }
+  REMUS_ASSERT( (server.received("meshing 10%")) );
+  REMUS_ASSERT( (server.received("meshing 50%")) );
+  REMUS_ASSERT( (server.received("done 100%")) );
+}
+
+void verify_custom_extractor(remus::worker::Worker& worker)
+{
+  boost::scoped_ptr<remus::common::ExecuteProcess> process(make_shell(
+    "echo one; echo two 1>&2; echo three"));
+  process->execute();
+
+  int count = 0;
+  ProcessMonitor monitor(worker, make_job());
+  monitor.progressExtractor(boost::bind(&count_lines, &count, _1, _2));
+  REMUS_ASSERT( (monitor.monitor(*process)) );
+  REMUS_ASSERT( (count == 3) );
+}
+
+void verify_stall_detection(remus::worker::Worker& worker)
+{
+  boost::scoped_ptr<remus::common::ExecuteProcess> process(make_shell(
+    "echo starting; exec sleep 30"));
+  process->execute();
+
+  ProcessMonitor monitor(worker, make_job());
+  monitor.stallTimeout(500);
+
+  remus::common::Timer timer;
+  REMUS_ASSERT( (!monitor.monitor(*process)) );
+  REMUS_ASSERT( (monitor.stalled()) );
+  REMUS_ASSERT( (timer.elapsed() < 10000) );
+  REMUS_ASSERT( (!process->isAlive()) );
+}
+
+void verify_crash(remus::worker::Worker& worker)
+{
+  boost::scoped_ptr<remus::common::ExecuteProcess> process(make_shell(
+    "echo about to crash; kill -9 $$"));
+  process->execute();
+
+  ProcessMonitor monitor(worker, make_job());
+  REMUS_ASSERT( (!monitor.monitor(*process)) );
+  REMUS_ASSERT( (!monitor.stalled()) );
+  REMUS_ASSERT( (monitor.tail() == "about to crash") );
+}
+#endif
+
+}
+
+int UnitTestProcessMonitor(int, char *[])
+{
+  verify_percent_progress();
+
+#ifndef _WIN32
+  using namespace remus::meshtypes;
+  const remus::common::MeshIOType mtype =
+                          remus::common::make_MeshIOType(Mesh1D(),Mesh3D());
+
+  zmq::socketInfo<zmq::proto::inproc> inproc_info("process_monitor");
+  remus::worker::ServerConnection conn(inproc_info);
+  recording_server server(inproc_info, conn.context());
+  remus::worker::Worker worker(mtype, conn);
+
+  verify_streaming(worker, server);
+  verify_custom_extractor(worker);
+  verify_stall_detection(worker);
+  verify_crash(worker);
+#endif
+  return 0;
+}
@@ -181,6 +181,26 @@ void verify_submission()
 
 }
 
+void verify_batch_serialization()
+{
+  std::vector<Job> jobs;
+  remus::proto::JobSubmission sub_with_data = make_empty_sub();
+  sub_with_data["non_default_key"] = remus::proto::make_JobContent("content");
+  jobs.push_back( Job(make_id(),make_empty_sub()) );
+  jobs.push_back( Job(make_id(),sub_with_data) );
+
+  std::vector<Job> from_string =
+                          remus::proto::to_WorkerJobBatch(to_string(jobs));
+  REMUS_ASSERT( (from_string.size() == jobs.size()) );
+  for(std::size_t i=0; i < jobs.size(); ++i)
+    {
+    REMUS_ASSERT( (from_string[i].valid() == true) );
+    REMUS_ASSERT( (from_string[i].id() == jobs[i].id()) );
+    REMUS_ASSERT( (from_string[i].submission() == jobs[i].submission()) );
+    }
+  REMUS_ASSERT( (from_string[1].details("non_default_key") == "content") );
+}
+
 } //namespace
 
 
@@ -190,5 +210,6 @@ int UnitTestWorkerJob(int, char *[])
   verify_validity();
   verify_meshTypes();
   verify_submission();
+  verify_batch_serialization();
   return 0;
 }